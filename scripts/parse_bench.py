@@ -1,19 +1,28 @@
 #!/usr/bin/env python3
 """
-Simple benchmark JSON parser for services/order-matching-engine/out/bench_results.json
-Computes percentiles (p50/p90/p99/p99.9) from iteration real_time values and
-writes a small markdown snippet to services/order-matching-engine/bench_summary.md
-and prints the snippet to stdout.
+Benchmark JSON parser for services/order-matching-engine/out/bench_results.json
+(order_bench --benchmark_out_format=json, or --benchmark_format=json > file).
+
+Benchmarks that sample per-operation latency report p50_ns / p99_ns /
+p99.9_ns / max_ns counters; those are tabulated as-is (with repetitions, the
+median across repetitions is used). Benchmarks without them fall back to
+percentiles of the per-repetition real_time values.
+
+Writes a markdown summary to services/order-matching-engine/bench_summary.md
+and prints it to stdout. An optional second argument filters benchmark names
+by substring.
 """
 import json
 import math
 import sys
+from collections import OrderedDict
 from pathlib import Path
 
 if len(sys.argv) > 1:
     in_path = Path(sys.argv[1])
 else:
     in_path = Path('services/order-matching-engine/out/bench_results.json')
+name_filter = sys.argv[2] if len(sys.argv) > 2 else ''
 
 if not in_path.exists():
     print(f"Bench JSON not found at {in_path.resolve()}")
@@ -21,18 +30,9 @@ if not in_path.exists():
 
 j = json.loads(in_path.read_text())
 
-# find iteration entries for the BM_AddOrderAndMatch benchmark
-values = []
-for b in j.get('benchmarks', []):
-    if b.get('run_type') == 'iteration' and 'BM_AddOrderAndMatch' in b.get('name', ''):
-        # real_time is in the unit given by time_unit (we'll assume microseconds 'us')
-        values.append(float(b.get('real_time')))
-
-if not values:
-    print('No iteration values found for BM_AddOrderAndMatch')
-    raise SystemExit(3)
+PERCENTILE_COUNTERS = ('p50_ns', 'p99_ns', 'p99.9_ns', 'max_ns')
+UNIT_TO_NS = {'ns': 1.0, 'us': 1e3, 'ms': 1e6, 's': 1e9}
 
-values.sort()
 
 def percentile(data, p):
     if not data:
@@ -46,29 +46,65 @@ def percentile(data, p):
     d1 = data[int(c)] * (k-f)
     return d0 + d1
 
-p50 = percentile(values, 50)
-p90 = percentile(values, 90)
-p99 = percentile(values, 99)
-p999 = percentile(values, 99.9)
-mean = sum(values)/len(values)
+
+def median(values):
+    return percentile(sorted(values), 50)
+
+
+def fmt_ns(ns):
+    if ns is None:
+        return '-'
+    if ns >= 1e6:
+        return f"{ns / 1e6:.2f} ms"
+    if ns >= 1e3:
+        return f"{ns / 1e3:.2f} µs"
+    return f"{ns:.0f} ns"
+
+
+# Group iteration runs (one per repetition) by benchmark name
+runs = OrderedDict()
+for b in j.get('benchmarks', []):
+    if b.get('run_type', 'iteration') != 'iteration':
+        continue
+    name = b.get('run_name') or b.get('name', '')
+    if name_filter and name_filter not in name:
+        continue
+    runs.setdefault(name, []).append(b)
+
+if not runs:
+    print('No iteration results found' + (f" matching '{name_filter}'" if name_filter else ''))
+    raise SystemExit(3)
+
+sampled_rows = []
+timed_rows = []
+for name, entries in runs.items():
+    if all(c in entries[0] for c in PERCENTILE_COUNTERS):
+        row = [name] + [median([float(e[c]) for e in entries]) for c in PERCENTILE_COUNTERS]
+        row.append(int(median([float(e.get('samples', e.get('iterations', 0))) for e in entries])))
+        sampled_rows.append(row)
+    else:
+        scale = UNIT_TO_NS.get(entries[0].get('time_unit', 'ns'), 1.0)
+        values = sorted(float(e.get('real_time')) * scale for e in entries)
+        timed_rows.append([name, percentile(values, 50), percentile(values, 90), percentile(values, 99),
+                           sum(values) / len(values), len(values)])
 
 ctx = j.get('context', {})
 host = ctx.get('host_name') or ctx.get('host') or 'unknown'
 date = ctx.get('date', 'unknown')
 cpus = ctx.get('num_cpus', ctx.get('cpus', 'unknown'))
 
-md = f"""
-## Benchmark summary (computed)
-
-| Metric | Value |
-|---|---:|
-| p50 | {p50:.6f} µs |
-| p90 | {p90:.6f} µs |
-| p99 | {p99:.6f} µs |
-| p99.9 | {p999:.6f} µs |
-| mean | {mean:.6f} µs |
-| samples | {len(values)} |
-
+md = "\n## Benchmark summary (computed)\n"
+if sampled_rows:
+    md += "\nPer-operation latency:\n\n"
+    md += "| Benchmark | p50 | p99 | p99.9 | max | samples |\n|---|---:|---:|---:|---:|---:|\n"
+    for name, p50, p99, p999, mx, samples in sampled_rows:
+        md += f"| {name} | {fmt_ns(p50)} | {fmt_ns(p99)} | {fmt_ns(p999)} | {fmt_ns(mx)} | {samples} |\n"
+if timed_rows:
+    md += "\nMean time per iteration, distribution across repetitions:\n\n"
+    md += "| Benchmark | p50 | p90 | p99 | mean | repetitions |\n|---|---:|---:|---:|---:|---:|\n"
+    for name, p50, p90, p99, mean, count in timed_rows:
+        md += f"| {name} | {fmt_ns(p50)} | {fmt_ns(p90)} | {fmt_ns(p99)} | {fmt_ns(mean)} | {count} |\n"
+md += f"""
 Context:
 
 - host: `{host}`
@@ -81,7 +117,3 @@ out_path.parent.mkdir(parents=True, exist_ok=True)
 out_path.write_text(md)
 print(md)
 print(f"Wrote summary to {out_path}")
-
-if __name__ == '__main__' and len(sys.argv) > 1:
-    # If run with explicit path, we already executed above; just exit cleanly
-    pass
@@ -0,0 +1,218 @@
+#include "logger.h"
+#include <ctime>
+
+namespace warpspeed {
+
+namespace {
+
+constexpr size_t kThreadBufferBytes = 256 * 1024;
+constexpr auto kWriterPoll = std::chrono::milliseconds(1);
+
+// Registers the calling thread's buffer on first use and marks it closed on
+// thread exit so the writer can drop it once drained.
+struct ThreadBufferHandle {
+    std::shared_ptr<LogBuffer> buffer;
+    ~ThreadBufferHandle() {
+        if (buffer) buffer->closed.store(true, std::memory_order_release);
+    }
+};
+
+thread_local ThreadBufferHandle tls_buffer;
+
+size_t round_up_pow2(size_t value) {
+    size_t result = 1;
+    while (result < value) result <<= 1;
+    return result;
+}
+
+template <typename V>
+V take(const char*& in) {
+    V value;
+    std::memcpy(&value, in, sizeof(value));
+    in += sizeof(value);
+    return value;
+}
+
+void append_arg(std::string& out, const char*& in) {
+    auto tag = static_cast<log_detail::ArgTag>(*in++);
+    char scratch[32];
+    switch (tag) {
+        case log_detail::ArgTag::INT:
+            out.append(scratch, std::snprintf(scratch, sizeof(scratch), "%lld", static_cast<long long>(take<int64_t>(in))));
+            break;
+        case log_detail::ArgTag::UINT:
+            out.append(scratch, std::snprintf(scratch, sizeof(scratch), "%llu", static_cast<unsigned long long>(take<uint64_t>(in))));
+            break;
+        case log_detail::ArgTag::DOUBLE:
+            out.append(scratch, std::snprintf(scratch, sizeof(scratch), "%g", take<double>(in)));
+            break;
+        case log_detail::ArgTag::BOOL:
+            out += take<uint8_t>(in) ? "true" : "false";
+            break;
+        case log_detail::ArgTag::CHAR:
+            out += take<char>(in);
+            break;
+        case log_detail::ArgTag::STRING: {
+            uint16_t length = take<uint16_t>(in);
+            out.append(in, length);
+            in += length;
+            break;
+        }
+    }
+}
+
+}
+
+LogBuffer::LogBuffer(size_t capacity)
+    : data_(), mask_(round_up_pow2(std::max(capacity, size_t(1024))) - 1), head_(0), cached_head_(0), tail_(0) {
+    data_ = std::make_unique<char[]>(mask_ + 1);
+}
+
+char* LogBuffer::reserve(size_t bytes) {
+    const size_t capacity = mask_ + 1;
+    if (bytes > capacity / 4) return nullptr;
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    size_t offset = tail & mask_;
+    size_t contiguous = capacity - offset;
+    size_t needed = bytes > contiguous ? contiguous + bytes : bytes;
+    if (capacity - (tail - cached_head_) < needed) {
+        cached_head_ = head_.load(std::memory_order_acquire);
+        if (capacity - (tail - cached_head_) < needed) return nullptr;
+    }
+    if (bytes > contiguous) {
+        uint32_t pad[2] = {static_cast<uint32_t>(contiguous), log_detail::kPadRecord};
+        std::memcpy(data_.get() + offset, pad, sizeof(pad));
+        tail_.store(tail + contiguous, std::memory_order_release);
+        offset = 0;
+    }
+    return data_.get() + offset;
+}
+
+Logger& Logger::instance() {
+    static Logger logger;
+    return logger;
+}
+
+Logger::Logger()
+    : output_(stdout), dropped_(0), dropped_reported_(0), passes_(0), flush_requested_(false), stopping_(false) {
+    writer_ = std::thread([this] { writer_loop(); });
+}
+
+Logger::~Logger() {
+    stopping_.store(true, std::memory_order_release);
+    writer_.join();
+}
+
+const char* Logger::level_name(LogLevel level) {
+    switch (level) {
+        case LogLevel::TRACE: return "TRACE";
+        case LogLevel::DEBUG: return "DEBUG";
+        case LogLevel::INFO: return "INFO";
+        case LogLevel::WARN: return "WARN";
+        case LogLevel::ERROR: return "ERROR";
+        case LogLevel::OFF: return "OFF";
+    }
+    return "?";
+}
+
+bool Logger::parse_level(std::string_view name, LogLevel& level) {
+    if (name == "trace") level = LogLevel::TRACE;
+    else if (name == "debug") level = LogLevel::DEBUG;
+    else if (name == "info") level = LogLevel::INFO;
+    else if (name == "warn") level = LogLevel::WARN;
+    else if (name == "error") level = LogLevel::ERROR;
+    else if (name == "off") level = LogLevel::OFF;
+    else return false;
+    return true;
+}
+
+LogBuffer* Logger::thread_buffer() {
+    if (!tls_buffer.buffer) {
+        tls_buffer.buffer = std::make_shared<LogBuffer>(kThreadBufferBytes);
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        buffers_.push_back(tls_buffer.buffer);
+    }
+    return tls_buffer.buffer.get();
+}
+
+void Logger::flush() {
+    std::vector<std::pair<std::shared_ptr<LogBuffer>, size_t>> targets;
+    {
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        for (const auto& buffer : buffers_) targets.emplace_back(buffer, buffer->produced());
+    }
+    flush_requested_.store(true, std::memory_order_release);
+    for (const auto& target : targets) {
+        while (target.first->consumed() < target.second) std::this_thread::yield();
+    }
+    uint64_t pass = passes_.load(std::memory_order_acquire);
+    flush_requested_.store(true, std::memory_order_release);
+    while (passes_.load(std::memory_order_acquire) <= pass) std::this_thread::yield();
+}
+
+void Logger::format_record(const char* record) {
+    log_detail::RecordHeader header;
+    std::memcpy(&header, record, sizeof(header));
+    const char* args = record + sizeof(header);
+
+    std::time_t seconds = static_cast<std::time_t>(header.timestamp_ns / 1000000000);
+    std::tm utc;
+    gmtime_r(&seconds, &utc);
+    char prefix[64];
+    size_t length = std::strftime(prefix, sizeof(prefix), "%Y-%m-%dT%H:%M:%S", &utc);
+    length += std::snprintf(prefix + length, sizeof(prefix) - length, ".%06lldZ %-5s ",
+                            static_cast<long long>(header.timestamp_ns % 1000000000 / 1000),
+                            level_name(header.site->level));
+    pending_.append(prefix, length);
+
+    uint32_t remaining = header.arg_count;
+    for (const char* f = header.site->format; *f; ++f) {
+        if (f[0] == '{' && f[1] == '}' && remaining > 0) {
+            append_arg(pending_, args);
+            --remaining;
+            ++f;
+        } else {
+            pending_ += *f;
+        }
+    }
+    pending_ += '\n';
+}
+
+bool Logger::drain_all() {
+    size_t records = 0;
+    {
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        for (auto it = buffers_.begin(); it != buffers_.end();) {
+            bool closed = (*it)->closed.load(std::memory_order_acquire);
+            records += (*it)->drain([this](const char* record) { format_record(record); });
+            if (closed) it = buffers_.erase(it);
+            else ++it;
+        }
+    }
+    uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+    if (dropped != dropped_reported_) {
+        pending_ += "WARN  [logger] dropped " + std::to_string(dropped - dropped_reported_) +
+                    " message(s): thread log buffer full\n";
+        dropped_reported_ = dropped;
+    }
+    if (!pending_.empty()) {
+        std::FILE* out = output_.load(std::memory_order_acquire);
+        std::fwrite(pending_.data(), 1, pending_.size(), out);
+        std::fflush(out);
+        pending_.clear();
+    }
+    return records > 0;
+}
+
+void Logger::writer_loop() {
+    while (true) {
+        bool stopping = stopping_.load(std::memory_order_acquire);
+        bool busy = drain_all();
+        passes_.fetch_add(1, std::memory_order_release);
+        if (stopping) return;
+        if (busy || flush_requested_.exchange(false, std::memory_order_acq_rel)) continue;
+        std::this_thread::sleep_for(kWriterPoll);
+    }
+}
+
+}
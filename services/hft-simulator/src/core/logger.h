@@ -0,0 +1,234 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace warpspeed {
+
+enum class LogLevel : uint8_t {
+    TRACE,
+    DEBUG,
+    INFO,
+    WARN,
+    ERROR,
+    OFF
+};
+
+// One per call site (a static in WS_LOG). Its address is the record's
+// format id: the hot path never copies the format string.
+struct LogSite {
+    LogLevel level;
+    const char* format;  // "{}" placeholders, filled in order
+};
+
+namespace log_detail {
+
+enum class ArgTag : uint8_t { INT, UINT, DOUBLE, BOOL, CHAR, STRING };
+
+constexpr size_t kMaxStringArg = 256;  // longer string arguments are truncated
+
+struct RecordHeader {
+    uint32_t size;       // whole record, header included, rounded up to 8 bytes
+    uint32_t arg_count;  // kPadRecord for the filler written before a wrap
+    const LogSite* site;
+    int64_t timestamp_ns;
+};
+constexpr uint32_t kPadRecord = 0xFFFFFFFFu;
+
+inline std::string_view string_arg(const char* value) { return value ? std::string_view(value) : std::string_view("(null)"); }
+inline std::string_view string_arg(std::string_view value) { return value; }
+inline std::string_view string_arg(const std::string& value) { return value; }
+
+template <typename T>
+size_t arg_size(const T& value) {
+    using U = std::decay_t<T>;
+    if constexpr (std::is_same_v<U, bool> || std::is_same_v<U, char>) {
+        return 2;
+    } else if constexpr (std::is_arithmetic_v<U> || std::is_enum_v<U>) {
+        return 9;
+    } else {
+        return 3 + std::min(string_arg(value).size(), kMaxStringArg);
+    }
+}
+
+template <typename V>
+inline void put(char*& out, ArgTag tag, const V& value) {
+    *out++ = static_cast<char>(tag);
+    std::memcpy(out, &value, sizeof(value));
+    out += sizeof(value);
+}
+
+template <typename T>
+void encode_arg(char*& out, const T& value) {
+    using U = std::decay_t<T>;
+    if constexpr (std::is_same_v<U, bool>) {
+        put(out, ArgTag::BOOL, static_cast<uint8_t>(value));
+    } else if constexpr (std::is_same_v<U, char>) {
+        put(out, ArgTag::CHAR, value);
+    } else if constexpr (std::is_enum_v<U>) {
+        put(out, ArgTag::INT, static_cast<int64_t>(value));
+    } else if constexpr (std::is_floating_point_v<U>) {
+        put(out, ArgTag::DOUBLE, static_cast<double>(value));
+    } else if constexpr (std::is_integral_v<U> && std::is_signed_v<U>) {
+        put(out, ArgTag::INT, static_cast<int64_t>(value));
+    } else if constexpr (std::is_integral_v<U>) {
+        put(out, ArgTag::UINT, static_cast<uint64_t>(value));
+    } else {
+        std::string_view text = string_arg(value);
+        uint16_t length = static_cast<uint16_t>(std::min(text.size(), kMaxStringArg));
+        put(out, ArgTag::STRING, length);
+        std::memcpy(out, text.data(), length);
+        out += length;
+    }
+}
+
+}
+
+// Single-producer / single-consumer byte ring holding one thread's encoded
+// records. Records never straddle the end: a pad record fills the tail and
+// the next record starts at offset 0.
+class LogBuffer {
+public:
+    explicit LogBuffer(size_t capacity);
+
+    LogBuffer(const LogBuffer&) = delete;
+    LogBuffer& operator=(const LogBuffer&) = delete;
+
+    size_t produced() const { return tail_.load(std::memory_order_acquire); }
+    size_t consumed() const { return head_.load(std::memory_order_acquire); }
+
+    // Producer. Contiguous space for `bytes` (a multiple of 8), or nullptr
+    // if the consumer has not caught up.
+    char* reserve(size_t bytes);
+    void commit(size_t bytes) { tail_.store(tail_.load(std::memory_order_relaxed) + bytes, std::memory_order_release); }
+
+    // Consumer. Calls fn(record) for every committed record, then frees them.
+    template <typename Fn>
+    size_t drain(Fn&& fn) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        size_t tail = tail_.load(std::memory_order_acquire);
+        size_t records = 0;
+        while (head != tail) {
+            const char* record = data_.get() + (head & mask_);
+            uint32_t size;
+            uint32_t arg_count;
+            std::memcpy(&size, record, sizeof(size));
+            std::memcpy(&arg_count, record + sizeof(size), sizeof(arg_count));
+            if (arg_count != log_detail::kPadRecord) {
+                fn(record);
+                ++records;
+            }
+            head += size;
+        }
+        head_.store(head, std::memory_order_release);
+        return records;
+    }
+
+    std::atomic<bool> closed{false};  // owning thread has exited
+
+private:
+    std::unique_ptr<char[]> data_;
+    size_t mask_;
+    alignas(64) std::atomic<size_t> head_;
+    size_t cached_head_;
+    alignas(64) std::atomic<size_t> tail_;
+};
+
+// Asynchronous logger. The calling thread copies the call site pointer, a
+// timestamp and the raw argument values into its own LogBuffer; a background
+// thread formats and writes them. A disabled level costs one relaxed load and
+// the arguments are not evaluated. A full buffer drops the record (counted
+// and reported) rather than stall the caller.
+class Logger {
+public:
+    static Logger& instance();
+
+    static bool enabled(LogLevel level) { return level >= level_.load(std::memory_order_relaxed); }
+    static void set_level(LogLevel level) { level_.store(level, std::memory_order_relaxed); }
+    static LogLevel level() { return level_.load(std::memory_order_relaxed); }
+    static const char* level_name(LogLevel level);
+    // trace, debug, info, warn, error, off
+    static bool parse_level(std::string_view name, LogLevel& level);
+
+    template <typename... Args>
+    void log(const LogSite& site, const Args&... args);
+
+    void set_output(std::FILE* out) { output_.store(out, std::memory_order_release); }
+    // Block until everything logged before the call has been written out
+    void flush();
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+    ~Logger();
+
+private:
+    Logger();
+
+    static inline std::atomic<LogLevel> level_{LogLevel::INFO};
+
+    std::mutex buffers_mutex_;
+    std::vector<std::shared_ptr<LogBuffer>> buffers_;
+    std::atomic<std::FILE*> output_;
+    std::atomic<uint64_t> dropped_;
+    uint64_t dropped_reported_;
+    std::atomic<uint64_t> passes_;
+    std::atomic<bool> flush_requested_;
+    std::atomic<bool> stopping_;
+    std::string pending_;
+    std::thread writer_;
+
+    LogBuffer* thread_buffer();
+    void writer_loop();
+    bool drain_all();
+    void format_record(const char* record);
+};
+
+template <typename... Args>
+void Logger::log(const LogSite& site, const Args&... args) {
+    size_t bytes = sizeof(log_detail::RecordHeader) + (size_t(0) + ... + log_detail::arg_size(args));
+    bytes = (bytes + 7) & ~size_t(7);
+    LogBuffer* buffer = thread_buffer();
+    char* out = buffer->reserve(bytes);
+    if (!out) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    log_detail::RecordHeader header;
+    header.size = static_cast<uint32_t>(bytes);
+    header.arg_count = static_cast<uint32_t>(sizeof...(Args));
+    header.site = &site;
+    header.timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                              std::chrono::system_clock::now().time_since_epoch()).count();
+    std::memcpy(out, &header, sizeof(header));
+    [[maybe_unused]] char* cursor = out + sizeof(header);  // unused when there are no arguments
+    (log_detail::encode_arg(cursor, args), ...);
+    buffer->commit(bytes);
+}
+
+}
+
+// WS_LOG(LogLevel::INFO, "cancel {}", id). Arguments are only evaluated when
+// the level is enabled.
+#define WS_LOG(level, format, ...)                                                  \
+    do {                                                                            \
+        if (::warpspeed::Logger::enabled(level)) {                                  \
+            static constexpr ::warpspeed::LogSite ws_log_site_{level, format};      \
+            ::warpspeed::Logger::instance().log(ws_log_site_, ##__VA_ARGS__);       \
+        }                                                                           \
+    } while (0)
+
+#define WS_LOG_TRACE(format, ...) WS_LOG(::warpspeed::LogLevel::TRACE, format, ##__VA_ARGS__)
+#define WS_LOG_DEBUG(format, ...) WS_LOG(::warpspeed::LogLevel::DEBUG, format, ##__VA_ARGS__)
+#define WS_LOG_INFO(format, ...) WS_LOG(::warpspeed::LogLevel::INFO, format, ##__VA_ARGS__)
+#define WS_LOG_WARN(format, ...) WS_LOG(::warpspeed::LogLevel::WARN, format, ##__VA_ARGS__)
+#define WS_LOG_ERROR(format, ...) WS_LOG(::warpspeed::LogLevel::ERROR, format, ##__VA_ARGS__)
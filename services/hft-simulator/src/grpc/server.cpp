@@ -1,5 +1,6 @@
 #include "server.h"
 #include <chrono>
+#include "../core/logger.h"
 
 namespace warpspeed {
 
@@ -15,8 +16,7 @@ HFTServiceImpl::~HFTServiceImpl() {
     matching_engine_.stop();
 }
 grpc::Status HFTServiceImpl::CancelOrder(grpc::ServerContext* context, const warpspeed::CancelRequest* request, warpspeed::CancelResponse* response) {
-    std::cout << "[Server] Received cancel request for Order ID: " << request->order_id() << std::endl;
-    
+    WS_LOG_DEBUG("[Server] Received cancel request for Order ID: {}", request->order_id());
 
     bool success = matching_engine_.cancel_order(request->order_id());
 
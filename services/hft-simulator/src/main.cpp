@@ -1,7 +1,10 @@
 #include <iostream>
 #include <csignal>
+#include <cstdlib>
+#include <stdexcept>
 #include <grpcpp/grpcpp.h>
 #include "grpc/server.h" 
+#include "core/logger.h"
 
 namespace {
     volatile std::sig_atomic_t gSignalStatus = 0;
@@ -16,10 +19,19 @@ int main(int argc, char** argv) {
         std::signal(SIGINT, signal_handler);
         std::signal(SIGTERM, signal_handler);
 
+        const char* log_level = std::getenv("WARPSPEED_LOG_LEVEL");
+        if (log_level && *log_level) {
+            warpspeed::LogLevel level;
+            if (!warpspeed::Logger::parse_level(log_level, level)) {
+                throw std::runtime_error(std::string("Invalid WARPSPEED_LOG_LEVEL: ") + log_level);
+            }
+            warpspeed::Logger::set_level(level);
+        }
+
         const std::string server_address("0.0.0.0:50052");
         
-        std::cout << "WarpSpeed HFT Simulator" << std::endl;
-        std::cout << "Starting gRPC server on " << server_address << std::endl;
+        WS_LOG_INFO("WarpSpeed HFT Simulator");
+        WS_LOG_INFO("Starting gRPC server on {}", server_address);
 
         // Create and start the server
         warpspeed::HFTServer server(server_address);
@@ -35,14 +47,15 @@ int main(int argc, char** argv) {
         }
 
         // Graceful shutdown
-        std::cout << "\nShutting down server..." << std::endl;
+        WS_LOG_INFO("Shutting down server...");
         server.stop();
         
         if (server_thread.joinable()) {
             server_thread.join();
         }
 
-        std::cout << "Server shutdown complete." << std::endl;
+        WS_LOG_INFO("Server shutdown complete.");
+        warpspeed::Logger::instance().flush();
         return 0;
 
     } catch (const std::exception& e) {
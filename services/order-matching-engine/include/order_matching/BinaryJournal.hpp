@@ -0,0 +1,350 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "Logger.hpp"
+#include "MappedFile.hpp"
+#include "MpscRing.hpp"
+
+namespace tradeflow {
+
+// File header written once when a journal file is created. The magic names
+// the record type; record_size lets readers reject a layout they don't know.
+struct JournalFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+};
+static_assert(sizeof(JournalFileHeader) == 16, "JournalFileHeader is a fixed 16-byte on-disk layout");
+
+// When the writer makes appended records durable.
+enum class JournalSync {
+    NONE,          // leave it to the OS page cache
+    GROUP_COMMIT,  // fdatasync at most once per group_commit_us while records are pending
+    EVERY_BATCH    // fdatasync after every batched write
+};
+
+struct JournalConfig {
+    size_t ring_capacity = 65536;      // records buffered between matching and the writer
+    size_t batch_records = 1024;       // records per write() call at most
+    JournalSync sync = JournalSync::GROUP_COMMIT;
+    uint32_t group_commit_us = 1000;   // GROUP_COMMIT: longest a written record waits for fdatasync
+    uint32_t idle_sleep_us = 200;      // writer poll interval when the ring is empty
+};
+
+struct JournalStats {
+    uint64_t records_written;
+    uint64_t writes;           // write() batches
+    uint64_t syncs;            // fdatasync calls
+    uint64_t ring_full_waits;  // appends that had to wait for the writer
+    uint64_t write_errors;     // batches lost to a failed write() or fdatasync, or dropped after one
+};
+
+// An append-only journal file of fixed-size records. Opening an existing
+// file checks its header and trims a torn trailing record left by a crash,
+// so new appends stay record-aligned.
+class JournalFile {
+public:
+    JournalFile(const std::string& path, const char* magic, uint32_t version, uint32_t record_size);
+    ~JournalFile();
+
+    JournalFile(const JournalFile&) = delete;
+    JournalFile& operator=(const JournalFile&) = delete;
+
+    // Throws on failure
+    void write(const void* data, size_t bytes);
+    void sync();
+    const std::string& path() const { return path_; }
+
+private:
+    std::string path_;
+    int fd_;
+};
+
+// Checks a mapped journal's header; returns the number of complete records.
+size_t validateJournal(const MappedFile& file, const char* magic, uint32_t version, uint32_t record_size);
+// N for every file in dir named <prefix>N<suffix>, ascending (segment and
+// snapshot files are numbered this way).
+std::vector<uint64_t> listNumberedFiles(const std::string& dir, const std::string& prefix, const std::string& suffix);
+
+// Asynchronous journal of fixed-size, trivially copyable records. Producers
+// push into a lock-free MPSC ring and return immediately; a background
+// writer drains the ring into large sequential write()s and applies the
+// sync policy. A full ring makes append() wait for the writer rather than
+// drop a record. rotate() moves later appends to a new file without
+// stopping producers.
+//
+// A failed write or sync is sticky: a short write may have left a torn
+// record, so the writer stops appending to the file, keeps draining the
+// ring so producers never wedge, and flush() and rotate() throw the error.
+template <typename Record>
+class BinaryJournal {
+    static_assert(std::is_trivially_copyable_v<Record>, "journal records are written as raw bytes");
+
+public:
+    BinaryJournal(const std::string& path, const char* magic, uint32_t version,
+                  const JournalConfig& config = JournalConfig());
+    ~BinaryJournal();
+
+    BinaryJournal(const BinaryJournal&) = delete;
+    BinaryJournal& operator=(const BinaryJournal&) = delete;
+
+    // Any thread; wait-free unless the ring is full
+    void append(const Record& record);
+    // Block until everything appended before the call has been written (and
+    // synced, unless the policy is NONE). Throws once the journal has failed
+    // and the wait can never finish.
+    void flush();
+    // Switch to a new file at path. Records appended before the call are in
+    // the old file (synced) or the new one; everything appended after the
+    // call returns goes to the new one. Throws, and keeps the current file,
+    // if path cannot be opened or the journal has failed.
+    void rotate(const std::string& path);
+
+    bool failed() const { return failed_.load(std::memory_order_acquire); }
+    std::string path() const;
+    JournalStats stats() const;
+
+private:
+    const char* magic_;
+    uint32_t version_;
+    JournalConfig config_;
+    std::unique_ptr<JournalFile> file_;  // writer thread only, after construction
+    MpscRing<Record> ring_;
+    std::atomic<uint64_t> durable_;  // ring positions written and synced per policy
+    std::atomic<uint64_t> writes_;
+    std::atomic<uint64_t> syncs_;
+    std::atomic<uint64_t> ring_full_waits_;
+    std::atomic<uint64_t> write_errors_;
+    std::atomic<bool> flush_requested_;
+    std::atomic<bool> stopping_;
+    std::atomic<bool> failed_;
+    std::string error_;  // set once by the writer before failed_
+
+    // rotate() hand-off to the writer thread
+    std::mutex rotate_call_mutex_;     // one rotate() at a time
+    mutable std::mutex rotate_mutex_;  // guards the strings below
+    std::atomic<bool> rotate_pending_;
+    std::string rotate_path_;
+    std::string rotate_error_;
+    std::string path_;
+
+    std::thread writer_;
+
+    void writerLoop();
+    void switchFile();
+    void fail(const char* what, size_t lost);
+    void throwIfFailed() const;
+};
+
+template <typename Record>
+BinaryJournal<Record>::BinaryJournal(const std::string& path, const char* magic, uint32_t version,
+                                     const JournalConfig& config)
+    : magic_(magic), version_(version), config_(config),
+      file_(std::make_unique<JournalFile>(path, magic, version, static_cast<uint32_t>(sizeof(Record)))),
+      ring_(config.ring_capacity), durable_(0), writes_(0), syncs_(0), ring_full_waits_(0), write_errors_(0),
+      flush_requested_(false), stopping_(false), failed_(false), error_(), rotate_call_mutex_(), rotate_mutex_(),
+      rotate_pending_(false), rotate_path_(), rotate_error_(), path_(path), writer_() {
+    if (config_.batch_records == 0) config_.batch_records = 1;
+    writer_ = std::thread([this] { writerLoop(); });
+}
+
+template <typename Record>
+BinaryJournal<Record>::~BinaryJournal() {
+    stopping_.store(true, std::memory_order_release);
+    writer_.join();
+}
+
+template <typename Record>
+void BinaryJournal<Record>::append(const Record& record) {
+    if (!ring_.tryPush(record)) {
+        // Back-pressure: the writer is behind, wait for it rather than lose a record
+        ring_full_waits_.fetch_add(1, std::memory_order_relaxed);
+        while (!ring_.tryPush(record)) std::this_thread::yield();
+    }
+}
+
+template <typename Record>
+void BinaryJournal<Record>::flush() {
+    // The writer pops in ring order, so once it has written up to the current
+    // claim mark every append that returned before this call is on disk.
+    uint64_t target = ring_.claimed();
+    if (durable_.load(std::memory_order_acquire) >= target) return;
+    flush_requested_.store(true, std::memory_order_release);
+    while (durable_.load(std::memory_order_acquire) < target) {
+        throwIfFailed();
+        std::this_thread::yield();
+    }
+}
+
+template <typename Record>
+void BinaryJournal<Record>::rotate(const std::string& path) {
+    std::lock_guard<std::mutex> call(rotate_call_mutex_);
+    {
+        std::lock_guard<std::mutex> lock(rotate_mutex_);
+        rotate_path_ = path;
+        rotate_error_.clear();
+    }
+    rotate_pending_.store(true, std::memory_order_release);
+    flush_requested_.store(true, std::memory_order_release);
+    // Rare (once per snapshot), so wait the same way flush() does
+    while (rotate_pending_.load(std::memory_order_acquire)) std::this_thread::yield();
+    std::lock_guard<std::mutex> lock(rotate_mutex_);
+    if (!rotate_error_.empty()) throw std::runtime_error(rotate_error_);
+}
+
+template <typename Record>
+void BinaryJournal<Record>::throwIfFailed() const {
+    if (failed_.load(std::memory_order_acquire)) throw std::runtime_error(error_);
+}
+
+template <typename Record>
+std::string BinaryJournal<Record>::path() const {
+    std::lock_guard<std::mutex> lock(rotate_mutex_);
+    return path_;
+}
+
+template <typename Record>
+JournalStats BinaryJournal<Record>::stats() const {
+    JournalStats stats;
+    stats.records_written = durable_.load(std::memory_order_relaxed);
+    stats.writes = writes_.load(std::memory_order_relaxed);
+    stats.syncs = syncs_.load(std::memory_order_relaxed);
+    stats.ring_full_waits = ring_full_waits_.load(std::memory_order_relaxed);
+    stats.write_errors = write_errors_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+// Writer thread, with everything written so far synced
+template <typename Record>
+void BinaryJournal<Record>::switchFile() {
+    std::lock_guard<std::mutex> lock(rotate_mutex_);
+    if (failed_.load(std::memory_order_relaxed)) {
+        // Records appended before the rotation were lost; a fresh file
+        // would hide the gap from recovery
+        rotate_error_ = error_;
+        rotate_pending_.store(false, std::memory_order_release);
+        return;
+    }
+    try {
+        file_ = std::make_unique<JournalFile>(rotate_path_, magic_, version_, static_cast<uint32_t>(sizeof(Record)));
+        path_ = rotate_path_;
+    } catch (const std::exception& e) {
+        rotate_error_ = e.what();
+    }
+    rotate_pending_.store(false, std::memory_order_release);
+}
+
+// Writer thread
+template <typename Record>
+void BinaryJournal<Record>::fail(const char* what, size_t lost) {
+    write_errors_.fetch_add(1, std::memory_order_relaxed);
+    error_ = what;
+    failed_.store(true, std::memory_order_release);
+    TF_LOG_ERROR("[journal] {} ({} records lost); no further records will be written", what, lost);
+}
+
+template <typename Record>
+void BinaryJournal<Record>::writerLoop() {
+    std::vector<Record> batch(config_.batch_records);
+    uint64_t written = 0;   // records write() accepted
+    bool unsynced = false;  // written but not yet fdatasync'd
+    auto last_sync = std::chrono::steady_clock::now();
+    const auto group_commit = std::chrono::microseconds(config_.group_commit_us);
+
+    while (true) {
+        // Read stopping_ before draining so the final pass sees every append
+        // that completed before the destructor ran.
+        bool stopping = stopping_.load(std::memory_order_acquire);
+        bool rotating = rotate_pending_.load(std::memory_order_acquire);
+        size_t count = 0;
+        while (count < batch.size() && ring_.tryPop(batch[count])) ++count;
+
+        bool failed = failed_.load(std::memory_order_relaxed);
+        if (count > 0 && failed) {
+            // Keep draining so producers never wedge on a full ring
+            write_errors_.fetch_add(1, std::memory_order_relaxed);
+        } else if (count > 0) {
+            try {
+                file_->write(batch.data(), count * sizeof(Record));
+                writes_.fetch_add(1, std::memory_order_relaxed);
+                written += count;
+                unsynced = true;
+            } catch (const std::exception& e) {
+                // Part of the batch may be on disk, ending in a torn record
+                fail(e.what(), count);
+                failed = true;
+            }
+        }
+
+        bool flush = flush_requested_.exchange(false, std::memory_order_acq_rel);
+        if (!failed && unsynced && config_.sync != JournalSync::NONE) {
+            auto now = std::chrono::steady_clock::now();
+            if (config_.sync == JournalSync::EVERY_BATCH || flush || stopping || rotating ||
+                now - last_sync >= group_commit) {
+                try {
+                    file_->sync();
+                    syncs_.fetch_add(1, std::memory_order_relaxed);
+                    last_sync = now;
+                    unsynced = false;
+                } catch (const std::exception& e) {
+                    // The kernel may already have dropped the dirty pages, so
+                    // a retry proves nothing; nothing unsynced is durable
+                    fail(e.what(), written - durable_.load(std::memory_order_relaxed));
+                    failed = true;
+                }
+            }
+        }
+        if (!failed && (!unsynced || config_.sync == JournalSync::NONE)) {
+            durable_.store(written, std::memory_order_release);
+        }
+        if (rotating) {
+            switchFile();
+            continue;
+        }
+
+        if (count == batch.size()) continue;
+        if (stopping && ring_.empty()) break;
+        if (count == 0 && !flush) std::this_thread::sleep_for(std::chrono::microseconds(config_.idle_sleep_us));
+    }
+}
+
+// Reads a journal file through a read-only mapping; used by recovery, the
+// decoders and tests. A torn trailing record is ignored.
+template <typename Record>
+class JournalReader {
+public:
+    JournalReader(const std::string& path, const char* magic, uint32_t version)
+        : file_(path), count_(validateJournal(file_, magic, version, sizeof(Record))), cursor_(0) {}
+
+    size_t size() const { return count_; }
+    Record at(size_t i) const {
+        Record record;
+        std::memcpy(&record, file_.data() + sizeof(JournalFileHeader) + i * sizeof(Record), sizeof(Record));
+        return record;
+    }
+    // Sequential access; false at the end
+    bool next(Record& record) {
+        if (cursor_ >= count_) return false;
+        record = at(cursor_++);
+        return true;
+    }
+
+private:
+    MappedFile file_;
+    size_t count_;
+    size_t cursor_;
+};
+
+} // namespace tradeflow
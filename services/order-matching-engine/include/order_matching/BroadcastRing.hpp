@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+
+namespace tradeflow {
+
+// Bounded single-producer / many-consumer broadcast ring of byte messages
+// (disruptor-style). The producer writes each message once into the next
+// slot, overwriting the oldest; every consumer keeps its own cursor and
+// copies messages out, so consumers never slow the producer down or touch
+// each other's state. A consumer that falls more than capacity() behind is
+// told it was lapped and decides how to resume.
+//
+// Slots are guarded seqlock-style: the producer clears the slot's sequence
+// before rewriting it and publishes the new sequence afterwards; a reader
+// that sees the sequence change around its copy discards the copy. Sequences
+// start at 1. Capacity is rounded up to a power of two.
+//
+// Producers must be serialised externally (one thread, or a lock held around
+// publish), which is how order books already run.
+class BroadcastRing {
+public:
+    enum class ReadStatus {
+        OK,      // message copied out
+        EMPTY,   // not published yet
+        LAPPED   // overwritten before (or while) it was read
+    };
+
+    BroadcastRing(size_t capacity, size_t slot_bytes)
+        : mask_(std::bit_ceil(capacity < 2 ? size_t(2) : capacity) - 1),
+          slot_bytes_(slot_bytes),
+          slots_(std::make_unique<Slot[]>(mask_ + 1)),
+          payload_(std::make_unique<char[]>((mask_ + 1) * slot_bytes)),
+          head_(0) {}
+
+    BroadcastRing(const BroadcastRing&) = delete;
+    BroadcastRing& operator=(const BroadcastRing&) = delete;
+
+    size_t capacity() const { return mask_ + 1; }
+    size_t slotBytes() const { return slot_bytes_; }
+    // Sequence of the newest published message; 0 before the first
+    uint64_t head() const { return head_.load(std::memory_order_acquire); }
+    // Oldest sequence that has not been overwritten yet (1 while filling)
+    uint64_t oldest() const {
+        uint64_t head = this->head();
+        return head > capacity() ? head - capacity() + 1 : 1;
+    }
+
+    // Producer only. write(char* dst) fills exactly `size` bytes in place, so
+    // a message is serialised straight into its slot. Returns false (and
+    // publishes nothing) when size exceeds slotBytes().
+    template <typename Write>
+    bool publish(size_t size, Write&& write) {
+        if (size > slot_bytes_) return false;
+        uint64_t sequence = head_.load(std::memory_order_relaxed) + 1;
+        Slot& slot = slots_[sequence & mask_];
+        slot.sequence.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        write(payload_.get() + (sequence & mask_) * slot_bytes_);
+        slot.size.store(static_cast<uint32_t>(size), std::memory_order_relaxed);
+        slot.sequence.store(sequence, std::memory_order_release);
+        head_.store(sequence, std::memory_order_release);
+        return true;
+    }
+
+    // Any thread. Copies message `sequence` into out.
+    ReadStatus read(uint64_t sequence, std::string& out) const {
+        if (sequence > head()) return ReadStatus::EMPTY;
+        const Slot& slot = slots_[sequence & mask_];
+        if (slot.sequence.load(std::memory_order_acquire) != sequence) return ReadStatus::LAPPED;
+        uint32_t size = slot.size.load(std::memory_order_relaxed);
+        out.assign(payload_.get() + (sequence & mask_) * slot_bytes_, std::min<size_t>(size, slot_bytes_));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != sequence) return ReadStatus::LAPPED;
+        return ReadStatus::OK;
+    }
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> sequence{0};  // 0 = empty or being rewritten
+        std::atomic<uint32_t> size{0};
+    };
+
+    size_t mask_;
+    size_t slot_bytes_;
+    std::unique_ptr<Slot[]> slots_;
+    std::unique_ptr<char[]> payload_;
+    alignas(64) std::atomic<uint64_t> head_;
+};
+
+} // namespace tradeflow
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace tradeflow {
+
+// A clock reading: opaque units of the clock that took it
+using ClockTicks = uint64_t;
+
+// Where a book's timestamps come from. now() is taken on every fill, so it
+// returns the clock's raw reading; toEpochNanos turns one into wall time only
+// where a timestamp leaves the engine (trade updates, journals, metrics).
+// Nothing orders events by time: books number them (Trade::sequence).
+class Clock {
+public:
+    virtual ~Clock() = default;
+    virtual ClockTicks now() const = 0;
+    // Nanoseconds since the Unix epoch for a reading of this clock
+    virtual int64_t toEpochNanos(ClockTicks ticks) const = 0;
+};
+
+// system_clock; a reading is already epoch nanoseconds
+class SystemClock final : public Clock {
+public:
+    ClockTicks now() const override {
+        return static_cast<ClockTicks>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                           std::chrono::system_clock::now().time_since_epoch())
+                                           .count());
+    }
+    int64_t toEpochNanos(ClockTicks ticks) const override { return static_cast<int64_t>(ticks); }
+};
+
+// The CPU time-stamp counter: a reading is one rdtsc, with no system call or
+// vDSO page. Construction pairs the counter with system_clock twice,
+// `calibration` apart, and derives the rate from that. Wall time is then
+// extrapolated from the second pairing, so it drifts from system_clock as
+// NTP slews the latter (parts per million). The calibration assumes a
+// constant rate, which only an invariant counter (supported()) has; that is
+// why tscClock() hands out systemClock() elsewhere. Built for a CPU without
+// rdtsc, counter() reads steady_clock nanoseconds so the class still works
+// when constructed directly.
+class TscClock final : public Clock {
+public:
+    explicit TscClock(std::chrono::nanoseconds calibration = std::chrono::milliseconds(20));
+
+    // An invariant TSC: constant rate across frequency changes and sleep states
+    static bool supported();
+
+    ClockTicks now() const override { return counter(); }
+    int64_t toEpochNanos(ClockTicks ticks) const override {
+        auto delta = static_cast<__int128>(static_cast<int64_t>(ticks - base_ticks_));
+        return base_nanos_ + static_cast<int64_t>((delta * nanos_per_tick_q32_) >> 32);
+    }
+    double ticksPerNanosecond() const { return 4294967296.0 / static_cast<double>(nanos_per_tick_q32_); }
+
+private:
+    static ClockTicks counter();
+
+    ClockTicks base_ticks_;
+    int64_t base_nanos_;
+    int64_t nanos_per_tick_q32_;  // 32.32 fixed point
+};
+
+// Time its owner sets, in epoch nanoseconds, so a replay stamps the same
+// trades with the same times on every run. Thread-safe.
+class VirtualClock final : public Clock {
+public:
+    explicit VirtualClock(int64_t epoch_nanos = 0) : nanos_(epoch_nanos) {}
+
+    void set(int64_t epoch_nanos) { nanos_.store(epoch_nanos, std::memory_order_relaxed); }
+    void advance(int64_t nanos) { nanos_.fetch_add(nanos, std::memory_order_relaxed); }
+
+    ClockTicks now() const override { return static_cast<ClockTicks>(nanos_.load(std::memory_order_relaxed)); }
+    int64_t toEpochNanos(ClockTicks ticks) const override { return static_cast<int64_t>(ticks); }
+
+private:
+    std::atomic<int64_t> nanos_;
+};
+
+// Process-wide clocks. tscClock() is calibrated on first use, and is
+// systemClock() where TscClock::supported() is false.
+const Clock& systemClock();
+const Clock& tscClock();
+
+} // namespace tradeflow
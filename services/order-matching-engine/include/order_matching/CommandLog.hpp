@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "BinaryJournal.hpp"
+#include "OrderBook.hpp"
+
+namespace tradeflow {
+
+enum class CommandKind : uint8_t {
+    ADD = 1,     // OrderBook::addOrder
+    SUBMIT = 2,  // OrderBook::submitOrder (matched on arrival)
+    CANCEL = 3,
+    MODIFY = 4,
+    MATCH = 5,   // OrderBook::triggerMatching
+    UNCROSS = 6  // OrderBook::uncross; price holds the reference price it used
+};
+
+// Fixed-size on-disk command record (native little-endian). Symbol and
+// client id are NUL-padded, and wide enough for MAX_SYMBOL_LENGTH and
+// MAX_CLIENT_ID_LENGTH.
+struct CommandRecord {
+    uint64_t sequence;  // engine-wide, increasing within each book
+    int64_t order_id;
+    int64_t price;      // ticks
+    int32_t quantity;
+    CommandKind kind;
+    uint8_t is_buy;
+    uint8_t order_type;  // OrderType, SUBMIT only
+    uint8_t reserved;
+    char symbol[32];
+    char client_id[64];
+};
+static_assert(sizeof(CommandRecord) == 128, "CommandRecord is a fixed 128-byte on-disk layout");
+static_assert(sizeof(CommandRecord::symbol) >= MAX_SYMBOL_LENGTH && sizeof(CommandRecord::client_id) >= MAX_CLIENT_ID_LENGTH,
+              "CommandRecord must hold the longest accepted symbol and client id");
+
+inline constexpr char COMMAND_LOG_MAGIC[8] = {'T', 'F', 'C', 'M', 'D', 'S', '\0', '\0'};
+inline constexpr uint32_t COMMAND_LOG_VERSION = 1;
+
+// Write-ahead journal of the commands that change order books. Books append
+// under their own lock (or on their sequencer thread) before the caller is
+// acknowledged, so each book's records are in the order it applied them.
+// Replaying a book's records on top of a snapshot that covers everything up
+// to some sequence reproduces the book exactly.
+//
+// The log is split into numbered segments, commands-<N>.wal in the state
+// directory. rotate() starts the next segment; once a snapshot taken after
+// the rotation is durable, earlier segments are no longer needed.
+class CommandLog {
+public:
+    // Append to segment `segment` in dir; the first command gets next_sequence
+    CommandLog(const std::string& dir, uint64_t segment, uint64_t next_sequence,
+               const JournalConfig& config = JournalConfig());
+
+    CommandLog(const CommandLog&) = delete;
+    CommandLog& operator=(const CommandLog&) = delete;
+
+    // Any thread; returns the command's sequence number
+    uint64_t append(CommandKind kind, const std::string& symbol, OrderId id, bool is_buy = false, Quantity qty = 0,
+                    Price px = 0, std::string_view client_id = {}, OrderType type = OrderType::LIMIT);
+    // Block until everything appended before the call is on disk; throws
+    // once a write or sync has failed
+    void flush() { journal_.flush(); }
+    // Start the next segment and return its number
+    uint64_t rotate();
+
+    uint64_t segment() const { return segment_.load(std::memory_order_acquire); }
+    std::string path() const { return journal_.path(); }
+    JournalStats stats() const { return journal_.stats(); }
+
+    static std::string segmentPath(const std::string& dir, uint64_t segment);
+    // Segment numbers present in dir, ascending
+    static std::vector<uint64_t> listSegments(const std::string& dir);
+
+private:
+    std::string dir_;
+    std::atomic<uint64_t> segment_;
+    std::atomic<uint64_t> next_sequence_;
+    BinaryJournal<CommandRecord> journal_;
+};
+
+class CommandLogReader : public JournalReader<CommandRecord> {
+public:
+    explicit CommandLogReader(const std::string& path)
+        : JournalReader<CommandRecord>(path, COMMAND_LOG_MAGIC, COMMAND_LOG_VERSION) {}
+};
+
+} // namespace tradeflow
@@ -0,0 +1,211 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "Order.hpp"
+
+namespace tradeflow {
+
+// Best bid and ask as last published by a book
+struct TopOfBook {
+    Price bid_price = 0;
+    Quantity bid_quantity = 0;  // 0: no bids
+    Price ask_price = 0;
+    Quantity ask_quantity = 0;  // 0: no asks
+    uint64_t sequence = 0;      // book depth sequence the levels reflect
+};
+
+// Equilibrium of a call auction: the price an uncross trades at and how much
+// it trades there. Sums over many orders, so wider than one order's Quantity.
+struct AuctionResult {
+    Price price = 0;
+    int64_t volume = 0;     // 0: the book is not crossed (price is then 0)
+    int64_t imbalance = 0;  // bid minus ask quantity willing to trade at price
+};
+
+// A book's best depth() levels per side (and, for a call auction, its
+// indicative uncross), republished by the book's writer whenever a change
+// reaches them, for readers that must not take the book lock or queue on
+// its shard (GetOrderBook, metrics scrapes).
+//
+// Seqlock: the writer makes the version odd, changes the levels and makes
+// it even again; a reader copies the levels and retries if the version was
+// odd or moved meanwhile, so it always gets both sides from one state. The
+// fields are relaxed atomics, which makes the racing copy well defined and
+// costs plain loads and stores on x86. Readers never delay the writer.
+class DepthCache {
+public:
+    explicit DepthCache(size_t depth)
+        : depth_(std::max<size_t>(1, depth)),
+          bids_(std::make_unique<Level[]>(depth_)),
+          asks_(std::make_unique<Level[]>(depth_)) {}
+
+    DepthCache(const DepthCache&) = delete;
+    DepthCache& operator=(const DepthCache&) = delete;
+
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    size_t depth() const { return depth_; }
+
+    // Writer only: whether a change to the level at px on one side can alter
+    // what is published, i.e. the side shows fewer than depth() levels or px
+    // is no worse than the last one shown
+    bool covers(bool is_buy, Price px) const {
+        const Shadow& side = is_buy ? bid_shadow_ : ask_shadow_;
+        if (side.count < depth_) return true;
+        return is_buy ? px >= side.worst : px <= side.worst;
+    }
+
+    // Writer only: the published index of the level at px, or npos
+    size_t find(bool is_buy, Price px) const {
+        const Level* levels = is_buy ? bids_.get() : asks_.get();
+        size_t count = (is_buy ? bid_shadow_ : ask_shadow_).count;
+        for (size_t i = 0; i < count; ++i) {
+            if (levels[i].price.load(std::memory_order_relaxed) == px) return i;
+        }
+        return npos;
+    }
+
+    // Writer only. Every change is made between beginWrite and endWrite,
+    // which readers observe as one step to sequence.
+    void beginWrite() {
+        uint64_t version = version_.load(std::memory_order_relaxed);
+        version_.store(version + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    void endWrite(uint64_t sequence) {
+        sequence_.store(sequence, std::memory_order_relaxed);
+        version_.store(version_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // A CALL_AUCTION book's indicative uncross
+    void setAuction(const AuctionResult& auction) {
+        auction_price_.store(auction.price, std::memory_order_relaxed);
+        auction_volume_.store(auction.volume, std::memory_order_relaxed);
+        auction_imbalance_.store(auction.imbalance, std::memory_order_relaxed);
+    }
+
+    // A published level's new quantity (its price and position unchanged)
+    void setQuantity(bool is_buy, size_t index, Quantity quantity) {
+        (is_buy ? bids_ : asks_)[index].quantity.store(quantity, std::memory_order_relaxed);
+    }
+
+    // Replace one side: visit(emit) calls emit(price, quantity) for the
+    // side's levels best first until it returns false
+    template <typename Visit>
+    void rewrite(bool is_buy, Visit&& visit) {
+        Level* levels = is_buy ? bids_.get() : asks_.get();
+        Shadow& shadow = is_buy ? bid_shadow_ : ask_shadow_;
+        size_t n = 0;
+        visit([&](Price price, Quantity quantity) {
+            levels[n].price.store(price, std::memory_order_relaxed);
+            levels[n].quantity.store(quantity, std::memory_order_relaxed);
+            shadow.worst = price;
+            return ++n < depth_;
+        });
+        (is_buy ? bid_count_ : ask_count_).store(n, std::memory_order_relaxed);
+        shadow.count = n;
+    }
+
+    // Any thread. Up to max_levels per side (0 or more than depth() = depth()),
+    // best first; returns the sequence they reflect.
+    uint64_t read(size_t max_levels, std::vector<std::pair<Price, Quantity>>& bids,
+                  std::vector<std::pair<Price, Quantity>>& asks) const {
+        size_t limit = max_levels == 0 ? depth_ : std::min(max_levels, depth_);
+        while (true) {
+            uint64_t before = beginRead();
+            readSide(bids_.get(), bid_count_, limit, bids);
+            readSide(asks_.get(), ask_count_, limit, asks);
+            uint64_t sequence = sequence_.load(std::memory_order_relaxed);
+            if (endRead(before)) return sequence;
+        }
+    }
+
+    // Any thread; all zero unless the book publishes one
+    AuctionResult auction() const {
+        while (true) {
+            uint64_t before = beginRead();
+            AuctionResult auction;
+            auction.price = auction_price_.load(std::memory_order_relaxed);
+            auction.volume = auction_volume_.load(std::memory_order_relaxed);
+            auction.imbalance = auction_imbalance_.load(std::memory_order_relaxed);
+            if (endRead(before)) return auction;
+        }
+    }
+
+    // Any thread
+    TopOfBook top() const {
+        while (true) {
+            uint64_t before = beginRead();
+            TopOfBook top;
+            if (bid_count_.load(std::memory_order_relaxed) > 0) {
+                top.bid_price = bids_[0].price.load(std::memory_order_relaxed);
+                top.bid_quantity = bids_[0].quantity.load(std::memory_order_relaxed);
+            }
+            if (ask_count_.load(std::memory_order_relaxed) > 0) {
+                top.ask_price = asks_[0].price.load(std::memory_order_relaxed);
+                top.ask_quantity = asks_[0].quantity.load(std::memory_order_relaxed);
+            }
+            top.sequence = sequence_.load(std::memory_order_relaxed);
+            if (endRead(before)) return top;
+        }
+    }
+
+private:
+    struct Level {
+        std::atomic<Price> price{0};
+        std::atomic<Quantity> quantity{0};
+    };
+
+    // The writer's own record of what it last published
+    struct Shadow {
+        size_t count = 0;
+        Price worst = 0;
+    };
+
+    static void readSide(const Level* levels, const std::atomic<size_t>& count, size_t limit,
+                         std::vector<std::pair<Price, Quantity>>& out) {
+        size_t n = std::min(count.load(std::memory_order_relaxed), limit);
+        out.resize(n);
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = {levels[i].price.load(std::memory_order_relaxed), levels[i].quantity.load(std::memory_order_relaxed)};
+        }
+    }
+
+    // Yields rather than spins while a rewrite is in progress: on a busy
+    // core the writer may be the thread waiting to run
+    uint64_t beginRead() const {
+        while (true) {
+            uint64_t version = version_.load(std::memory_order_acquire);
+            if ((version & 1) == 0) return version;
+            std::this_thread::yield();
+        }
+    }
+
+    bool endRead(uint64_t before) const {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return version_.load(std::memory_order_relaxed) == before;
+    }
+
+    size_t depth_;
+    std::unique_ptr<Level[]> bids_;
+    std::unique_ptr<Level[]> asks_;
+    std::atomic<size_t> bid_count_{0};
+    std::atomic<size_t> ask_count_{0};
+    std::atomic<uint64_t> sequence_{0};
+    std::atomic<Price> auction_price_{0};
+    std::atomic<int64_t> auction_volume_{0};
+    std::atomic<int64_t> auction_imbalance_{0};
+    alignas(64) std::atomic<uint64_t> version_{0};
+    Shadow bid_shadow_;
+    Shadow ask_shadow_;
+};
+
+} // namespace tradeflow
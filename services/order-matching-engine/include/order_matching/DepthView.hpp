@@ -0,0 +1,53 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <utility>
+#include <vector>
+#include "OrderBook.hpp"
+
+namespace tradeflow {
+
+// One book subscriber's view of a book's levels, fed with the book's
+// DepthCallback updates, that reports what a client holding the view must
+// change since the last flush. Between flushes each level keeps only its
+// latest quantity, so a flush interval conflates any number of updates into
+// one per level.
+//
+// With depth 0 the view is the whole book and only changed levels are kept.
+// With depth N it is each side's N best levels: the whole book is mirrored,
+// because a level outside the view enters it when a better one goes, and a
+// flush diffs the current N best against what was last reported (levels
+// pushed out of the view are reported with quantity 0).
+class DepthView {
+private:
+    using Levels = std::vector<std::pair<Price, Quantity>>;
+    using BidMap = std::map<Price, Quantity, std::greater<Price>>;
+    using AskMap = std::map<Price, Quantity>;
+
+    size_t depth_;
+    BidMap bids_;  // depth 0: changed levels only; depth N: the whole side
+    AskMap asks_;
+    Levels sent_bids_;  // depth N: the view as last reported
+    Levels sent_asks_;
+    bool pending_;
+
+    bool affectsView(const LevelUpdate& update) const;
+
+public:
+    explicit DepthView(size_t depth = 0) : depth_(depth), pending_(false) {}
+
+    size_t depth() const { return depth_; }
+    // Replace the book with a snapshot (OrderBook::getDepth with max_levels 0
+    // when depth > 0) and take what the client is sent for it into view_bids
+    // and view_asks, best first. Nothing is pending afterwards.
+    void reset(const Levels& bids, const Levels& asks, Levels& view_bids, Levels& view_asks);
+    void apply(const LevelUpdate& update);
+    // Whether a flush may have something to report
+    bool pending() const { return pending_; }
+    // Append the view's changes since the last flush to out, bids then asks,
+    // best first; quantity 0 removes a level from the client's view
+    void flush(std::vector<LevelUpdate>& out);
+};
+
+} // namespace tradeflow
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "Logger.hpp"
+#include "OrderBook.hpp"
+
+namespace tradeflow {
+
+// How RPC threads reach the order books.
+enum class ExecutionMode {
+    LOCKED,     // RPC threads call into books directly under each book's mutex
+    SEQUENCER   // each book is owned by one Sequencer thread fed through a ring
+};
+
+// How the gRPC server runs handlers.
+enum class GrpcServerMode {
+    SYNC,  // gRPC's synchronous server: a thread per in-flight RPC and per trade stream
+    ASYNC  // a fixed pool of threads, each polling its own completion queue
+};
+
+// What a SubscribeTrades stream does once it falls a whole trade ring behind.
+enum class SlowSubscriberPolicy {
+    SKIP,       // jump to the newest trade, dropping everything missed
+    LAG,        // resume a quarter ring in from the oldest trade still in the ring
+    DISCONNECT  // end the stream with RESOURCE_EXHAUSTED
+};
+
+// Process-wide engine settings. Values come from TRADEFLOW_* environment
+// variables so the service can be tuned from docker-compose without a rebuild.
+struct EngineConfig {
+    OrderBookConfig book;  // applied to every order book the service creates
+    std::unordered_set<std::string> ladder_symbols;  // symbols that use BookLayout::TICK_LADDER
+    std::unordered_set<std::string> auction_symbols; // symbols whose books are MatchingMode::CALL_AUCTION
+    size_t router_stripes = 64;  // lock stripes in the order-id -> book routing index
+    ExecutionMode execution = ExecutionMode::LOCKED;
+    size_t shard_count = 1;                 // SEQUENCER: symbols are consistent-hashed across this many shards
+    std::vector<int> shard_cores;           // SEQUENCER: shard i is pinned to shard_cores[i % size]; empty = unpinned
+    std::unordered_map<std::string, size_t> shard_overrides;  // SEQUENCER: symbol -> shard for hot names
+    size_t sequencer_ring_capacity = 4096;  // SEQUENCER: pending commands per shard before submitters block
+    bool journal_enabled = true;            // append executed trades to binary journals
+    std::string journal_dir = ".";          // trades.journal (LOCKED) or trades-shard<N>.journal (SEQUENCER)
+    JournalConfig journal;
+    std::string state_dir;                  // command log + snapshots for recovery; empty = purely in-memory
+    JournalConfig command_log;
+    bool wal_durable_ack = false;           // acknowledge order entry only once its command is on disk
+    size_t snapshot_interval_s = 300;       // 0 = snapshot only at startup, after recovery
+    GrpcServerMode grpc_server = GrpcServerMode::SYNC;
+    size_t grpc_threads = 0;                // ASYNC: polling threads, one completion queue each; 0 = one per core
+    size_t grpc_handler_threads = 0;        // ASYNC: threads running unary and order entry handlers; 0 = four per core
+    size_t trade_ring_capacity = 4096;      // trades per symbol kept for SubscribeTrades streams
+    SlowSubscriberPolicy slow_subscriber = SlowSubscriberPolicy::LAG;
+    size_t book_ring_capacity = 1024;       // depth update messages per symbol kept for SubscribeBook streams
+    bool latency_histograms = true;         // per-RPC / per-stage latency histograms on the metrics port
+    size_t metrics_max_symbols = 1000;      // symbols with their own per-symbol series; later ones count as "other"
+    LogLevel log_level = LogLevel::INFO;    // initial level; changeable at runtime via /loglevel on the metrics port
+    std::string clock = "tsc";              // book.clock: tsc (system where the TSC is not invariant) or system
+
+    // Book settings for one symbol, with per-symbol overrides applied
+    OrderBookConfig bookConfigFor(const std::string& symbol) const;
+    MatchingMode matchingModeFor(const std::string& symbol) const;
+
+    static EngineConfig fromEnvironment();
+};
+
+} // namespace tradeflow
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace tradeflow {
+
+// Append-only table giving each distinct string a dense uint32_t handle, so
+// books and trades carry a 4-byte id instead of a copy of a symbol. Handle 0
+// is the empty string. Names are never removed and
+// name() references stay valid for the table's lifetime. Thread-safe: a
+// string seen before costs one shared-lock lookup; only a new one takes
+// the lock exclusively.
+class Interner {
+private:
+    mutable std::shared_mutex mutex_;
+    std::deque<std::string> names_;  // by handle; a deque never moves them
+    std::unordered_map<std::string_view, uint32_t> handles_;  // views into names_
+
+public:
+    Interner();
+
+    Interner(const Interner&) = delete;
+    Interner& operator=(const Interner&) = delete;
+
+    uint32_t intern(std::string_view name);
+    // The string a handle returned by intern() stands for
+    const std::string& name(uint32_t handle) const;
+    size_t size() const;
+};
+
+// Process-wide table, shared by every book so a SymbolHandle means the same
+// string everywhere
+Interner& symbolNames();
+
+// One book's client ids (ClientHandle): a handle per distinct id among its
+// resting orders, counted by the orders holding it. Client ids are chosen by
+// clients, so unlike symbols they are not kept forever: a handle no order
+// holds is given to the next new id, so the table never has more entries
+// than the most ids held at once, however many pass through. Until then the
+// released id keeps its entry, so a client whose orders come and go is not
+// re-added (and reallocated) each time. Not synchronised; the book's writer
+// owns it.
+class ClientTable {
+private:
+    struct Entry {
+        std::string name;
+        uint32_t refs = 0;
+        bool listed = false;  // on free_
+    };
+    std::deque<Entry> entries_;  // by handle; a deque never moves them
+    std::vector<uint32_t> free_;  // released handles; skipped if re-acquired since
+    std::unordered_map<std::string_view, uint32_t> handles_;  // views into entries_
+
+public:
+    ClientTable() = default;
+
+    ClientTable(const ClientTable&) = delete;
+    ClientTable& operator=(const ClientTable&) = delete;
+
+    // The handle for client_id, held until the matching release()
+    uint32_t acquire(std::string_view client_id);
+    void release(uint32_t handle);
+    // The id a held handle stands for
+    const std::string& name(uint32_t handle) const { return entries_[handle].name; }
+    // Entries allocated: the most distinct ids held at once
+    size_t size() const { return entries_.size(); }
+};
+
+} // namespace tradeflow
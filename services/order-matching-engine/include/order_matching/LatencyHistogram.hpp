@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace tradeflow {
+
+// Monotonic clock used for every latency the service records
+inline uint64_t monotonicNanos() {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+}
+
+// Merged contents of a LatencyHistogram at one point in time
+struct HistogramSnapshot {
+    std::vector<uint64_t> counts;  // per bucket, see LatencyHistogram::bucketIndex
+    uint64_t count = 0;
+    uint64_t sum_ns = 0;
+
+    // Upper bound of the bucket holding the q-th value (0 when empty)
+    uint64_t quantile(double q) const;
+};
+
+// Log-linear latency histogram in nanoseconds: values below 16 get a bucket
+// each, above that every power of two is split into 16 linear sub-buckets, so
+// a bucket's width is at most 1/16 of its values (HDR-style, ~6% precision).
+// Values from 2^36 ns (~69 s) up share the last bucket.
+//
+// Recording is lock-free and contention-free: each thread writes to its own
+// shard (registered under a mutex on first use, like Logger's per-thread
+// buffers) with relaxed single-writer stores. snapshot() merges the shards,
+// so a scrape may miss a record still in flight but never blocks a recorder.
+// Shards of threads that exit are kept, so their counts are not lost.
+class LatencyHistogram {
+public:
+    static constexpr unsigned SUB_BUCKET_BITS = 4;
+    static constexpr unsigned SUB_BUCKETS = 1u << SUB_BUCKET_BITS;
+    static constexpr unsigned MAX_EXPONENT = 36;
+    static constexpr size_t BUCKETS = SUB_BUCKETS + (MAX_EXPONENT - SUB_BUCKET_BITS) * SUB_BUCKETS;
+
+    LatencyHistogram();
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    void record(uint64_t ns) {
+        Shard& shard = threadShard();
+        auto bump = [](std::atomic<uint64_t>& cell, uint64_t by) {
+            cell.store(cell.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+        };
+        bump(shard.counts[bucketIndex(ns)], 1);
+        bump(shard.count, 1);
+        bump(shard.sum_ns, ns);
+    }
+
+    HistogramSnapshot snapshot() const;
+
+    static size_t bucketIndex(uint64_t ns) {
+        if (ns < SUB_BUCKETS) return static_cast<size_t>(ns);
+        unsigned exponent = 63u - static_cast<unsigned>(__builtin_clzll(ns));
+        if (exponent >= MAX_EXPONENT) return BUCKETS - 1;
+        unsigned shift = exponent - SUB_BUCKET_BITS;
+        return SUB_BUCKETS + shift * SUB_BUCKETS + static_cast<size_t>((ns >> shift) & (SUB_BUCKETS - 1));
+    }
+    // Smallest and largest value that land in bucket `index`
+    static uint64_t bucketLowerBound(size_t index);
+    static uint64_t bucketUpperBound(size_t index);
+
+private:
+    struct Shard {
+        std::atomic<uint64_t> counts[BUCKETS] = {};
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> sum_ns{0};
+    };
+
+    Shard& threadShard() {
+        thread_local std::vector<Shard*> shards;
+        if (id_ < shards.size() && shards[id_]) return *shards[id_];
+        return registerShard(shards);
+    }
+    Shard& registerShard(std::vector<Shard*>& thread_shards);
+
+    size_t id_;  // slot in every thread's shard table; never reused
+    mutable std::mutex shards_mutex_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+// Prometheus histogram series for one label set: cumulative _bucket lines on
+// a 1-2-5 ladder from 1 us to 10 s, then _sum and _count, in seconds.
+// `labels` is the inside of the braces (e.g. rpc="SubmitOrder"); the caller
+// writes the # HELP / # TYPE lines once per metric. A bucket is counted
+// under the first `le` at or above its upper bound, so counts near an edge
+// can shift by up to the bucket width.
+void writePrometheusHistogram(std::ostream& out, const std::string& name, const std::string& labels,
+                              const HistogramSnapshot& snapshot);
+
+// Where the command the current thread just ran spent its time besides the
+// book work itself. While stage timing is on, OrderBook adds to it when its
+// write/read lock is contended and around trade publication (callback plus
+// journal append); Sequencer adds the time a command sat in its ring and
+// hands the owning thread's figures back to the caller. RPC handlers reset
+// it before a book call and read it afterwards.
+struct StageTimes {
+    uint64_t lock_wait_ns = 0;
+    uint64_t publish_ns = 0;
+};
+
+StageTimes& threadStageTimes();
+
+// Process-wide switch for the clock reads behind StageTimes and the RPC
+// histograms (TRADEFLOW_LATENCY_HISTOGRAMS); off by default
+void setStageTiming(bool enabled);
+bool stageTiming();
+
+} // namespace tradeflow
@@ -0,0 +1,243 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace tradeflow {
+
+enum class LogLevel : uint8_t {
+    TRACE,
+    DEBUG,
+    INFO,
+    WARN,
+    ERROR,
+    OFF
+};
+
+// One per call site (a static in TF_LOG). Its address is the record's
+// format id: the hot path never copies the format string.
+struct LogSite {
+    LogLevel level;
+    const char* format;  // "{}" placeholders, filled in order
+};
+
+namespace logdetail {
+
+enum class ArgTag : uint8_t { INT, UINT, DOUBLE, BOOL, CHAR, STRING };
+
+constexpr size_t MAX_STRING_ARG = 256;  // longer string arguments are truncated
+
+struct RecordHeader {
+    uint32_t size;       // whole record, header included, rounded up to 8 bytes
+    uint32_t arg_count;  // PAD_RECORD for the filler written before a wrap
+    const LogSite* site;
+    int64_t timestamp_ns;
+};
+constexpr uint32_t PAD_RECORD = 0xFFFFFFFFu;
+
+inline std::string_view stringArg(const char* value) { return value ? std::string_view(value) : std::string_view("(null)"); }
+inline std::string_view stringArg(std::string_view value) { return value; }
+inline std::string_view stringArg(const std::string& value) { return value; }
+
+template <typename T>
+size_t argSize(const T& value) {
+    using U = std::decay_t<T>;
+    if constexpr (std::is_same_v<U, bool> || std::is_same_v<U, char>) {
+        return 2;
+    } else if constexpr (std::is_arithmetic_v<U> || std::is_enum_v<U>) {
+        return 9;
+    } else {
+        return 3 + std::min(stringArg(value).size(), MAX_STRING_ARG);
+    }
+}
+
+template <typename V>
+inline void put(char*& out, ArgTag tag, const V& value) {
+    *out++ = static_cast<char>(tag);
+    std::memcpy(out, &value, sizeof(value));
+    out += sizeof(value);
+}
+
+template <typename T>
+void encodeArg(char*& out, const T& value) {
+    using U = std::decay_t<T>;
+    if constexpr (std::is_same_v<U, bool>) {
+        put(out, ArgTag::BOOL, static_cast<uint8_t>(value));
+    } else if constexpr (std::is_same_v<U, char>) {
+        put(out, ArgTag::CHAR, value);
+    } else if constexpr (std::is_enum_v<U>) {
+        put(out, ArgTag::INT, static_cast<int64_t>(value));
+    } else if constexpr (std::is_floating_point_v<U>) {
+        put(out, ArgTag::DOUBLE, static_cast<double>(value));
+    } else if constexpr (std::is_integral_v<U> && std::is_signed_v<U>) {
+        put(out, ArgTag::INT, static_cast<int64_t>(value));
+    } else if constexpr (std::is_integral_v<U>) {
+        put(out, ArgTag::UINT, static_cast<uint64_t>(value));
+    } else {
+        std::string_view text = stringArg(value);
+        uint16_t length = static_cast<uint16_t>(std::min(text.size(), MAX_STRING_ARG));
+        put(out, ArgTag::STRING, length);
+        std::memcpy(out, text.data(), length);
+        out += length;
+    }
+}
+
+} // namespace logdetail
+
+// Single-producer / single-consumer byte ring holding one thread's encoded
+// records. Records never straddle the end: a pad record fills the tail and
+// the next record starts at offset 0.
+class LogBuffer {
+private:
+    std::unique_ptr<char[]> data_;
+    size_t mask_;
+    alignas(64) std::atomic<size_t> head_;  // consumer position
+    size_t cached_head_;                    // producer's last view of head_
+    alignas(64) std::atomic<size_t> tail_;  // producer position
+
+public:
+    explicit LogBuffer(size_t capacity);
+
+    LogBuffer(const LogBuffer&) = delete;
+    LogBuffer& operator=(const LogBuffer&) = delete;
+
+    size_t capacity() const { return mask_ + 1; }
+    size_t produced() const { return tail_.load(std::memory_order_acquire); }
+    size_t consumed() const { return head_.load(std::memory_order_acquire); }
+
+    // Producer. Contiguous space for `bytes` (a multiple of 8), or nullptr
+    // if the consumer has not caught up.
+    char* reserve(size_t bytes);
+    void commit(size_t bytes) { tail_.store(tail_.load(std::memory_order_relaxed) + bytes, std::memory_order_release); }
+
+    // Consumer. Calls fn(header) for every committed record, then frees them.
+    template <typename Fn>
+    size_t drain(Fn&& fn) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        size_t tail = tail_.load(std::memory_order_acquire);
+        size_t records = 0;
+        while (head != tail) {
+            const char* record = data_.get() + (head & mask_);
+            uint32_t size;
+            uint32_t arg_count;
+            std::memcpy(&size, record, sizeof(size));
+            std::memcpy(&arg_count, record + sizeof(size), sizeof(arg_count));
+            if (arg_count != logdetail::PAD_RECORD) {
+                fn(record);
+                ++records;
+            }
+            head += size;
+        }
+        head_.store(head, std::memory_order_release);
+        return records;
+    }
+
+    std::atomic<bool> closed{false};  // owning thread has exited
+};
+
+// Asynchronous logger. The calling thread copies the call site pointer, a
+// timestamp and the raw argument values into its own LogBuffer; a background
+// thread formats records and writes them out in batches. A disabled level
+// costs one relaxed load at the call site and the arguments are not
+// evaluated. A full buffer drops the record (counted and reported) rather
+// than stall the caller. Lines from different threads are ordered within a
+// thread; across threads, use the timestamps.
+class Logger {
+public:
+    static Logger& instance();
+
+    static bool enabled(LogLevel level) { return level >= level_.load(std::memory_order_relaxed); }
+    // Safe to call at any time from any thread
+    static void setLevel(LogLevel level) { level_.store(level, std::memory_order_relaxed); }
+    static LogLevel level() { return level_.load(std::memory_order_relaxed); }
+    static const char* levelName(LogLevel level);
+    // trace, debug, info, warn, error, off
+    static bool parseLevel(std::string_view name, LogLevel& level);
+
+    template <typename... Args>
+    void log(const LogSite& site, const Args&... args);
+
+    void setOutput(std::FILE* out) { output_.store(out, std::memory_order_release); }
+    // Buffer size for threads that log for the first time after the call
+    void setThreadBufferBytes(size_t bytes) { buffer_bytes_.store(bytes, std::memory_order_relaxed); }
+    // Block until everything logged before the call has been written out
+    void flush();
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+    ~Logger();
+
+private:
+    Logger();
+
+    static inline std::atomic<LogLevel> level_{LogLevel::INFO};
+
+    std::mutex buffers_mutex_;
+    std::vector<std::shared_ptr<LogBuffer>> buffers_;
+    std::atomic<std::FILE*> output_;
+    std::atomic<size_t> buffer_bytes_;
+    std::atomic<uint64_t> dropped_;
+    uint64_t dropped_reported_;
+    std::atomic<uint64_t> passes_;  // completed drain-and-write passes
+    std::atomic<bool> flush_requested_;
+    std::atomic<bool> stopping_;
+    std::string pending_;  // formatted output of the current pass
+    std::thread writer_;
+
+    LogBuffer* threadBuffer();
+    void writerLoop();
+    bool drainAll();
+    void formatRecord(const char* record);
+};
+
+template <typename... Args>
+void Logger::log(const LogSite& site, const Args&... args) {
+    size_t bytes = sizeof(logdetail::RecordHeader) + (size_t(0) + ... + logdetail::argSize(args));
+    bytes = (bytes + 7) & ~size_t(7);
+    LogBuffer* buffer = threadBuffer();
+    char* out = buffer->reserve(bytes);
+    if (!out) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    logdetail::RecordHeader header;
+    header.size = static_cast<uint32_t>(bytes);
+    header.arg_count = static_cast<uint32_t>(sizeof...(Args));
+    header.site = &site;
+    header.timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                              std::chrono::system_clock::now().time_since_epoch()).count();
+    std::memcpy(out, &header, sizeof(header));
+    [[maybe_unused]] char* cursor = out + sizeof(header);  // unused when there are no arguments
+    (logdetail::encodeArg(cursor, args), ...);
+    buffer->commit(bytes);
+}
+
+} // namespace tradeflow
+
+// TF_LOG(LogLevel::INFO, "filled {} @ {}", qty, px). Arguments are only
+// evaluated when the level is enabled; supported types are integers, enums,
+// floating point, bool, char and strings (const char*, std::string,
+// std::string_view).
+#define TF_LOG(level, format, ...)                                                          \
+    do {                                                                                    \
+        if (::tradeflow::Logger::enabled(level)) {                                          \
+            static constexpr ::tradeflow::LogSite tf_log_site_{level, format};              \
+            ::tradeflow::Logger::instance().log(tf_log_site_ __VA_OPT__(, ) __VA_ARGS__);   \
+        }                                                                                   \
+    } while (0)
+
+#define TF_LOG_TRACE(format, ...) TF_LOG(::tradeflow::LogLevel::TRACE, format __VA_OPT__(, ) __VA_ARGS__)
+#define TF_LOG_DEBUG(format, ...) TF_LOG(::tradeflow::LogLevel::DEBUG, format __VA_OPT__(, ) __VA_ARGS__)
+#define TF_LOG_INFO(format, ...) TF_LOG(::tradeflow::LogLevel::INFO, format __VA_OPT__(, ) __VA_ARGS__)
+#define TF_LOG_WARN(format, ...) TF_LOG(::tradeflow::LogLevel::WARN, format __VA_OPT__(, ) __VA_ARGS__)
+#define TF_LOG_ERROR(format, ...) TF_LOG(::tradeflow::LogLevel::ERROR, format __VA_OPT__(, ) __VA_ARGS__)
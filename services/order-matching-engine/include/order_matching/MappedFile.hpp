@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace tradeflow {
+
+// Read-only, private mapping of a whole file; the kernel pages it in on
+// demand, so recovery and replay read large files without copying them
+// through a stdio buffer first. An empty file maps to (nullptr, 0).
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+    const std::string& path() const { return path_; }
+
+private:
+    std::string path_;
+    const char* data_;
+    size_t size_;
+};
+
+} // namespace tradeflow
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace tradeflow {
+
+class MetricsRegistry;
+
+enum class MetricType { COUNTER, GAUGE };
+
+// A label value escaped for the text exposition format (backslash, double
+// quote and newline). For series written by hand next to the registry's own.
+std::string escapeLabel(const std::string& value);
+
+// One series of a MetricFamily. A handle is two words, copyable, and is meant
+// to be looked up once and kept (in a handler's static, a book callback, ...)
+// so the hot path is only the increment.
+class Counter {
+public:
+    Counter() = default;
+
+    inline void add(int64_t delta) const;
+    void inc(uint64_t n = 1) const { add(static_cast<int64_t>(n)); }
+    void dec(uint64_t n = 1) const { add(-static_cast<int64_t>(n)); }
+    // Sum over every thread's slot; what a scrape reports
+    int64_t value() const;
+
+private:
+    friend class MetricFamily;
+    Counter(MetricsRegistry* registry, uint32_t slot) : registry_(registry), slot_(slot) {}
+
+    MetricsRegistry* registry_ = nullptr;
+    uint32_t slot_ = 0;
+};
+
+// A named metric and its label names; labels() returns the series for one set
+// of label values, creating it on first use. Lookups are cached per thread,
+// so repeated calls with the same values do not touch the family's mutex;
+// values folded by capLabel() are not cached, so the caches stay bounded too.
+class MetricFamily {
+public:
+    MetricFamily(MetricsRegistry& registry, std::string name, std::string help, MetricType type,
+                 std::vector<std::string> label_names);
+    MetricFamily(const MetricFamily&) = delete;
+    MetricFamily& operator=(const MetricFamily&) = delete;
+
+    // values must match the label names in number and order
+    Counter labels(std::initializer_list<std::string> values);
+    Counter labels(const std::vector<std::string>& values);
+    // Give at most max_values distinct values of label `label` their own
+    // series; later values are all counted under `overflow`. For labels fed
+    // by client input, so the exposition cannot grow without bound. Call
+    // before the first labels().
+    void capLabel(size_t label, size_t max_values, std::string overflow = "other");
+    // Whether labels() gives (or would now give) `value` of the capped label
+    // its own series rather than the overflow one; true without a cap. For
+    // series written by hand that must follow the same cap.
+    bool hasOwnSeries(const std::string& value) const;
+
+    const std::string& name() const { return name_; }
+    void writePrometheus(std::ostream& out) const;
+
+private:
+    struct Series {
+        std::vector<std::string> values;
+        uint32_t slot;
+    };
+
+    MetricsRegistry& registry_;
+    std::string name_;
+    std::string help_;
+    MetricType type_;
+    std::vector<std::string> label_names_;
+    uint64_t id_;  // key of the per-thread lookup cache; never reused
+    mutable std::mutex mutex_;
+    std::vector<Series> series_;  // in creation order, which is the exposition order
+    std::unordered_map<std::string, uint32_t> index_;
+    size_t capped_label_ = SIZE_MAX;  // capLabel(); SIZE_MAX = no cap
+    size_t max_label_values_ = 0;
+    std::string overflow_value_;
+    std::unordered_set<std::string> label_values_;  // values of the capped label with their own series
+};
+
+// Counters and gauges that many threads update without sharing cache lines.
+// Every thread that increments gets its own block of slots (one slot per
+// series, 64-byte aligned chunks allocated on first touch), registered under
+// a mutex once per thread like Logger's per-thread buffers. An increment is a
+// relaxed load + store to the calling thread's slot; a scrape sums the slot
+// across all blocks. Blocks of exited threads are kept, so nothing is lost.
+//
+// Gauges use the same slots: inc/dec from any thread, summed on scrape (a
+// sum of wrapping uint64 deltas, read back as int64).
+class MetricsRegistry {
+public:
+    static constexpr size_t SLOTS_PER_CHUNK = 64;
+    static constexpr size_t MAX_CHUNKS = 1024;
+    static constexpr size_t MAX_SERIES = SLOTS_PER_CHUNK * MAX_CHUNKS;
+
+    MetricsRegistry();
+    ~MetricsRegistry();
+    MetricsRegistry(const MetricsRegistry&) = delete;
+    MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+    // Returns the existing family when name was registered before
+    MetricFamily& family(const std::string& name, const std::string& help, MetricType type,
+                         std::vector<std::string> label_names = {});
+    // Shorthands for an unlabelled series
+    Counter counter(const std::string& name, const std::string& help);
+    Counter gauge(const std::string& name, const std::string& help);
+
+    // Every family in registration order
+    void writePrometheus(std::ostream& out) const;
+
+private:
+    friend class Counter;
+    friend class MetricFamily;
+
+    struct alignas(64) Chunk {
+        std::atomic<uint64_t> slots[SLOTS_PER_CHUNK] = {};
+    };
+    struct ThreadBlock {
+        std::atomic<Chunk*> chunks[MAX_CHUNKS] = {};
+        ~ThreadBlock();
+    };
+
+    std::atomic<uint64_t>& threadSlot(uint32_t slot) {
+        thread_local std::vector<ThreadBlock*> blocks;
+        ThreadBlock* block = id_ < blocks.size() ? blocks[id_] : nullptr;
+        if (!block) block = registerBlock(blocks);
+        Chunk* chunk = block->chunks[slot / SLOTS_PER_CHUNK].load(std::memory_order_acquire);
+        if (!chunk) chunk = allocateChunk(*block, slot / SLOTS_PER_CHUNK);
+        return chunk->slots[slot % SLOTS_PER_CHUNK];
+    }
+    ThreadBlock* registerBlock(std::vector<ThreadBlock*>& thread_blocks);
+    Chunk* allocateChunk(ThreadBlock& block, size_t chunk);
+    uint32_t allocateSlot();
+    int64_t sum(uint32_t slot) const;
+
+    size_t id_;  // slot in every thread's block table; never reused
+    std::atomic<uint32_t> next_slot_;
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<ThreadBlock>> blocks_;
+    std::vector<std::unique_ptr<MetricFamily>> families_;
+};
+
+inline void Counter::add(int64_t delta) const {
+    std::atomic<uint64_t>& cell = registry_->threadSlot(slot_);
+    cell.store(cell.load(std::memory_order_relaxed) + static_cast<uint64_t>(delta), std::memory_order_relaxed);
+}
+
+} // namespace tradeflow
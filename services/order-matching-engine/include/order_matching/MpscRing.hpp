@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace tradeflow {
+
+// Bounded lock-free multi-producer / single-consumer ring. Each cell carries
+// a sequence number that tells producers whether it is free for position
+// `pos` and tells the consumer whether it has been published, so producers
+// only contend on one fetch of the tail and never on the consumer's cursor.
+// Capacity is rounded up to a power of two. tryPush fails when the ring is
+// full; callers decide whether to spin, yield or reject.
+template <typename T>
+class MpscRing {
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    std::unique_ptr<Cell[]> cells_;
+    size_t mask_;
+    alignas(64) std::atomic<size_t> tail_;  // next position producers claim
+    alignas(64) std::atomic<size_t> head_;  // next position the consumer reads; written by the consumer only
+
+public:
+    explicit MpscRing(size_t capacity)
+        : cells_(), mask_(std::bit_ceil(capacity < 2 ? size_t(2) : capacity) - 1), tail_(0), head_(0) {
+        cells_ = std::make_unique<Cell[]>(mask_ + 1);
+        for (size_t i = 0; i <= mask_; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpscRing(const MpscRing&) = delete;
+    MpscRing& operator=(const MpscRing&) = delete;
+
+    size_t capacity() const { return mask_ + 1; }
+
+    // Any thread. Returns false if the ring is full.
+    bool tryPush(const T& value) {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells_[pos & mask_];
+            size_t seq = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value = value;
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;  // consumer has not freed this cell yet
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Consumer thread only. Returns false if nothing has been published.
+    bool tryPop(T& out) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        Cell& cell = cells_[head & mask_];
+        size_t seq = cell.sequence.load(std::memory_order_acquire);
+        if (seq != head + 1) return false;
+        out = std::move(cell.value);
+        cell.sequence.store(head + mask_ + 1, std::memory_order_release);
+        head_.store(head + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Consumer thread only.
+    bool empty() const {
+        size_t head = head_.load(std::memory_order_relaxed);
+        return cells_[head & mask_].sequence.load(std::memory_order_acquire) != head + 1;
+    }
+
+    // Any thread. Positions claimed so far; every push that has returned
+    // true is below this mark.
+    size_t claimed() const { return tail_.load(std::memory_order_acquire); }
+
+    // Any thread. Claimed-but-unconsumed positions; approximate while
+    // producers and the consumer are running.
+    size_t sizeApprox() const {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t head = head_.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+};
+
+} // namespace tradeflow
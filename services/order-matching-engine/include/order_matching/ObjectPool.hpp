@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace tradeflow {
+
+struct PoolStats {
+    size_t capacity;    // objects backed by allocated slabs
+    size_t in_use;      // objects currently handed out
+    size_t high_water;  // peak in_use since the pool was created
+    size_t slabs;       // number of slab allocations made
+};
+
+// Slab-backed free-list pool. Objects are default-constructed once when their
+// slab is allocated and are recycled (not destroyed) on release, so the caller
+// re-initialises them on acquire and members such as std::string keep their
+// capacity. Once the pool has grown to the working-set size, acquire/release
+// never touch the heap. Not thread-safe; the owning OrderBook serialises access.
+template <typename T>
+class ObjectPool {
+private:
+    std::vector<std::unique_ptr<T[]>> slabs_;
+    std::vector<T*> free_list_;
+    size_t slab_size_;
+    size_t capacity_;
+    size_t in_use_;
+    size_t high_water_;
+
+    void grow(size_t count) {
+        slabs_.push_back(std::make_unique<T[]>(count));
+        T* slab = slabs_.back().get();
+        capacity_ += count;
+        free_list_.reserve(capacity_);
+        // Push in reverse so the first acquire hands out the start of the slab
+        for (size_t i = count; i > 0; --i) {
+            free_list_.push_back(&slab[i - 1]);
+        }
+    }
+
+public:
+    explicit ObjectPool(size_t reserve = 0, size_t slab_size = 256)
+        : slabs_(), free_list_(), slab_size_(slab_size ? slab_size : 1), capacity_(0), in_use_(0), high_water_(0) {
+        if (reserve > 0) grow(reserve);
+    }
+
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+
+    T* acquire() {
+        if (free_list_.empty()) grow(slab_size_);
+        T* obj = free_list_.back();
+        free_list_.pop_back();
+        if (++in_use_ > high_water_) high_water_ = in_use_;
+        return obj;
+    }
+
+    void release(T* obj) {
+        free_list_.push_back(obj);
+        --in_use_;
+    }
+
+    PoolStats stats() const {
+        return PoolStats{capacity_, in_use_, high_water_, slabs_.size()};
+    }
+};
+
+} // namespace tradeflow
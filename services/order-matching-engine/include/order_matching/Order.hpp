@@ -1,7 +1,7 @@
 #pragma once
 
-#include <chrono>
-#include <string>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 
 namespace tradeflow {
@@ -9,20 +9,40 @@ namespace tradeflow {
 using Price = int64_t;  // Price in ticks (e.g., 100.00 = 10000 ticks if tick_size=0.01)
 using Quantity = int32_t;
 using OrderId = int64_t;
-using Timestamp = std::chrono::system_clock::time_point;
+using SymbolHandle = uint32_t;  // symbolNames() handle
+using ClientHandle = uint32_t;  // handle in the owning book's ClientTable
 
+// Longest symbol and client id that survive the journals, the command log
+// and snapshots, whose records hold them in fixed-width fields. The service
+// rejects longer ones at the RPC boundary.
+inline constexpr size_t MAX_SYMBOL_LENGTH = 24;
+inline constexpr size_t MAX_CLIENT_ID_LENGTH = 64;
+
+struct PriceLevel;
+
+// A resting order: only what matching and cancellation touch. The price is
+// the owning level's and the client a handle in the book's ClientTable, so
+// an order is 48 bytes with nothing on the heap; time priority is its queue
+// position.
 struct Order {
     OrderId id;
-    bool is_buy;
     Quantity quantity;
-    Price price;
-    Timestamp timestamp;
-    std::string client_id;
-    std::string symbol;
+    ClientHandle client;
+    bool is_buy;
+
+    // Intrusive links into the owning PriceLevel's FIFO queue
+    Order* prev;
+    Order* next;
+    PriceLevel* level;
 
     Order();
-    Order(OrderId id_, bool is_buy_, Quantity quantity_, Price price_,
-          const std::string& client_id_, const std::string& symbol_);
+    Order(OrderId id_, bool is_buy_, Quantity quantity_, ClientHandle client_);
+
+    // Re-initialise a recycled pool object in place
+    void reset(OrderId id_, bool is_buy_, Quantity quantity_, ClientHandle client_);
+
+    // The owning level's price; only while the order rests (PriceLevel.hpp)
+    Price price() const;
 };
 
 } // namespace tradeflow
@@ -1,72 +1,317 @@
 #pragma once
 
-#include <deque>
-#include <unordered_map>
+#include <atomic>
 #include <map>
 #include <memory>
+#include <memory_resource>
+#include <mutex>
 #include <functional>
 #include <vector>
 #include <shared_mutex>
+#include <string_view>
+#include <type_traits>
+#include "Clock.hpp"
+#include "DepthCache.hpp"
+#include "Interner.hpp"
 #include "Order.hpp"
-#include "TradeLog.hpp"
+#include "ObjectPool.hpp"
+#include "OrderIdIndex.hpp"
+#include "PriceLadder.hpp"
+#include "PriceLevel.hpp"
+#include "ProRataAllocator.hpp"
+#include "TradeJournal.hpp"
 
 namespace tradeflow {
 
+class CommandLog;
+
 enum class MatchingMode {
     PRICE_TIME_PRIORITY,
     PRO_RATA,
     CALL_AUCTION
 };
 
+enum class OrderType {
+    LIMIT,   // match what crosses, rest the remainder
+    MARKET,  // match at any price, cancel the remainder
+    IOC,     // match what crosses the limit, cancel the remainder
+    FOK      // fill completely within the limit or do nothing
+};
+
+enum class SubmitStatus {
+    RESTING,           // nothing crossed; the whole order rests
+    PARTIALLY_FILLED,  // LIMIT: some quantity traded, the remainder rests
+    FILLED,            // fully traded on arrival; no Order was created
+    CANCELLED,         // MARKET/IOC: remainder cancelled (filled_quantity may be > 0)
+    REJECTED           // duplicate id, FOK not fillable, or type unsupported in this mode
+};
+
+struct SubmitResult {
+    SubmitStatus status;
+    Quantity filled_quantity;
+    Quantity remaining_quantity;  // resting for LIMIT, cancelled otherwise
+};
+
 struct Trade {
     OrderId buy_order_id;
     OrderId sell_order_id;
     Price price;
     Quantity quantity;
-    std::string symbol;
-    Timestamp timestamp;
+    SymbolHandle symbol;   // the book's getSymbolHandle()
+    uint64_t sequence;     // the book's trades numbered from 1; this, not timestamp, orders them
+    ClockTicks timestamp;  // a reading of the book's clock(); toEpochNanos for wall time
 };
+static_assert(std::is_trivially_copyable_v<Trade>, "trades are copied into rings and journals as bytes");
 
-using TradeCallback = std::function<void(const Trade&)>;
+// One command of OrderBook::applyBatch
+struct BookCommand {
+    enum class Kind { SUBMIT, CANCEL, MODIFY };
+
+    Kind kind = Kind::SUBMIT;
+    OrderId id = 0;
+    bool is_buy = false;                     // SUBMIT
+    OrderType type = OrderType::LIMIT;       // SUBMIT
+    Quantity quantity = 0;                   // SUBMIT: size; MODIFY: new size
+    Price price = 0;                         // SUBMIT: limit; MODIFY: new price
+    std::string_view client_id;              // SUBMIT; must outlive the applyBatch call
+};
+
+struct BookCommandResult {
+    SubmitResult submit{SubmitStatus::REJECTED, 0, 0};  // SUBMIT
+    bool found = false;                                 // CANCEL/MODIFY: the order was resting
+    bool applied = false;                               // the command ran; false past a throwing one
+};
 
-struct PriceLevel {
+// A price level's aggregate quantity after a change; 0 means the level is gone
+struct LevelUpdate {
+    bool is_buy;
     Price price;
-    Quantity total_quantity;
-    std::deque<Order*> orders;  // FIFO queue
+    Quantity quantity;
+};
 
-    PriceLevel(Price p) : price(p), total_quantity(0) {}
+using TradeCallback = std::function<void(const Trade&)>;
+// Invoked under the book lock when an order leaves the book (fully filled or
+// cancelled). Must not call back into the book.
+using OrderClosedCallback = std::function<void(OrderId)>;
+// Invoked under the book lock at the end of every call (addOrder, submitOrder,
+// cancelOrder, modifyOrder, modifyAndMatch, triggerMatching, applyBatch) that
+// changed any level, with the book's new depth sequence and each changed
+// level once.
+// Must not call back into the book.
+using DepthCallback = std::function<void(uint64_t sequence, const std::vector<LevelUpdate>&)>;
+
+// Per-book sizing. Pools and index nodes are pre-reserved at construction so
+// a book that stays within these bounds never allocates on add/match/cancel.
+struct OrderBookConfig {
+    size_t order_pool_reserve = 0;     // Order objects allocated up front
+    size_t level_pool_reserve = 0;     // PriceLevel objects allocated up front
+    size_t order_pool_slab_size = 256; // growth step once the reservation is exhausted
+    size_t level_pool_slab_size = 64;
+    size_t order_index_capacity = 0;   // resting orders the id index holds before rehashing; 0 = order_pool_reserve
+    BookLayout layout = BookLayout::SPARSE_MAP;
+    size_t ladder_ticks = 4096;        // TICK_LADDER band width per side, in ticks
+    Price ladder_base_price = 0;       // lowest price of the band; 0 = centre on first order
+    bool locking = true;               // false when a single Sequencer thread owns the book
+    size_t published_depth = 10;       // levels per side kept in the lock-free DepthCache (at least 1: the BBO)
+    ProRataConfig pro_rata;            // PRO_RATA allocation rules
+    const Clock* clock = nullptr;      // stamps trades; must outlive the book; nullptr = systemClock()
 };
 
 class OrderBook {
 private:
-    std::unordered_map<OrderId, std::unique_ptr<Order>> order_map_;
-    std::map<Price, std::unique_ptr<PriceLevel>> bid_levels_;  // Buy: higher price first
-    std::map<Price, std::unique_ptr<PriceLevel>, std::greater<Price>> ask_levels_;  // Sell: lower price first
+    // Node storage for the out-of-band level maps; recycles freed nodes
+    // instead of returning them to the global heap. Declared first so it
+    // outlives them.
+    std::pmr::unsynchronized_pool_resource node_resource_;
+    ObjectPool<Order> order_pool_;
+    ObjectPool<PriceLevel> level_pool_;
+    OrderIdIndex<Order> order_index_;
+    PriceLadder bid_levels_;  // Buy: higher price first
+    PriceLadder ask_levels_;  // Sell: lower price first
     mutable std::shared_mutex mutex_;
+    bool locking_;
     MatchingMode mode_;
     TradeCallback trade_callback_;
+    OrderClosedCallback order_closed_callback_;
+    DepthCallback depth_callback_;
+    std::vector<LevelUpdate> level_updates_;  // levels changed by the current call
+    uint64_t depth_sequence_;                 // bumped once per call that changed a level
+    DepthCache depth_cache_;
+    // Pool stats as of the last publishDepth, for readers that must not take
+    // the book lock or queue on its shard; written by the book's writer only
+    struct PublishedPoolStats {
+        std::atomic<size_t> capacity{0};
+        std::atomic<size_t> in_use{0};
+        std::atomic<size_t> high_water{0};
+        std::atomic<size_t> slabs{0};
+
+        void store(const PoolStats& stats) {
+            capacity.store(stats.capacity, std::memory_order_relaxed);
+            in_use.store(stats.in_use, std::memory_order_relaxed);
+            high_water.store(stats.high_water, std::memory_order_relaxed);
+            slabs.store(stats.slabs, std::memory_order_relaxed);
+        }
+        PoolStats load() const {
+            return PoolStats{capacity.load(std::memory_order_relaxed), in_use.load(std::memory_order_relaxed),
+                             high_water.load(std::memory_order_relaxed), slabs.load(std::memory_order_relaxed)};
+        }
+    };
+    PublishedPoolStats published_order_pool_;
+    PublishedPoolStats published_level_pool_;
     std::string symbol_;
-    std::unique_ptr<TradeLog> trade_log_;
+    SymbolHandle symbol_handle_;
+    ClientTable clients_;          // client ids of the resting orders (Order::client)
+    TradeJournal* trade_journal_;  // not owned; usually shared by every book on a shard
+    CommandLog* command_log_;      // not owned; shared by every book
+    uint64_t last_sequence_;       // sequence of the last logged command applied here
+    uint64_t trade_sequence_;      // Trade::sequence of the last trade
+    const Clock* clock_;
+    ProRataConfig pro_rata_;
+
+    // One level's orders gathered for allocateProRata; kept between matches
+    // so a level only allocates when it is the largest seen so far
+    struct LevelAllocation {
+        std::vector<Order*> orders;
+        std::vector<Quantity> quantities;
+        std::vector<Quantity> allocations;
+    };
+    LevelAllocation bid_allocation_;
+    LevelAllocation ask_allocation_;
+    // CALL_AUCTION: tie-break price for the next uncross (the last clearing
+    // price) and scratch for computeAuction
+    Price auction_reference_;
+    std::vector<std::pair<Price, Quantity>> auction_bids_;
+    std::vector<std::pair<Price, Quantity>> auction_asks_;
+    std::vector<AuctionResult> auction_candidates_;
 
-    void addToLevel(Order* order);
+    // Book locks; empty (no-op) guards when the book is single-writer
+    std::unique_lock<std::shared_mutex> writeLock() const;
+    std::shared_lock<std::shared_mutex> readLock() const;
+    PriceLevel* acquireLevel(Price px);
+    void releaseOrder(Order* order);
+    void addToLevel(Order* order, Price px);
     void removeFromLevel(Order* order);
+    // Record a level's new aggregate for the DepthCache and DepthCallback
+    void levelChanged(bool is_buy, const PriceLevel& level) { recordLevel(is_buy, level.price, level.total_quantity); }
+    void recordLevel(bool is_buy, Price px, Quantity qty);
+    // End of a locked call: republish the DepthCache if the recorded levels
+    // reach it and hand them to the DepthCallback
+    void publishDepth();
     Price getBestBid() const;
     Price getBestAsk() const;
+    bool crosses(bool is_buy, Price limit, Price level_px) const {
+        return is_buy ? level_px <= limit : level_px >= limit;
+    }
+    bool canFill(bool is_buy, Quantity qty, Price limit) const;
+    Quantity matchAggressor(OrderId id, bool is_buy, Quantity qty, Price limit);
+    Quantity fillAtLevel(PriceLevel* level, OrderId id, bool is_buy, Quantity qty);
     void matchOrders();
     void matchPriceTime(PriceLevel* bid_level, PriceLevel* ask_level);
     void matchProRata(PriceLevel* bid_level, PriceLevel* ask_level);
-    void executeTrade(Order* buy_order, Order* sell_order, Quantity qty, Price px);
+    // Split qty across a level's orders by the book's ProRataConfig
+    void allocateLevel(const PriceLevel& level, Quantity qty, LevelAllocation& split);
+    // Release the orders of split that allocation left empty
+    void releaseFilled(PriceLevel* level, const LevelAllocation& split);
+    AuctionResult computeAuction(Price reference_price);
+    void executeAuction(const AuctionResult& auction);
+    void executeTrade(OrderId buy_id, OrderId sell_id, Quantity qty, Price px);
+    // Command bodies; the caller holds the write lock
+    SubmitResult applySubmit(OrderId id, bool is_buy, Quantity qty, Price px, std::string_view client_id,
+                             OrderType type);
+    bool applyCancel(OrderId id);
+    bool applyModify(OrderId id, Quantity new_qty, Price new_px);
+    void applyMatch();
+    AuctionResult applyUncross(Price reference_price);
 
 public:
-    explicit OrderBook(const std::string& symbol, MatchingMode mode = MatchingMode::PRICE_TIME_PRIORITY);
+    explicit OrderBook(const std::string& symbol, MatchingMode mode = MatchingMode::PRICE_TIME_PRIORITY,
+                       const OrderBookConfig& config = OrderBookConfig());
+    const std::string& getSymbol() const { return symbol_; }
+    SymbolHandle getSymbolHandle() const { return symbol_handle_; }
+    MatchingMode getMatchingMode() const { return mode_; }
     void setTradeCallback(TradeCallback callback);
-    void setTradeLog(std::unique_ptr<TradeLog> log);
-    bool addOrder(OrderId id, bool is_buy, Quantity qty, Price px, const std::string& client_id);
+    void setOrderClosedCallback(OrderClosedCallback callback);
+    void setDepthCallback(DepthCallback callback);
+    // Append every execution to journal (nullptr to stop); the journal must
+    // outlive the book. Both throw invalid_argument if the symbol is longer
+    // than MAX_SYMBOL_LENGTH, since the records could not name the book.
+    void setTradeJournal(TradeJournal* journal);
+    // Append every state-changing command to log (nullptr to stop) before it
+    // is acknowledged; the log must outlive the book
+    void setCommandLog(CommandLog* log);
+    // Recovery: the sequence of the last command replayed into the book
+    void setLastSequence(uint64_t sequence) { last_sequence_ = sequence; }
+    uint64_t lastSequence() const { return last_sequence_; }
+    // Trades so far, i.e. the last Trade::sequence; recovery restores it
+    // from the snapshot, and replaying the command tail then renumbers the
+    // same trades the same way
+    uint64_t tradeSequence() const { return trade_sequence_; }
+    void setTradeSequence(uint64_t sequence) { trade_sequence_ = sequence; }
+    const Clock& clock() const { return *clock_; }
+    // Rest an order without matching it (replay, tests, auction collection).
+    // The client id is only read during the call; a resting order holds a
+    // handle in the book's own client table.
+    bool addOrder(OrderId id, bool is_buy, Quantity qty, Price px, std::string_view client_id);
+    // Match an incoming order against the opposite side, then rest or cancel
+    // the remainder according to its type. MARKET ignores px. Fires the
+    // OrderClosedCallback for ids that end without resting (except duplicates).
+    SubmitResult submitOrder(OrderId id, bool is_buy, Quantity qty, Price px, std::string_view client_id,
+                             OrderType type = OrderType::LIMIT);
     bool cancelOrder(OrderId id);
+    // Throws invalid_argument, changing nothing, unless new_qty and new_px
+    // are positive
     bool modifyOrder(OrderId id, Quantity new_qty, Price new_px);
+    // modifyOrder, then triggerMatching if the order was found, under one
+    // lock acquisition and publishing depth once: a repriced order may now
+    // cross, and no other call can run in between
+    bool modifyAndMatch(OrderId id, Quantity new_qty, Price new_px);
     std::vector<std::pair<Price, Quantity>> getBidLevels() const;
     std::vector<std::pair<Price, Quantity>> getAskLevels() const;
+    // Up to max_levels best levels per side (0 = all) under one read lock.
+    // Returns the depth sequence they reflect: DepthCallback updates up to and
+    // including it are already applied.
+    uint64_t getDepth(size_t max_levels, std::vector<std::pair<Price, Quantity>>& bids,
+                      std::vector<std::pair<Price, Quantity>>& asks) const;
+    // Lock-free reads of the DepthCache, from any thread and in either
+    // execution mode; they never touch the book mutex or its shard.
+    size_t publishedDepth() const { return depth_cache_.depth(); }
+    // Like getDepth, but at most publishedDepth() levels per side (0 = that many)
+    uint64_t readPublishedDepth(size_t max_levels, std::vector<std::pair<Price, Quantity>>& bids,
+                                std::vector<std::pair<Price, Quantity>>& asks) const {
+        return depth_cache_.read(max_levels, bids, asks);
+    }
+    TopOfBook topOfBook() const { return depth_cache_.top(); }
+    // Match crossed levels (continuous modes; a call auction only trades in
+    // uncross)
     void triggerMatching();
+    // Call auction: trade every crossed order that can trade at the
+    // equilibrium price, all at that price and in price-time priority, and
+    // return it. The price maximises executable volume, then minimises the
+    // imbalance, then is the level price nearest reference_price (0 = the
+    // last clearing price; with neither, the middle of the tied prices).
+    // Works on any book, but only a CALL_AUCTION book rests crossed.
+    AuctionResult uncross(Price reference_price = 0);
+    // CALL_AUCTION: what uncross() would do now, lock-free from the
+    // DepthCache (all zero for other modes)
+    AuctionResult indicativeAuction() const { return depth_cache_.auction(); }
+    // Apply commands in order under a single write-lock acquisition, with the
+    // same effects as the one-at-a-time calls; a MODIFY runs as modifyAndMatch.
+    // results is resized to match commands.
+    void applyBatch(const std::vector<BookCommand>& commands, std::vector<BookCommandResult>& results);
+    // Visit every resting order under the read lock: bids then asks, best
+    // price first and FIFO within a level, so adding them back in this
+    // order rebuilds the same queues. Returns lastSequence() as of the visit,
+    // and stores tradeSequence() as of it in trade_sequence if given.
+    uint64_t forEachOrder(const std::function<void(const Order&)>& visit, uint64_t* trade_sequence = nullptr) const;
+    // The client id of a resting order's Order::client; for forEachOrder
+    // visitors, while the book is held
+    const std::string& clientName(ClientHandle client) const { return clients_.name(client); }
+    PoolStats getOrderPoolStats() const;
+    PoolStats getLevelPoolStats() const;
+    // Lock-free, from any thread: the pool stats as of the last call that
+    // changed a level, each field read on its own (metrics scrapes)
+    PoolStats publishedOrderPoolStats() const { return published_order_pool_.load(); }
+    PoolStats publishedLevelPoolStats() const { return published_level_pool_.load(); }
 };
 
 } // namespace tradeflow
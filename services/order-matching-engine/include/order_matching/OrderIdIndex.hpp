@@ -0,0 +1,112 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Order.hpp"
+
+namespace tradeflow {
+
+// Flat open-addressing map from OrderId to T*. Slots are a single contiguous
+// array probed linearly, so a lookup is usually one cache line. Deletion
+// uses backward shifting instead of tombstones: the following run is pulled
+// back over the hole, which keeps probe lengths bounded under heavy
+// add/cancel churn without periodic rehashing. A null value marks an empty
+// slot, so null cannot be stored. Grows (and allocates) only when the load
+// factor would exceed 1/2; size it with reserve() to keep the hot path
+// allocation-free. Not thread-safe.
+template <typename T>
+class OrderIdIndex {
+private:
+    struct Slot {
+        OrderId key;
+        T* value;
+    };
+
+    std::vector<Slot> slots_;
+    size_t mask_;
+    size_t size_;
+    int shift_;
+
+    // Fibonacci hashing: spreads dense sequential ids across the table while
+    // keeping the top bits, which are the well-mixed ones.
+    size_t home(OrderId key) const {
+        return static_cast<size_t>((static_cast<uint64_t>(key) * 0x9E3779B97F4A7C15ull) >> shift_);
+    }
+
+    void rehash(size_t capacity) {
+        std::vector<Slot> old;
+        old.swap(slots_);
+        slots_.assign(capacity, Slot{0, nullptr});
+        mask_ = capacity - 1;
+        shift_ = 64 - std::countr_zero(capacity);
+        size_ = 0;
+        for (const Slot& slot : old) {
+            if (slot.value) insert(slot.key, slot.value);
+        }
+    }
+
+public:
+    explicit OrderIdIndex(size_t expected = 0) : slots_(), mask_(0), size_(0), shift_(64) {
+        reserve(expected);
+    }
+
+    // Make room for `count` entries without further growth.
+    void reserve(size_t count) {
+        size_t capacity = std::bit_ceil(count * 2 < 16 ? size_t(16) : count * 2);
+        if (capacity > slots_.size()) rehash(capacity);
+    }
+
+    T* find(OrderId key) const {
+        for (size_t i = home(key);; i = (i + 1) & mask_) {
+            const Slot& slot = slots_[i];
+            if (!slot.value) return nullptr;
+            if (slot.key == key) return slot.value;
+        }
+    }
+
+    // Returns false (and leaves the entry untouched) if the key is present.
+    bool insert(OrderId key, T* value) {
+        if ((size_ + 1) * 2 > slots_.size()) rehash(slots_.size() * 2);
+        for (size_t i = home(key);; i = (i + 1) & mask_) {
+            Slot& slot = slots_[i];
+            if (!slot.value) {
+                slot = Slot{key, value};
+                ++size_;
+                return true;
+            }
+            if (slot.key == key) return false;
+        }
+    }
+
+    // Removes the entry and returns its value, or nullptr if absent.
+    T* erase(OrderId key) {
+        size_t i = home(key);
+        while (true) {
+            if (!slots_[i].value) return nullptr;
+            if (slots_[i].key == key) break;
+            i = (i + 1) & mask_;
+        }
+        T* removed = slots_[i].value;
+        // Shift later members of the run back into the hole unless they are
+        // already sitting between their home slot and the hole.
+        size_t hole = i;
+        for (size_t j = (i + 1) & mask_; slots_[j].value; j = (j + 1) & mask_) {
+            size_t h = home(slots_[j].key);
+            if (((j - h) & mask_) >= ((j - hole) & mask_)) {
+                slots_[hole] = slots_[j];
+                hole = j;
+            }
+        }
+        slots_[hole] = Slot{0, nullptr};
+        --size_;
+        return removed;
+    }
+
+    size_t size() const { return size_; }
+    size_t capacity() const { return slots_.size(); }
+    bool empty() const { return size_ == 0; }
+};
+
+} // namespace tradeflow
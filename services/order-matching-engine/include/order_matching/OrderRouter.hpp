@@ -0,0 +1,50 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include "OrderIdIndex.hpp"
+
+namespace tradeflow {
+
+class OrderBook;
+
+// Process-wide order-id -> owning OrderBook map, so cancel and modify go
+// straight to one book instead of scanning every symbol under a global lock.
+// The table is split into independently locked stripes (id modulo stripe
+// count); with sequential ids consecutive orders land on different stripes,
+// so concurrent submits and cancels rarely contend.
+//
+// Routes are added before the order reaches its book and removed by the
+// book's OrderClosedCallback when the order fills or is cancelled. A stripe
+// lock is never held while calling into a book, so taking it from inside the
+// book lock cannot deadlock.
+class OrderRouter {
+private:
+    struct alignas(64) Stripe {
+        std::mutex mutex;
+        OrderIdIndex<OrderBook> index;
+    };
+
+    std::unique_ptr<Stripe[]> stripes_;
+    size_t stripe_count_;
+
+    Stripe& stripeFor(OrderId id) const {
+        return stripes_[static_cast<uint64_t>(id) % stripe_count_];
+    }
+
+public:
+    // reserve: expected resting orders across all books
+    explicit OrderRouter(size_t stripes = 64, size_t reserve = 0);
+
+    OrderRouter(const OrderRouter&) = delete;
+    OrderRouter& operator=(const OrderRouter&) = delete;
+
+    // Returns false if the id is already routed
+    bool add(OrderId id, OrderBook* book);
+    void remove(OrderId id);
+    // Owning book, or nullptr if the order is unknown or already closed
+    OrderBook* find(OrderId id) const;
+    size_t size() const;
+};
+
+} // namespace tradeflow
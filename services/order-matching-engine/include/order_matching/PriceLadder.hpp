@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory_resource>
+#include <vector>
+#include "PriceLevel.hpp"
+
+namespace tradeflow {
+
+// How a book side stores its price levels.
+enum class BookLayout {
+    SPARSE_MAP,   // ordered map keyed by price (red-black tree)
+    TICK_LADDER   // flat tick-indexed array around a price band, map for outliers
+};
+
+// Hierarchical occupancy bitmap: level 0 holds one bit per tick, each higher
+// level holds one bit per non-empty word of the level below. Finding the next
+// or previous occupied tick touches at most one word per level.
+class TickBitmap {
+private:
+    std::vector<std::vector<uint64_t>> levels_;
+    size_t bits_;
+
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    TickBitmap() : levels_(), bits_(0) {}
+    void resize(size_t bits);
+    size_t size() const { return bits_; }
+    void set(size_t i);
+    void clear(size_t i);
+    void clearAll();
+    // Lowest set index >= i, or npos
+    size_t findNext(size_t i) const;
+    // Highest set index <= i, or npos
+    size_t findPrev(size_t i) const;
+};
+
+// One side of an order book. In TICK_LADDER layout, prices inside
+// [base, base + ticks) live in a contiguous slot array indexed by tick offset
+// and are located through a TickBitmap; prices outside the band fall back to
+// a sparse ordered map. SPARSE_MAP layout is the same structure with an empty
+// band, so both layouts share one code path in OrderBook.
+class PriceLadder {
+private:
+    bool is_bid_;
+    bool fixed_base_;         // band pinned by configuration, never re-centred
+    Price base_;
+    size_t ticks_;
+    size_t ladder_count_;     // levels currently stored in slots_
+    std::vector<PriceLevel*> slots_;
+    TickBitmap occupancy_;
+    std::pmr::map<Price, PriceLevel*> sparse_;  // ascending; only prices outside the band
+
+    bool inBand(Price px) const { return ticks_ > 0 && px >= base_ && px - base_ < static_cast<Price>(ticks_); }
+    PriceLevel* ladderBest() const;
+    void recentre(Price px);
+
+public:
+    PriceLadder(bool is_bid, std::pmr::memory_resource* resource);
+
+    // Switch to TICK_LADDER with a band of `ticks` slots. base_price > 0 pins
+    // the band at [base_price, base_price + ticks); otherwise the band is
+    // centred on the first price inserted while the ladder is empty.
+    void configureBand(size_t ticks, Price base_price);
+
+    PriceLevel* find(Price px) const;
+    void insert(PriceLevel* level);
+    void erase(Price px);
+    // Best level on this side (highest bid / lowest ask), nullptr when empty
+    PriceLevel* best() const;
+    bool empty() const { return ladder_count_ == 0 && sparse_.empty(); }
+    size_t size() const { return ladder_count_ + sparse_.size(); }
+    size_t ladderSize() const { return ladder_count_; }
+
+    // Visit levels from best to worst price.
+    template <typename F>
+    void forEach(F&& visit) const {
+        forEachWhile([&](const PriceLevel& level) {
+            visit(level);
+            return true;
+        });
+    }
+
+    // Visit levels from best to worst price until visit returns false.
+    template <typename F>
+    void forEachWhile(F&& visit) const;
+};
+
+template <typename F>
+void PriceLadder::forEachWhile(F&& visit) const {
+    const Price band_end = base_ + static_cast<Price>(ticks_);
+    if (is_bid_) {
+        auto it = sparse_.rbegin();
+        for (; it != sparse_.rend() && ticks_ > 0 && it->first >= band_end; ++it) {
+            if (!visit(*it->second)) return;
+        }
+        if (ladder_count_ > 0) {
+            for (size_t i = occupancy_.findPrev(ticks_ - 1); i != TickBitmap::npos;
+                 i = i == 0 ? TickBitmap::npos : occupancy_.findPrev(i - 1)) {
+                if (!visit(*slots_[i])) return;
+            }
+        }
+        for (; it != sparse_.rend(); ++it) {
+            if (!visit(*it->second)) return;
+        }
+    } else {
+        auto it = sparse_.begin();
+        for (; it != sparse_.end() && ticks_ > 0 && it->first < base_; ++it) {
+            if (!visit(*it->second)) return;
+        }
+        if (ladder_count_ > 0) {
+            for (size_t i = occupancy_.findNext(0); i != TickBitmap::npos; i = occupancy_.findNext(i + 1)) {
+                if (!visit(*slots_[i])) return;
+            }
+        }
+        for (; it != sparse_.end(); ++it) {
+            if (!visit(*it->second)) return;
+        }
+    }
+}
+
+} // namespace tradeflow
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include "Order.hpp"
+
+namespace tradeflow {
+
+// Price level holding an intrusive doubly-linked FIFO of resting orders.
+// Links live in Order itself, so push, unlink and front are all O(1) and
+// cancelling an order deep inside a level never scans the queue.
+struct PriceLevel {
+    Price price;
+    Quantity total_quantity;
+    size_t order_count;
+    Order* head;  // oldest order, first in time priority
+    Order* tail;  // newest order
+
+    PriceLevel(Price p = 0) : price(p), total_quantity(0), order_count(0), head(nullptr), tail(nullptr) {}
+
+    bool empty() const { return head == nullptr; }
+    Order* front() const { return head; }
+
+    void pushBack(Order* order) {
+        order->level = this;
+        order->next = nullptr;
+        order->prev = tail;
+        if (tail) tail->next = order;
+        else head = order;
+        tail = order;
+        ++order_count;
+    }
+
+    void unlink(Order* order) {
+        if (order->prev) order->prev->next = order->next;
+        else head = order->next;
+        if (order->next) order->next->prev = order->prev;
+        else tail = order->prev;
+        order->prev = nullptr;
+        order->next = nullptr;
+        order->level = nullptr;
+        --order_count;
+    }
+};
+
+inline Price Order::price() const { return level->price; }
+
+} // namespace tradeflow
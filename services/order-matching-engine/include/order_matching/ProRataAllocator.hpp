@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include "Order.hpp"
+
+namespace tradeflow {
+
+struct ProRataConfig {
+    Quantity min_allocation = 1;  // proportional shares below this are not given; their lots join the residual
+    bool top_order = false;       // the first order in time priority is filled before the rest share
+};
+
+// Split qty across the resting orders of one level in proportion to their
+// open quantities (quantities[0..count), time priority first, summing to at
+// most a Quantity), writing allocations[i] <= quantities[i]. Returns the
+// quantity allocated, which is always min(qty, total of quantities), so a
+// match can never stall on shares that round to nothing. With top_order the
+// first order takes what it can; the rest get floor(q * remaining / total)
+// when that reaches min_allocation, and the lots left over are handed out
+// round-robin in time priority.
+//
+// The proportional pass is one branch-free loop over the two arrays with
+// no division in it, so callers gather a level's quantities into a
+// contiguous array rather than walking its list.
+Quantity allocateProRata(const ProRataConfig& config, const Quantity* quantities, size_t count, Quantity qty,
+                         Quantity* allocations);
+
+} // namespace tradeflow
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "BinaryJournal.hpp"
+#include "OrderBook.hpp"
+
+namespace tradeflow {
+
+enum class ReplayEventKind : uint8_t {
+    ADD = 1,     // OrderBook::addOrder (rests without matching)
+    SUBMIT = 2,  // OrderBook::submitOrder with order_type
+    CANCEL = 3,
+    MODIFY = 4,
+    MATCH = 5,   // OrderBook::triggerMatching
+    SYMBOL = 6   // defines symbol index `symbol`; the name is stored in place of the order fields
+};
+
+// Fixed-size replay event (native little-endian). Replay files are journal
+// files (JournalFileHeader, then records), so they are written and mapped
+// with the same code as the trade journal and command log.
+struct ReplayEvent {
+    ReplayEventKind kind;
+    uint8_t is_buy;
+    uint8_t order_type;  // OrderType, SUBMIT only
+    uint8_t reserved;
+    uint32_t symbol;     // index defined by an earlier SYMBOL event
+    int64_t order_id;
+    int64_t price;       // ticks
+    int32_t quantity;
+    uint32_t reserved2;
+};
+static_assert(sizeof(ReplayEvent) == 32, "ReplayEvent is a fixed 32-byte on-disk layout");
+
+inline constexpr char REPLAY_MAGIC[8] = {'T', 'F', 'R', 'E', 'P', 'L', 'A', 'Y'};
+inline constexpr uint32_t REPLAY_VERSION = 1;
+// Longest symbol name a SYMBOL event can carry
+inline constexpr size_t REPLAY_SYMBOL_BYTES = sizeof(ReplayEvent) - offsetof(ReplayEvent, order_id);
+
+ReplayEvent makeSymbolEvent(uint32_t index, const std::string& name);
+std::string replaySymbolName(const ReplayEvent& event);
+
+// Writes a replay file, replacing any existing one. Events are buffered and
+// written in large blocks; call finish() to surface write errors.
+class ReplayWriter {
+public:
+    explicit ReplayWriter(const std::string& path);
+    ~ReplayWriter();
+
+    ReplayWriter(const ReplayWriter&) = delete;
+    ReplayWriter& operator=(const ReplayWriter&) = delete;
+
+    // Index for name, emitting its SYMBOL event the first time. Throws if
+    // the name does not fit in REPLAY_SYMBOL_BYTES.
+    uint32_t symbol(const std::string& name);
+
+    void add(uint32_t symbol, OrderId id, bool is_buy, Quantity qty, Price px);
+    void submit(uint32_t symbol, OrderId id, bool is_buy, Quantity qty, Price px, OrderType type = OrderType::LIMIT);
+    void cancel(uint32_t symbol, OrderId id);
+    void modify(uint32_t symbol, OrderId id, Quantity qty, Price px);
+    void match(uint32_t symbol);
+    void append(const ReplayEvent& event);
+
+    // Write out buffered events; throws on I/O errors
+    void finish();
+    uint64_t events() const { return events_; }
+
+private:
+    JournalFile file_;
+    std::vector<ReplayEvent> buffer_;
+    std::vector<std::string> symbols_;
+    uint64_t events_;
+};
+
+class ReplayReader : public JournalReader<ReplayEvent> {
+public:
+    explicit ReplayReader(const std::string& path) : JournalReader<ReplayEvent>(path, REPLAY_MAGIC, REPLAY_VERSION) {}
+};
+
+// Apply one order event (not SYMBOL) to its book. Returns false if the book
+// refused it (unknown id, duplicate, rejected submit); throws for an unknown
+// event kind.
+bool applyReplayEvent(OrderBook& book, const ReplayEvent& event, std::string_view client);
+
+struct ReplayStats {
+    uint64_t events = 0;           // order events applied (SYMBOL events excluded)
+    uint64_t rejected = 0;         // adds/submits/cancels/modifies the book refused
+    uint64_t trades = 0;
+    uint64_t traded_quantity = 0;
+    uint64_t resting_orders = 0;   // left in the books at the end
+    uint64_t trade_checksum = 0;   // over (symbol, buy id, sell id, price, quantity) of every trade, in order
+    uint64_t book_checksum = 0;    // over every book's final resting orders, in priority order
+    size_t books = 0;
+    double seconds = 0;            // applying events (books are created by their SYMBOL events); excludes checksums
+};
+
+// Map a replay file and apply its events to one book per symbol, created
+// with the given mode and config. Books are single-writer (the config's
+// locking flag is ignored) and stamp trades from a VirtualClock reading
+// event index * 1us (the config's clock is ignored). Throws if the file is malformed or an event
+// names an undefined symbol.
+ReplayStats runReplay(const std::string& path, MatchingMode mode = MatchingMode::PRICE_TIME_PRIORITY,
+                      const OrderBookConfig& config = OrderBookConfig());
+
+} // namespace tradeflow
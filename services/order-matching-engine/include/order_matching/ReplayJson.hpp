@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <nlohmann/json.hpp>
+#include "Replay.hpp"
+
+namespace tradeflow {
+
+// Converts the JSON replay schema to binary events:
+//
+//   { "symbol": "ABC",            // optional, default "REPLAY"
+//     "events": [ { "type": "add", "id": 1, "is_buy": true, "qty": 100, "price": 1000 },
+//                 { "type": "submit", ..., "order_type": "ioc" },   // limit (default), market, ioc, fok
+//                 { "type": "cancel", "id": 1 },
+//                 { "type": "modify", "id": 1, "qty": 50, "price": 1001 },
+//                 { "type": "match" } ] }
+//
+// Any event may carry its own "symbol". Header-only so the engine library
+// does not depend on nlohmann_json. Returns the number of order events
+// written; throws std::invalid_argument on a malformed document.
+inline uint64_t convertJsonReplay(const nlohmann::json& doc, ReplayWriter& writer) {
+    if (!doc.is_object()) throw std::invalid_argument("replay JSON: expected an object");
+    if (!doc.contains("events") || !doc["events"].is_array()) {
+        throw std::invalid_argument("replay JSON: missing 'events' array");
+    }
+    const std::string default_symbol = doc.value("symbol", std::string("REPLAY"));
+
+    uint64_t converted = 0;
+    for (const auto& ev : doc["events"]) {
+        std::string type = ev.value("type", std::string());
+        uint32_t symbol = writer.symbol(ev.value("symbol", default_symbol));
+        OrderId id = ev.value("id", OrderId(0));
+        bool is_buy = ev.value("is_buy", true);
+        Quantity qty = ev.value("qty", Quantity(0));
+        Price price = ev.value("price", Price(0));
+        if (type == "add") {
+            writer.add(symbol, id, is_buy, qty, price);
+        } else if (type == "submit") {
+            std::string order_type = ev.value("order_type", std::string("limit"));
+            OrderType kind;
+            if (order_type == "limit") kind = OrderType::LIMIT;
+            else if (order_type == "market") kind = OrderType::MARKET;
+            else if (order_type == "ioc") kind = OrderType::IOC;
+            else if (order_type == "fok") kind = OrderType::FOK;
+            else throw std::invalid_argument("replay JSON: unknown order_type '" + order_type + "' in event " +
+                                             std::to_string(converted));
+            writer.submit(symbol, id, is_buy, qty, price, kind);
+        } else if (type == "cancel") {
+            writer.cancel(symbol, id);
+        } else if (type == "modify") {
+            writer.modify(symbol, id, qty, price);
+        } else if (type == "match") {
+            writer.match(symbol);
+        } else {
+            throw std::invalid_argument("replay JSON: unknown event type '" + type + "' in event " +
+                                        std::to_string(converted));
+        }
+        ++converted;
+    }
+    return converted;
+}
+
+} // namespace tradeflow
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "LatencyHistogram.hpp"
+#include "MpscRing.hpp"
+#include "OrderBook.hpp"
+
+namespace tradeflow {
+
+// Single-writer execution for a set of order books. Every command for a book
+// owned by this sequencer is pushed onto one bounded MPSC ring and applied,
+// in ring order, by the sequencer's own thread; the calling thread blocks
+// until its command has run. Books owned by a sequencer are created with
+// OrderBookConfig::locking = false, so the matching path takes no locks and
+// submit + match happen as one step that other submitters cannot interleave.
+//
+// Commands carry pointers into the caller's stack frame, which is safe
+// because the caller waits for completion before returning. An exception
+// thrown while a command runs is handed back and rethrown to the caller.
+//
+// With stage timing on, the time a command waited in the ring counts as
+// lock wait and the owning thread's StageTimes for the command are added to
+// the caller's, so RPC handlers see the same stages in both execution modes.
+//
+// cpu >= 0 pins the sequencer thread to that core (Linux only), so the books
+// it owns stay in one core's caches.
+class Sequencer {
+public:
+    explicit Sequencer(size_t ring_capacity = 4096, int cpu = -1, const std::string& name = "");
+    ~Sequencer();
+
+    Sequencer(const Sequencer&) = delete;
+    Sequencer& operator=(const Sequencer&) = delete;
+
+    // OrderBook::submitOrder on the owning thread
+    SubmitResult submit(OrderBook& book, OrderId id, bool is_buy, Quantity qty, Price px, std::string_view client_id,
+                        OrderType type = OrderType::LIMIT);
+    bool cancel(OrderBook& book, OrderId id);
+    // Modify, then uncross the book if the new price crosses
+    bool modify(OrderBook& book, OrderId id, Quantity new_qty, Price new_px);
+    // OrderBook::applyBatch on the owning thread: one ring round trip for the lot
+    void batch(OrderBook& book, const std::vector<BookCommand>& commands, std::vector<BookCommandResult>& results);
+    // Run fn on the sequencer thread, e.g. to read a consistent snapshot
+    void execute(OrderBook& book, const std::function<void(OrderBook&)>& fn);
+    // Run task on the sequencer thread, e.g. to create a book on its core
+    void execute(const std::function<void()>& task);
+
+    int cpu() const { return cpu_; }
+    uint64_t commandsProcessed() const { return commands_processed_.load(std::memory_order_relaxed); }
+    // Wall time spent draining commands, i.e. not polling an empty ring
+    uint64_t busyNanos() const { return busy_nanos_.load(std::memory_order_relaxed); }
+    size_t pendingCommands() const { return ring_.sizeApprox(); }
+
+private:
+    enum class CommandType { SUBMIT, CANCEL, MODIFY, BATCH, EXECUTE, TASK, STOP };
+
+    // PENDING -> DONE (result ready, the sequencer is still notifying) ->
+    // RELEASED (the sequencer is finished with it). The caller owns the
+    // completion and must not let it go out of scope before RELEASED.
+    enum CompletionState : uint32_t { PENDING, DONE, RELEASED };
+
+    struct Completion {
+        std::atomic<uint32_t> state{PENDING};
+        bool result = false;
+        std::exception_ptr error;
+        SubmitResult submit{SubmitStatus::REJECTED, 0, 0};
+        StageTimes stages;
+    };
+
+    struct Command {
+        CommandType type = CommandType::STOP;
+        OrderBook* book = nullptr;
+        OrderId id = 0;
+        bool is_buy = false;
+        OrderType order_type = OrderType::LIMIT;
+        Quantity quantity = 0;
+        Price price = 0;
+        std::string_view client_id;  // the caller's, which waits for the result
+        const std::vector<BookCommand>* commands = nullptr;
+        std::vector<BookCommandResult>* results = nullptr;
+        const std::function<void(OrderBook&)>* fn = nullptr;
+        const std::function<void()>* task = nullptr;
+        Completion* completion = nullptr;
+        uint64_t enqueued_ns = 0;  // set only while stage timing is on
+    };
+
+    MpscRing<Command> ring_;
+    alignas(64) std::atomic<bool> sleeping_;
+    std::atomic<uint64_t> commands_processed_;
+    std::atomic<uint64_t> busy_nanos_;
+    int cpu_;
+    std::string name_;
+    std::thread thread_;
+
+    bool run(Command& command, Completion& completion);
+    void enqueue(const Command& command);
+    void apply(Command& command);
+    void pinThread();
+    void loop();
+};
+
+} // namespace tradeflow
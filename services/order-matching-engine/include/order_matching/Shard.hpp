@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "OrderBook.hpp"
+#include "Sequencer.hpp"
+#include "TradeJournal.hpp"
+
+namespace tradeflow {
+
+// Symbol -> shard assignment. Symbols are hashed with FNV-1a (stable across
+// processes and builds, unlike std::hash) and placed with jump consistent
+// hashing, so growing from N to N+1 shards moves only ~1/(N+1) of the
+// symbols. Explicit overrides pin hot names to a chosen shard.
+class ShardMap {
+private:
+    size_t shard_count_;
+    std::unordered_map<std::string, size_t> overrides_;
+
+public:
+    explicit ShardMap(size_t shard_count = 1, std::unordered_map<std::string, size_t> overrides = {});
+
+    size_t shardCount() const { return shard_count_; }
+    size_t shardFor(const std::string& symbol) const;
+
+    static uint64_t hashSymbol(const std::string& symbol);
+    // Lamping & Veach, "A Fast, Minimal Memory, Consistent Hash Algorithm"
+    static size_t jumpHash(uint64_t key, size_t buckets);
+};
+
+// One engine shard: a pinned Sequencer plus the books it owns. Books are
+// created on the shard's own thread so their pools and index tables are
+// first touched (and, on NUMA hosts, placed) by the core that runs them.
+// Only the sequencer thread inserts into the registry, taking its lock just
+// for the insert; book state is touched by the sequencer thread alone. An optional trade journal is shared by the
+// shard's books, so each shard writes its own file with a single producer.
+class Shard {
+public:
+    using BookFactory = std::function<std::unique_ptr<OrderBook>(const std::string& symbol)>;
+
+    Shard(size_t index, size_t ring_capacity, int cpu, std::unique_ptr<TradeJournal> journal = nullptr);
+
+    Shard(const Shard&) = delete;
+    Shard& operator=(const Shard&) = delete;
+
+    size_t index() const { return index_; }
+    Sequencer& sequencer() { return sequencer_; }
+    const Sequencer& sequencer() const { return sequencer_; }
+    TradeJournal* journal() const { return journal_.get(); }
+
+    OrderBook& getOrCreateBook(const std::string& symbol, const BookFactory& factory);
+    size_t bookCount() const;
+    // Visit every book (under the registry lock; do not create books from fn)
+    void forEachBook(const std::function<void(const std::string&, OrderBook&)>& fn) const;
+
+private:
+    size_t index_;
+    std::unique_ptr<TradeJournal> journal_;  // outlives the books that append to it
+    mutable std::shared_mutex books_mutex_;
+    std::unordered_map<std::string, std::unique_ptr<OrderBook>> books_;
+    Sequencer sequencer_;  // declared last: its thread stops before the books go away
+};
+
+} // namespace tradeflow
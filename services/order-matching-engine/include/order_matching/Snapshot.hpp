@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "OrderBook.hpp"
+
+namespace tradeflow {
+
+// Snapshot file layout (native little-endian, every section 8-byte aligned):
+//
+//   SnapshotFileHeader
+//   per book: SnapshotBookHeader
+//             client table: client_count x {uint16 length, bytes}, zero-padded to client_bytes
+//             bid_count + ask_count SnapshotOrder, bids then asks, best price
+//             first and FIFO within a level
+//   uint64 checksum of everything after the file header
+//
+// Client ids repeat across many orders, so each book stores them once and
+// orders refer to them by index; a resting order costs 24 bytes.
+struct SnapshotFileHeader {
+    char magic[8];  // "TFSNAP\0\0"
+    uint32_t version;
+    uint32_t book_count;
+    int64_t next_order_id;
+    uint64_t body_bytes;  // bytes between this header and the checksum
+};
+static_assert(sizeof(SnapshotFileHeader) == 32, "SnapshotFileHeader is a fixed 32-byte on-disk layout");
+
+struct SnapshotBookHeader {
+    char symbol[32];
+    uint64_t last_sequence;  // commands up to here are reflected in the orders below
+    uint64_t bid_count;
+    uint64_t ask_count;
+    uint32_t client_count;
+    uint32_t client_bytes;
+    uint64_t trade_sequence;  // the book's tradeSequence() at last_sequence (version 2)
+};
+static_assert(sizeof(SnapshotBookHeader) == 72, "SnapshotBookHeader is a fixed 72-byte on-disk layout");
+static_assert(sizeof(SnapshotBookHeader::symbol) >= MAX_SYMBOL_LENGTH, "SnapshotBookHeader must hold the longest accepted symbol");
+
+struct SnapshotOrder {
+    int64_t id;
+    int64_t price;
+    int32_t quantity;
+    uint32_t client;  // index into the book's client table
+};
+static_assert(sizeof(SnapshotOrder) == 24, "SnapshotOrder is a fixed 24-byte on-disk layout");
+
+// In-memory copy of one book, taken under the book's lock and written out
+// after the lock is released.
+struct BookImage {
+    std::string symbol;
+    uint64_t last_sequence = 0;
+    uint64_t trade_sequence = 0;
+    std::vector<std::string> clients;
+    std::vector<SnapshotOrder> bids;
+    std::vector<SnapshotOrder> asks;
+};
+
+// Copy a book's resting orders. Takes the book's read lock; for a book owned
+// by a Sequencer, call it on the sequencer thread.
+BookImage captureBook(const OrderBook& book);
+
+// Write a snapshot atomically: a temporary file is written, synced and
+// renamed over path. Throws on I/O errors.
+void writeSnapshot(const std::string& path, const std::vector<BookImage>& books, OrderId next_order_id);
+
+struct SnapshotInfo {
+    OrderId next_order_id = 1;   // above every id in the snapshot
+    uint64_t last_sequence = 0;  // highest book sequence in the snapshot
+    uint64_t books = 0;
+    uint64_t orders = 0;
+};
+
+// Returns the (possibly newly created) book for a symbol during recovery.
+using BookResolver = std::function<OrderBook&(const std::string& symbol)>;
+
+// Map a snapshot and add its orders to the books returned by book_for, which
+// should be empty. Throws if the file is truncated or its checksum is wrong.
+SnapshotInfo loadSnapshot(const std::string& path, const BookResolver& book_for);
+
+// The state directory holds snapshot-<N>.snap and commands-<N>.wal files. A
+// snapshot is taken just after the command log rotates to segment N, so
+// snapshot N plus segments N, N+1, ... reproduce the engine.
+std::string snapshotPath(const std::string& dir, uint64_t segment);
+
+struct RecoveryResult {
+    bool snapshot_loaded = false;
+    uint64_t snapshot_segment = 0;
+    uint64_t snapshot_orders = 0;
+    uint64_t commands_replayed = 0;
+    uint64_t commands_skipped = 0;  // already covered by the snapshot
+    OrderId next_order_id = 1;
+    uint64_t next_sequence = 1;
+    uint64_t next_segment = 1;      // first segment number the new command log may use
+    double seconds = 0;
+};
+
+// Create dir if needed, rebuild the books from the newest snapshot in it and
+// replay every command log segment on top, skipping commands a book's
+// snapshot already reflects. Books come from book_for and must not log or
+// publish while recovery runs.
+RecoveryResult recoverState(const std::string& dir, const BookResolver& book_for);
+
+// Delete snapshots and command log segments older than segment, plus any
+// temporary snapshot files left by an interrupted write.
+void pruneState(const std::string& dir, uint64_t segment);
+
+} // namespace tradeflow
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "BinaryJournal.hpp"
+#include "Order.hpp"
+
+namespace tradeflow {
+
+// Fixed-size on-disk trade record (native little-endian). The symbol is
+// NUL-padded to 24 bytes (MAX_SYMBOL_LENGTH); books with longer symbols
+// cannot be journalled.
+struct TradeRecord {
+    int64_t timestamp_ns;  // system_clock nanoseconds since epoch
+    int64_t buy_order_id;
+    int64_t sell_order_id;
+    int64_t price;         // ticks
+    int32_t quantity;
+    uint32_t reserved;
+    char symbol[24];
+};
+static_assert(sizeof(TradeRecord) == 64, "TradeRecord is a fixed 64-byte on-disk layout");
+static_assert(sizeof(TradeRecord::symbol) >= MAX_SYMBOL_LENGTH, "TradeRecord must hold the longest accepted symbol");
+
+inline constexpr char TRADE_JOURNAL_MAGIC[8] = {'T', 'F', 'T', 'R', 'A', 'D', 'E', '\0'};
+inline constexpr uint32_t TRADE_JOURNAL_VERSION = 1;
+
+// Asynchronous binary trade journal: matching threads append executions and
+// return immediately, a background writer batches them to disk (see
+// BinaryJournal). Files are opened in append mode, so restarts keep
+// extending the same journal.
+class TradeJournal {
+public:
+    TradeJournal(const std::string& path, const JournalConfig& config = JournalConfig());
+
+    // Any thread; wait-free unless the ring is full
+    void append(int64_t timestamp_ns, int64_t buy_order_id, int64_t sell_order_id, int64_t price,
+                int32_t quantity, const std::string& symbol);
+    // Block until everything appended before the call has been written (and
+    // synced, unless the policy is NONE); throws once a write has failed
+    void flush() { journal_.flush(); }
+
+    std::string path() const { return journal_.path(); }
+    JournalStats stats() const { return journal_.stats(); }
+
+private:
+    BinaryJournal<TradeRecord> journal_;
+};
+
+// Reader for trade journal files; used by the decoder and tests.
+class TradeJournalReader : public JournalReader<TradeRecord> {
+public:
+    explicit TradeJournalReader(const std::string& path)
+        : JournalReader<TradeRecord>(path, TRADE_JOURNAL_MAGIC, TRADE_JOURNAL_VERSION) {}
+};
+
+} // namespace tradeflow
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "Replay.hpp"
+
+namespace tradeflow {
+
+enum class SizeDistribution {
+    FIXED,      // always size_min lots
+    UNIFORM,    // size_min..size_max lots
+    LOGNORMAL   // median size_min lots, long right tail (size_sigma), capped at size_max
+};
+
+// Synthetic order flow. Each event picks a symbol by Zipf popularity, moves
+// that symbol's mid price by a random walk, then draws one action:
+//
+//   cancel_ratio     cancel one of the symbol's earlier passive orders
+//   modify_ratio     change the quantity (and sometimes the price) of one
+//   aggressor_ratio  an order priced through the mid by up to sweep_levels
+//                    ticks, split into MARKET / IOC / FOK / crossing LIMIT
+//   otherwise        a passive LIMIT order depth ticks away from the mid
+//
+// The generator does not run a book, so some cancels and modifies target
+// orders that have already traded; the replay counts them as rejected, as
+// an exchange would.
+struct WorkloadConfig {
+    uint64_t seed = 1;
+    uint64_t events = 1000000;       // order events after the initial depth
+    uint32_t symbols = 16;
+    double zipf_exponent = 1.0;      // 0 = uniform popularity
+    Price start_price = 10000;       // ticks
+    double walk_probability = 0.02;  // chance per event that the symbol's mid moves one tick
+    uint32_t depth = 20;             // passive orders rest 1..depth ticks from the mid, nearer ones more often
+    uint32_t initial_levels = 10;    // per side, added before the flow starts
+    uint32_t orders_per_level = 4;
+    double cancel_ratio = 0.35;
+    double modify_ratio = 0.10;
+    double aggressor_ratio = 0.10;
+    double market_share = 0.10;      // of aggressors
+    double ioc_share = 0.40;
+    double fok_share = 0.05;         // the rest cross as LIMIT
+    uint32_t sweep_levels = 3;       // aggressor limit is mid + 0..sweep_levels ticks
+    SizeDistribution size_distribution = SizeDistribution::LOGNORMAL;
+    uint32_t size_min = 1;           // lots
+    uint32_t size_max = 100;
+    double size_sigma = 1.0;
+    Quantity lot = 100;
+};
+
+struct WorkloadSummary {
+    uint64_t events = 0;  // written, excluding SYMBOL events
+    uint64_t adds = 0;    // initial depth
+    uint64_t passive = 0;
+    uint64_t aggressive = 0;
+    uint64_t cancels = 0;
+    uint64_t modifies = 0;
+    OrderId last_order_id = 0;
+};
+
+// Symbol names generated for index i: SYM0000, SYM0001, ...
+std::string workloadSymbol(uint32_t index);
+
+// Write a workload to writer. The same config (seed included) always
+// produces the same events: the generator draws from mt19937_64 through its
+// own distributions rather than the standard library's, whose output
+// differs between implementations.
+// Throws std::invalid_argument for an inconsistent config.
+WorkloadSummary generateWorkload(const WorkloadConfig& config, ReplayWriter& writer);
+
+} // namespace tradeflow
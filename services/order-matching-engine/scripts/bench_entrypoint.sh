@@ -21,7 +21,7 @@ fi
 # Run replay runner if available
 if [ -x "$BUILD_DIR/replay_runner" ]; then
   echo "Running replay runner..."
-  "$BUILD_DIR/replay_runner" /workspace/testdata/replays/simple_replay.json > "$OUTDIR/replay_output.txt" 2>&1 || true
+  "$BUILD_DIR/replay_runner" /workspace/tests/data/replays/simple_replay.json > "$OUTDIR/replay_output.txt" 2>&1 || true
 else
   echo "replay_runner not built. Skipping replay."
 fi
@@ -0,0 +1,398 @@
+// OrderBook operation suite. Every benchmark samples the latency of the one
+// operation it is named after (see LatencyRecorder) and is parameterized by
+// book depth; restoring the book between samples happens outside the
+// sampled region.
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../../include/order_matching/OrderBook.hpp"
+#include "../../include/order_matching/Replay.hpp"
+#include "../../include/order_matching/Workload.hpp"
+#include "LatencyRecorder.hpp"
+
+using namespace tradeflow;
+
+namespace {
+
+constexpr Price MID = 100000;
+constexpr Quantity LOT = 100;
+constexpr std::string_view CLIENT = "client";
+
+class XorShift {
+public:
+    uint64_t next() {
+        state_ ^= state_ << 13;
+        state_ ^= state_ >> 7;
+        state_ ^= state_ << 17;
+        return state_;
+    }
+    uint64_t below(uint64_t n) { return next() % n; }
+
+private:
+    uint64_t state_ = 0x9E3779B97F4A7C15ull;
+};
+
+OrderBookConfig suiteConfig(int64_t orders) {
+    OrderBookConfig config;
+    config.order_pool_reserve = static_cast<size_t>(orders) + 1024;
+    config.level_pool_reserve = 1 << 12;
+    config.locking = false;
+    return config;
+}
+
+struct RestingOrder {
+    OrderId id;
+    bool is_buy;
+    Price price;
+};
+
+// `levels` price levels per side, `per_level` orders each, one tick apart
+// around MID; returns the resting orders
+std::vector<RestingOrder> fillBook(OrderBook& book, int64_t levels, int64_t per_level, OrderId& id) {
+    std::vector<RestingOrder> resting;
+    resting.reserve(static_cast<size_t>(levels * per_level * 2));
+    for (int64_t level = 0; level < levels; ++level) {
+        for (int64_t k = 0; k < per_level; ++k) {
+            for (bool is_buy : {true, false}) {
+                Price px = is_buy ? MID - 1 - level : MID + 1 + level;
+                book.addOrder(id, is_buy, LOT, px, CLIENT);
+                resting.push_back({id++, is_buy, px});
+            }
+        }
+    }
+    return resting;
+}
+
+} // namespace
+
+// Insert a passive order at a random level of a book with state.range(0)
+// levels per side (4 orders each); the order is cancelled again unsampled.
+static void BM_DeepBookInsert(benchmark::State& state) {
+    const int64_t levels = state.range(0);
+    OrderBook book("TEST", MatchingMode::PRICE_TIME_PRIORITY, suiteConfig(levels * 8));
+    OrderId id = 1;
+    fillBook(book, levels, 4, id);
+    XorShift rng;
+    LatencyRecorder latency(state);
+    for (auto _ : state) {
+        uint64_t r = rng.next();
+        bool is_buy = r & 1;
+        Price offset = 1 + static_cast<Price>((r >> 1) % static_cast<uint64_t>(levels));
+        Price px = is_buy ? MID - offset : MID + offset;
+        OrderId order = id++;
+        latency.time([&] { book.addOrder(order, is_buy, LOT, px, CLIENT); });
+        book.cancelOrder(order);
+    }
+    latency.report(state);
+}
+BENCHMARK(BM_DeepBookInsert)->RangeMultiplier(8)->Range(8, 4096)->Unit(benchmark::kNanosecond);
+
+// Cancel the order at the front (0), middle (1) or back (2) of a single
+// level holding state.range(1) orders; a replacement joins the back unsampled.
+static void BM_CancelInLevel(benchmark::State& state) {
+    const int64_t position = state.range(0);
+    const int64_t depth = state.range(1);
+    OrderBook book("TEST", MatchingMode::PRICE_TIME_PRIORITY, suiteConfig(depth));
+    std::deque<OrderId> queue;
+    OrderId id = 1;
+    for (int64_t i = 0; i < depth; ++i) {
+        book.addOrder(id, true, LOT, MID, CLIENT);
+        queue.push_back(id++);
+    }
+    LatencyRecorder latency(state);
+    for (auto _ : state) {
+        size_t slot = position == 0 ? 0 : position == 1 ? queue.size() / 2 : queue.size() - 1;
+        OrderId victim = queue[slot];
+        latency.time([&] { book.cancelOrder(victim); });
+        queue.erase(queue.begin() + static_cast<std::ptrdiff_t>(slot));
+        book.addOrder(id, true, LOT, MID, CLIENT);
+        queue.push_back(id++);
+    }
+    latency.report(state);
+}
+BENCHMARK(BM_CancelInLevel)->ArgsProduct({{0, 1, 2}, {16, 256, 4096}})->Unit(benchmark::kNanosecond);
+
+// Modify a random resting order in a book with state.range(1) levels per
+// side: range(0) = 0 changes the quantity only, 1 moves it to another level
+// on the same side.
+static void BM_ModifyOrder(benchmark::State& state) {
+    const bool reprice = state.range(0) == 1;
+    const int64_t levels = state.range(1);
+    OrderBook book("TEST", MatchingMode::PRICE_TIME_PRIORITY, suiteConfig(levels * 8));
+    OrderId id = 1;
+    std::vector<RestingOrder> resting = fillBook(book, levels, 4, id);
+    XorShift rng;
+    LatencyRecorder latency(state);
+    for (auto _ : state) {
+        RestingOrder& order = resting[rng.below(resting.size())];
+        Quantity qty = LOT / 2 + static_cast<Quantity>(rng.below(LOT));
+        if (reprice) {
+            Price offset = 1 + static_cast<Price>(rng.below(static_cast<uint64_t>(levels)));
+            order.price = order.is_buy ? MID - offset : MID + offset;
+        }
+        latency.time([&] { book.modifyOrder(order.id, qty, order.price); });
+    }
+    latency.report(state);
+}
+BENCHMARK(BM_ModifyOrder)->ArgsProduct({{0, 1}, {16, 256, 4096}})->Unit(benchmark::kNanosecond);
+
+// One aggressive buy that takes out exactly state.range(0) ask levels (one
+// order each) of a book state.range(1) levels deep; the swept levels are
+// restored unsampled.
+static void BM_SweepLevels(benchmark::State& state) {
+    const int64_t sweep = state.range(0);
+    const int64_t levels = state.range(1);
+    OrderBook book("TEST", MatchingMode::PRICE_TIME_PRIORITY, suiteConfig(levels * 2));
+    OrderId id = 1;
+    fillBook(book, levels, 1, id);
+    LatencyRecorder latency(state);
+    for (auto _ : state) {
+        OrderId aggressor = id++;
+        latency.time([&] {
+            book.submitOrder(aggressor, true, static_cast<Quantity>(sweep) * LOT, MID + sweep, CLIENT);
+        });
+        for (int64_t level = 0; level < sweep; ++level) book.addOrder(id++, false, LOT, MID + 1 + level, CLIENT);
+    }
+    latency.report(state);
+    state.SetItemsProcessed(state.iterations() * sweep);
+}
+BENCHMARK(BM_SweepLevels)->ArgsProduct({{1, 8, 64}, {64, 1024}})->Unit(benchmark::kNanosecond);
+
+// An aggressor for a quarter of one level holding state.range(1) orders of
+// uneven size. range(0): 0 = price-time (fills the front of the queue),
+// 1 = pro-rata (touches every order). The level is rebuilt unsampled.
+static void BM_LevelAllocation(benchmark::State& state) {
+    const MatchingMode mode = state.range(0) == 1 ? MatchingMode::PRO_RATA : MatchingMode::PRICE_TIME_PRIORITY;
+    const int64_t depth = state.range(1);
+    OrderBook book("TEST", mode, suiteConfig(depth * 2));
+    OrderId id = 1;
+    std::vector<OrderId> resting;
+    Quantity total = 0;
+    auto rebuild = [&] {
+        for (OrderId order : resting) book.cancelOrder(order);
+        resting.clear();
+        total = 0;
+        for (int64_t i = 0; i < depth; ++i) {
+            Quantity qty = LOT * static_cast<Quantity>(1 + i % 7);
+            book.addOrder(id, false, qty, MID, CLIENT);
+            resting.push_back(id++);
+            total += qty;
+        }
+    };
+    rebuild();
+    LatencyRecorder latency(state);
+    for (auto _ : state) {
+        OrderId aggressor = id++;
+        latency.time([&] { book.submitOrder(aggressor, true, total / 4, MID, CLIENT); });
+        state.PauseTiming();
+        rebuild();
+        state.ResumeTiming();
+    }
+    latency.report(state);
+}
+BENCHMARK(BM_LevelAllocation)->ArgsProduct({{0, 1}, {16, 256, 4096, 16384}})->Unit(benchmark::kNanosecond);
+
+// triggerMatching on a pro-rata book whose best bid and ask levels, each of
+// state.range(0) orders of uneven size, rest at the same price; the asks
+// hold three quarters of the bid quantity, so every ask fills and every bid
+// gets a share. The levels are rebuilt unsampled.
+static void BM_ProRataCross(benchmark::State& state) {
+    const int64_t depth = state.range(0);
+    OrderBook book("TEST", MatchingMode::PRO_RATA, suiteConfig(depth * 2));
+    OrderId id = 1;
+    std::vector<OrderId> resting;
+    auto rebuild = [&] {
+        for (OrderId order : resting) book.cancelOrder(order);
+        resting.clear();
+        for (int64_t i = 0; i < depth; ++i) {
+            book.addOrder(id, true, LOT * static_cast<Quantity>(4 * (1 + i % 7)), MID, CLIENT);
+            resting.push_back(id++);
+            book.addOrder(id, false, LOT * static_cast<Quantity>(3 * (1 + i % 7)), MID, CLIENT);
+            resting.push_back(id++);
+        }
+    };
+    rebuild();
+    LatencyRecorder latency(state);
+    for (auto _ : state) {
+        latency.time([&] { book.triggerMatching(); });
+        state.PauseTiming();
+        rebuild();
+        state.ResumeTiming();
+    }
+    latency.report(state);
+}
+BENCHMARK(BM_ProRataCross)->Arg(16)->Arg(256)->Arg(4096)->Arg(16384)->Unit(benchmark::kNanosecond);
+
+namespace {
+
+// state.range(0) LIMIT orders collected by a call auction: bids spread over
+// the 100 ticks up to MID + 20, asks over the 100 from MID - 20, so the
+// sides overlap on 41 price levels
+void fillAuction(OrderBook& book, int64_t orders, OrderId& id) {
+    uint64_t rng = 12345;
+    for (int64_t i = 0; i < orders; ++i) {
+        rng = rng * 6364136223846793005ull + 1442695040888963407ull;
+        bool is_buy = (rng >> 63) != 0;
+        Price offset = static_cast<Price>((rng >> 20) % 100);
+        Quantity qty = LOT * static_cast<Quantity>(1 + (rng >> 40) % 5);
+        book.submitOrder(id++, is_buy, qty, is_buy ? MID + 20 - offset : MID - 20 + offset, CLIENT);
+    }
+}
+
+} // namespace
+
+// uncross() of a call auction holding state.range(0) orders: the
+// equilibrium search plus every fill. The book is refilled unsampled.
+static void BM_AuctionUncross(benchmark::State& state) {
+    const int64_t orders = state.range(0);
+    LatencyRecorder latency(state);
+    size_t trades = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        OrderBook book("TEST", MatchingMode::CALL_AUCTION, suiteConfig(orders));
+        OrderId id = 1;
+        fillAuction(book, orders, id);
+        trades = 0;
+        book.setTradeCallback([&](const Trade&) { ++trades; });
+        state.ResumeTiming();
+        latency.time([&] { benchmark::DoNotOptimize(book.uncross()); });
+    }
+    latency.report(state);
+    state.counters["trades"] = static_cast<double>(trades);
+}
+BENCHMARK(BM_AuctionUncross)->Arg(1000)->Arg(10000)->Arg(100000)->Unit(benchmark::kMicrosecond);
+
+// A LIMIT order added to (and then, unsampled, cancelled from) a call
+// auction of state.range(0) orders, including the indicative price it
+// republishes
+static void BM_AuctionIndicative(benchmark::State& state) {
+    const int64_t orders = state.range(0);
+    OrderBook book("TEST", MatchingMode::CALL_AUCTION, suiteConfig(orders + 16));
+    OrderId id = 1;
+    fillAuction(book, orders, id);
+    LatencyRecorder latency(state);
+    for (auto _ : state) {
+        OrderId order = id++;
+        latency.time([&] { book.submitOrder(order, true, LOT, MID, CLIENT); });
+        state.PauseTiming();
+        book.cancelOrder(order);
+        state.ResumeTiming();
+    }
+    latency.report(state);
+}
+BENCHMARK(BM_AuctionIndicative)->Arg(1000)->Arg(100000)->Unit(benchmark::kNanosecond);
+
+// getBidLevels() on a book with state.range(0) bid levels
+static void BM_GetBidLevels(benchmark::State& state) {
+    const int64_t levels = state.range(0);
+    OrderBook book("TEST", MatchingMode::PRICE_TIME_PRIORITY, suiteConfig(levels * 2));
+    OrderId id = 1;
+    fillBook(book, levels, 1, id);
+    LatencyRecorder latency(state);
+    size_t returned = 0;
+    for (auto _ : state) {
+        latency.time([&] {
+            auto snapshot = book.getBidLevels();
+            returned = snapshot.size();
+            benchmark::DoNotOptimize(snapshot.data());
+        });
+    }
+    latency.report(state);
+    state.counters["levels"] = static_cast<double>(returned);
+}
+BENCHMARK(BM_GetBidLevels)->RangeMultiplier(8)->Range(8, 4096)->Unit(benchmark::kNanosecond);
+
+// The 10 best levels per side of a locking book with state.range(1) levels
+// per side: state.range(0) 0 = getDepth under the read lock, 1 =
+// readPublishedDepth from the DepthCache
+static void BM_GetOrderBookDepth(benchmark::State& state) {
+    const bool published = state.range(0) == 1;
+    const int64_t levels = state.range(1);
+    OrderBookConfig config = suiteConfig(levels * 2);
+    config.locking = true;
+    OrderBook book("TEST", MatchingMode::PRICE_TIME_PRIORITY, config);
+    OrderId id = 1;
+    fillBook(book, levels, 1, id);
+    std::vector<std::pair<Price, Quantity>> bids, asks;
+    LatencyRecorder latency(state);
+    for (auto _ : state) {
+        latency.time([&] {
+            uint64_t sequence = published ? book.readPublishedDepth(10, bids, asks) : book.getDepth(10, bids, asks);
+            benchmark::DoNotOptimize(sequence);
+            benchmark::DoNotOptimize(bids.data());
+        });
+    }
+    latency.report(state);
+    state.counters["levels"] = static_cast<double>(bids.size() + asks.size());
+}
+BENCHMARK(BM_GetOrderBookDepth)->ArgsProduct({{0, 1}, {8, 256, 4096}})->Unit(benchmark::kNanosecond);
+
+namespace {
+
+// Replay files for BM_ReplayMix, generated once per depth into the temp
+// directory and removed at exit. TRADEFLOW_BENCH_REPLAY names a file to use instead (the depth
+// argument is then only a label).
+std::string replayFor(int64_t depth) {
+    if (const char* path = std::getenv("TRADEFLOW_BENCH_REPLAY")) return path;
+    static struct GeneratedFiles {
+        std::map<int64_t, std::string> paths;
+        ~GeneratedFiles() {
+            for (const auto& entry : paths) std::remove(entry.second.c_str());
+        }
+    } generated;
+    auto& files = generated.paths;
+    auto it = files.find(depth);
+    if (it != files.end()) return it->second;
+    std::string path =
+        (std::filesystem::temp_directory_path() / ("order_bench_mix_" + std::to_string(depth) + ".bin")).string();
+    WorkloadConfig config;
+    config.events = 1 << 20;
+    config.depth = static_cast<uint32_t>(depth);
+    config.initial_levels = static_cast<uint32_t>(depth);
+    ReplayWriter writer(path);
+    generateWorkload(config, writer);
+    writer.finish();
+    files.emplace(depth, path);
+    return path;
+}
+
+} // namespace
+
+// Events of a generated (or TRADEFLOW_BENCH_REPLAY) workload applied one at
+// a time, each sampled; books start at state.range(0) levels per side. When
+// the file runs out the books are rebuilt and the replay starts over.
+static void BM_ReplayMix(benchmark::State& state) {
+    ReplayReader reader(replayFor(state.range(0)));
+    std::vector<std::unique_ptr<OrderBook>> books;
+    const std::string_view client = "replay";
+    size_t next = 0;
+    LatencyRecorder latency(state);
+    for (auto _ : state) {
+        ReplayEvent event;
+        while (true) {
+            if (next == reader.size()) {
+                state.PauseTiming();
+                books.clear();
+                next = 0;
+                state.ResumeTiming();
+            }
+            event = reader.at(next++);
+            if (event.kind != ReplayEventKind::SYMBOL) break;
+            state.PauseTiming();
+            books.push_back(std::make_unique<OrderBook>(replaySymbolName(event), MatchingMode::PRICE_TIME_PRIORITY,
+                                                        suiteConfig(1 << 16)));
+            state.ResumeTiming();
+        }
+        OrderBook& book = *books[event.symbol];
+        latency.time([&] { applyReplayEvent(book, event, client); });
+    }
+    latency.report(state);
+}
+BENCHMARK(BM_ReplayMix)->Arg(16)->Arg(256)->Arg(1024)->Unit(benchmark::kNanosecond);
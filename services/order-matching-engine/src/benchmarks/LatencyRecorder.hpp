@@ -0,0 +1,84 @@
+#pragma once
+
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace tradeflow {
+
+// Per-operation latency samples for one benchmark run, reported as
+// p50_ns / p99_ns / p99.9_ns / max_ns counters instead of the mean Google
+// Benchmark prints. Only the code inside time() is sampled, so set-up and
+// restore work in the same iteration does not skew the distribution. The
+// clock's own back-to-back cost is measured once and subtracted.
+//
+// Up to MAX_SAMPLES are kept; longer runs keep a uniform random subset
+// (reservoir sampling), except max_ns, which sees every sample.
+class LatencyRecorder {
+public:
+    static constexpr size_t MAX_SAMPLES = 1 << 22;
+
+    explicit LatencyRecorder(const benchmark::State& state) : seen_(0), max_(0), rng_(0x9E3779B97F4A7C15ull) {
+        samples_.reserve(std::min<size_t>(static_cast<size_t>(state.max_iterations), MAX_SAMPLES));
+    }
+
+    template <typename Fn>
+    void time(Fn&& fn) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        auto end = std::chrono::steady_clock::now();
+        int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() - clockOverhead();
+        record(ns > 0 ? static_cast<uint64_t>(ns) : 0);
+    }
+
+    void record(uint64_t ns) {
+        max_ = std::max(max_, ns);
+        ++seen_;
+        if (samples_.size() < MAX_SAMPLES) {
+            samples_.push_back(ns);
+            return;
+        }
+        rng_ ^= rng_ << 13;
+        rng_ ^= rng_ >> 7;
+        rng_ ^= rng_ << 17;
+        uint64_t slot = rng_ % seen_;
+        if (slot < MAX_SAMPLES) samples_[slot] = ns;
+    }
+
+    void report(benchmark::State& state) {
+        if (samples_.empty()) return;
+        std::sort(samples_.begin(), samples_.end());
+        auto at = [&](double q) {
+            size_t index = static_cast<size_t>(q * static_cast<double>(samples_.size() - 1) + 0.5);
+            return static_cast<double>(samples_[index]);
+        };
+        state.counters["p50_ns"] = at(0.50);
+        state.counters["p99_ns"] = at(0.99);
+        state.counters["p99.9_ns"] = at(0.999);
+        state.counters["max_ns"] = static_cast<double>(max_);
+        state.counters["samples"] = static_cast<double>(seen_);
+    }
+
+    static int64_t clockOverhead() {
+        static const int64_t overhead = [] {
+            int64_t best = INT64_MAX;
+            for (int i = 0; i < 1000; ++i) {
+                auto a = std::chrono::steady_clock::now();
+                auto b = std::chrono::steady_clock::now();
+                best = std::min<int64_t>(best, std::chrono::duration_cast<std::chrono::nanoseconds>(b - a).count());
+            }
+            return best;
+        }();
+        return overhead;
+    }
+
+private:
+    std::vector<uint64_t> samples_;
+    uint64_t seen_;
+    uint64_t max_;
+    uint64_t rng_;
+};
+
+} // namespace tradeflow
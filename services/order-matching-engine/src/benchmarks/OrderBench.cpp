@@ -1,19 +1,512 @@
 #include <benchmark/benchmark.h>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "../../include/order_matching/Clock.hpp"
+#include "../../include/order_matching/CommandLog.hpp"
+#include "../../include/order_matching/LatencyHistogram.hpp"
+#include "../../include/order_matching/Logger.hpp"
+#include "../../include/order_matching/MetricsRegistry.hpp"
 #include "../../include/order_matching/Order.hpp"
 #include "../../include/order_matching/OrderBook.hpp"
+#include "../../include/order_matching/OrderRouter.hpp"
+#include "../../include/order_matching/Sequencer.hpp"
+#include "../../include/order_matching/Snapshot.hpp"
+#include "../../include/order_matching/TradeJournal.hpp"
 
 using namespace tradeflow;
 using namespace benchmark;
 
+static constexpr std::string_view CLIENT = "client";
+
 static void BM_AddOrderAndMatch(benchmark::State& state) {
     OrderBook ob("TEST");
     int64_t id = 1;
     for (auto _ : state) {
-        ob.addOrder(id++, true, 100, 1000, "client");
-        ob.addOrder(id++, false, 100, 1000, "client");
+        ob.addOrder(id++, true, 100, 1000, CLIENT);
+        ob.addOrder(id++, false, 100, 1000, CLIENT);
         ob.triggerMatching();
     }
 }
 BENCHMARK(BM_AddOrderAndMatch)->Iterations(1000)->Unit(benchmark::kMicrosecond);
 
+// Aggressive order that fully fills against a resting order, on a book with
+// state.range(1) resting levels per side. range(0) = 0 rests the aggressor
+// and then sweeps the book (previous SubmitOrder path), 1 matches it on
+// arrival via submitOrder.
+static void BM_AggressorOnArrival(benchmark::State& state) {
+    const bool on_arrival = state.range(0) == 1;
+    OrderBook ob("TEST");
+    int64_t id = 1;
+    for (int64_t i = 0; i < state.range(1); ++i) {
+        ob.addOrder(id++, true, 100, 9999 - i, CLIENT);
+        ob.addOrder(id++, false, 100, 10001 + i, CLIENT);
+    }
+    for (auto _ : state) {
+        ob.addOrder(id++, false, 10, 10000, CLIENT);
+        if (on_arrival) {
+            ob.submitOrder(id++, true, 10, 10000, CLIENT);
+        } else {
+            ob.addOrder(id++, true, 10, 10000, CLIENT);
+            ob.triggerMatching();
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_AggressorOnArrival)->ArgsProduct({{0, 1}, {1, 1000}})->Unit(benchmark::kNanosecond);
+
+// Cancel a randomly positioned order from a single price level holding
+// state.range(0) resting orders, then re-add it at the tail so the depth stays
+// constant. With O(1) unlink the per-iteration cost should not grow with depth.
+static void BM_CancelAtDepth(benchmark::State& state) {
+    const int64_t depth = state.range(0);
+    OrderBook ob("TEST");
+    std::vector<OrderId> resting(depth);
+    int64_t id = 1;
+    for (int64_t i = 0; i < depth; ++i) {
+        resting[i] = id;
+        ob.addOrder(id++, true, 100, 1000, CLIENT);
+    }
+    uint64_t rng = 0x9E3779B97F4A7C15ull;
+    for (auto _ : state) {
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        size_t slot = rng % depth;
+        ob.cancelOrder(resting[slot]);
+        resting[slot] = id;
+        ob.addOrder(id++, true, 100, 1000, CLIENT);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CancelAtDepth)->RangeMultiplier(10)->Range(10, 100000)->Unit(benchmark::kNanosecond);
+
+static OrderBookConfig layoutConfig(int64_t layout) {
+    OrderBookConfig config;
+    config.order_pool_reserve = 1 << 16;
+    config.level_pool_reserve = 1 << 12;
+    if (layout == 1) {
+        config.layout = BookLayout::TICK_LADDER;
+        config.ladder_ticks = 8192;
+    }
+    return config;
+}
+
+// Random add + cancel across state.range(1) populated price levels on each
+// side. range(0) selects the layout: 0 = sparse map, 1 = tick ladder.
+static void BM_LayoutAddCancel(benchmark::State& state) {
+    const int64_t levels = state.range(1);
+    const Price mid = 100000;
+    OrderBook ob("TEST", MatchingMode::PRICE_TIME_PRIORITY, layoutConfig(state.range(0)));
+    std::vector<OrderId> resting;
+    int64_t id = 1;
+    for (int64_t i = 0; i < levels; ++i) {
+        for (int k = 0; k < 4; ++k) {
+            resting.push_back(id);
+            ob.addOrder(id++, true, 10, mid - 1 - i, CLIENT);
+            resting.push_back(id);
+            ob.addOrder(id++, false, 10, mid + 1 + i, CLIENT);
+        }
+    }
+    uint64_t rng = 0x9E3779B97F4A7C15ull;
+    for (auto _ : state) {
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        size_t slot = rng % resting.size();
+        ob.cancelOrder(resting[slot]);
+        bool is_buy = (rng >> 32) & 1;
+        Price offset = 1 + static_cast<Price>((rng >> 33) % levels);
+        resting[slot] = id;
+        ob.addOrder(id++, is_buy, 10, is_buy ? mid - offset : mid + offset, CLIENT);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LayoutAddCancel)->ArgsProduct({{0, 1}, {16, 256, 4096}})->Unit(benchmark::kNanosecond);
+
+// Best-price churn: each iteration an aggressive sell takes out the whole top
+// bid level, then the level is replenished. Exercises best-level lookup and
+// level create/erase, which is where the bitmap replaces tree walks.
+static void BM_LayoutMatchBest(benchmark::State& state) {
+    const int64_t levels = state.range(1);
+    const Price mid = 100000;
+    OrderBook ob("TEST", MatchingMode::PRICE_TIME_PRIORITY, layoutConfig(state.range(0)));
+    int64_t id = 1;
+    for (int64_t i = 0; i < levels; ++i) {
+        ob.addOrder(id++, true, 10, mid - i, CLIENT);
+    }
+    for (auto _ : state) {
+        ob.addOrder(id++, false, 10, mid, CLIENT);
+        ob.triggerMatching();
+        ob.addOrder(id++, true, 10, mid, CLIENT);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LayoutMatchBest)->ArgsProduct({{0, 1}, {16, 256, 4096}})->Unit(benchmark::kNanosecond);
+
+// Id index comparison at state.range(0) resting orders with dense sequential
+// ids, as handed out by the service. Each iteration looks up (or erases and
+// re-inserts under a fresh id) a random resting order.
+struct UnorderedMapIndex {
+    std::unordered_map<OrderId, Order*> map;
+    explicit UnorderedMapIndex(size_t n) { map.reserve(n); }
+    Order* find(OrderId id) const {
+        auto it = map.find(id);
+        return it == map.end() ? nullptr : it->second;
+    }
+    void insert(OrderId id, Order* order) { map.emplace(id, order); }
+    Order* erase(OrderId id) {
+        auto it = map.find(id);
+        Order* order = it->second;
+        map.erase(it);
+        return order;
+    }
+};
+
+struct OpenAddressingIndex {
+    OrderIdIndex<Order> index;
+    explicit OpenAddressingIndex(size_t n) : index(n) {}
+    Order* find(OrderId id) const { return index.find(id); }
+    void insert(OrderId id, Order* order) { index.insert(id, order); }
+    Order* erase(OrderId id) { return index.erase(id); }
+};
+
+template <typename Index>
+static void BM_IndexLookup(benchmark::State& state) {
+    const size_t n = static_cast<size_t>(state.range(0));
+    Order dummy;
+    Index index(n);
+    for (size_t i = 1; i <= n; ++i) index.insert(static_cast<OrderId>(i), &dummy);
+    uint64_t rng = 0x9E3779B97F4A7C15ull;
+    for (auto _ : state) {
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        benchmark::DoNotOptimize(index.find(static_cast<OrderId>(1 + rng % n)));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_IndexLookup, UnorderedMapIndex)->Arg(1 << 20)->Arg(1 << 22)->Unit(benchmark::kNanosecond);
+BENCHMARK_TEMPLATE(BM_IndexLookup, OpenAddressingIndex)->Arg(1 << 20)->Arg(1 << 22)->Unit(benchmark::kNanosecond);
+
+template <typename Index>
+static void BM_IndexEraseInsert(benchmark::State& state) {
+    const size_t n = static_cast<size_t>(state.range(0));
+    Order dummy;
+    Index index(n);
+    std::vector<OrderId> resting(n);
+    for (size_t i = 0; i < n; ++i) {
+        resting[i] = static_cast<OrderId>(i + 1);
+        index.insert(resting[i], &dummy);
+    }
+    OrderId next_id = static_cast<OrderId>(n + 1);
+    uint64_t rng = 0x9E3779B97F4A7C15ull;
+    for (auto _ : state) {
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        size_t slot = rng % n;
+        benchmark::DoNotOptimize(index.erase(resting[slot]));
+        resting[slot] = next_id;
+        index.insert(next_id++, &dummy);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_IndexEraseInsert, UnorderedMapIndex)->Arg(1 << 20)->Arg(1 << 22)->Unit(benchmark::kNanosecond);
+BENCHMARK_TEMPLATE(BM_IndexEraseInsert, OpenAddressingIndex)->Arg(1 << 20)->Arg(1 << 22)->Unit(benchmark::kNanosecond);
+
+// Cancel + resubmit of a random resting order spread over state.range(1)
+// symbols. range(0) = 0 scans every book until one accepts the cancel (the
+// previous service behaviour), 1 resolves the owning book through OrderRouter.
+static void BM_CancelAcrossSymbols(benchmark::State& state) {
+    const bool routed = state.range(0) == 1;
+    const size_t symbols = static_cast<size_t>(state.range(1));
+    const size_t per_book = 8;
+    std::vector<std::unique_ptr<OrderBook>> books;
+    OrderRouter router(64, symbols * per_book);
+    for (size_t s = 0; s < symbols; ++s) {
+        books.push_back(std::make_unique<OrderBook>("SYM" + std::to_string(s)));
+        books.back()->setOrderClosedCallback([&router](OrderId id) { router.remove(id); });
+    }
+    std::vector<std::pair<OrderId, size_t>> resting;
+    OrderId id = 1;
+    for (size_t s = 0; s < symbols; ++s) {
+        for (size_t k = 0; k < per_book; ++k) {
+            router.add(id, books[s].get());
+            books[s]->addOrder(id, true, 10, 10000 - static_cast<Price>(k), CLIENT);
+            resting.emplace_back(id++, s);
+        }
+    }
+    uint64_t rng = 0x9E3779B97F4A7C15ull;
+    for (auto _ : state) {
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        auto& [victim, book_index] = resting[rng % resting.size()];
+        if (routed) {
+            OrderBook* book = router.find(victim);
+            benchmark::DoNotOptimize(book && book->cancelOrder(victim));
+        } else {
+            for (auto& book : books) {
+                if (book->cancelOrder(victim)) break;
+            }
+        }
+        victim = id++;
+        router.add(victim, books[book_index].get());
+        books[book_index]->addOrder(victim, true, 10, 10000, CLIENT);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CancelAcrossSymbols)->ArgsProduct({{0, 1}, {16, 1024, 5000}})->Unit(benchmark::kNanosecond);
+
+// Contention on one hot symbol: every benchmark thread is an RPC client doing
+// submit (add + match) then cancel, on its own id range, at non-crossing
+// prices so the book stays bounded and trade printing stays out of the
+// measurement. range(0) = 0 locks the book from each client thread (LOCKED
+// execution), 1 funnels all commands through one Sequencer.
+static std::unique_ptr<OrderBook> g_contended_book;
+static std::unique_ptr<Sequencer> g_contended_sequencer;
+
+static void BM_HotSymbolContention(benchmark::State& state) {
+    const bool sequenced = state.range(0) == 1;
+    if (state.thread_index() == 0) {
+        OrderBookConfig config;
+        config.order_pool_reserve = 1024;
+        config.locking = !sequenced;
+        g_contended_book = std::make_unique<OrderBook>("HOT", MatchingMode::PRICE_TIME_PRIORITY, config);
+        g_contended_sequencer = sequenced ? std::make_unique<Sequencer>() : nullptr;
+    }
+    const bool is_buy = state.thread_index() % 2 == 0;
+    const Price px = is_buy ? 9900 : 10100;
+    OrderId id = static_cast<OrderId>(state.thread_index() + 1) << 40;
+    for (auto _ : state) {
+        OrderBook& book = *g_contended_book;
+        if (sequenced) {
+            g_contended_sequencer->submit(book, id, is_buy, 10, px, CLIENT);
+            g_contended_sequencer->cancel(book, id);
+        } else {
+            book.addOrder(id, is_buy, 10, px, CLIENT);
+            book.triggerMatching();
+            book.cancelOrder(id);
+        }
+        ++id;
+    }
+    state.SetItemsProcessed(state.iterations());
+    if (state.thread_index() == 0) {
+        g_contended_sequencer.reset();
+        g_contended_book.reset();
+    }
+}
+BENCHMARK(BM_HotSymbolContention)->Arg(0)->Arg(1)->ThreadRange(1, 8)->UseRealTime()->Unit(benchmark::kNanosecond);
+
+// One trade per iteration (rest a sell, cross it with a buy). range(0):
+// 0 = no journal, 1 = journal without fsync, 2 = journal with group commit,
+// 3 = journal with fdatasync after every batch. The matching thread only
+// pays for the ring append; the writer's I/O runs on its own thread.
+static void BM_TradeJournal(benchmark::State& state) {
+    const std::string path = (std::filesystem::temp_directory_path() / "order_bench_trades.journal").string();
+    std::remove(path.c_str());
+    std::unique_ptr<TradeJournal> journal;
+    if (state.range(0) > 0) {
+        JournalConfig config;
+        config.sync = state.range(0) == 1 ? JournalSync::NONE
+                    : state.range(0) == 2 ? JournalSync::GROUP_COMMIT
+                                          : JournalSync::EVERY_BATCH;
+        journal = std::make_unique<TradeJournal>(path, config);
+    }
+    OrderBookConfig config;
+    config.order_pool_reserve = 1024;
+    OrderBook ob("TEST", MatchingMode::PRICE_TIME_PRIORITY, config);
+    ob.setTradeJournal(journal.get());
+    int64_t id = 1;
+    for (auto _ : state) {
+        ob.addOrder(id++, false, 10, 10000, CLIENT);
+        ob.submitOrder(id++, true, 10, 10000, CLIENT);
+    }
+    if (journal) {
+        journal->flush();
+        state.counters["ring_full_waits"] = static_cast<double>(journal->stats().ring_full_waits);
+    }
+    journal.reset();
+    std::remove(path.c_str());
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TradeJournal)->DenseRange(0, 3)->Unit(benchmark::kNanosecond);
+
+// Rest-then-fill pair with the write-ahead command log off (0) or on (1)
+static void BM_CommandLog(benchmark::State& state) {
+    const std::string dir = std::filesystem::temp_directory_path().string();
+    const std::string path = CommandLog::segmentPath(dir, 1);
+    std::remove(path.c_str());
+    std::unique_ptr<CommandLog> log;
+    if (state.range(0) > 0) log = std::make_unique<CommandLog>(dir, 1, 1);
+    OrderBookConfig config;
+    config.order_pool_reserve = 1024;
+    OrderBook ob("TEST", MatchingMode::PRICE_TIME_PRIORITY, config);
+    ob.setCommandLog(log.get());
+    int64_t id = 1;
+    for (auto _ : state) {
+        ob.addOrder(id++, false, 10, 10000, CLIENT);
+        ob.submitOrder(id++, true, 10, 10000, CLIENT);
+    }
+    if (log) {
+        log->flush();
+        state.counters["ring_full_waits"] = static_cast<double>(log->stats().ring_full_waits);
+    }
+    ob.setCommandLog(nullptr);
+    log.reset();
+    std::remove(path.c_str());
+    state.SetItemsProcessed(state.iterations() * 2);
+}
+BENCHMARK(BM_CommandLog)->DenseRange(0, 1)->Unit(benchmark::kNanosecond);
+
+// A book with `orders` resting orders spread over 2000 levels and 64 clients
+static std::unique_ptr<OrderBook> makeSnapshotBook(const std::string& symbol, int64_t orders) {
+    OrderBookConfig config;
+    config.order_pool_reserve = static_cast<size_t>(orders);
+    auto book = std::make_unique<OrderBook>(symbol, MatchingMode::PRICE_TIME_PRIORITY, config);
+    for (int64_t id = 1; id <= orders; ++id) {
+        bool is_buy = id % 2 == 0;
+        Price px = is_buy ? 10000 - id % 1000 : 10001 + id % 1000;
+        book->addOrder(id, is_buy, 1 + id % 50, px, "client-" + std::to_string(id % 64));
+    }
+    return book;
+}
+
+// Capture + write + fsync of one book holding state.range(0) orders
+static void BM_SnapshotWrite(benchmark::State& state) {
+    const std::string path = (std::filesystem::temp_directory_path() / "order_bench.snap").string();
+    auto book = makeSnapshotBook("TEST", state.range(0));
+    for (auto _ : state) {
+        std::vector<BookImage> images;
+        images.push_back(captureBook(*book));
+        writeSnapshot(path, images, state.range(0) + 1);
+    }
+    state.counters["bytes"] = static_cast<double>(std::filesystem::file_size(path));
+    std::remove(path.c_str());
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SnapshotWrite)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMillisecond);
+
+// Map a snapshot of state.range(0) orders and rebuild the book from it
+static void BM_SnapshotRestore(benchmark::State& state) {
+    const std::string path = (std::filesystem::temp_directory_path() / "order_bench.snap").string();
+    {
+        auto book = makeSnapshotBook("TEST", state.range(0));
+        writeSnapshot(path, {captureBook(*book)}, state.range(0) + 1);
+    }
+    OrderBookConfig config;
+    config.order_pool_reserve = static_cast<size_t>(state.range(0));
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto book = std::make_unique<OrderBook>("TEST", MatchingMode::PRICE_TIME_PRIORITY, config);
+        state.ResumeTiming();
+        loadSnapshot(path, [&](const std::string&) -> OrderBook& { return *book; });
+        state.PauseTiming();
+        book.reset();
+        state.ResumeTiming();
+    }
+    std::remove(path.c_str());
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SnapshotRestore)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMillisecond);
+
+// Cost of one trade log line on the calling thread. range(0): 0 = stream
+// with std::endl (the old executeTrade print; /dev/null keeps the terminal
+// out of it), 1 = TF_LOG with the level enabled, 2 = level disabled.
+static void BM_TradeLogLine(benchmark::State& state) {
+    std::ofstream stream("/dev/null");
+    std::FILE* sink = std::fopen("/dev/null", "w");
+    Logger& logger = Logger::instance();
+    logger.setOutput(sink);
+    LogLevel previous = Logger::level();
+    Logger::setLevel(state.range(0) == 2 ? LogLevel::INFO : LogLevel::DEBUG);
+    const std::string symbol = "TEST";
+    Quantity qty = 10;
+    Price px = 10000;
+    OrderId id = 1;
+    const uint64_t dropped_before = logger.dropped();
+    for (auto _ : state) {
+        if (state.range(0) == 0) {
+            stream << "Trade: " << symbol << ' ' << qty << " @ " << px << " between " << id << " and " << id + 1 << std::endl;
+        } else {
+            TF_LOG_DEBUG("Trade: {} {} @ {} between {} and {}", symbol, qty, px, id, id + 1);
+        }
+        ++id;
+    }
+    logger.flush();
+    // Lines the writer could not keep up with; on a machine with a spare
+    // core for it this stays near zero
+    state.counters["dropped"] = static_cast<double>(logger.dropped() - dropped_before);
+    logger.setOutput(stdout);
+    Logger::setLevel(previous);
+    std::fclose(sink);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TradeLogLine)->DenseRange(0, 2)->Unit(benchmark::kNanosecond);
+
+// Stamping a trade: a system_clock read (0), a TSC read (1), and a TSC read
+// converted to epoch nanoseconds as it is when a trade is published (2)
+static void BM_ClockNow(benchmark::State& state) {
+    const Clock& clock = state.range(0) == 0 ? systemClock() : tscClock();
+    const bool convert = state.range(0) == 2;
+    for (auto _ : state) {
+        ClockTicks ticks = clock.now();
+        if (convert) benchmark::DoNotOptimize(clock.toEpochNanos(ticks));
+        else benchmark::DoNotOptimize(ticks);
+    }
+}
+BENCHMARK(BM_ClockNow)->DenseRange(0, 2)->Unit(benchmark::kNanosecond);
+
+// What stage timing adds to a book call: one histogram record from every
+// thread (no shared cache lines), and a locked addOrder with stage timing
+// off (0) and on (1), which swaps the lock for a try_lock.
+static void BM_HistogramRecord(benchmark::State& state) {
+    static LatencyHistogram histogram;
+    uint64_t value = 1000 + static_cast<uint64_t>(state.thread_index()) * 7;
+    for (auto _ : state) {
+        histogram.record(value);
+        value = value * 33 % 1000003;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_HistogramRecord)->ThreadRange(1, 8)->UseRealTime()->Unit(benchmark::kNanosecond);
+
+static void BM_StageTimingAddCancel(benchmark::State& state) {
+    OrderBook book("TEST", MatchingMode::PRICE_TIME_PRIORITY);
+    setStageTiming(state.range(0) == 1);
+    OrderId id = 1;
+    for (auto _ : state) {
+        book.addOrder(id, true, 100, 10000, CLIENT);
+        book.cancelOrder(id++);
+    }
+    setStageTiming(false);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_StageTimingAddCancel)->DenseRange(0, 1)->Unit(benchmark::kNanosecond);
+
+// Request counters bumped from every thread, as each RPC does. range(0):
+// 0 = adjacent std::atomic fetch_adds (the old metrics_* globals; four
+// counters share one cache line), 1 = MetricsRegistry counters (per-thread
+// slots, summed on scrape).
+static void BM_CounterIncrement(benchmark::State& state) {
+    static std::atomic<uint64_t> shared[4];
+    static MetricsRegistry registry;
+    static tradeflow::Counter counters[4] = {registry.counter("bench_a_total", "a"), registry.counter("bench_b_total", "b"),
+                                  registry.counter("bench_c_total", "c"), registry.counter("bench_d_total", "d")};
+    const bool sharded = state.range(0) == 1;
+    for (auto _ : state) {
+        for (int i = 0; i < 4; ++i) {
+            if (sharded) counters[i].inc();
+            else shared[i].fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * 4);
+}
+BENCHMARK(BM_CounterIncrement)->Arg(0)->Arg(1)->ThreadRange(1, 32)->UseRealTime()->Unit(benchmark::kNanosecond);
+
 BENCHMARK_MAIN();
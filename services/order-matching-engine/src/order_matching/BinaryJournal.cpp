@@ -0,0 +1,114 @@
+#include "order_matching/BinaryJournal.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace tradeflow {
+
+JournalFile::JournalFile(const string& path, const char* magic, uint32_t version, uint32_t record_size)
+    : path_(path), fd_(-1) {
+    fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (fd_ < 0) {
+        throw runtime_error("Unable to open journal " + path_ + ": " + strerror(errno));
+    }
+    struct stat st;
+    if (::fstat(fd_, &st) != 0) {
+        int error = errno;
+        ::close(fd_);
+        throw runtime_error("Unable to stat journal " + path_ + ": " + strerror(error));
+    }
+    JournalFileHeader header;
+    if (st.st_size == 0) {
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, magic, sizeof(header.magic));
+        header.version = version;
+        header.record_size = record_size;
+        write(&header, sizeof(header));
+        return;
+    }
+    if (::pread(fd_, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)) ||
+        memcmp(header.magic, magic, sizeof(header.magic)) != 0 || header.version != version ||
+        header.record_size != record_size) {
+        ::close(fd_);
+        throw runtime_error(path_ + " exists but is not a compatible journal");
+    }
+    // A crash mid-write can leave a partial record; appending after it would
+    // misalign every later record
+    off_t body = st.st_size - static_cast<off_t>(sizeof(header));
+    off_t torn = body % static_cast<off_t>(record_size);
+    if (torn != 0 && ::ftruncate(fd_, st.st_size - torn) != 0) {
+        int error = errno;
+        ::close(fd_);
+        throw runtime_error("Unable to trim torn record from " + path_ + ": " + strerror(error));
+    }
+}
+
+JournalFile::~JournalFile() {
+    ::close(fd_);
+}
+
+void JournalFile::write(const void* data, size_t bytes) {
+    const char* cursor = static_cast<const char*>(data);
+    while (bytes > 0) {
+        ssize_t written = ::write(fd_, cursor, bytes);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            throw runtime_error("Journal write to " + path_ + " failed: " + strerror(errno));
+        }
+        cursor += written;
+        bytes -= static_cast<size_t>(written);
+    }
+}
+
+void JournalFile::sync() {
+#ifdef __APPLE__
+    int result = ::fsync(fd_);
+#else
+    int result = ::fdatasync(fd_);
+#endif
+    if (result != 0) {
+        throw runtime_error("Journal sync of " + path_ + " failed: " + strerror(errno));
+    }
+}
+
+size_t validateJournal(const MappedFile& file, const char* magic, uint32_t version, uint32_t record_size) {
+    JournalFileHeader header;
+    if (file.size() < sizeof(header)) throw runtime_error(file.path() + " is not a journal (too short)");
+    memcpy(&header, file.data(), sizeof(header));
+    if (memcmp(header.magic, magic, sizeof(header.magic)) != 0) {
+        throw runtime_error(file.path() + " is not a " + string(magic, strnlen(magic, sizeof(header.magic))) + " journal");
+    }
+    if (header.version != version || header.record_size != record_size) {
+        throw runtime_error(file.path() + ": unsupported journal version " + to_string(header.version));
+    }
+    return (file.size() - sizeof(header)) / record_size;
+}
+
+vector<uint64_t> listNumberedFiles(const string& dir, const string& prefix, const string& suffix) {
+    vector<uint64_t> numbers;
+    DIR* handle = ::opendir(dir.c_str());
+    if (!handle) return numbers;
+    while (const dirent* entry = ::readdir(handle)) {
+        string name = entry->d_name;
+        if (name.size() <= prefix.size() + suffix.size() || name.compare(0, prefix.size(), prefix) != 0 ||
+            name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0) {
+            continue;
+        }
+        string digits = name.substr(prefix.size(), name.size() - prefix.size() - suffix.size());
+        if (digits.size() > 19 || !all_of(digits.begin(), digits.end(), [](unsigned char c) { return isdigit(c); })) continue;
+        numbers.push_back(stoull(digits));
+    }
+    ::closedir(handle);
+    sort(numbers.begin(), numbers.end());
+    return numbers;
+}
+
+} // namespace tradeflow
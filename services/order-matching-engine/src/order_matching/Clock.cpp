@@ -0,0 +1,81 @@
+#include "order_matching/Clock.hpp"
+#include <thread>
+#include <utility>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#define TRADEFLOW_HAVE_TSC 1
+#endif
+
+using namespace std;
+
+namespace tradeflow {
+
+namespace {
+
+int64_t systemNanos() {
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// The counter and system_clock read together: the narrowest of a few
+// counter-bracketed system_clock reads, taken at the bracket's midpoint
+pair<ClockTicks, int64_t> pairedReading(ClockTicks (*counter)()) {
+    ClockTicks best_ticks = 0;
+    int64_t best_nanos = 0;
+    ClockTicks narrowest = ~ClockTicks(0);
+    for (int attempt = 0; attempt < 16; ++attempt) {
+        ClockTicks before = counter();
+        int64_t nanos = systemNanos();
+        ClockTicks after = counter();
+        if (after - before < narrowest) {
+            narrowest = after - before;
+            best_ticks = before + (after - before) / 2;
+            best_nanos = nanos;
+        }
+    }
+    return {best_ticks, best_nanos};
+}
+
+} // namespace
+
+bool TscClock::supported() {
+#ifdef TRADEFLOW_HAVE_TSC
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) return false;
+    return (edx & (1u << 8)) != 0;  // "Invariant TSC"
+#else
+    return false;
+#endif
+}
+
+ClockTicks TscClock::counter() {
+#ifdef TRADEFLOW_HAVE_TSC
+    return __rdtsc();
+#else
+    return static_cast<ClockTicks>(chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+TscClock::TscClock(chrono::nanoseconds calibration) {
+    auto [start_ticks, start_nanos] = pairedReading(&TscClock::counter);
+    this_thread::sleep_for(calibration);
+    auto [end_ticks, end_nanos] = pairedReading(&TscClock::counter);
+    ClockTicks ticks = end_ticks > start_ticks ? end_ticks - start_ticks : 1;
+    int64_t nanos = end_nanos > start_nanos ? end_nanos - start_nanos : 1;
+    base_ticks_ = end_ticks;
+    base_nanos_ = end_nanos;
+    nanos_per_tick_q32_ = static_cast<int64_t>((static_cast<__int128>(nanos) << 32) / ticks);
+}
+
+const Clock& systemClock() {
+    static const SystemClock clock;
+    return clock;
+}
+
+const Clock& tscClock() {
+    if (!TscClock::supported()) return systemClock();
+    static const TscClock clock;
+    return clock;
+}
+
+} // namespace tradeflow
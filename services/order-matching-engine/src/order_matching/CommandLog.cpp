@@ -0,0 +1,58 @@
+#include "order_matching/CommandLog.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+using namespace std;
+
+namespace tradeflow {
+
+namespace {
+
+template <size_t N>
+void copyField(char (&field)[N], string_view value) {
+    memset(field, 0, N);
+    memcpy(field, value.data(), min(value.size(), N));
+}
+
+} // namespace
+
+CommandLog::CommandLog(const string& dir, uint64_t segment, uint64_t next_sequence, const JournalConfig& config)
+    : dir_(dir), segment_(segment), next_sequence_(next_sequence),
+      journal_(segmentPath(dir, segment), COMMAND_LOG_MAGIC, COMMAND_LOG_VERSION, config) {}
+
+uint64_t CommandLog::append(CommandKind kind, const string& symbol, OrderId id, bool is_buy, Quantity qty, Price px,
+                            string_view client_id, OrderType type) {
+    CommandRecord record;
+    record.sequence = next_sequence_.fetch_add(1, memory_order_relaxed);
+    record.order_id = id;
+    record.price = px;
+    record.quantity = qty;
+    record.kind = kind;
+    record.is_buy = is_buy ? 1 : 0;
+    record.order_type = static_cast<uint8_t>(type);
+    record.reserved = 0;
+    copyField(record.symbol, symbol);
+    copyField(record.client_id, client_id);
+    journal_.append(record);
+    return record.sequence;
+}
+
+uint64_t CommandLog::rotate() {
+    uint64_t next = segment_.load(memory_order_relaxed) + 1;
+    journal_.rotate(segmentPath(dir_, next));
+    segment_.store(next, memory_order_release);
+    return next;
+}
+
+string CommandLog::segmentPath(const string& dir, uint64_t segment) {
+    char name[48];
+    snprintf(name, sizeof(name), "commands-%08llu.wal", static_cast<unsigned long long>(segment));
+    return dir + "/" + name;
+}
+
+vector<uint64_t> CommandLog::listSegments(const string& dir) {
+    return listNumberedFiles(dir, "commands-", ".wal");
+}
+
+} // namespace tradeflow
@@ -0,0 +1,99 @@
+#include "order_matching/DepthView.hpp"
+
+using namespace std;
+
+namespace tradeflow {
+
+namespace {
+
+template <typename Map>
+void copyBest(const Map& side, size_t depth, vector<pair<Price, Quantity>>& out) {
+    out.clear();
+    for (auto it = side.begin(); it != side.end() && out.size() < depth; ++it) out.emplace_back(it->first, it->second);
+}
+
+// Both lists are best first on the same side; better(a, b) orders prices
+template <typename Better>
+void diffLevels(bool is_buy, const vector<pair<Price, Quantity>>& sent, const vector<pair<Price, Quantity>>& now,
+                Better better, vector<LevelUpdate>& out) {
+    size_t i = 0;
+    size_t j = 0;
+    while (i < sent.size() || j < now.size()) {
+        if (j == now.size() || (i < sent.size() && better(sent[i].first, now[j].first))) {
+            out.push_back(LevelUpdate{is_buy, sent[i++].first, 0});  // left the view
+        } else if (i == sent.size() || better(now[j].first, sent[i].first)) {
+            out.push_back(LevelUpdate{is_buy, now[j].first, now[j].second});  // entered it
+            ++j;
+        } else {
+            if (sent[i].second != now[j].second) out.push_back(LevelUpdate{is_buy, now[j].first, now[j].second});
+            ++i;
+            ++j;
+        }
+    }
+}
+
+} // namespace
+
+void DepthView::reset(const Levels& bids, const Levels& asks, Levels& view_bids, Levels& view_asks) {
+    bids_.clear();
+    asks_.clear();
+    pending_ = false;
+    if (depth_ == 0) {
+        view_bids = bids;
+        view_asks = asks;
+        return;
+    }
+    bids_.insert(bids.begin(), bids.end());
+    asks_.insert(asks.begin(), asks.end());
+    copyBest(bids_, depth_, sent_bids_);
+    copyBest(asks_, depth_, sent_asks_);
+    view_bids = sent_bids_;
+    view_asks = sent_asks_;
+}
+
+// With nothing pending the view equals what was last sent, so a change
+// behind the worst reported level of a full view cannot alter it
+bool DepthView::affectsView(const LevelUpdate& update) const {
+    if (depth_ == 0 || pending_) return true;
+    const Levels& sent = update.is_buy ? sent_bids_ : sent_asks_;
+    if (sent.size() < depth_) return true;
+    Price worst = sent.back().first;
+    return update.is_buy ? update.price >= worst : update.price <= worst;
+}
+
+void DepthView::apply(const LevelUpdate& update) {
+    pending_ = pending_ || affectsView(update);
+    if (depth_ == 0) {
+        // Latest quantity wins; 0 is kept so the removal is reported
+        if (update.is_buy) bids_[update.price] = update.quantity;
+        else asks_[update.price] = update.quantity;
+        return;
+    }
+    auto update_side = [&](auto& side) {
+        if (update.quantity == 0) side.erase(update.price);
+        else side[update.price] = update.quantity;
+    };
+    if (update.is_buy) update_side(bids_);
+    else update_side(asks_);
+}
+
+void DepthView::flush(vector<LevelUpdate>& out) {
+    if (!pending_) return;
+    pending_ = false;
+    if (depth_ == 0) {
+        for (const auto& [price, quantity] : bids_) out.push_back(LevelUpdate{true, price, quantity});
+        for (const auto& [price, quantity] : asks_) out.push_back(LevelUpdate{false, price, quantity});
+        bids_.clear();
+        asks_.clear();
+        return;
+    }
+    Levels now;
+    copyBest(bids_, depth_, now);
+    diffLevels(true, sent_bids_, now, greater<Price>(), out);
+    sent_bids_.swap(now);
+    copyBest(asks_, depth_, now);
+    diffLevels(false, sent_asks_, now, less<Price>(), out);
+    sent_asks_.swap(now);
+}
+
+} // namespace tradeflow
@@ -0,0 +1,183 @@
+#include "order_matching/EngineConfig.hpp"
+#include <cstdlib>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace tradeflow {
+
+namespace {
+
+string envString(const char* name, const string& fallback) {
+    const char* value = getenv(name);
+    return (value && *value) ? string(value) : fallback;
+}
+
+size_t envSize(const char* name, size_t fallback) {
+    const char* value = getenv(name);
+    if (!value || !*value) return fallback;
+    try {
+        return static_cast<size_t>(stoull(value));
+    } catch (const exception&) {
+        throw runtime_error(string("Invalid value for ") + name + ": " + value);
+    }
+}
+
+vector<string> splitList(const string& value) {
+    vector<string> items;
+    stringstream ss(value);
+    string item;
+    while (getline(ss, item, ',')) {
+        if (!item.empty()) items.push_back(item);
+    }
+    return items;
+}
+
+BookLayout parseLayout(const string& value) {
+    if (value == "map") return BookLayout::SPARSE_MAP;
+    if (value == "ladder") return BookLayout::TICK_LADDER;
+    throw runtime_error("Invalid value for TRADEFLOW_BOOK_LAYOUT: " + value + " (expected map or ladder)");
+}
+
+// "AAPL=0,MSFT=1"
+unordered_map<string, size_t> parseShardOverrides(const string& value) {
+    unordered_map<string, size_t> overrides;
+    for (const auto& item : splitList(value)) {
+        size_t eq = item.find('=');
+        if (eq == string::npos || eq == 0) {
+            throw runtime_error("Invalid entry in TRADEFLOW_SHARD_OVERRIDES: " + item + " (expected SYMBOL=SHARD)");
+        }
+        try {
+            overrides[item.substr(0, eq)] = static_cast<size_t>(stoull(item.substr(eq + 1)));
+        } catch (const exception&) {
+            throw runtime_error("Invalid entry in TRADEFLOW_SHARD_OVERRIDES: " + item + " (expected SYMBOL=SHARD)");
+        }
+    }
+    return overrides;
+}
+
+ExecutionMode parseExecution(const string& value) {
+    if (value == "locked") return ExecutionMode::LOCKED;
+    if (value == "sequencer") return ExecutionMode::SEQUENCER;
+    throw runtime_error("Invalid value for TRADEFLOW_EXECUTION: " + value + " (expected locked or sequencer)");
+}
+
+bool parseSwitch(const char* name, const string& value) {
+    if (value == "on" || value == "1" || value == "true") return true;
+    if (value == "off" || value == "0" || value == "false") return false;
+    throw runtime_error(string("Invalid value for ") + name + ": " + value + " (expected on or off)");
+}
+
+JournalSync parseJournalSync(const char* name, const string& value) {
+    if (value == "none") return JournalSync::NONE;
+    if (value == "group") return JournalSync::GROUP_COMMIT;
+    if (value == "batch") return JournalSync::EVERY_BATCH;
+    throw runtime_error(string("Invalid value for ") + name + ": " + value + " (expected none, group or batch)");
+}
+
+GrpcServerMode parseGrpcServer(const string& value) {
+    if (value == "sync") return GrpcServerMode::SYNC;
+    if (value == "async") return GrpcServerMode::ASYNC;
+    throw runtime_error("Invalid value for TRADEFLOW_GRPC_SERVER: " + value + " (expected sync or async)");
+}
+
+SlowSubscriberPolicy parseSlowSubscriber(const string& value) {
+    if (value == "skip") return SlowSubscriberPolicy::SKIP;
+    if (value == "lag") return SlowSubscriberPolicy::LAG;
+    if (value == "disconnect") return SlowSubscriberPolicy::DISCONNECT;
+    throw runtime_error("Invalid value for TRADEFLOW_SLOW_SUBSCRIBER: " + value + " (expected skip, lag or disconnect)");
+}
+
+bool parseWalAck(const string& value) {
+    if (value == "async") return false;
+    if (value == "durable") return true;
+    throw runtime_error("Invalid value for TRADEFLOW_WAL_ACK: " + value + " (expected async or durable)");
+}
+
+const Clock* parseClock(const string& value) {
+    if (value == "tsc") return &tscClock();
+    if (value == "system") return &systemClock();
+    throw runtime_error("Invalid value for TRADEFLOW_CLOCK: " + value + " (expected tsc or system)");
+}
+
+LogLevel parseLogLevel(const string& value) {
+    LogLevel level;
+    if (!Logger::parseLevel(value, level)) {
+        throw runtime_error("Invalid value for TRADEFLOW_LOG_LEVEL: " + value +
+                            " (expected trace, debug, info, warn, error or off)");
+    }
+    return level;
+}
+
+} // namespace
+
+OrderBookConfig EngineConfig::bookConfigFor(const string& symbol) const {
+    OrderBookConfig config = book;
+    if (ladder_symbols.count(symbol)) config.layout = BookLayout::TICK_LADDER;
+    config.locking = execution == ExecutionMode::LOCKED;
+    return config;
+}
+
+MatchingMode EngineConfig::matchingModeFor(const string& symbol) const {
+    return auction_symbols.count(symbol) ? MatchingMode::CALL_AUCTION : MatchingMode::PRICE_TIME_PRIORITY;
+}
+
+EngineConfig EngineConfig::fromEnvironment() {
+    EngineConfig config;
+    config.book.order_pool_reserve = envSize("TRADEFLOW_ORDER_POOL_RESERVE", 1024);
+    config.book.level_pool_reserve = envSize("TRADEFLOW_LEVEL_POOL_RESERVE", 64);
+    config.book.order_pool_slab_size = envSize("TRADEFLOW_ORDER_POOL_SLAB", config.book.order_pool_slab_size);
+    config.book.level_pool_slab_size = envSize("TRADEFLOW_LEVEL_POOL_SLAB", config.book.level_pool_slab_size);
+    config.book.order_index_capacity = envSize("TRADEFLOW_ORDER_INDEX_CAPACITY", config.book.order_index_capacity);
+    config.book.layout = parseLayout(envString("TRADEFLOW_BOOK_LAYOUT", "map"));
+    config.book.ladder_ticks = envSize("TRADEFLOW_LADDER_TICKS", config.book.ladder_ticks);
+    config.book.published_depth = envSize("TRADEFLOW_PUBLISHED_DEPTH", config.book.published_depth);
+    config.router_stripes = envSize("TRADEFLOW_ROUTER_STRIPES", config.router_stripes);
+    config.execution = parseExecution(envString("TRADEFLOW_EXECUTION", "locked"));
+    for (const auto& core : splitList(envString("TRADEFLOW_SHARD_CORES", ""))) {
+        try {
+            config.shard_cores.push_back(stoi(core));
+        } catch (const exception&) {
+            throw runtime_error("Invalid core in TRADEFLOW_SHARD_CORES: " + core);
+        }
+    }
+    // One shard per listed core unless the count is given explicitly
+    config.shard_count = envSize("TRADEFLOW_SHARDS", config.shard_cores.empty() ? 1 : config.shard_cores.size());
+    config.shard_overrides = parseShardOverrides(envString("TRADEFLOW_SHARD_OVERRIDES", ""));
+    config.sequencer_ring_capacity = envSize("TRADEFLOW_SEQUENCER_RING", config.sequencer_ring_capacity);
+    config.journal_enabled = parseSwitch("TRADEFLOW_JOURNAL", envString("TRADEFLOW_JOURNAL", "on"));
+    config.journal_dir = envString("TRADEFLOW_JOURNAL_DIR", config.journal_dir);
+    config.journal.sync = parseJournalSync("TRADEFLOW_JOURNAL_SYNC", envString("TRADEFLOW_JOURNAL_SYNC", "group"));
+    config.journal.group_commit_us =
+        static_cast<uint32_t>(envSize("TRADEFLOW_JOURNAL_GROUP_COMMIT_US", config.journal.group_commit_us));
+    config.journal.ring_capacity = envSize("TRADEFLOW_JOURNAL_RING", config.journal.ring_capacity);
+    config.state_dir = envString("TRADEFLOW_STATE_DIR", "");
+    config.command_log.sync = parseJournalSync("TRADEFLOW_WAL_SYNC", envString("TRADEFLOW_WAL_SYNC", "group"));
+    config.command_log.ring_capacity = envSize("TRADEFLOW_WAL_RING", config.command_log.ring_capacity);
+    config.wal_durable_ack = parseWalAck(envString("TRADEFLOW_WAL_ACK", "async"));
+    config.snapshot_interval_s = envSize("TRADEFLOW_SNAPSHOT_INTERVAL_S", config.snapshot_interval_s);
+    config.grpc_server = parseGrpcServer(envString("TRADEFLOW_GRPC_SERVER", "sync"));
+    config.grpc_threads = envSize("TRADEFLOW_GRPC_THREADS", config.grpc_threads);
+    config.grpc_handler_threads = envSize("TRADEFLOW_GRPC_HANDLER_THREADS", config.grpc_handler_threads);
+    config.trade_ring_capacity = envSize("TRADEFLOW_TRADE_RING", config.trade_ring_capacity);
+    config.slow_subscriber = parseSlowSubscriber(envString("TRADEFLOW_SLOW_SUBSCRIBER", "lag"));
+    config.book_ring_capacity = envSize("TRADEFLOW_BOOK_RING", config.book_ring_capacity);
+    config.latency_histograms =
+        parseSwitch("TRADEFLOW_LATENCY_HISTOGRAMS", envString("TRADEFLOW_LATENCY_HISTOGRAMS", "on"));
+    config.metrics_max_symbols = envSize("TRADEFLOW_METRICS_MAX_SYMBOLS", config.metrics_max_symbols);
+    config.log_level = parseLogLevel(envString("TRADEFLOW_LOG_LEVEL", "info"));
+    config.clock = envString("TRADEFLOW_CLOCK", config.clock);
+    config.book.clock = parseClock(config.clock);
+    for (const auto& symbol : splitList(envString("TRADEFLOW_LADDER_SYMBOLS", ""))) {
+        config.ladder_symbols.insert(symbol);
+    }
+    for (const auto& symbol : splitList(envString("TRADEFLOW_AUCTION_SYMBOLS", ""))) {
+        config.auction_symbols.insert(symbol);
+    }
+    return config;
+}
+
+} // namespace tradeflow
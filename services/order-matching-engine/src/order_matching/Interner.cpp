@@ -0,0 +1,77 @@
+#include "order_matching/Interner.hpp"
+#include <mutex>
+#include <stdexcept>
+
+using namespace std;
+
+namespace tradeflow {
+
+Interner::Interner() {
+    intern(string_view());
+}
+
+uint32_t Interner::intern(string_view name) {
+    {
+        shared_lock<shared_mutex> lock(mutex_);
+        auto it = handles_.find(name);
+        if (it != handles_.end()) return it->second;
+    }
+    unique_lock<shared_mutex> lock(mutex_);
+    auto it = handles_.find(name);  // another thread may have added it meanwhile
+    if (it != handles_.end()) return it->second;
+    uint32_t handle = static_cast<uint32_t>(names_.size());
+    names_.emplace_back(name);
+    handles_.emplace(names_.back(), handle);
+    return handle;
+}
+
+const string& Interner::name(uint32_t handle) const {
+    shared_lock<shared_mutex> lock(mutex_);
+    if (handle >= names_.size()) throw out_of_range("unknown interned handle " + to_string(handle));
+    return names_[handle];
+}
+
+size_t Interner::size() const {
+    shared_lock<shared_mutex> lock(mutex_);
+    return names_.size();
+}
+
+Interner& symbolNames() {
+    static Interner table;
+    return table;
+}
+
+uint32_t ClientTable::acquire(string_view client_id) {
+    auto it = handles_.find(client_id);
+    if (it != handles_.end()) {
+        ++entries_[it->second].refs;
+        return it->second;
+    }
+    while (!free_.empty()) {
+        uint32_t handle = free_.back();
+        free_.pop_back();
+        Entry& entry = entries_[handle];
+        entry.listed = false;
+        if (entry.refs > 0) continue;
+        // Re-key the entry's map node rather than allocating another
+        auto node = handles_.extract(entry.name);
+        entry.name.assign(client_id);
+        entry.refs = 1;
+        node.key() = entry.name;
+        handles_.insert(move(node));
+        return handle;
+    }
+    uint32_t handle = static_cast<uint32_t>(entries_.size());
+    entries_.push_back(Entry{string(client_id), 1, false});
+    handles_.emplace(entries_.back().name, handle);
+    return handle;
+}
+
+void ClientTable::release(uint32_t handle) {
+    Entry& entry = entries_[handle];
+    if (--entry.refs > 0 || entry.listed) return;
+    entry.listed = true;
+    free_.push_back(handle);
+}
+
+} // namespace tradeflow
@@ -0,0 +1,112 @@
+#include "order_matching/LatencyHistogram.hpp"
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+namespace tradeflow {
+
+namespace {
+
+atomic<size_t> next_histogram_id{0};
+atomic<bool> stage_timing_enabled{false};
+thread_local StageTimes thread_stage_times;
+
+// Prometheus bucket edges: 1-2-5 per decade, 1 us to 10 s
+vector<uint64_t> prometheusEdges() {
+    vector<uint64_t> edges;
+    for (uint64_t decade = 1000; decade <= 1000000000; decade *= 10) {
+        for (uint64_t step : {1, 2, 5}) edges.push_back(step * decade);
+    }
+    edges.push_back(10000000000ull);
+    return edges;
+}
+
+} // namespace
+
+uint64_t HistogramSnapshot::quantile(double q) const {
+    if (count == 0) return 0;
+    uint64_t rank = static_cast<uint64_t>(ceil(clamp(q, 0.0, 1.0) * static_cast<double>(count)));
+    rank = max<uint64_t>(rank, 1);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts.size(); ++i) {
+        seen += counts[i];
+        if (seen >= rank) return LatencyHistogram::bucketUpperBound(i);
+    }
+    return LatencyHistogram::bucketUpperBound(counts.size() - 1);
+}
+
+LatencyHistogram::LatencyHistogram() : id_(next_histogram_id.fetch_add(1, memory_order_relaxed)) {}
+
+uint64_t LatencyHistogram::bucketLowerBound(size_t index) {
+    if (index < SUB_BUCKETS) return index;
+    size_t shift = (index - SUB_BUCKETS) / SUB_BUCKETS;
+    uint64_t sub = (index - SUB_BUCKETS) % SUB_BUCKETS;
+    return (SUB_BUCKETS + sub) << shift;
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(size_t index) {
+    if (index < SUB_BUCKETS) return index;
+    if (index >= BUCKETS - 1) return UINT64_MAX;
+    size_t shift = (index - SUB_BUCKETS) / SUB_BUCKETS;
+    return bucketLowerBound(index) + (uint64_t{1} << shift) - 1;
+}
+
+LatencyHistogram::Shard& LatencyHistogram::registerShard(vector<Shard*>& thread_shards) {
+    if (thread_shards.size() <= id_) thread_shards.resize(id_ + 1, nullptr);
+    auto shard = make_unique<Shard>();
+    Shard* raw = shard.get();
+    {
+        lock_guard<mutex> lock(shards_mutex_);
+        shards_.push_back(move(shard));
+    }
+    thread_shards[id_] = raw;
+    return *raw;
+}
+
+HistogramSnapshot LatencyHistogram::snapshot() const {
+    HistogramSnapshot merged;
+    merged.counts.assign(BUCKETS, 0);
+    lock_guard<mutex> lock(shards_mutex_);
+    for (const auto& shard : shards_) {
+        for (size_t i = 0; i < BUCKETS; ++i) merged.counts[i] += shard->counts[i].load(memory_order_relaxed);
+        merged.count += shard->count.load(memory_order_relaxed);
+        merged.sum_ns += shard->sum_ns.load(memory_order_relaxed);
+    }
+    return merged;
+}
+
+void writePrometheusHistogram(ostream& out, const string& name, const string& labels,
+                              const HistogramSnapshot& snapshot) {
+    static const vector<uint64_t> edges = prometheusEdges();
+    string prefix = labels.empty() ? "" : labels + ",";
+    size_t bucket = 0;
+    uint64_t cumulative = 0;
+    for (uint64_t edge : edges) {
+        while (bucket < snapshot.counts.size() && LatencyHistogram::bucketUpperBound(bucket) <= edge) {
+            cumulative += snapshot.counts[bucket++];
+        }
+        out << name << "_bucket{" << prefix << "le=\"" << edge / 1e9 << "\"} " << cumulative << '\n';
+    }
+    // Bucket totals rather than snapshot.count, which can include records that
+    // landed after their bucket was read; the series must stay monotonic
+    while (bucket < snapshot.counts.size()) cumulative += snapshot.counts[bucket++];
+    out << name << "_bucket{" << prefix << "le=\"+Inf\"} " << cumulative << '\n';
+    string braces = labels.empty() ? "" : "{" + labels + "}";
+    out << name << "_sum" << braces << ' ' << snapshot.sum_ns / 1e9 << '\n';
+    out << name << "_count" << braces << ' ' << cumulative << '\n';
+}
+
+StageTimes& threadStageTimes() {
+    return thread_stage_times;
+}
+
+void setStageTiming(bool enabled) {
+    stage_timing_enabled.store(enabled, memory_order_relaxed);
+}
+
+bool stageTiming() {
+    return stage_timing_enabled.load(memory_order_relaxed);
+}
+
+} // namespace tradeflow
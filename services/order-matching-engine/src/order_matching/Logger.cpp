@@ -0,0 +1,219 @@
+#include "order_matching/Logger.hpp"
+#include <bit>
+#include <ctime>
+
+using namespace std;
+
+namespace tradeflow {
+
+namespace {
+
+constexpr size_t DEFAULT_THREAD_BUFFER_BYTES = 256 * 1024;
+constexpr auto WRITER_POLL = chrono::milliseconds(1);
+
+// Registers the calling thread's buffer on first use and marks it closed on
+// thread exit so the writer can drop it once drained.
+struct ThreadBufferHandle {
+    shared_ptr<LogBuffer> buffer;
+    ~ThreadBufferHandle() {
+        if (buffer) buffer->closed.store(true, memory_order_release);
+    }
+};
+
+thread_local ThreadBufferHandle tls_buffer;
+
+template <typename V>
+V take(const char*& in) {
+    V value;
+    memcpy(&value, in, sizeof(value));
+    in += sizeof(value);
+    return value;
+}
+
+void appendArg(string& out, const char*& in) {
+    auto tag = static_cast<logdetail::ArgTag>(*in++);
+    char scratch[32];
+    switch (tag) {
+        case logdetail::ArgTag::INT:
+            out.append(scratch, snprintf(scratch, sizeof(scratch), "%lld", static_cast<long long>(take<int64_t>(in))));
+            break;
+        case logdetail::ArgTag::UINT:
+            out.append(scratch, snprintf(scratch, sizeof(scratch), "%llu", static_cast<unsigned long long>(take<uint64_t>(in))));
+            break;
+        case logdetail::ArgTag::DOUBLE:
+            out.append(scratch, snprintf(scratch, sizeof(scratch), "%g", take<double>(in)));
+            break;
+        case logdetail::ArgTag::BOOL:
+            out += take<uint8_t>(in) ? "true" : "false";
+            break;
+        case logdetail::ArgTag::CHAR:
+            out += take<char>(in);
+            break;
+        case logdetail::ArgTag::STRING: {
+            uint16_t length = take<uint16_t>(in);
+            out.append(in, length);
+            in += length;
+            break;
+        }
+    }
+}
+
+} // namespace
+
+LogBuffer::LogBuffer(size_t capacity)
+    : data_(), mask_(bit_ceil(capacity < 1024 ? size_t(1024) : capacity) - 1), head_(0), cached_head_(0), tail_(0) {
+    data_ = make_unique<char[]>(mask_ + 1);
+}
+
+char* LogBuffer::reserve(size_t bytes) {
+    const size_t capacity = mask_ + 1;
+    if (bytes > capacity / 4) return nullptr;  // keeps a wrap from ever needing the whole ring
+    size_t tail = tail_.load(memory_order_relaxed);
+    size_t offset = tail & mask_;
+    size_t contiguous = capacity - offset;
+    size_t needed = bytes > contiguous ? contiguous + bytes : bytes;
+    if (capacity - (tail - cached_head_) < needed) {
+        cached_head_ = head_.load(memory_order_acquire);
+        if (capacity - (tail - cached_head_) < needed) return nullptr;
+    }
+    if (bytes > contiguous) {
+        // Fill the end with a pad record and start over at offset 0
+        uint32_t pad[2] = {static_cast<uint32_t>(contiguous), logdetail::PAD_RECORD};
+        memcpy(data_.get() + offset, pad, sizeof(pad));
+        tail_.store(tail + contiguous, memory_order_release);
+        offset = 0;
+    }
+    return data_.get() + offset;
+}
+
+Logger& Logger::instance() {
+    static Logger logger;
+    return logger;
+}
+
+Logger::Logger()
+    : buffers_mutex_(), buffers_(), output_(stdout), buffer_bytes_(DEFAULT_THREAD_BUFFER_BYTES), dropped_(0),
+      dropped_reported_(0), passes_(0), flush_requested_(false), stopping_(false), pending_(), writer_() {
+    writer_ = thread([this] { writerLoop(); });
+}
+
+Logger::~Logger() {
+    stopping_.store(true, memory_order_release);
+    writer_.join();
+}
+
+const char* Logger::levelName(LogLevel level) {
+    switch (level) {
+        case LogLevel::TRACE: return "TRACE";
+        case LogLevel::DEBUG: return "DEBUG";
+        case LogLevel::INFO: return "INFO";
+        case LogLevel::WARN: return "WARN";
+        case LogLevel::ERROR: return "ERROR";
+        case LogLevel::OFF: return "OFF";
+    }
+    return "?";
+}
+
+bool Logger::parseLevel(string_view name, LogLevel& level) {
+    if (name == "trace") level = LogLevel::TRACE;
+    else if (name == "debug") level = LogLevel::DEBUG;
+    else if (name == "info") level = LogLevel::INFO;
+    else if (name == "warn") level = LogLevel::WARN;
+    else if (name == "error") level = LogLevel::ERROR;
+    else if (name == "off") level = LogLevel::OFF;
+    else return false;
+    return true;
+}
+
+LogBuffer* Logger::threadBuffer() {
+    if (!tls_buffer.buffer) {
+        tls_buffer.buffer = make_shared<LogBuffer>(buffer_bytes_.load(memory_order_relaxed));
+        lock_guard<mutex> lock(buffers_mutex_);
+        buffers_.push_back(tls_buffer.buffer);
+    }
+    return tls_buffer.buffer.get();
+}
+
+void Logger::flush() {
+    vector<pair<shared_ptr<LogBuffer>, size_t>> targets;
+    {
+        lock_guard<mutex> lock(buffers_mutex_);
+        for (const auto& buffer : buffers_) targets.emplace_back(buffer, buffer->produced());
+    }
+    flush_requested_.store(true, memory_order_release);
+    for (const auto& target : targets) {
+        while (target.first->consumed() < target.second) this_thread::yield();
+    }
+    // The pass that consumed the last record writes it before passes_ moves on
+    uint64_t pass = passes_.load(memory_order_acquire);
+    flush_requested_.store(true, memory_order_release);
+    while (passes_.load(memory_order_acquire) <= pass) this_thread::yield();
+}
+
+void Logger::formatRecord(const char* record) {
+    logdetail::RecordHeader header;
+    memcpy(&header, record, sizeof(header));
+    const char* args = record + sizeof(header);
+
+    time_t seconds = static_cast<time_t>(header.timestamp_ns / 1000000000);
+    tm utc;
+    gmtime_r(&seconds, &utc);
+    char prefix[64];
+    size_t length = strftime(prefix, sizeof(prefix), "%Y-%m-%dT%H:%M:%S", &utc);
+    length += snprintf(prefix + length, sizeof(prefix) - length, ".%06lldZ %-5s ",
+                       static_cast<long long>(header.timestamp_ns % 1000000000 / 1000), levelName(header.site->level));
+    pending_.append(prefix, length);
+
+    uint32_t remaining = header.arg_count;
+    for (const char* f = header.site->format; *f; ++f) {
+        if (f[0] == '{' && f[1] == '}' && remaining > 0) {
+            appendArg(pending_, args);
+            --remaining;
+            ++f;
+        } else {
+            pending_ += *f;
+        }
+    }
+    pending_ += '\n';
+}
+
+bool Logger::drainAll() {
+    size_t records = 0;
+    {
+        lock_guard<mutex> lock(buffers_mutex_);
+        for (auto it = buffers_.begin(); it != buffers_.end();) {
+            // Check closed before draining so a record committed just before
+            // the thread exited is still picked up.
+            bool closed = (*it)->closed.load(memory_order_acquire);
+            records += (*it)->drain([this](const char* record) { formatRecord(record); });
+            if (closed) it = buffers_.erase(it);
+            else ++it;
+        }
+    }
+    uint64_t dropped = dropped_.load(memory_order_relaxed);
+    if (dropped != dropped_reported_) {
+        pending_ += "WARN  [logger] dropped " + to_string(dropped - dropped_reported_) +
+                    " message(s): thread log buffer full\n";
+        dropped_reported_ = dropped;
+    }
+    if (!pending_.empty()) {
+        FILE* out = output_.load(memory_order_acquire);
+        fwrite(pending_.data(), 1, pending_.size(), out);
+        fflush(out);
+        pending_.clear();
+    }
+    return records > 0;
+}
+
+void Logger::writerLoop() {
+    while (true) {
+        bool stopping = stopping_.load(memory_order_acquire);
+        bool busy = drainAll();
+        passes_.fetch_add(1, memory_order_release);
+        if (stopping) return;
+        if (busy || flush_requested_.exchange(false, memory_order_acq_rel)) continue;
+        this_thread::sleep_for(WRITER_POLL);
+    }
+}
+
+} // namespace tradeflow
@@ -0,0 +1,209 @@
+#include "order_matching/MetricsRegistry.hpp"
+#include <stdexcept>
+
+using namespace std;
+
+namespace tradeflow {
+
+namespace {
+
+atomic<size_t> next_registry_id{0};
+atomic<uint64_t> next_family_id{0};
+
+// Per-thread label lookups: family id -> joined label values -> slot
+thread_local unordered_map<uint64_t, unordered_map<string, uint32_t>> thread_series;
+
+string joinLabels(const vector<string>& values) {
+    string key;
+    for (const auto& value : values) {
+        key += value;
+        key += '\x1f';
+    }
+    return key;
+}
+
+} // namespace
+
+string escapeLabel(const string& value) {
+    string escaped;
+    escaped.reserve(value.size());
+    for (char c : value) {
+        if (c == '\\' || c == '"') escaped += '\\';
+        if (c == '\n') {
+            escaped += "\\n";
+            continue;
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+int64_t Counter::value() const {
+    return registry_ ? registry_->sum(slot_) : 0;
+}
+
+MetricFamily::MetricFamily(MetricsRegistry& registry, string name, string help, MetricType type,
+                           vector<string> label_names)
+    : registry_(registry), name_(move(name)), help_(move(help)), type_(type), label_names_(move(label_names)),
+      id_(next_family_id.fetch_add(1, memory_order_relaxed)) {}
+
+Counter MetricFamily::labels(initializer_list<string> values) {
+    return labels(vector<string>(values));
+}
+
+Counter MetricFamily::labels(const vector<string>& values) {
+    if (values.size() != label_names_.size()) {
+        throw invalid_argument("metric " + name_ + " takes " + to_string(label_names_.size()) + " label values");
+    }
+    string key = joinLabels(values);
+    auto& cache = thread_series[id_];
+    auto cached = cache.find(key);
+    if (cached != cache.end()) return Counter(&registry_, cached->second);
+
+    uint32_t slot;
+    bool folded = false;
+    {
+        lock_guard<mutex> lock(mutex_);
+        auto it = index_.find(key);
+        if (it != index_.end()) {
+            slot = it->second;
+        } else {
+            vector<string> series_values = values;
+            if (capped_label_ < series_values.size()) {
+                string& value = series_values[capped_label_];
+                if (!label_values_.count(value)) {
+                    if (label_values_.size() < max_label_values_) {
+                        label_values_.insert(value);
+                    } else {
+                        value = overflow_value_;
+                        folded = true;
+                    }
+                }
+            }
+            // Values past the cap share one series and stay out of index_
+            string series_key = joinLabels(series_values);
+            auto existing = index_.find(series_key);
+            if (existing != index_.end()) {
+                slot = existing->second;
+            } else {
+                slot = registry_.allocateSlot();
+                series_.push_back({move(series_values), slot});
+                index_.emplace(move(series_key), slot);
+            }
+        }
+    }
+    // A folded value goes back to the mutex each time rather than growing
+    // every calling thread's cache with one entry per client-chosen value
+    if (!folded) cache.emplace(move(key), slot);
+    return Counter(&registry_, slot);
+}
+
+void MetricFamily::capLabel(size_t label, size_t max_values, string overflow) {
+    if (label >= label_names_.size()) {
+        throw invalid_argument("metric " + name_ + " has no label " + to_string(label));
+    }
+    lock_guard<mutex> lock(mutex_);
+    capped_label_ = label;
+    max_label_values_ = max_values;
+    overflow_value_ = move(overflow);
+}
+
+bool MetricFamily::hasOwnSeries(const string& value) const {
+    lock_guard<mutex> lock(mutex_);
+    if (capped_label_ == SIZE_MAX) return true;
+    return label_values_.count(value) || label_values_.size() < max_label_values_;
+}
+
+void MetricFamily::writePrometheus(ostream& out) const {
+    vector<Series> series;
+    {
+        lock_guard<mutex> lock(mutex_);
+        series = series_;
+    }
+    if (series.empty()) return;
+    out << "# HELP " << name_ << ' ' << help_ << '\n';
+    out << "# TYPE " << name_ << ' ' << (type_ == MetricType::COUNTER ? "counter" : "gauge") << '\n';
+    for (const auto& entry : series) {
+        out << name_;
+        if (!label_names_.empty()) {
+            out << '{';
+            for (size_t i = 0; i < label_names_.size(); ++i) {
+                out << (i ? "," : "") << label_names_[i] << "=\"" << escapeLabel(entry.values[i]) << '"';
+            }
+            out << '}';
+        }
+        out << ' ' << registry_.sum(entry.slot) << '\n';
+    }
+}
+
+MetricsRegistry::ThreadBlock::~ThreadBlock() {
+    for (auto& chunk : chunks) delete chunk.load(memory_order_relaxed);
+}
+
+MetricsRegistry::MetricsRegistry() : id_(next_registry_id.fetch_add(1, memory_order_relaxed)), next_slot_(0) {}
+
+MetricsRegistry::~MetricsRegistry() = default;
+
+MetricFamily& MetricsRegistry::family(const string& name, const string& help, MetricType type,
+                                      vector<string> label_names) {
+    lock_guard<mutex> lock(mutex_);
+    for (const auto& family : families_) {
+        if (family->name() == name) return *family;
+    }
+    families_.push_back(make_unique<MetricFamily>(*this, name, help, type, move(label_names)));
+    return *families_.back();
+}
+
+Counter MetricsRegistry::counter(const string& name, const string& help) {
+    return family(name, help, MetricType::COUNTER).labels({});
+}
+
+Counter MetricsRegistry::gauge(const string& name, const string& help) {
+    return family(name, help, MetricType::GAUGE).labels({});
+}
+
+void MetricsRegistry::writePrometheus(ostream& out) const {
+    vector<const MetricFamily*> families;
+    {
+        lock_guard<mutex> lock(mutex_);
+        for (const auto& family : families_) families.push_back(family.get());
+    }
+    for (const MetricFamily* family : families) family->writePrometheus(out);
+}
+
+MetricsRegistry::ThreadBlock* MetricsRegistry::registerBlock(vector<ThreadBlock*>& thread_blocks) {
+    if (thread_blocks.size() <= id_) thread_blocks.resize(id_ + 1, nullptr);
+    auto block = make_unique<ThreadBlock>();
+    ThreadBlock* raw = block.get();
+    {
+        lock_guard<mutex> lock(mutex_);
+        blocks_.push_back(move(block));
+    }
+    thread_blocks[id_] = raw;
+    return raw;
+}
+
+MetricsRegistry::Chunk* MetricsRegistry::allocateChunk(ThreadBlock& block, size_t chunk) {
+    // Only the owning thread writes its block; scrapes load with acquire
+    Chunk* fresh = new Chunk();
+    block.chunks[chunk].store(fresh, memory_order_release);
+    return fresh;
+}
+
+uint32_t MetricsRegistry::allocateSlot() {
+    uint32_t slot = next_slot_.fetch_add(1, memory_order_relaxed);
+    if (slot >= MAX_SERIES) throw runtime_error("metrics registry is out of series slots");
+    return slot;
+}
+
+int64_t MetricsRegistry::sum(uint32_t slot) const {
+    uint64_t total = 0;
+    lock_guard<mutex> lock(mutex_);
+    for (const auto& block : blocks_) {
+        const Chunk* chunk = block->chunks[slot / SLOTS_PER_CHUNK].load(memory_order_acquire);
+        if (chunk) total += chunk->slots[slot % SLOTS_PER_CHUNK].load(memory_order_relaxed);
+    }
+    return static_cast<int64_t>(total);
+}
+
+} // namespace tradeflow
@@ -1,16 +1,25 @@
 #include "order_matching/Order.hpp"
-#include <chrono>
-#include <string>
 
 using namespace std;
 
 namespace tradeflow {
 
+static_assert(sizeof(Order) <= 48, "an Order should stay within 48 bytes");
+
 Order::Order()
-    : id(0), is_buy(false), quantity(0), price(0), timestamp(chrono::system_clock::now()), client_id(), symbol() {}
+    : id(0), quantity(0), client(0), is_buy(false), prev(nullptr), next(nullptr), level(nullptr) {}
+
+Order::Order(OrderId id_, bool is_buy_, Quantity quantity_, ClientHandle client_)
+    : id(id_), quantity(quantity_), client(client_), is_buy(is_buy_), prev(nullptr), next(nullptr), level(nullptr) {}
 
-Order::Order(OrderId id_, bool is_buy_, Quantity quantity_, Price price_,
-             const string& client_id_, const string& symbol_)
-    : id(id_), is_buy(is_buy_), quantity(quantity_), price(price_), timestamp(chrono::system_clock::now()), client_id(client_id_), symbol(symbol_) {}
+void Order::reset(OrderId id_, bool is_buy_, Quantity quantity_, ClientHandle client_) {
+    id = id_;
+    is_buy = is_buy_;
+    quantity = quantity_;
+    client = client_;
+    prev = nullptr;
+    next = nullptr;
+    level = nullptr;
+}
 
 } // namespace tradeflow
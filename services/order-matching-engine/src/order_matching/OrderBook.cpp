@@ -1,164 +1,504 @@
 #include "order_matching/OrderBook.hpp"
+#include "order_matching/CommandLog.hpp"
+#include "order_matching/LatencyHistogram.hpp"
+#include "order_matching/Logger.hpp"
 #include <algorithm>
-#include <iostream>
+#include <cstdlib>
+#include <limits>
+#include <stdexcept>
 
 using namespace std;
 
 namespace tradeflow {
 
-OrderBook::OrderBook(const string& symbol, MatchingMode mode)
-    : order_map_(), bid_levels_(), ask_levels_(), mutex_(), mode_(mode), trade_callback_(nullptr), symbol_(symbol), trade_log_(nullptr) {}
+namespace {
+
+void checkRecordableSymbol(const string& symbol) {
+    if (symbol.size() > MAX_SYMBOL_LENGTH) {
+        throw invalid_argument("Symbol " + symbol + " is longer than " + to_string(MAX_SYMBOL_LENGTH) + " bytes");
+    }
+}
+
+} // namespace
+
+OrderBook::OrderBook(const string& symbol, MatchingMode mode, const OrderBookConfig& config)
+    : node_resource_(),
+      order_pool_(config.order_pool_reserve, config.order_pool_slab_size),
+      level_pool_(config.level_pool_reserve, config.level_pool_slab_size),
+      order_index_(config.order_index_capacity ? config.order_index_capacity : config.order_pool_reserve),
+      bid_levels_(true, &node_resource_), ask_levels_(false, &node_resource_),
+      mutex_(), locking_(config.locking), mode_(mode), trade_callback_(nullptr), order_closed_callback_(nullptr),
+      depth_callback_(nullptr), level_updates_(), depth_sequence_(0), depth_cache_(config.published_depth),
+      symbol_(symbol), symbol_handle_(symbolNames().intern(symbol)), trade_journal_(nullptr),
+      command_log_(nullptr), last_sequence_(0), trade_sequence_(0),
+      clock_(config.clock ? config.clock : &systemClock()), pro_rata_(config.pro_rata), auction_reference_(0) {
+    if (config.layout == BookLayout::TICK_LADDER && config.ladder_ticks > 0) {
+        bid_levels_.configureBand(config.ladder_ticks, config.ladder_base_price);
+        ask_levels_.configureBand(config.ladder_ticks, config.ladder_base_price);
+    }
+    published_order_pool_.store(order_pool_.stats());
+    published_level_pool_.store(level_pool_.stats());
+}
+
+// With stage timing on, an uncontended lock costs one try_lock; only a
+// contended acquisition reads the clock (into StageTimes::lock_wait_ns)
+unique_lock<shared_mutex> OrderBook::writeLock() const {
+    if (!locking_) return unique_lock<shared_mutex>();
+    if (!stageTiming()) return unique_lock<shared_mutex>(mutex_);
+    unique_lock<shared_mutex> lock(mutex_, try_to_lock);
+    if (!lock.owns_lock()) {
+        uint64_t start = monotonicNanos();
+        lock.lock();
+        threadStageTimes().lock_wait_ns += monotonicNanos() - start;
+    }
+    return lock;
+}
+
+shared_lock<shared_mutex> OrderBook::readLock() const {
+    if (!locking_) return shared_lock<shared_mutex>();
+    if (!stageTiming()) return shared_lock<shared_mutex>(mutex_);
+    shared_lock<shared_mutex> lock(mutex_, try_to_lock);
+    if (!lock.owns_lock()) {
+        uint64_t start = monotonicNanos();
+        lock.lock();
+        threadStageTimes().lock_wait_ns += monotonicNanos() - start;
+    }
+    return lock;
+}
 
 void OrderBook::setTradeCallback(TradeCallback callback) {
     trade_callback_ = callback;
 }
 
-void OrderBook::setTradeLog(unique_ptr<TradeLog> log) {
-    trade_log_ = move(log);
+void OrderBook::setOrderClosedCallback(OrderClosedCallback callback) {
+    order_closed_callback_ = callback;
 }
 
-void OrderBook::addToLevel(Order* order) {
-    if (order->is_buy) {
-        auto it = bid_levels_.find(order->price);
-        if (it == bid_levels_.end()) {
-            it = bid_levels_.emplace(order->price, make_unique<PriceLevel>(order->price)).first;
-        }
-        it->second->orders.push_back(order);
-        it->second->total_quantity += order->quantity;
-    } else {
-        auto it = ask_levels_.find(order->price);
-        if (it == ask_levels_.end()) {
-            it = ask_levels_.emplace(order->price, make_unique<PriceLevel>(order->price)).first;
-        }
-        it->second->orders.push_back(order);
-        it->second->total_quantity += order->quantity;
+void OrderBook::setDepthCallback(DepthCallback callback) {
+    depth_callback_ = callback;
+}
+
+void OrderBook::setTradeJournal(TradeJournal* journal) {
+    if (journal) checkRecordableSymbol(symbol_);
+    trade_journal_ = journal;
+}
+
+void OrderBook::setCommandLog(CommandLog* log) {
+    if (log) checkRecordableSymbol(symbol_);
+    command_log_ = log;
+}
+
+PriceLevel* OrderBook::acquireLevel(Price px) {
+    PriceLevel* level = level_pool_.acquire();
+    *level = PriceLevel(px);
+    return level;
+}
+
+void OrderBook::releaseOrder(Order* order) {
+    order_index_.erase(order->id);
+    if (order_closed_callback_) order_closed_callback_(order->id);
+    clients_.release(order->client);
+    order_pool_.release(order);
+}
+
+void OrderBook::addToLevel(Order* order, Price px) {
+    PriceLadder& side = order->is_buy ? bid_levels_ : ask_levels_;
+    PriceLevel* level = side.find(px);
+    if (!level) {
+        level = acquireLevel(px);
+        side.insert(level);
     }
+    level->pushBack(order);
+    level->total_quantity += order->quantity;
+    levelChanged(order->is_buy, *level);
 }
 
 void OrderBook::removeFromLevel(Order* order) {
-    if (order->is_buy) {
-        auto it = bid_levels_.find(order->price);
-        if (it != bid_levels_.end()) {
-            auto& orders = it->second->orders;
-            auto order_it = find(orders.begin(), orders.end(), order);
-            if (order_it != orders.end()) {
-                orders.erase(order_it);
-                it->second->total_quantity -= order->quantity;
-                if (orders.empty()) {
-                    bid_levels_.erase(it);
-                }
-            }
-        }
-    } else {
-        auto it = ask_levels_.find(order->price);
-        if (it != ask_levels_.end()) {
-            auto& orders = it->second->orders;
-            auto order_it = find(orders.begin(), orders.end(), order);
-            if (order_it != orders.end()) {
-                orders.erase(order_it);
-                it->second->total_quantity -= order->quantity;
-                if (orders.empty()) {
-                    ask_levels_.erase(it);
-                }
-            }
+    PriceLevel* level = order->level;
+    if (!level) return;
+    level->unlink(order);
+    level->total_quantity -= order->quantity;
+    levelChanged(order->is_buy, *level);
+    if (level->empty()) {
+        if (order->is_buy) bid_levels_.erase(level->price);
+        else ask_levels_.erase(level->price);
+        level_pool_.release(level);
+    }
+}
+
+// A level touched twice in one call (modify in place, a sweep) is reported
+// once, with its final quantity
+void OrderBook::recordLevel(bool is_buy, Price px, Quantity qty) {
+    for (auto it = level_updates_.rbegin(); it != level_updates_.rend(); ++it) {
+        if (it->price == px && it->is_buy == is_buy) {
+            it->quantity = qty;
+            return;
         }
     }
+    level_updates_.push_back(LevelUpdate{is_buy, px, qty});
+}
+
+void OrderBook::publishDepth() {
+    if (level_updates_.empty()) return;
+    ++depth_sequence_;
+    // A side is rewritten from the ladder when a level enters or leaves its
+    // published levels; a quantity change at a published price is made in place
+    bool rewrite_bids = false;
+    bool rewrite_asks = false;
+    for (const LevelUpdate& update : level_updates_) {
+        if (!depth_cache_.covers(update.is_buy, update.price)) continue;
+        if (update.quantity > 0 && depth_cache_.find(update.is_buy, update.price) != DepthCache::npos) continue;
+        (update.is_buy ? rewrite_bids : rewrite_asks) = true;
+    }
+    depth_cache_.beginWrite();
+    for (const LevelUpdate& update : level_updates_) {
+        if (update.is_buy ? rewrite_bids : rewrite_asks) continue;
+        size_t index = depth_cache_.find(update.is_buy, update.price);
+        if (index != DepthCache::npos) depth_cache_.setQuantity(update.is_buy, index, update.quantity);
+    }
+    auto side = [](const PriceLadder& ladder) {
+        return [&ladder](auto&& emit) {
+            ladder.forEachWhile([&](const PriceLevel& level) { return emit(level.price, level.total_quantity); });
+        };
+    };
+    if (rewrite_bids) depth_cache_.rewrite(true, side(bid_levels_));
+    if (rewrite_asks) depth_cache_.rewrite(false, side(ask_levels_));
+    if (mode_ == MatchingMode::CALL_AUCTION) depth_cache_.setAuction(computeAuction(auction_reference_));
+    depth_cache_.endWrite(depth_sequence_);
+    // Orders and levels only come and go with a level change
+    published_order_pool_.store(order_pool_.stats());
+    published_level_pool_.store(level_pool_.stats());
+    if (depth_callback_) depth_callback_(depth_sequence_, level_updates_);
+    level_updates_.clear();
 }
 
 Price OrderBook::getBestBid() const {
-    if (bid_levels_.empty()) return 0;
-    return bid_levels_.rbegin()->first;  // Highest price
+    PriceLevel* best = bid_levels_.best();
+    return best ? best->price : 0;  // Highest price
 }
 
 Price OrderBook::getBestAsk() const {
-    if (ask_levels_.empty()) return INT64_MAX;
-    return ask_levels_.rbegin()->first;  // Lowest price
+    PriceLevel* best = ask_levels_.best();
+    return best ? best->price : INT64_MAX;  // Lowest price
 }
 
-bool OrderBook::addOrder(OrderId id, bool is_buy, Quantity qty, Price px, const string& client_id) {
-    unique_lock lock(mutex_);
-    auto order = make_unique<Order>(id, is_buy, qty, px, client_id, symbol_);
-    Order* order_ptr = order.get();
-    order_map_[id] = move(order);
-    addToLevel(order_ptr);
+bool OrderBook::addOrder(OrderId id, bool is_buy, Quantity qty, Price px, string_view client_id) {
+    auto lock = writeLock();
+    Order* order = order_pool_.acquire();
+    if (!order_index_.insert(id, order)) {  // duplicate id
+        order_pool_.release(order);
+        return false;
+    }
+    order->reset(id, is_buy, qty, clients_.acquire(client_id));
+    addToLevel(order, px);
+    if (command_log_) last_sequence_ = command_log_->append(CommandKind::ADD, symbol_, id, is_buy, qty, px, client_id);
+    publishDepth();
     return true;
 }
 
+SubmitResult OrderBook::submitOrder(OrderId id, bool is_buy, Quantity qty, Price px, string_view client_id,
+                                    OrderType type) {
+    auto lock = writeLock();
+    SubmitResult result = applySubmit(id, is_buy, qty, px, client_id, type);
+    publishDepth();
+    return result;
+}
+
+SubmitResult OrderBook::applySubmit(OrderId id, bool is_buy, Quantity qty, Price px, string_view client_id,
+                                    OrderType type) {
+    if (order_index_.find(id)) return SubmitResult{SubmitStatus::REJECTED, 0, qty};  // duplicate id
+    if (command_log_) {
+        last_sequence_ = command_log_->append(CommandKind::SUBMIT, symbol_, id, is_buy, qty, px, client_id, type);
+    }
+    auto close = [&](SubmitStatus status, Quantity filled, Quantity remaining) {
+        if (order_closed_callback_) order_closed_callback_(id);
+        return SubmitResult{status, filled, remaining};
+    };
+    if (qty <= 0) return close(SubmitStatus::REJECTED, 0, qty);
+
+    Quantity remaining = qty;
+    if (mode_ == MatchingMode::CALL_AUCTION) {
+        // Orders only collect until the auction uncrosses
+        if (type != OrderType::LIMIT) return close(SubmitStatus::REJECTED, 0, qty);
+    } else {
+        Price limit = px;
+        if (type == OrderType::MARKET) limit = is_buy ? numeric_limits<Price>::max() : numeric_limits<Price>::min();
+        if (type == OrderType::FOK && !canFill(is_buy, qty, limit)) return close(SubmitStatus::REJECTED, 0, qty);
+        remaining = matchAggressor(id, is_buy, qty, limit);
+    }
+
+    Quantity filled = qty - remaining;
+    if (remaining == 0) return close(SubmitStatus::FILLED, filled, 0);
+    if (type != OrderType::LIMIT) return close(SubmitStatus::CANCELLED, filled, remaining);
+
+    Order* order = order_pool_.acquire();
+    order->reset(id, is_buy, remaining, clients_.acquire(client_id));
+    order_index_.insert(id, order);
+    addToLevel(order, px);
+    return SubmitResult{filled > 0 ? SubmitStatus::PARTIALLY_FILLED : SubmitStatus::RESTING, filled, remaining};
+}
+
 bool OrderBook::cancelOrder(OrderId id) {
-    unique_lock lock(mutex_);
-    auto it = order_map_.find(id);
-    if (it == order_map_.end()) return false;
-    removeFromLevel(it->second.get());
-    order_map_.erase(it);
+    auto lock = writeLock();
+    bool found = applyCancel(id);
+    publishDepth();
+    return found;
+}
+
+bool OrderBook::applyCancel(OrderId id) {
+    Order* order = order_index_.erase(id);
+    if (!order) return false;
+    removeFromLevel(order);
+    if (order_closed_callback_) order_closed_callback_(id);
+    clients_.release(order->client);
+    order_pool_.release(order);
+    if (command_log_) last_sequence_ = command_log_->append(CommandKind::CANCEL, symbol_, id);
     return true;
 }
 
 bool OrderBook::modifyOrder(OrderId id, Quantity new_qty, Price new_px) {
-    unique_lock lock(mutex_);
-    auto it = order_map_.find(id);
-    if (it == order_map_.end()) return false;
-    Order* order = it->second.get();
+    auto lock = writeLock();
+    bool found = applyModify(id, new_qty, new_px);
+    publishDepth();
+    return found;
+}
+
+bool OrderBook::modifyAndMatch(OrderId id, Quantity new_qty, Price new_px) {
+    auto lock = writeLock();
+    bool found = applyModify(id, new_qty, new_px);
+    if (found) applyMatch();
+    publishDepth();
+    return found;
+}
+
+bool OrderBook::applyModify(OrderId id, Quantity new_qty, Price new_px) {
+    // Checked before anything changes or is logged: a non-positive size
+    // would print zero or negative trades and overfill aggressors
+    if (new_qty <= 0) throw invalid_argument("Quantity must be positive");
+    if (new_px <= 0) throw invalid_argument("Price must be positive");
+    Order* order = order_index_.find(id);
+    if (!order) return false;
     removeFromLevel(order);
     order->quantity = new_qty;
-    order->price = new_px;
-    addToLevel(order);
+    addToLevel(order, new_px);
+    if (command_log_) {
+        last_sequence_ = command_log_->append(CommandKind::MODIFY, symbol_, id, order->is_buy, new_qty, new_px);
+    }
     return true;
 }
 
 vector<pair<Price, Quantity>> OrderBook::getBidLevels() const {
-    shared_lock lock(mutex_);
+    auto lock = readLock();
     vector<pair<Price, Quantity>> levels;
-    for (auto it = bid_levels_.rbegin(); it != bid_levels_.rend(); ++it) {
-        levels.emplace_back(it->first, it->second->total_quantity);
-    }
+    levels.reserve(bid_levels_.size());
+    bid_levels_.forEach([&](const PriceLevel& level) { levels.emplace_back(level.price, level.total_quantity); });
     return levels;
 }
 
 vector<pair<Price, Quantity>> OrderBook::getAskLevels() const {
-    shared_lock lock(mutex_);
+    auto lock = readLock();
     vector<pair<Price, Quantity>> levels;
-    for (auto it = ask_levels_.rbegin(); it != ask_levels_.rend(); ++it) {
-        levels.emplace_back(it->first, it->second->total_quantity);
-    }
+    levels.reserve(ask_levels_.size());
+    ask_levels_.forEach([&](const PriceLevel& level) { levels.emplace_back(level.price, level.total_quantity); });
     return levels;
 }
 
+uint64_t OrderBook::getDepth(size_t max_levels, vector<pair<Price, Quantity>>& bids,
+                             vector<pair<Price, Quantity>>& asks) const {
+    auto lock = readLock();
+    auto copy = [max_levels](const PriceLadder& side, vector<pair<Price, Quantity>>& levels) {
+        size_t count = max_levels ? min(max_levels, side.size()) : side.size();
+        levels.clear();
+        levels.reserve(count);
+        side.forEachWhile([&](const PriceLevel& level) {
+            levels.emplace_back(level.price, level.total_quantity);
+            return levels.size() < count;
+        });
+    };
+    copy(bid_levels_, bids);
+    copy(ask_levels_, asks);
+    return depth_sequence_;
+}
+
 void OrderBook::triggerMatching() {
-    unique_lock lock(mutex_);
+    auto lock = writeLock();
+    applyMatch();
+    publishDepth();
+}
+
+void OrderBook::applyMatch() {
+    if (command_log_) last_sequence_ = command_log_->append(CommandKind::MATCH, symbol_, 0);
     matchOrders();
 }
 
-void OrderBook::matchOrders() {
-    while (!bid_levels_.empty() && !ask_levels_.empty()) {
-        Price best_bid = getBestBid();
-        Price best_ask = getBestAsk();
-        if (best_bid < best_ask) break;
+AuctionResult OrderBook::uncross(Price reference_price) {
+    auto lock = writeLock();
+    AuctionResult auction = applyUncross(reference_price);
+    publishDepth();
+    return auction;
+}
+
+AuctionResult OrderBook::applyUncross(Price reference_price) {
+    if (reference_price <= 0) reference_price = auction_reference_;
+    if (command_log_) {
+        last_sequence_ = command_log_->append(CommandKind::UNCROSS, symbol_, 0, false, 0, reference_price);
+    }
+    AuctionResult auction = computeAuction(reference_price);
+    executeAuction(auction);
+    if (auction.volume > 0) auction_reference_ = auction.price;
+    return auction;
+}
+
+void OrderBook::applyBatch(const vector<BookCommand>& commands, vector<BookCommandResult>& results) {
+    results.assign(commands.size(), BookCommandResult{});
+    auto lock = writeLock();
+    try {
+        for (size_t i = 0; i < commands.size(); ++i) {
+            const BookCommand& command = commands[i];
+            switch (command.kind) {
+                case BookCommand::Kind::SUBMIT:
+                    results[i].submit = applySubmit(command.id, command.is_buy, command.quantity, command.price,
+                                                    command.client_id, command.type);
+                    break;
+                case BookCommand::Kind::CANCEL:
+                    results[i].found = applyCancel(command.id);
+                    break;
+                case BookCommand::Kind::MODIFY:
+                    results[i].found = applyModify(command.id, command.quantity, command.price);
+                    if (results[i].found) applyMatch();
+                    break;
+            }
+            results[i].applied = true;
+        }
+    } catch (...) {
+        // Commands before the failing one have been applied; publish them
+        publishDepth();
+        throw;
+    }
+    publishDepth();
+}
+
+uint64_t OrderBook::forEachOrder(const function<void(const Order&)>& visit, uint64_t* trade_sequence) const {
+    auto lock = readLock();
+    if (trade_sequence) *trade_sequence = trade_sequence_;
+    for (const PriceLadder* side : {&bid_levels_, &ask_levels_}) {
+        side->forEach([&](const PriceLevel& level) {
+            for (const Order* order = level.front(); order; order = order->next) visit(*order);
+        });
+    }
+    return last_sequence_;
+}
 
-        auto bid_it = bid_levels_.find(best_bid);
-        auto ask_it = ask_levels_.find(best_ask);
-        if (bid_it == bid_levels_.end() || ask_it == ask_levels_.end()) break;
+PoolStats OrderBook::getOrderPoolStats() const {
+    auto lock = readLock();
+    return order_pool_.stats();
+}
+
+PoolStats OrderBook::getLevelPoolStats() const {
+    auto lock = readLock();
+    return level_pool_.stats();
+}
+
+bool OrderBook::canFill(bool is_buy, Quantity qty, Price limit) const {
+    const PriceLadder& side = is_buy ? ask_levels_ : bid_levels_;
+    int64_t available = 0;
+    bool enough = false;
+    side.forEachWhile([&](const PriceLevel& level) {
+        if (!crosses(is_buy, limit, level.price)) return false;
+        available += level.total_quantity;
+        enough = available >= qty;
+        return !enough;
+    });
+    return enough;
+}
+
+// Trade an incoming order against the opposite side from the best price
+// until it is filled or the next level no longer crosses. Returns the
+// unfilled quantity. The aggressor has no Order object, so nothing is
+// allocated for orders that fill on arrival.
+Quantity OrderBook::matchAggressor(OrderId id, bool is_buy, Quantity qty, Price limit) {
+    PriceLadder& side = is_buy ? ask_levels_ : bid_levels_;
+    Quantity remaining = qty;
+    while (remaining > 0) {
+        PriceLevel* level = side.best();
+        if (!level || !crosses(is_buy, limit, level->price)) break;
+        remaining -= fillAtLevel(level, id, is_buy, remaining);
+        if (level->empty()) {
+            side.erase(level->price);
+            level_pool_.release(level);
+        }
+    }
+    return remaining;
+}
+
+// Fill up to qty against one resting level at its price; returns the
+// quantity traded. Price-time walks the FIFO; pro-rata trades each resting
+// order's allocateProRata share, in time priority.
+Quantity OrderBook::fillAtLevel(PriceLevel* level, OrderId id, bool is_buy, Quantity qty) {
+    Quantity filled = 0;
+    auto trade = [&](Order* resting, Quantity q) {
+        executeTrade(is_buy ? id : resting->id, is_buy ? resting->id : id, q, level->price);
+        resting->quantity -= q;
+        level->total_quantity -= q;
+        filled += q;
+    };
+    if (mode_ == MatchingMode::PRO_RATA) {
+        LevelAllocation& split = is_buy ? ask_allocation_ : bid_allocation_;
+        allocateLevel(*level, qty, split);
+        for (size_t i = 0; i < split.orders.size(); ++i) {
+            if (split.allocations[i] > 0) trade(split.orders[i], split.allocations[i]);
+        }
+        releaseFilled(level, split);
+    } else {
+        Order* resting = level->front();
+        while (resting && filled < qty) {
+            Order* next = resting->next;
+            trade(resting, min(resting->quantity, qty - filled));
+            if (resting->quantity == 0) {
+                level->unlink(resting);
+                releaseOrder(resting);
+            }
+            resting = next;
+        }
+    }
+    if (filled > 0) levelChanged(!is_buy, *level);
+    return filled;
+}
 
-        PriceLevel* bid_level = bid_it->second.get();
-        PriceLevel* ask_level = ask_it->second.get();
+void OrderBook::matchOrders() {
+    while (true) {
+        PriceLevel* bid_level = bid_levels_.best();
+        PriceLevel* ask_level = ask_levels_.best();
+        if (!bid_level || !ask_level || bid_level->price < ask_level->price) break;
 
         if (mode_ == MatchingMode::PRICE_TIME_PRIORITY) {
             matchPriceTime(bid_level, ask_level);
         } else if (mode_ == MatchingMode::PRO_RATA) {
             matchProRata(bid_level, ask_level);
+        } else {
+            break;  // CALL_AUCTION rests crossed until uncross()
         }
+        levelChanged(true, *bid_level);
+        levelChanged(false, *ask_level);
         // Remove empty levels
-        if (bid_level->orders.empty()) bid_levels_.erase(bid_it);
-        if (ask_level->orders.empty()) ask_levels_.erase(ask_it);
+        if (bid_level->empty()) {
+            bid_levels_.erase(bid_level->price);
+            level_pool_.release(bid_level);
+        }
+        if (ask_level->empty()) {
+            ask_levels_.erase(ask_level->price);
+            level_pool_.release(ask_level);
+        }
     }
 }
 
 void OrderBook::matchPriceTime(PriceLevel* bid_level, PriceLevel* ask_level) {
-    while (!bid_level->orders.empty() && !ask_level->orders.empty()) {
-        Order* buy_order = bid_level->orders.front();
-        Order* sell_order = ask_level->orders.front();
+    while (!bid_level->empty() && !ask_level->empty()) {
+        Order* buy_order = bid_level->front();
+        Order* sell_order = ask_level->front();
 
     Quantity match_qty = min(buy_order->quantity, sell_order->quantity);
-    executeTrade(buy_order, sell_order, match_qty, sell_order->price);
+    executeTrade(buy_order->id, sell_order->id, match_qty, ask_level->price);
 
     // Maintain level total quantities
     if (bid_level->total_quantity >= match_qty) bid_level->total_quantity -= match_qty;
@@ -170,57 +510,195 @@ void OrderBook::matchPriceTime(PriceLevel* bid_level, PriceLevel* ask_level) {
     sell_order->quantity -= match_qty;
 
         if (buy_order->quantity == 0) {
-            bid_level->orders.pop_front();
-            order_map_.erase(buy_order->id);
+            bid_level->unlink(buy_order);
+            releaseOrder(buy_order);
         }
         if (sell_order->quantity == 0) {
-            ask_level->orders.pop_front();
-            order_map_.erase(sell_order->id);
+            ask_level->unlink(sell_order);
+            releaseOrder(sell_order);
         }
     }
 }
 
+// Both levels are allocated the smaller of their totals pro-rata, and the
+// two allocation lists are paired off in time priority, so every call
+// empties at least one level and costs O(bids + asks).
 void OrderBook::matchProRata(PriceLevel* bid_level, PriceLevel* ask_level) {
-    // Simplified pro-rata: allocate proportionally
-    Quantity total_bid_qty = bid_level->total_quantity;
-    Quantity total_ask_qty = ask_level->total_quantity;
-    Quantity match_qty = min(total_bid_qty, total_ask_qty);
-
-    for (auto* buy_order : bid_level->orders) {
-        Quantity alloc = (buy_order->quantity * match_qty) / total_bid_qty;
-        if (alloc > 0) {
-            // Match with sell orders proportionally
-            for (auto* sell_order : ask_level->orders) {
-                Quantity sell_alloc = min(alloc, sell_order->quantity);
-                if (sell_alloc > 0) {
-                    executeTrade(buy_order, sell_order, sell_alloc, sell_order->price);
-                    buy_order->quantity -= sell_alloc;
-                    sell_order->quantity -= sell_alloc;
-                    alloc -= sell_alloc;
-                    if (alloc == 0) break;
-                }
-            }
+    Quantity match_qty = min(bid_level->total_quantity, ask_level->total_quantity);
+    allocateLevel(*bid_level, match_qty, bid_allocation_);
+    allocateLevel(*ask_level, match_qty, ask_allocation_);
+    vector<Quantity>& bid_left = bid_allocation_.allocations;
+    vector<Quantity>& ask_left = ask_allocation_.allocations;
+    size_t b = 0;
+    size_t a = 0;
+    while (true) {
+        while (b < bid_left.size() && bid_left[b] == 0) ++b;
+        while (a < ask_left.size() && ask_left[a] == 0) ++a;
+        if (b == bid_left.size() || a == ask_left.size()) break;
+        Order* buy_order = bid_allocation_.orders[b];
+        Order* sell_order = ask_allocation_.orders[a];
+        Quantity q = min(bid_left[b], ask_left[a]);
+        executeTrade(buy_order->id, sell_order->id, q, ask_level->price);
+        bid_left[b] -= q;
+        ask_left[a] -= q;
+        buy_order->quantity -= q;
+        sell_order->quantity -= q;
+        bid_level->total_quantity -= q;
+        ask_level->total_quantity -= q;
+    }
+    releaseFilled(bid_level, bid_allocation_);
+    releaseFilled(ask_level, ask_allocation_);
+}
+
+void OrderBook::allocateLevel(const PriceLevel& level, Quantity qty, LevelAllocation& split) {
+    split.orders.clear();
+    split.quantities.clear();
+    for (Order* order = level.front(); order; order = order->next) {
+        split.orders.push_back(order);
+        split.quantities.push_back(order->quantity);
+    }
+    split.allocations.resize(split.orders.size());
+    allocateProRata(pro_rata_, split.quantities.data(), split.quantities.size(), qty, split.allocations.data());
+}
+
+void OrderBook::releaseFilled(PriceLevel* level, const LevelAllocation& split) {
+    for (Order* order : split.orders) {
+        if (order->quantity == 0) {
+            level->unlink(order);
+            releaseOrder(order);
+        }
+    }
+}
+
+// One pass up the crossed levels (bids at or above the best ask, asks at or
+// below the best bid) merged in ascending price order: at each level price
+// p, the bids at or above p and the asks at or below p are what would trade
+// there. The candidates are then narrowed by volume, imbalance and distance
+// to the reference price.
+AuctionResult OrderBook::computeAuction(Price reference_price) {
+    PriceLevel* best_bid = bid_levels_.best();
+    PriceLevel* best_ask = ask_levels_.best();
+    if (!best_bid || !best_ask || best_bid->price < best_ask->price) return AuctionResult{};
+    const Price high = best_bid->price;
+    const Price low = best_ask->price;
+    auction_bids_.clear();
+    auction_asks_.clear();
+    int64_t bid_total = 0;
+    bid_levels_.forEachWhile([&](const PriceLevel& level) {
+        if (level.price < low) return false;
+        auction_bids_.emplace_back(level.price, level.total_quantity);
+        bid_total += level.total_quantity;
+        return true;
+    });
+    reverse(auction_bids_.begin(), auction_bids_.end());
+    ask_levels_.forEachWhile([&](const PriceLevel& level) {
+        if (level.price > high) return false;
+        auction_asks_.emplace_back(level.price, level.total_quantity);
+        return true;
+    });
+
+    auction_candidates_.clear();
+    int64_t bids_below = 0;  // bid quantity priced under p
+    int64_t asks_upto = 0;   // ask quantity priced at or under p
+    size_t b = 0;
+    size_t a = 0;
+    int64_t best_volume = 0;
+    while (b < auction_bids_.size() || a < auction_asks_.size()) {
+        Price px = b == auction_bids_.size()   ? auction_asks_[a].first
+                   : a == auction_asks_.size() ? auction_bids_[b].first
+                                               : min(auction_bids_[b].first, auction_asks_[a].first);
+        if (a < auction_asks_.size() && auction_asks_[a].first == px) asks_upto += auction_asks_[a++].second;
+        int64_t bids_from = bid_total - bids_below;
+        int64_t volume = min(bids_from, asks_upto);
+        auction_candidates_.push_back(AuctionResult{px, volume, bids_from - asks_upto});
+        best_volume = max(best_volume, volume);
+        if (b < auction_bids_.size() && auction_bids_[b].first == px) bids_below += auction_bids_[b++].second;
+    }
+
+    int64_t least_imbalance = numeric_limits<int64_t>::max();
+    for (const AuctionResult& candidate : auction_candidates_) {
+        if (candidate.volume == best_volume) least_imbalance = min(least_imbalance, abs(candidate.imbalance));
+    }
+    auto tied = [&](const AuctionResult& candidate) {
+        return candidate.volume == best_volume && abs(candidate.imbalance) == least_imbalance;
+    };
+    if (reference_price <= 0) {
+        Price lowest = numeric_limits<Price>::max();
+        Price highest = numeric_limits<Price>::min();
+        for (const AuctionResult& candidate : auction_candidates_) {
+            if (!tied(candidate)) continue;
+            lowest = min(lowest, candidate.price);
+            highest = max(highest, candidate.price);
+        }
+        reference_price = lowest + (highest - lowest) / 2;
+    }
+    // Ascending, so the lower of two equally near prices wins
+    AuctionResult chosen;
+    Price distance = numeric_limits<Price>::max();
+    for (const AuctionResult& candidate : auction_candidates_) {
+        if (!tied(candidate)) continue;
+        Price from_reference = candidate.price > reference_price ? candidate.price - reference_price
+                                                                 : reference_price - candidate.price;
+        if (from_reference < distance) {
+            distance = from_reference;
+            chosen = candidate;
+        }
+    }
+    return chosen;
+}
+
+// Best bid against best ask, FIFO within each level, until the auction
+// volume has traded; every trade is at the auction price
+void OrderBook::executeAuction(const AuctionResult& auction) {
+    int64_t remaining = auction.volume;
+    PriceLevel* bid_level = bid_levels_.best();
+    PriceLevel* ask_level = ask_levels_.best();
+    while (remaining > 0) {
+        Order* buy_order = bid_level->front();
+        Order* sell_order = ask_level->front();
+        Quantity q = min(buy_order->quantity, sell_order->quantity);
+        if (q > remaining) q = static_cast<Quantity>(remaining);
+        executeTrade(buy_order->id, sell_order->id, q, auction.price);
+        buy_order->quantity -= q;
+        sell_order->quantity -= q;
+        bid_level->total_quantity -= q;
+        ask_level->total_quantity -= q;
+        remaining -= q;
+        if (buy_order->quantity == 0) {
+            bid_level->unlink(buy_order);
+            releaseOrder(buy_order);
+        }
+        if (sell_order->quantity == 0) {
+            ask_level->unlink(sell_order);
+            releaseOrder(sell_order);
+        }
+        // Levels are reported once, when emptied or when the auction ends
+        if (bid_level->empty() || remaining == 0) levelChanged(true, *bid_level);
+        if (ask_level->empty() || remaining == 0) levelChanged(false, *ask_level);
+        if (bid_level->empty()) {
+            bid_levels_.erase(bid_level->price);
+            level_pool_.release(bid_level);
+            bid_level = bid_levels_.best();
+        }
+        if (ask_level->empty()) {
+            ask_levels_.erase(ask_level->price);
+            level_pool_.release(ask_level);
+            ask_level = ask_levels_.best();
         }
     }
-    // Clean up filled orders
-    bid_level->orders.erase(remove_if(bid_level->orders.begin(), bid_level->orders.end(),
-                                           [](Order* o) { return o->quantity == 0; }), bid_level->orders.end());
-    ask_level->orders.erase(remove_if(ask_level->orders.begin(), ask_level->orders.end(),
-                                           [](Order* o) { return o->quantity == 0; }), ask_level->orders.end());
-    for (auto* o : bid_level->orders) order_map_.erase(o->id);
-    for (auto* o : ask_level->orders) order_map_.erase(o->id);
 }
 
-void OrderBook::executeTrade(Order* buy_order, Order* sell_order, Quantity qty, Price px) {
-    Trade trade{buy_order->id, sell_order->id, px, qty, symbol_, chrono::system_clock::now()};
+void OrderBook::executeTrade(OrderId buy_id, OrderId sell_id, Quantity qty, Price px) {
+    Trade trade{buy_id, sell_id, px, qty, symbol_handle_, ++trade_sequence_, clock_->now()};
+    uint64_t publish_start = stageTiming() ? monotonicNanos() : 0;
     if (trade_callback_) {
         trade_callback_(trade);
     }
-    if (trade_log_) {
-        auto ts = chrono::duration_cast<chrono::milliseconds>(trade.timestamp.time_since_epoch()).count();
-        trade_log_->logTradeRaw(ts, trade.buy_order_id, trade.sell_order_id, trade.price, trade.quantity, trade.symbol);
+    if (trade_journal_) {
+        trade_journal_->append(clock_->toEpochNanos(trade.timestamp), buy_id, sell_id, px, qty, symbol_);
     }
-    cout << "Trade: " << qty << " @ " << px << " between " << buy_order->id << " and " << sell_order->id << endl;
+    if (publish_start) threadStageTimes().publish_ns += monotonicNanos() - publish_start;
+    TF_LOG_DEBUG("Trade: {} {} @ {} between {} and {}", symbol_, qty, px, buy_id, sell_id);
 }
 
 } // namespace tradeflow
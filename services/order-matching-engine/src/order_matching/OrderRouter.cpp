@@ -0,0 +1,41 @@
+#include "order_matching/OrderRouter.hpp"
+
+using namespace std;
+
+namespace tradeflow {
+
+OrderRouter::OrderRouter(size_t stripes, size_t reserve)
+    : stripes_(make_unique<Stripe[]>(stripes ? stripes : 1)), stripe_count_(stripes ? stripes : 1) {
+    for (size_t i = 0; i < stripe_count_; ++i) {
+        stripes_[i].index.reserve(reserve / stripe_count_ + 1);
+    }
+}
+
+bool OrderRouter::add(OrderId id, OrderBook* book) {
+    Stripe& stripe = stripeFor(id);
+    lock_guard<mutex> lock(stripe.mutex);
+    return stripe.index.insert(id, book);
+}
+
+void OrderRouter::remove(OrderId id) {
+    Stripe& stripe = stripeFor(id);
+    lock_guard<mutex> lock(stripe.mutex);
+    stripe.index.erase(id);
+}
+
+OrderBook* OrderRouter::find(OrderId id) const {
+    Stripe& stripe = stripeFor(id);
+    lock_guard<mutex> lock(stripe.mutex);
+    return stripe.index.find(id);
+}
+
+size_t OrderRouter::size() const {
+    size_t total = 0;
+    for (size_t i = 0; i < stripe_count_; ++i) {
+        lock_guard<mutex> lock(stripes_[i].mutex);
+        total += stripes_[i].index.size();
+    }
+    return total;
+}
+
+} // namespace tradeflow
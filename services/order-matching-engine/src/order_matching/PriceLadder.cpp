@@ -0,0 +1,175 @@
+#include "order_matching/PriceLadder.hpp"
+#include <algorithm>
+#include <bit>
+
+using namespace std;
+
+namespace tradeflow {
+
+void TickBitmap::resize(size_t bits) {
+    bits_ = bits;
+    levels_.clear();
+    size_t width = bits;
+    do {
+        size_t words = (width + 63) / 64;
+        levels_.emplace_back(words, 0);
+        width = words;
+    } while (width > 1);
+}
+
+void TickBitmap::set(size_t i) {
+    for (auto& level : levels_) {
+        uint64_t& word = level[i >> 6];
+        bool was_empty = word == 0;
+        word |= 1ull << (i & 63);
+        if (!was_empty) return;
+        i >>= 6;
+    }
+}
+
+void TickBitmap::clear(size_t i) {
+    for (auto& level : levels_) {
+        uint64_t& word = level[i >> 6];
+        word &= ~(1ull << (i & 63));
+        if (word != 0) return;
+        i >>= 6;
+    }
+}
+
+void TickBitmap::clearAll() {
+    for (auto& level : levels_) fill(level.begin(), level.end(), 0);
+}
+
+size_t TickBitmap::findNext(size_t i) const {
+    if (i >= bits_) return npos;
+    size_t depth = 0;
+    // Climb until a word with a set bit at or after the cursor is found
+    while (true) {
+        if (depth == levels_.size()) return npos;
+        const auto& level = levels_[depth];
+        size_t w = i >> 6;
+        if (w >= level.size()) return npos;
+        uint64_t bits = level[w] & (~0ull << (i & 63));
+        if (bits) {
+            i = (w << 6) + countr_zero(bits);
+            break;
+        }
+        i = w + 1;
+        ++depth;
+    }
+    // Descend taking the lowest set bit of each summarised word
+    while (depth > 0) {
+        --depth;
+        i = (i << 6) + countr_zero(levels_[depth][i]);
+    }
+    return i;
+}
+
+size_t TickBitmap::findPrev(size_t i) const {
+    if (bits_ == 0) return npos;
+    if (i >= bits_) i = bits_ - 1;
+    size_t depth = 0;
+    while (true) {
+        if (depth == levels_.size()) return npos;
+        size_t w = i >> 6;
+        size_t bit = i & 63;
+        uint64_t mask = bit == 63 ? ~0ull : ((1ull << (bit + 1)) - 1);
+        uint64_t bits = levels_[depth][w] & mask;
+        if (bits) {
+            i = (w << 6) + 63 - countl_zero(bits);
+            break;
+        }
+        if (w == 0) return npos;
+        i = w - 1;
+        ++depth;
+    }
+    while (depth > 0) {
+        --depth;
+        i = (i << 6) + 63 - countl_zero(levels_[depth][i]);
+    }
+    return i;
+}
+
+PriceLadder::PriceLadder(bool is_bid, pmr::memory_resource* resource)
+    : is_bid_(is_bid), fixed_base_(false), base_(0), ticks_(0), ladder_count_(0),
+      slots_(), occupancy_(), sparse_(resource) {}
+
+void PriceLadder::configureBand(size_t ticks, Price base_price) {
+    // Move any existing levels back to the map, then rebuild the band
+    for (size_t i = 0; i < ticks_; ++i) {
+        if (slots_[i]) sparse_.emplace(slots_[i]->price, slots_[i]);
+    }
+    ticks_ = ticks;
+    ladder_count_ = 0;
+    slots_.assign(ticks, nullptr);
+    occupancy_.resize(ticks);
+    fixed_base_ = base_price > 0;
+    base_ = base_price;
+    if (fixed_base_) recentre(base_price + static_cast<Price>(ticks / 2));
+}
+
+void PriceLadder::recentre(Price px) {
+    base_ = fixed_base_ ? base_ : px - static_cast<Price>(ticks_ / 2);
+    // Pull any sparse levels that now fall inside the band into the slots
+    auto it = sparse_.lower_bound(base_);
+    while (it != sparse_.end() && inBand(it->first)) {
+        size_t offset = static_cast<size_t>(it->first - base_);
+        slots_[offset] = it->second;
+        occupancy_.set(offset);
+        ++ladder_count_;
+        it = sparse_.erase(it);
+    }
+}
+
+PriceLevel* PriceLadder::find(Price px) const {
+    if (inBand(px)) return slots_[static_cast<size_t>(px - base_)];
+    auto it = sparse_.find(px);
+    return it == sparse_.end() ? nullptr : it->second;
+}
+
+void PriceLadder::insert(PriceLevel* level) {
+    Price px = level->price;
+    // An empty ladder re-centres on the incoming price so the band follows
+    // the market between sessions instead of pushing everything to the map.
+    if (ticks_ > 0 && !fixed_base_ && ladder_count_ == 0 && !inBand(px)) {
+        recentre(px);
+    }
+    if (inBand(px)) {
+        size_t offset = static_cast<size_t>(px - base_);
+        slots_[offset] = level;
+        occupancy_.set(offset);
+        ++ladder_count_;
+    } else {
+        sparse_.emplace(px, level);
+    }
+}
+
+void PriceLadder::erase(Price px) {
+    if (inBand(px)) {
+        size_t offset = static_cast<size_t>(px - base_);
+        if (slots_[offset]) {
+            slots_[offset] = nullptr;
+            occupancy_.clear(offset);
+            --ladder_count_;
+        }
+    } else {
+        sparse_.erase(px);
+    }
+}
+
+PriceLevel* PriceLadder::ladderBest() const {
+    if (ladder_count_ == 0) return nullptr;
+    size_t i = is_bid_ ? occupancy_.findPrev(ticks_ - 1) : occupancy_.findNext(0);
+    return slots_[i];
+}
+
+PriceLevel* PriceLadder::best() const {
+    PriceLevel* ladder = ladderBest();
+    if (sparse_.empty()) return ladder;
+    PriceLevel* sparse = is_bid_ ? sparse_.rbegin()->second : sparse_.begin()->second;
+    if (!ladder) return sparse;
+    if (is_bid_) return sparse->price > ladder->price ? sparse : ladder;
+    return sparse->price < ladder->price ? sparse : ladder;
+}
+
+} // namespace tradeflow
@@ -0,0 +1,68 @@
+#include "order_matching/ProRataAllocator.hpp"
+#include <algorithm>
+#include <cstdint>
+
+using namespace std;
+
+namespace tradeflow {
+
+Quantity allocateProRata(const ProRataConfig& config, const Quantity* quantities, size_t count, Quantity qty,
+                         Quantity* allocations) {
+    int64_t total = 0;
+    for (size_t i = 0; i < count; ++i) total += quantities[i];
+    if (qty <= 0 || total == 0) {
+        fill_n(allocations, count, 0);
+        return 0;
+    }
+    if (qty >= total) {
+        copy_n(quantities, count, allocations);
+        return static_cast<Quantity>(total);
+    }
+
+    int64_t remaining = qty;
+    size_t first = 0;
+    if (config.top_order) {
+        // Either the top order is now full or nothing is left to share
+        allocations[0] = static_cast<Quantity>(min<int64_t>(quantities[0], remaining));
+        remaining -= allocations[0];
+        total -= quantities[0];
+        first = 1;
+    }
+    if (remaining == 0) {
+        fill(allocations + first, allocations + count, 0);
+        return qty;
+    }
+
+    // floor(q * remaining / total): estimated in double, then moved by at
+    // most one lot to the exact value (every product is below 2^62)
+    const double ratio = static_cast<double>(remaining) / static_cast<double>(total);
+    const int64_t min_allocation = config.min_allocation;
+    int64_t allocated = 0;
+    for (size_t i = first; i < count; ++i) {
+        const int64_t q = quantities[i];
+        const int64_t product = q * remaining;
+        int64_t share = static_cast<int64_t>(static_cast<double>(q) * ratio);
+        share -= share * total > product;
+        share += (share + 1) * total <= product;
+        share = share >= min_allocation ? share : 0;
+        allocations[i] = static_cast<Quantity>(share);
+        allocated += share;
+    }
+
+    // Residual, in rounds over the orders in time priority: an even split
+    // first, then single lots once fewer lots than orders remain. Capacity
+    // left always covers it, since remaining never exceeds total.
+    int64_t residual = remaining - allocated;
+    const int64_t sharing = static_cast<int64_t>(count - first);
+    while (residual > 0) {
+        const int64_t lot = max<int64_t>(1, residual / sharing);
+        for (size_t i = first; i < count && residual > 0; ++i) {
+            int64_t give = min<int64_t>({lot, residual, static_cast<int64_t>(quantities[i]) - allocations[i]});
+            allocations[i] += static_cast<Quantity>(give);
+            residual -= give;
+        }
+    }
+    return qty;
+}
+
+} // namespace tradeflow
@@ -0,0 +1,211 @@
+#include "order_matching/Replay.hpp"
+#include <unistd.h>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+using namespace std;
+
+namespace tradeflow {
+
+namespace {
+
+constexpr size_t WRITE_BATCH_EVENTS = 8192;  // 256 KiB per write()
+
+// FNV-1a over 64-bit words; order-sensitive, so it fingerprints a stream
+class StreamChecksum {
+public:
+    void add(uint64_t word) { hash_ = (hash_ ^ word) * 0x100000001b3ull; }
+    uint64_t value() const { return hash_; }
+
+private:
+    uint64_t hash_ = 0xcbf29ce484222325ull;
+};
+
+ReplayEvent makeEvent(ReplayEventKind kind, uint32_t symbol, OrderId id, bool is_buy, Quantity qty, Price px,
+                      OrderType type = OrderType::LIMIT) {
+    ReplayEvent event;
+    memset(&event, 0, sizeof(event));
+    event.kind = kind;
+    event.is_buy = is_buy ? 1 : 0;
+    event.order_type = static_cast<uint8_t>(type);
+    event.symbol = symbol;
+    event.order_id = id;
+    event.price = px;
+    event.quantity = qty;
+    return event;
+}
+
+// JournalFile appends to an existing file, so remove it first
+const string& replaceFile(const string& path) {
+    if (::unlink(path.c_str()) != 0 && errno != ENOENT) {
+        throw runtime_error("Unable to replace " + path + ": " + strerror(errno));
+    }
+    return path;
+}
+
+} // namespace
+
+ReplayEvent makeSymbolEvent(uint32_t index, const string& name) {
+    if (name.empty() || name.size() > REPLAY_SYMBOL_BYTES) {
+        throw invalid_argument("replay symbol names must be 1-" + to_string(REPLAY_SYMBOL_BYTES) + " bytes: " + name);
+    }
+    ReplayEvent event = makeEvent(ReplayEventKind::SYMBOL, index, 0, false, 0, 0);
+    memcpy(reinterpret_cast<char*>(&event) + offsetof(ReplayEvent, order_id), name.data(), name.size());
+    return event;
+}
+
+string replaySymbolName(const ReplayEvent& event) {
+    const char* name = reinterpret_cast<const char*>(&event) + offsetof(ReplayEvent, order_id);
+    return string(name, strnlen(name, REPLAY_SYMBOL_BYTES));
+}
+
+ReplayWriter::ReplayWriter(const string& path)
+    : file_(replaceFile(path), REPLAY_MAGIC, REPLAY_VERSION, sizeof(ReplayEvent)), buffer_(), symbols_(), events_(0) {
+    buffer_.reserve(WRITE_BATCH_EVENTS);
+}
+
+ReplayWriter::~ReplayWriter() {
+    try {
+        finish();
+    } catch (...) {
+        // Callers that care about errors call finish() themselves
+    }
+}
+
+uint32_t ReplayWriter::symbol(const string& name) {
+    for (size_t i = 0; i < symbols_.size(); ++i) {
+        if (symbols_[i] == name) return static_cast<uint32_t>(i);
+    }
+    uint32_t index = static_cast<uint32_t>(symbols_.size());
+    append(makeSymbolEvent(index, name));
+    symbols_.push_back(name);
+    return index;
+}
+
+void ReplayWriter::add(uint32_t symbol, OrderId id, bool is_buy, Quantity qty, Price px) {
+    append(makeEvent(ReplayEventKind::ADD, symbol, id, is_buy, qty, px));
+}
+
+void ReplayWriter::submit(uint32_t symbol, OrderId id, bool is_buy, Quantity qty, Price px, OrderType type) {
+    append(makeEvent(ReplayEventKind::SUBMIT, symbol, id, is_buy, qty, px, type));
+}
+
+void ReplayWriter::cancel(uint32_t symbol, OrderId id) {
+    append(makeEvent(ReplayEventKind::CANCEL, symbol, id, false, 0, 0));
+}
+
+void ReplayWriter::modify(uint32_t symbol, OrderId id, Quantity qty, Price px) {
+    append(makeEvent(ReplayEventKind::MODIFY, symbol, id, false, qty, px));
+}
+
+void ReplayWriter::match(uint32_t symbol) {
+    append(makeEvent(ReplayEventKind::MATCH, symbol, 0, false, 0, 0));
+}
+
+void ReplayWriter::append(const ReplayEvent& event) {
+    buffer_.push_back(event);
+    ++events_;
+    if (buffer_.size() == WRITE_BATCH_EVENTS) {
+        file_.write(buffer_.data(), buffer_.size() * sizeof(ReplayEvent));
+        buffer_.clear();
+    }
+}
+
+void ReplayWriter::finish() {
+    if (buffer_.empty()) return;
+    file_.write(buffer_.data(), buffer_.size() * sizeof(ReplayEvent));
+    buffer_.clear();
+}
+
+bool applyReplayEvent(OrderBook& book, const ReplayEvent& event, string_view client) {
+    switch (event.kind) {
+    case ReplayEventKind::ADD:
+        return book.addOrder(event.order_id, event.is_buy != 0, event.quantity, event.price, client);
+    case ReplayEventKind::SUBMIT:
+        return book.submitOrder(event.order_id, event.is_buy != 0, event.quantity, event.price, client,
+                                static_cast<OrderType>(event.order_type))
+                   .status != SubmitStatus::REJECTED;
+    case ReplayEventKind::CANCEL:
+        return book.cancelOrder(event.order_id);
+    case ReplayEventKind::MODIFY:
+        return book.modifyOrder(event.order_id, event.quantity, event.price);
+    case ReplayEventKind::MATCH:
+        book.triggerMatching();
+        return true;
+    default:
+        throw invalid_argument("unknown replay event kind " + to_string(static_cast<int>(event.kind)));
+    }
+}
+
+ReplayStats runReplay(const string& path, MatchingMode mode, const OrderBookConfig& config) {
+    ReplayReader reader(path);
+    // Trades are stamped with the event index in microseconds, so every run
+    // of a file produces the same timestamps
+    VirtualClock clock;
+    OrderBookConfig book_config = config;
+    book_config.locking = false;
+    book_config.clock = &clock;
+
+    ReplayStats stats;
+    StreamChecksum trades;
+    vector<unique_ptr<OrderBook>> books;
+    const string_view client = "replay";
+
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < reader.size(); ++i) {
+        ReplayEvent event = reader.at(i);
+        clock.set(static_cast<int64_t>(i) * 1000);
+        if (event.kind == ReplayEventKind::SYMBOL) {
+            if (event.symbol != books.size()) {
+                throw runtime_error(path + ": symbol " + to_string(event.symbol) + " defined out of order at event " +
+                                    to_string(i));
+            }
+            auto book = make_unique<OrderBook>(replaySymbolName(event), mode, book_config);
+            uint64_t index = event.symbol;
+            book->setTradeCallback([&stats, &trades, index](const Trade& trade) {
+                ++stats.trades;
+                stats.traded_quantity += static_cast<uint64_t>(trade.quantity);
+                trades.add(index);
+                trades.add(static_cast<uint64_t>(trade.buy_order_id));
+                trades.add(static_cast<uint64_t>(trade.sell_order_id));
+                trades.add(static_cast<uint64_t>(trade.price));
+                trades.add(static_cast<uint64_t>(trade.quantity));
+            });
+            books.push_back(std::move(book));
+            continue;
+        }
+        if (event.symbol >= books.size()) {
+            throw runtime_error(path + ": event " + to_string(i) + " uses undefined symbol " + to_string(event.symbol));
+        }
+        bool applied;
+        try {
+            applied = applyReplayEvent(*books[event.symbol], event, client);
+        } catch (const exception& e) {
+            throw runtime_error(path + ": " + e.what() + " at event " + to_string(i));
+        }
+        ++stats.events;
+        if (!applied) ++stats.rejected;
+    }
+    stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    StreamChecksum resting;
+    for (size_t i = 0; i < books.size(); ++i) {
+        books[i]->forEachOrder([&](const Order& order) {
+            ++stats.resting_orders;
+            resting.add(i);
+            resting.add(static_cast<uint64_t>(order.id));
+            resting.add(order.is_buy ? 1 : 0);
+            resting.add(static_cast<uint64_t>(order.price()));
+            resting.add(static_cast<uint64_t>(order.quantity));
+        });
+    }
+    stats.books = books.size();
+    stats.trade_checksum = trades.value();
+    stats.book_checksum = resting.value();
+    return stats;
+}
+
+} // namespace tradeflow
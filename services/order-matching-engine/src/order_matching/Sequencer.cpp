@@ -0,0 +1,229 @@
+#include "order_matching/Sequencer.hpp"
+#include "order_matching/Logger.hpp"
+#include <chrono>
+#include <exception>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace std;
+
+namespace tradeflow {
+
+namespace {
+// Empty polls before the sequencer yields, and before it parks on sleeping_
+constexpr unsigned SPIN_POLLS = 64;
+constexpr unsigned YIELD_POLLS = 256;
+}
+
+Sequencer::Sequencer(size_t ring_capacity, int cpu, const string& name)
+    : ring_(ring_capacity), sleeping_(false), commands_processed_(0), busy_nanos_(0), cpu_(cpu), name_(name),
+      thread_() {
+    thread_ = thread([this] {
+        pinThread();
+        loop();
+    });
+}
+
+Sequencer::~Sequencer() {
+    Command stop;
+    stop.type = CommandType::STOP;
+    enqueue(stop);
+    thread_.join();
+}
+
+SubmitResult Sequencer::submit(OrderBook& book, OrderId id, bool is_buy, Quantity qty, Price px,
+                              string_view client_id, OrderType type) {
+    Command command;
+    command.type = CommandType::SUBMIT;
+    command.book = &book;
+    command.id = id;
+    command.is_buy = is_buy;
+    command.quantity = qty;
+    command.price = px;
+    command.client_id = client_id;
+    command.order_type = type;
+    Completion completion;
+    run(command, completion);
+    return completion.submit;
+}
+
+bool Sequencer::cancel(OrderBook& book, OrderId id) {
+    Command command;
+    command.type = CommandType::CANCEL;
+    command.book = &book;
+    command.id = id;
+    Completion completion;
+    return run(command, completion);
+}
+
+bool Sequencer::modify(OrderBook& book, OrderId id, Quantity new_qty, Price new_px) {
+    Command command;
+    command.type = CommandType::MODIFY;
+    command.book = &book;
+    command.id = id;
+    command.quantity = new_qty;
+    command.price = new_px;
+    Completion completion;
+    return run(command, completion);
+}
+
+void Sequencer::batch(OrderBook& book, const vector<BookCommand>& commands, vector<BookCommandResult>& results) {
+    Command command;
+    command.type = CommandType::BATCH;
+    command.book = &book;
+    command.commands = &commands;
+    command.results = &results;
+    Completion completion;
+    run(command, completion);
+}
+
+void Sequencer::execute(OrderBook& book, const function<void(OrderBook&)>& fn) {
+    Command command;
+    command.type = CommandType::EXECUTE;
+    command.book = &book;
+    command.fn = &fn;
+    Completion completion;
+    run(command, completion);
+}
+
+void Sequencer::execute(const function<void()>& task) {
+    Command command;
+    command.type = CommandType::TASK;
+    command.task = &task;
+    Completion completion;
+    run(command, completion);
+}
+
+bool Sequencer::run(Command& command, Completion& completion) {
+    command.completion = &completion;
+    if (stageTiming()) command.enqueued_ns = monotonicNanos();
+    enqueue(command);
+    completion.state.wait(PENDING, memory_order_acquire);
+    // The sequencer stores RELEASED straight after its notify
+    while (completion.state.load(memory_order_acquire) != RELEASED) this_thread::yield();
+    if (command.enqueued_ns) {
+        StageTimes& times = threadStageTimes();
+        times.lock_wait_ns += completion.stages.lock_wait_ns;
+        times.publish_ns += completion.stages.publish_ns;
+    }
+    if (completion.error) rethrow_exception(completion.error);
+    return completion.result;
+}
+
+void Sequencer::enqueue(const Command& command) {
+    // Full ring: back-pressure the caller rather than dropping the command
+    while (!ring_.tryPush(command)) this_thread::yield();
+    // Pairs with the fence in loop() so either the sequencer sees the new
+    // command before parking or we see it parked and wake it.
+    atomic_thread_fence(memory_order_seq_cst);
+    if (sleeping_.load(memory_order_relaxed)) {
+        sleeping_.store(false, memory_order_relaxed);
+        sleeping_.notify_one();
+    }
+}
+
+void Sequencer::apply(Command& command) {
+    if (command.enqueued_ns) {
+        uint64_t start = monotonicNanos();
+        threadStageTimes() = StageTimes{start > command.enqueued_ns ? start - command.enqueued_ns : 0, 0};
+    }
+    bool result = false;
+    try {
+        switch (command.type) {
+            case CommandType::SUBMIT:
+                command.completion->submit = command.book->submitOrder(
+                    command.id, command.is_buy, command.quantity, command.price, command.client_id, command.order_type);
+                result = command.completion->submit.status != SubmitStatus::REJECTED;
+                break;
+            case CommandType::CANCEL:
+                result = command.book->cancelOrder(command.id);
+                break;
+            case CommandType::MODIFY:
+                result = command.book->modifyAndMatch(command.id, command.quantity, command.price);
+                break;
+            case CommandType::BATCH:
+                command.book->applyBatch(*command.commands, *command.results);
+                result = true;
+                break;
+            case CommandType::EXECUTE:
+                (*command.fn)(*command.book);
+                result = true;
+                break;
+            case CommandType::TASK:
+                (*command.task)();
+                result = true;
+                break;
+            case CommandType::STOP:
+                break;
+        }
+    } catch (...) {
+        command.completion->error = current_exception();
+    }
+    commands_processed_.fetch_add(1, memory_order_relaxed);
+    Completion& completion = *command.completion;
+    if (command.enqueued_ns) completion.stages = threadStageTimes();
+    completion.result = result;
+    completion.state.store(DONE, memory_order_release);
+    completion.state.notify_one();
+    // Last touch: once the caller sees RELEASED the completion may be gone
+    completion.state.store(RELEASED, memory_order_release);
+}
+
+void Sequencer::pinThread() {
+#ifdef __linux__
+    if (!name_.empty()) {
+        pthread_setname_np(pthread_self(), name_.substr(0, 15).c_str());
+    }
+    if (cpu_ >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu_, &set);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+            TF_LOG_WARN("[sequencer] failed to pin {} to cpu {}", name_, cpu_);
+        }
+    }
+#else
+    if (cpu_ >= 0) TF_LOG_WARN("[sequencer] CPU pinning is only supported on Linux");
+#endif
+}
+
+void Sequencer::loop() {
+    Command command;
+    unsigned idle = 0;
+    bool busy = false;
+    chrono::steady_clock::time_point busy_since;
+    while (true) {
+        if (ring_.tryPop(command)) {
+            if (!busy) {
+                busy = true;
+                busy_since = chrono::steady_clock::now();
+            }
+            idle = 0;
+            if (command.type == CommandType::STOP) return;
+            apply(command);
+            continue;
+        }
+        if (busy) {
+            busy = false;
+            auto elapsed = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - busy_since);
+            busy_nanos_.fetch_add(static_cast<uint64_t>(elapsed.count()), memory_order_relaxed);
+        }
+        if (++idle < SPIN_POLLS) continue;
+        if (idle < YIELD_POLLS) {
+            this_thread::yield();
+            continue;
+        }
+        sleeping_.store(true, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        if (!ring_.empty()) {
+            sleeping_.store(false, memory_order_relaxed);
+            continue;
+        }
+        sleeping_.wait(true, memory_order_relaxed);
+        idle = 0;
+    }
+}
+
+} // namespace tradeflow
@@ -0,0 +1,86 @@
+#include "order_matching/Shard.hpp"
+#include <mutex>
+#include <stdexcept>
+
+using namespace std;
+
+namespace tradeflow {
+
+ShardMap::ShardMap(size_t shard_count, unordered_map<string, size_t> overrides)
+    : shard_count_(shard_count ? shard_count : 1), overrides_(move(overrides)) {
+    for (const auto& pair : overrides_) {
+        if (pair.second >= shard_count_) {
+            throw runtime_error("Shard override for " + pair.first + " points at shard " + to_string(pair.second) +
+                                " but only " + to_string(shard_count_) + " shards are configured");
+        }
+    }
+}
+
+size_t ShardMap::shardFor(const string& symbol) const {
+    if (shard_count_ == 1) return 0;
+    if (!overrides_.empty()) {
+        auto it = overrides_.find(symbol);
+        if (it != overrides_.end()) return it->second;
+    }
+    return jumpHash(hashSymbol(symbol), shard_count_);
+}
+
+uint64_t ShardMap::hashSymbol(const string& symbol) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (unsigned char c : symbol) {
+        hash ^= c;
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+size_t ShardMap::jumpHash(uint64_t key, size_t buckets) {
+    int64_t b = -1;
+    int64_t j = 0;
+    while (j < static_cast<int64_t>(buckets)) {
+        b = j;
+        key = key * 2862933555777941757ull + 1;
+        j = static_cast<int64_t>((b + 1) * (double(1ll << 31) / double((key >> 33) + 1)));
+    }
+    return static_cast<size_t>(b);
+}
+
+Shard::Shard(size_t index, size_t ring_capacity, int cpu, unique_ptr<TradeJournal> journal)
+    : index_(index), journal_(move(journal)), books_mutex_(), books_(), sequencer_(ring_capacity, cpu, "tf-shard-" + to_string(index)) {}
+
+OrderBook& Shard::getOrCreateBook(const string& symbol, const BookFactory& factory) {
+    {
+        shared_lock lock(books_mutex_);
+        auto it = books_.find(symbol);
+        if (it != books_.end()) return *it->second;
+    }
+    // The shard's thread is the only writer of books_, so it can look the
+    // symbol up again without the lock: a racing creator's task runs after
+    // this one and finds the book. The lock is held for the insert alone,
+    // never across the round trip or the factory.
+    OrderBook* book = nullptr;
+    sequencer_.execute([&]() {
+        auto it = books_.find(symbol);
+        if (it != books_.end()) {
+            book = it->second.get();
+            return;
+        }
+        unique_ptr<OrderBook> created = factory(symbol);
+        book = created.get();
+        unique_lock lock(books_mutex_);
+        books_.emplace(symbol, move(created));
+    });
+    return *book;
+}
+
+size_t Shard::bookCount() const {
+    shared_lock lock(books_mutex_);
+    return books_.size();
+}
+
+void Shard::forEachBook(const function<void(const string&, OrderBook&)>& fn) const {
+    shared_lock lock(books_mutex_);
+    for (const auto& pair : books_) fn(pair.first, *pair.second);
+}
+
+} // namespace tradeflow
@@ -0,0 +1,394 @@
+#include "order_matching/Snapshot.hpp"
+#include "order_matching/CommandLog.hpp"
+#include "order_matching/Logger.hpp"
+#include "order_matching/MappedFile.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace tradeflow {
+
+namespace {
+
+constexpr char SNAPSHOT_MAGIC[8] = {'T', 'F', 'S', 'N', 'A', 'P', '\0', '\0'};
+constexpr uint32_t SNAPSHOT_VERSION = 2;
+// Version 1 book headers end before trade_sequence
+constexpr size_t SNAPSHOT_V1_BOOK_HEADER_BYTES = offsetof(SnapshotBookHeader, trade_sequence);
+
+size_t padTo8(size_t bytes) {
+    return (bytes + 7) & ~size_t(7);
+}
+
+// Word-at-a-time FNV-style checksum; every section is a multiple of 8 bytes
+class Checksum {
+public:
+    void update(const void* data, size_t bytes) {
+        const char* p = static_cast<const char*>(data);
+        for (size_t i = 0; i + 8 <= bytes; i += 8) {
+            uint64_t word;
+            memcpy(&word, p + i, sizeof(word));
+            hash_ = (hash_ ^ word) * 0x100000001b3ull;
+        }
+    }
+    uint64_t value() const { return hash_; }
+
+private:
+    uint64_t hash_ = 0xcbf29ce484222325ull;
+};
+
+class SnapshotWriter {
+public:
+    explicit SnapshotWriter(const string& path) : path_(path), fd_(::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644)) {
+        if (fd_ < 0) throw runtime_error("Unable to create snapshot " + path + ": " + strerror(errno));
+        buffer_.reserve(BUFFER_BYTES);
+    }
+    ~SnapshotWriter() {
+        if (fd_ >= 0) ::close(fd_);
+    }
+
+    void append(const void* data, size_t bytes, bool checksummed = true) {
+        if (checksummed) checksum_.update(data, bytes);
+        const char* p = static_cast<const char*>(data);
+        if (buffer_.size() + bytes > BUFFER_BYTES) drain();
+        if (bytes >= BUFFER_BYTES) {
+            writeAll(p, bytes);
+        } else {
+            buffer_.insert(buffer_.end(), p, p + bytes);
+        }
+    }
+    void seekStartAndWrite(const void* data, size_t bytes) {
+        drain();
+        if (::pwrite(fd_, data, bytes, 0) != static_cast<ssize_t>(bytes)) fail("write");
+    }
+    void finish() {
+        drain();
+        if (::fsync(fd_) != 0) fail("fsync");
+        ::close(fd_);
+        fd_ = -1;
+    }
+    uint64_t checksum() const { return checksum_.value(); }
+
+private:
+    static constexpr size_t BUFFER_BYTES = 1 << 20;
+    string path_;
+    int fd_;
+    vector<char> buffer_;
+    Checksum checksum_;
+
+    void drain() {
+        writeAll(buffer_.data(), buffer_.size());
+        buffer_.clear();
+    }
+    void writeAll(const char* p, size_t bytes) {
+        while (bytes > 0) {
+            ssize_t written = ::write(fd_, p, bytes);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                fail("write");
+            }
+            p += written;
+            bytes -= static_cast<size_t>(written);
+        }
+    }
+    [[noreturn]] void fail(const char* what) {
+        throw runtime_error(string("Snapshot ") + what + " to " + path_ + " failed: " + strerror(errno));
+    }
+};
+
+// Bounds-checked cursor over a mapped snapshot
+class SnapshotCursor {
+public:
+    SnapshotCursor(const MappedFile& file) : file_(file), offset_(0) {}
+
+    const char* take(size_t bytes) {
+        if (bytes > file_.size() - offset_) throw runtime_error(file_.path() + ": snapshot is truncated");
+        const char* p = file_.data() + offset_;
+        offset_ += bytes;
+        return p;
+    }
+    template <typename T>
+    T read() {
+        T value;
+        memcpy(&value, take(sizeof(T)), sizeof(T));
+        return value;
+    }
+
+private:
+    const MappedFile& file_;
+    size_t offset_;
+};
+
+string parentDirectory(const string& path) {
+    size_t slash = path.rfind('/');
+    if (slash == string::npos) return ".";
+    return slash == 0 ? "/" : path.substr(0, slash);
+}
+
+// mkdir -p
+void createDirectories(const string& dir) {
+    for (size_t slash = dir.find('/', 1);; slash = dir.find('/', slash + 1)) {
+        string prefix = dir.substr(0, slash);
+        if (::mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST) {
+            throw runtime_error("Unable to create " + prefix + ": " + strerror(errno));
+        }
+        if (slash == string::npos) return;
+    }
+}
+
+void syncDirectory(const string& dir) {
+    int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0) return;
+    ::fsync(fd);
+    ::close(fd);
+}
+
+void applyCommand(OrderBook& book, const CommandRecord& record) {
+    string_view client(record.client_id, strnlen(record.client_id, sizeof(record.client_id)));
+    switch (record.kind) {
+        case CommandKind::ADD:
+            book.addOrder(record.order_id, record.is_buy, record.quantity, record.price, client);
+            break;
+        case CommandKind::SUBMIT:
+            book.submitOrder(record.order_id, record.is_buy, record.quantity, record.price, client,
+                             static_cast<OrderType>(record.order_type));
+            break;
+        case CommandKind::CANCEL:
+            book.cancelOrder(record.order_id);
+            break;
+        case CommandKind::MODIFY:
+            book.modifyOrder(record.order_id, record.quantity, record.price);
+            break;
+        case CommandKind::MATCH:
+            book.triggerMatching();
+            break;
+        case CommandKind::UNCROSS:
+            book.uncross(record.price);
+            break;
+        default:
+            throw runtime_error("unknown command kind " + to_string(static_cast<int>(record.kind)));
+    }
+}
+
+} // namespace
+
+BookImage captureBook(const OrderBook& book) {
+    BookImage image;
+    image.symbol = book.getSymbol();
+    size_t resting = book.getOrderPoolStats().in_use;
+    image.bids.reserve(resting);
+    image.asks.reserve(resting);
+    unordered_map<ClientHandle, uint32_t> client_index;
+    bool have_client = false;  // consecutive orders usually share a client
+    ClientHandle last_client = 0;
+    uint32_t last_index = 0;
+    image.last_sequence = book.forEachOrder([&](const Order& order) {
+        if (!have_client || last_client != order.client) {
+            auto [it, inserted] = client_index.emplace(order.client, static_cast<uint32_t>(image.clients.size()));
+            if (inserted) image.clients.push_back(book.clientName(order.client));
+            have_client = true;
+            last_client = order.client;
+            last_index = it->second;
+        }
+        (order.is_buy ? image.bids : image.asks).push_back(SnapshotOrder{order.id, order.price(), order.quantity, last_index});
+    }, &image.trade_sequence);
+    return image;
+}
+
+void writeSnapshot(const string& path, const vector<BookImage>& books, OrderId next_order_id) {
+    string temp = path + ".tmp";
+    SnapshotWriter writer(temp);
+    SnapshotFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.book_count = static_cast<uint32_t>(books.size());
+    header.next_order_id = next_order_id;
+    writer.append(&header, sizeof(header), false);  // rewritten with body_bytes at the end
+
+    uint64_t body = 0;
+    string table;
+    for (const BookImage& image : books) {
+        table.clear();
+        for (const string& client : image.clients) {
+            uint16_t length = static_cast<uint16_t>(min<size_t>(client.size(), UINT16_MAX));
+            table.append(reinterpret_cast<const char*>(&length), sizeof(length));
+            table.append(client.data(), length);
+        }
+        table.resize(padTo8(table.size()), '\0');
+
+        SnapshotBookHeader book;
+        memset(&book, 0, sizeof(book));
+        memcpy(book.symbol, image.symbol.data(), min(image.symbol.size(), sizeof(book.symbol)));
+        book.last_sequence = image.last_sequence;
+        book.bid_count = image.bids.size();
+        book.ask_count = image.asks.size();
+        book.client_count = static_cast<uint32_t>(image.clients.size());
+        book.client_bytes = static_cast<uint32_t>(table.size());
+        book.trade_sequence = image.trade_sequence;
+        writer.append(&book, sizeof(book));
+        writer.append(table.data(), table.size());
+        writer.append(image.bids.data(), image.bids.size() * sizeof(SnapshotOrder));
+        writer.append(image.asks.data(), image.asks.size() * sizeof(SnapshotOrder));
+        body += sizeof(book) + table.size() + (image.bids.size() + image.asks.size()) * sizeof(SnapshotOrder);
+    }
+    uint64_t checksum = writer.checksum();
+    writer.append(&checksum, sizeof(checksum), false);
+    header.body_bytes = body;
+    writer.seekStartAndWrite(&header, sizeof(header));
+    writer.finish();
+
+    if (::rename(temp.c_str(), path.c_str()) != 0) {
+        throw runtime_error("Unable to rename " + temp + " to " + path + ": " + strerror(errno));
+    }
+    syncDirectory(parentDirectory(path));
+}
+
+SnapshotInfo loadSnapshot(const string& path, const BookResolver& book_for) {
+    MappedFile file(path);
+    SnapshotCursor cursor(file);
+    auto header = cursor.read<SnapshotFileHeader>();
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0) throw runtime_error(path + " is not a snapshot");
+    if (header.version != SNAPSHOT_VERSION && header.version != 1) {
+        throw runtime_error(path + ": unsupported snapshot version " + to_string(header.version));
+    }
+    if (header.body_bytes + sizeof(header) + sizeof(uint64_t) != file.size()) {
+        throw runtime_error(path + ": snapshot is truncated");
+    }
+    // Verify before touching any book so a damaged file changes nothing
+    Checksum checksum;
+    checksum.update(file.data() + sizeof(header), header.body_bytes);
+    uint64_t expected;
+    memcpy(&expected, file.data() + sizeof(header) + header.body_bytes, sizeof(expected));
+    if (checksum.value() != expected) throw runtime_error(path + ": snapshot checksum mismatch");
+
+    SnapshotInfo info;
+    OrderId max_id = 0;
+    vector<string_view> clients;  // the book's client table, in the file
+    for (uint32_t b = 0; b < header.book_count; ++b) {
+        SnapshotBookHeader book_header{};  // trade_sequence 0 for version 1
+        size_t book_header_bytes = header.version == 1 ? SNAPSHOT_V1_BOOK_HEADER_BYTES : sizeof(book_header);
+        memcpy(&book_header, cursor.take(book_header_bytes), book_header_bytes);
+        const char* table = cursor.take(book_header.client_bytes);
+        clients.clear();
+        clients.reserve(book_header.client_count);
+        size_t offset = 0;
+        for (uint32_t c = 0; c < book_header.client_count; ++c) {
+            uint16_t length;
+            if (offset + sizeof(length) > book_header.client_bytes) throw runtime_error(path + ": bad client table");
+            memcpy(&length, table + offset, sizeof(length));
+            offset += sizeof(length);
+            if (offset + length > book_header.client_bytes) throw runtime_error(path + ": bad client table");
+            clients.emplace_back(table + offset, length);
+            offset += length;
+        }
+
+        string symbol(book_header.symbol, strnlen(book_header.symbol, sizeof(book_header.symbol)));
+        OrderBook& book = book_for(symbol);
+        uint64_t counts[2] = {book_header.bid_count, book_header.ask_count};
+        for (int side = 0; side < 2; ++side) {
+            const bool is_buy = side == 0;
+            const char* orders = cursor.take(counts[side] * sizeof(SnapshotOrder));
+            for (uint64_t i = 0; i < counts[side]; ++i) {
+                SnapshotOrder order;
+                memcpy(&order, orders + i * sizeof(SnapshotOrder), sizeof(order));
+                if (order.client >= clients.size()) throw runtime_error(path + ": order refers to a missing client");
+                book.addOrder(order.id, is_buy, order.quantity, order.price, clients[order.client]);
+                max_id = max(max_id, order.id);
+            }
+            info.orders += counts[side];
+        }
+        book.setLastSequence(book_header.last_sequence);
+        book.setTradeSequence(book_header.trade_sequence);
+        info.last_sequence = max(info.last_sequence, book_header.last_sequence);
+        ++info.books;
+    }
+    info.next_order_id = max<OrderId>(header.next_order_id, max_id + 1);
+    return info;
+}
+
+string snapshotPath(const string& dir, uint64_t segment) {
+    char name[48];
+    snprintf(name, sizeof(name), "snapshot-%08llu.snap", static_cast<unsigned long long>(segment));
+    return dir + "/" + name;
+}
+
+RecoveryResult recoverState(const string& dir, const BookResolver& book_for) {
+    auto start = chrono::steady_clock::now();
+    RecoveryResult result;
+    createDirectories(dir);
+    OrderId max_id = 0;
+    uint64_t max_sequence = 0;
+    uint64_t last_segment = 0;
+
+    vector<uint64_t> snapshots = listNumberedFiles(dir, "snapshot-", ".snap");
+    if (!snapshots.empty()) {
+        // Refuse to start from a damaged snapshot: its segments may be gone
+        SnapshotInfo info = loadSnapshot(snapshotPath(dir, snapshots.back()), book_for);
+        result.snapshot_loaded = true;
+        result.snapshot_segment = snapshots.back();
+        result.snapshot_orders = info.orders;
+        max_id = info.next_order_id - 1;
+        max_sequence = info.last_sequence;
+        last_segment = snapshots.back();
+    }
+
+    // Segments older than the snapshot are normally pruned; if any are left,
+    // the per-book sequence check skips what the snapshot already holds.
+    OrderBook* book = nullptr;
+    for (uint64_t segment : CommandLog::listSegments(dir)) {
+        CommandLogReader reader(CommandLog::segmentPath(dir, segment));
+        for (size_t i = 0; i < reader.size(); ++i) {
+            CommandRecord record = reader.at(i);
+            size_t symbol_length = strnlen(record.symbol, sizeof(record.symbol));
+            if (!book || book->getSymbol().compare(0, string::npos, record.symbol, symbol_length) != 0) {
+                book = &book_for(string(record.symbol, symbol_length));
+            }
+            max_sequence = max(max_sequence, record.sequence);
+            max_id = max(max_id, record.order_id);
+            if (record.sequence <= book->lastSequence()) {
+                ++result.commands_skipped;
+                continue;
+            }
+            try {
+                applyCommand(*book, record);
+            } catch (const exception& e) {
+                TF_LOG_WARN("[recovery] {} record {}: {}", CommandLog::segmentPath(dir, segment), i, e.what());
+                continue;
+            }
+            book->setLastSequence(record.sequence);
+            ++result.commands_replayed;
+        }
+        last_segment = max(last_segment, segment);
+    }
+
+    result.next_order_id = max_id + 1;
+    result.next_sequence = max_sequence + 1;
+    result.next_segment = last_segment + 1;
+    result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+void pruneState(const string& dir, uint64_t segment) {
+    for (uint64_t old : listNumberedFiles(dir, "snapshot-", ".snap")) {
+        if (old < segment) ::unlink(snapshotPath(dir, old).c_str());
+    }
+    for (uint64_t old : CommandLog::listSegments(dir)) {
+        if (old < segment) ::unlink(CommandLog::segmentPath(dir, old).c_str());
+    }
+    for (uint64_t stale : listNumberedFiles(dir, "snapshot-", ".snap.tmp")) {
+        ::unlink((snapshotPath(dir, stale) + ".tmp").c_str());
+    }
+}
+
+} // namespace tradeflow
@@ -0,0 +1,26 @@
+#include "order_matching/TradeJournal.hpp"
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+namespace tradeflow {
+
+TradeJournal::TradeJournal(const string& path, const JournalConfig& config)
+    : journal_(path, TRADE_JOURNAL_MAGIC, TRADE_JOURNAL_VERSION, config) {}
+
+void TradeJournal::append(int64_t timestamp_ns, int64_t buy_order_id, int64_t sell_order_id, int64_t price,
+                          int32_t quantity, const string& symbol) {
+    TradeRecord record;
+    record.timestamp_ns = timestamp_ns;
+    record.buy_order_id = buy_order_id;
+    record.sell_order_id = sell_order_id;
+    record.price = price;
+    record.quantity = quantity;
+    record.reserved = 0;
+    memset(record.symbol, 0, sizeof(record.symbol));
+    memcpy(record.symbol, symbol.data(), min(symbol.size(), sizeof(record.symbol)));
+    journal_.append(record);
+}
+
+} // namespace tradeflow
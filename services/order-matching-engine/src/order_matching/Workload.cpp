@@ -0,0 +1,204 @@
+#include "order_matching/Workload.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+
+namespace tradeflow {
+
+namespace {
+
+// Distributions built directly on the engine's output so a seed means the
+// same workload whichever standard library built the tool.
+class WorkloadRandom {
+public:
+    explicit WorkloadRandom(uint64_t seed) : engine_(seed) {}
+
+    // [0, 1)
+    double uniform() { return static_cast<double>(engine_() >> 11) * 0x1.0p-53; }
+    // [0, n)
+    uint64_t below(uint64_t n) { return n <= 1 ? 0 : engine_() % n; }
+    bool chance(double p) { return uniform() < p; }
+    double normal() {
+        // Box-Muller; one value per call keeps the stream position simple
+        double u1 = 1.0 - uniform();
+        double u2 = uniform();
+        return sqrt(-2.0 * log(u1)) * cos(6.283185307179586 * u2);
+    }
+    // Exponential with the given mean
+    double exponential(double mean) { return -log(1.0 - uniform()) * mean; }
+
+private:
+    mt19937_64 engine_;
+};
+
+// Mean age, in the symbol's own passive orders, of the order a cancel or
+// modify picks
+constexpr double RECENT_ORDERS = 64.0;
+
+struct LiveOrder {
+    OrderId id;
+    bool is_buy;
+    Price price;
+};
+
+struct SymbolFlow {
+    uint32_t index;  // in the replay file
+    Price mid;
+    vector<LiveOrder> live;  // passive orders not yet cancelled by the generator
+};
+
+void validate(const WorkloadConfig& config) {
+    auto fraction = [](double value) { return value >= 0.0 && value <= 1.0; };
+    if (config.symbols == 0) throw invalid_argument("workload needs at least one symbol");
+    if (config.depth == 0) throw invalid_argument("workload depth must be at least one tick");
+    if (config.lot <= 0) throw invalid_argument("workload lot must be positive");
+    if (config.size_min == 0 || config.size_max < config.size_min) {
+        throw invalid_argument("workload sizes need 1 <= size_min <= size_max");
+    }
+    if (!fraction(config.walk_probability) || !fraction(config.cancel_ratio) || !fraction(config.modify_ratio) ||
+        !fraction(config.aggressor_ratio) || config.cancel_ratio + config.modify_ratio + config.aggressor_ratio > 1.0) {
+        throw invalid_argument("workload cancel, modify and aggressor ratios must be fractions summing to at most 1");
+    }
+    if (!fraction(config.market_share) || !fraction(config.ioc_share) || !fraction(config.fok_share) ||
+        config.market_share + config.ioc_share + config.fok_share > 1.0) {
+        throw invalid_argument("workload market, IOC and FOK shares must be fractions summing to at most 1");
+    }
+    if (config.zipf_exponent < 0.0) throw invalid_argument("workload Zipf exponent must not be negative");
+    if (config.start_price <= static_cast<Price>(config.depth) + static_cast<Price>(config.initial_levels)) {
+        throw invalid_argument("workload start price must leave room for the book depth");
+    }
+}
+
+} // namespace
+
+string workloadSymbol(uint32_t index) {
+    char name[16];
+    snprintf(name, sizeof(name), "SYM%04u", index);
+    return name;
+}
+
+WorkloadSummary generateWorkload(const WorkloadConfig& config, ReplayWriter& writer) {
+    validate(config);
+    WorkloadRandom random(config.seed);
+    WorkloadSummary summary;
+    OrderId next_id = 1;
+
+    vector<SymbolFlow> flows(config.symbols);
+    // Cumulative Zipf weights: rank k is chosen with weight 1 / (k + 1)^s
+    vector<double> popularity(config.symbols);
+    double total = 0.0;
+    for (uint32_t i = 0; i < config.symbols; ++i) {
+        flows[i].index = writer.symbol(workloadSymbol(i));
+        flows[i].mid = config.start_price;
+        total += 1.0 / pow(static_cast<double>(i + 1), config.zipf_exponent);
+        popularity[i] = total;
+    }
+    for (double& weight : popularity) weight /= total;
+
+    auto drawSize = [&]() -> Quantity {
+        double lots = config.size_min;
+        switch (config.size_distribution) {
+        case SizeDistribution::FIXED:
+            break;
+        case SizeDistribution::UNIFORM:
+            lots = static_cast<double>(config.size_min + random.below(config.size_max - config.size_min + 1));
+            break;
+        case SizeDistribution::LOGNORMAL:
+            lots = floor(config.size_min * exp(config.size_sigma * random.normal()) + 0.5);
+            break;
+        }
+        lots = min(max(lots, static_cast<double>(config.size_min)), static_cast<double>(config.size_max));
+        return static_cast<Quantity>(lots) * config.lot;
+    };
+    // Passive distance from the mid: exponential, so the inside levels are the busiest
+    auto drawDistance = [&]() -> Price {
+        double ticks = random.exponential(max(1.0, config.depth / 4.0));
+        return 1 + static_cast<Price>(min(ticks, static_cast<double>(config.depth - 1)));
+    };
+    auto passivePrice = [](const SymbolFlow& flow, bool is_buy, Price distance) {
+        return is_buy ? flow.mid - distance : flow.mid + distance;
+    };
+
+    for (auto& flow : flows) {
+        for (uint32_t level = 1; level <= config.initial_levels; ++level) {
+            for (int side = 0; side < 2; ++side) {
+                bool is_buy = side == 0;
+                Price px = passivePrice(flow, is_buy, level);
+                for (uint32_t n = 0; n < config.orders_per_level; ++n) {
+                    OrderId id = next_id++;
+                    writer.add(flow.index, id, is_buy, drawSize(), px);
+                    flow.live.push_back({id, is_buy, px});
+                    ++summary.adds;
+                }
+            }
+        }
+    }
+
+    const double cancel_below = config.cancel_ratio;
+    const double modify_below = cancel_below + config.modify_ratio;
+    const double aggressor_below = modify_below + config.aggressor_ratio;
+    for (uint64_t e = 0; e < config.events; ++e) {
+        double pick = random.uniform();
+        size_t rank = lower_bound(popularity.begin(), popularity.end(), pick) - popularity.begin();
+        SymbolFlow& flow = flows[min(rank, flows.size() - 1)];
+
+        if (random.chance(config.walk_probability)) {
+            Price floor_px = static_cast<Price>(config.depth) + 1;
+            flow.mid = random.chance(0.5) ? flow.mid + 1 : max(floor_px, flow.mid - 1);
+        }
+
+        double action = random.uniform();
+        if (action < modify_below && !flow.live.empty()) {
+            // Recent orders are the likeliest to be cancelled or amended
+            size_t back = static_cast<size_t>(random.exponential(RECENT_ORDERS));
+            size_t slot = flow.live.size() - 1 - min(back, flow.live.size() - 1);
+            LiveOrder& order = flow.live[slot];
+            if (action < cancel_below) {
+                writer.cancel(flow.index, order.id);
+                flow.live.erase(flow.live.begin() + static_cast<ptrdiff_t>(slot));
+                ++summary.cancels;
+            } else {
+                // Mostly size amendments in place; some re-price toward the current mid
+                if (random.chance(0.3)) order.price = passivePrice(flow, order.is_buy, drawDistance());
+                writer.modify(flow.index, order.id, drawSize(), order.price);
+                ++summary.modifies;
+            }
+        } else if (action >= modify_below && action < aggressor_below) {
+            bool is_buy = random.chance(0.5);
+            Price through = static_cast<Price>(random.below(config.sweep_levels + 1));
+            Price px = is_buy ? flow.mid + through : flow.mid - through;
+            double kind = random.uniform();
+            OrderType type = OrderType::LIMIT;
+            if (kind < config.market_share) {
+                type = OrderType::MARKET;
+                px = 0;
+            } else if (kind < config.market_share + config.ioc_share) {
+                type = OrderType::IOC;
+            } else if (kind < config.market_share + config.ioc_share + config.fok_share) {
+                type = OrderType::FOK;
+            }
+            OrderId id = next_id++;
+            writer.submit(flow.index, id, is_buy, drawSize(), px, type);
+            if (type == OrderType::LIMIT) flow.live.push_back({id, is_buy, px});
+            ++summary.aggressive;
+        } else {
+            bool is_buy = random.chance(0.5);
+            Price px = passivePrice(flow, is_buy, drawDistance());
+            OrderId id = next_id++;
+            writer.submit(flow.index, id, is_buy, drawSize(), px);
+            flow.live.push_back({id, is_buy, px});
+            ++summary.passive;
+        }
+    }
+
+    summary.events = summary.adds + summary.passive + summary.aggressive + summary.cancels + summary.modifies;
+    summary.last_order_id = next_id - 1;
+    return summary;
+}
+
+} // namespace tradeflow
@@ -1,19 +1,35 @@
 #include <iostream>
 #include <memory>
 #include <string>
+#include <grpcpp/alarm.h>
 #include <grpcpp/grpcpp.h>
 #include <thread>
 #include <mutex>
 #include <unordered_map>
 #include "order_service.grpc.pb.h"
 #include "order_matching/OrderBook.hpp"
-#include "order_matching/TradeLog.hpp"
-#include "order_matching/Matcher.hpp"
+#include "order_matching/TradeJournal.hpp"
+#include "order_matching/BroadcastRing.hpp"
+#include "order_matching/CommandLog.hpp"
+#include "order_matching/DepthView.hpp"
+#include "order_matching/Snapshot.hpp"
+#include "order_matching/EngineConfig.hpp"
+#include "order_matching/LatencyHistogram.hpp"
+#include "order_matching/Logger.hpp"
+#include "order_matching/MetricsRegistry.hpp"
+#include "order_matching/MpscRing.hpp"
+#include "order_matching/OrderRouter.hpp"
+#include "order_matching/Sequencer.hpp"
+#include "order_matching/Shard.hpp"
 #include <condition_variable>
 #include <deque>
+#include <functional>
+#include <ctime>
 #include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <atomic>
+#include <fstream>
 #include <sstream>
 #ifndef _WIN32
 #include <arpa/inet.h>
@@ -34,30 +50,158 @@ namespace tradeflow {
 const int64_t TICK_SIZE = 100;  // 1.00 = 100 ticks
 constexpr int METRICS_PORT = 9464;
 
-std::atomic<uint64_t> metrics_submit_requests{0};
-std::atomic<uint64_t> metrics_submit_accepted{0};
-std::atomic<uint64_t> metrics_submit_rejected{0};
-std::atomic<uint64_t> metrics_submit_errors{0};
-std::atomic<uint64_t> metrics_get_orderbook_requests{0};
-std::atomic<uint64_t> metrics_cancel_requests{0};
-std::atomic<uint64_t> metrics_cancel_success{0};
-std::atomic<uint64_t> metrics_cancel_not_found{0};
-std::atomic<uint64_t> metrics_cancel_errors{0};
-std::atomic<uint64_t> metrics_modify_requests{0};
-std::atomic<uint64_t> metrics_modify_success{0};
-std::atomic<uint64_t> metrics_modify_not_found{0};
-std::atomic<uint64_t> metrics_modify_errors{0};
-std::atomic<uint64_t> metrics_trade_updates_published{0};
-std::atomic<uint64_t> metrics_trade_quantity_total{0};
+// Order service counters. Every gRPC thread increments its own slots (see
+// MetricsRegistry), so concurrent RPCs do not contend on these cache lines.
+MetricsRegistry metrics_;
+Counter metrics_submit_requests =
+    metrics_.counter("tradeflow_order_service_submit_requests_total", "Total SubmitOrder RPCs received");
+Counter metrics_submit_accepted =
+    metrics_.counter("tradeflow_order_service_submit_accepted_total", "Successfully accepted submit requests");
+Counter metrics_submit_rejected =
+    metrics_.counter("tradeflow_order_service_submit_rejected_total", "Submit requests rejected due to validation");
+Counter metrics_submit_errors =
+    metrics_.counter("tradeflow_order_service_submit_errors_total", "Submit requests that triggered internal errors");
+Counter metrics_get_orderbook_requests =
+    metrics_.counter("tradeflow_order_service_get_orderbook_requests_total", "Total GetOrderBook RPCs");
+Counter metrics_cancel_requests =
+    metrics_.counter("tradeflow_order_service_cancel_requests_total", "Total CancelOrder RPCs");
+Counter metrics_cancel_success =
+    metrics_.counter("tradeflow_order_service_cancel_success_total", "CancelOrder RPCs that cancelled an order");
+Counter metrics_cancel_not_found =
+    metrics_.counter("tradeflow_order_service_cancel_not_found_total", "CancelOrder RPCs where order was not found");
+Counter metrics_cancel_errors =
+    metrics_.counter("tradeflow_order_service_cancel_errors_total", "CancelOrder RPCs that triggered internal errors");
+Counter metrics_modify_requests =
+    metrics_.counter("tradeflow_order_service_modify_requests_total", "Total ModifyOrder RPCs");
+Counter metrics_modify_success =
+    metrics_.counter("tradeflow_order_service_modify_success_total", "ModifyOrder RPCs that modified an order");
+Counter metrics_modify_not_found =
+    metrics_.counter("tradeflow_order_service_modify_not_found_total", "ModifyOrder RPCs where order was not found");
+Counter metrics_modify_rejected =
+    metrics_.counter("tradeflow_order_service_modify_rejected_total", "Modify requests rejected due to validation");
+Counter metrics_modify_errors =
+    metrics_.counter("tradeflow_order_service_modify_errors_total", "ModifyOrder RPCs that triggered internal errors");
+Counter metrics_trade_updates_published =
+    metrics_.counter("tradeflow_order_service_trade_updates_total", "Trade updates published to subscribers");
+Counter metrics_trade_quantity_total =
+    metrics_.counter("tradeflow_order_service_trade_quantity_total", "Cumulative filled quantity across trades");
+Counter metrics_subscribe_requests =
+    metrics_.counter("tradeflow_order_service_subscribe_requests_total", "Total SubscribeTrades RPCs");
+Counter metrics_trade_updates_skipped = metrics_.counter(
+    "tradeflow_order_service_trade_updates_skipped_total", "Trade updates slow subscribers missed after being lapped");
+Counter metrics_slow_subscriber_disconnects = metrics_.counter(
+    "tradeflow_order_service_slow_subscriber_disconnects_total", "Trade streams ended for falling a whole ring behind");
+Counter metrics_active_trade_subscriptions =
+    metrics_.gauge("tradeflow_order_service_active_trade_subscriptions", "Active trade streaming subscriptions");
+Counter metrics_submit_batches =
+    metrics_.counter("tradeflow_order_service_submit_batches_total", "Total SubmitOrders RPCs");
+Counter metrics_entry_requests = metrics_.counter(
+    "tradeflow_order_service_entry_requests_total", "Command batches received on order entry streams");
+Counter metrics_entry_fills =
+    metrics_.counter("tradeflow_order_service_entry_fills_total", "Fills sent on order entry streams");
+Counter metrics_active_entry_streams =
+    metrics_.gauge("tradeflow_order_service_active_entry_streams", "Open OrderEntryStream RPCs");
+Counter metrics_book_subscribe_requests =
+    metrics_.counter("tradeflow_order_service_book_subscribe_requests_total", "Total SubscribeBook RPCs");
+Counter metrics_book_updates_published = metrics_.counter(
+    "tradeflow_order_service_book_updates_total", "Depth update messages published to book subscribers");
+Counter metrics_book_snapshots = metrics_.counter(
+    "tradeflow_order_service_book_snapshots_total", "Book snapshots sent, on subscribe and after being lapped");
+Counter metrics_active_book_subscriptions =
+    metrics_.gauge("tradeflow_order_service_active_book_subscriptions", "Active SubscribeBook streams");
+Counter metrics_uncross_requests =
+    metrics_.counter("tradeflow_order_service_uncross_requests_total", "Total Uncross RPCs");
+Counter metrics_auction_volume = metrics_.counter(
+    "tradeflow_order_service_auction_traded_quantity_total", "Quantity traded by call-auction uncrosses");
+// Per-book series, looked up once per book or cached per thread by labels()
+MetricFamily& metrics_symbol_submits = metrics_.family(
+    "tradeflow_order_service_symbol_submits_total", "Orders the book accepted or rejected, by outcome",
+    MetricType::COUNTER, {"symbol", "outcome"});
+MetricFamily& metrics_symbol_trades = metrics_.family(
+    "tradeflow_order_service_symbol_trades_total", "Trades executed by the book", MetricType::COUNTER, {"symbol"});
+MetricFamily& metrics_symbol_traded_quantity = metrics_.family(
+    "tradeflow_order_service_symbol_traded_quantity_total", "Filled quantity executed by the book",
+    MetricType::COUNTER, {"symbol"});
+// Written once per second of trading at most, so a plain atomic
 std::atomic<long long> metrics_last_trade_timestamp_epoch{0};
-std::atomic<uint64_t> metrics_subscribe_requests{0};
-std::atomic<int64_t> metrics_active_trade_subscriptions{0};
+std::atomic<uint64_t> metrics_snapshots{0};
+std::atomic<uint64_t> metrics_snapshot_failures{0};
+std::atomic<double> metrics_snapshot_last_seconds{0};
+std::atomic<uint64_t> metrics_snapshot_last_orders{0};
+
+// Latency of one RPC, whole and by stage (see RpcTimer)
+struct RpcLatency {
+    explicit RpcLatency(const char* rpc_name) : rpc(rpc_name) {}
+
+    const char* rpc;
+    LatencyHistogram total;
+    LatencyHistogram lock_wait;  // contended book lock (LOCKED) or sequencer ring (SEQUENCER)
+    LatencyHistogram book;       // the book call itself: matching, resting, cancelling, reading
+    LatencyHistogram publish;    // trade callbacks and journal appends made by the call
+    LatencyHistogram durable;    // TRADEFLOW_WAL_ACK=durable wait for the command log
+};
+
+RpcLatency submit_latency_{"SubmitOrder"};
+RpcLatency cancel_latency_{"CancelOrder"};
+RpcLatency modify_latency_{"ModifyOrder"};
+RpcLatency get_orderbook_latency_{"GetOrderBook"};
+RpcLatency submit_batch_latency_{"SubmitOrders"};
+RpcLatency entry_stream_latency_{"OrderEntryStream"};  // per request (batch) on the stream
+RpcLatency uncross_latency_{"Uncross"};
+
+// Times one RPC into its RpcLatency. beginBook()/endBook() bracket the book
+// call (or sequencer round trip); the lock wait and publishing the book
+// reported through threadStageTimes() are split out of that interval and the
+// rest is the book stage. endDurable() closes the durable-ack wait. No-op
+// when TRADEFLOW_LATENCY_HISTOGRAMS=off.
+class RpcTimer {
+public:
+    explicit RpcTimer(RpcLatency& latency)
+        : latency_(latency), enabled_(stageTiming()), start_(enabled_ ? monotonicNanos() : 0), mark_(start_) {}
+    ~RpcTimer() {
+        if (enabled_) latency_.total.record(monotonicNanos() - start_);
+    }
+
+    void beginBook() {
+        if (!enabled_) return;
+        threadStageTimes() = StageTimes();
+        mark_ = monotonicNanos();
+    }
+    void endBook() {
+        if (!enabled_) return;
+        uint64_t now = monotonicNanos();
+        const StageTimes& stages = threadStageTimes();
+        uint64_t elapsed = now - mark_;
+        uint64_t waited = min(elapsed, stages.lock_wait_ns);
+        uint64_t published = min(elapsed - waited, stages.publish_ns);
+        latency_.lock_wait.record(waited);
+        latency_.publish.record(published);
+        latency_.book.record(elapsed - waited - published);
+        mark_ = now;
+    }
+    void endDurable() {
+        if (!enabled_) return;
+        uint64_t now = monotonicNanos();
+        latency_.durable.record(now - mark_);
+        mark_ = now;
+    }
+
+private:
+    RpcLatency& latency_;
+    bool enabled_;
+    uint64_t start_;
+    uint64_t mark_;
+};
+
+EngineConfig engine_config_;
 
 std::string CollectMetricsSnapshot();
+void AppendOrderBookMetrics(std::ostringstream& oss);
 void MetricsHttpServer();
 
+// Rounded, so a price that went out through priceToDouble comes back exact
 Price doubleToPrice(double price) {
-    return static_cast<Price>(price * TICK_SIZE);
+    return static_cast<Price>(llround(price * TICK_SIZE));
 }
 
 double priceToDouble(Price price) {
@@ -66,65 +210,7 @@ double priceToDouble(Price price) {
 
 std::string CollectMetricsSnapshot() {
     std::ostringstream oss;
-    oss << "# HELP tradeflow_order_service_submit_requests_total Total SubmitOrder RPCs received" << '\n';
-    oss << "# TYPE tradeflow_order_service_submit_requests_total counter" << '\n';
-    oss << "tradeflow_order_service_submit_requests_total " << metrics_submit_requests.load() << '\n';
-
-    oss << "# HELP tradeflow_order_service_submit_accepted_total Successfully accepted submit requests" << '\n';
-    oss << "# TYPE tradeflow_order_service_submit_accepted_total counter" << '\n';
-    oss << "tradeflow_order_service_submit_accepted_total " << metrics_submit_accepted.load() << '\n';
-
-    oss << "# HELP tradeflow_order_service_submit_rejected_total Submit requests rejected due to validation" << '\n';
-    oss << "# TYPE tradeflow_order_service_submit_rejected_total counter" << '\n';
-    oss << "tradeflow_order_service_submit_rejected_total " << metrics_submit_rejected.load() << '\n';
-
-    oss << "# HELP tradeflow_order_service_submit_errors_total Submit requests that triggered internal errors" << '\n';
-    oss << "# TYPE tradeflow_order_service_submit_errors_total counter" << '\n';
-    oss << "tradeflow_order_service_submit_errors_total " << metrics_submit_errors.load() << '\n';
-
-    oss << "# HELP tradeflow_order_service_get_orderbook_requests_total Total GetOrderBook RPCs" << '\n';
-    oss << "# TYPE tradeflow_order_service_get_orderbook_requests_total counter" << '\n';
-    oss << "tradeflow_order_service_get_orderbook_requests_total " << metrics_get_orderbook_requests.load() << '\n';
-
-    oss << "# HELP tradeflow_order_service_cancel_requests_total Total CancelOrder RPCs" << '\n';
-    oss << "# TYPE tradeflow_order_service_cancel_requests_total counter" << '\n';
-    oss << "tradeflow_order_service_cancel_requests_total " << metrics_cancel_requests.load() << '\n';
-
-    oss << "# HELP tradeflow_order_service_cancel_success_total CancelOrder RPCs that cancelled an order" << '\n';
-    oss << "# TYPE tradeflow_order_service_cancel_success_total counter" << '\n';
-    oss << "tradeflow_order_service_cancel_success_total " << metrics_cancel_success.load() << '\n';
-
-    oss << "# HELP tradeflow_order_service_cancel_not_found_total CancelOrder RPCs where order was not found" << '\n';
-    oss << "# TYPE tradeflow_order_service_cancel_not_found_total counter" << '\n';
-    oss << "tradeflow_order_service_cancel_not_found_total " << metrics_cancel_not_found.load() << '\n';
-
-    oss << "# HELP tradeflow_order_service_cancel_errors_total CancelOrder RPCs that triggered internal errors" << '\n';
-    oss << "# TYPE tradeflow_order_service_cancel_errors_total counter" << '\n';
-    oss << "tradeflow_order_service_cancel_errors_total " << metrics_cancel_errors.load() << '\n';
-
-    oss << "# HELP tradeflow_order_service_modify_requests_total Total ModifyOrder RPCs" << '\n';
-    oss << "# TYPE tradeflow_order_service_modify_requests_total counter" << '\n';
-    oss << "tradeflow_order_service_modify_requests_total " << metrics_modify_requests.load() << '\n';
-
-    oss << "# HELP tradeflow_order_service_modify_success_total ModifyOrder RPCs that modified an order" << '\n';
-    oss << "# TYPE tradeflow_order_service_modify_success_total counter" << '\n';
-    oss << "tradeflow_order_service_modify_success_total " << metrics_modify_success.load() << '\n';
-
-    oss << "# HELP tradeflow_order_service_modify_not_found_total ModifyOrder RPCs where order was not found" << '\n';
-    oss << "# TYPE tradeflow_order_service_modify_not_found_total counter" << '\n';
-    oss << "tradeflow_order_service_modify_not_found_total " << metrics_modify_not_found.load() << '\n';
-
-    oss << "# HELP tradeflow_order_service_modify_errors_total ModifyOrder RPCs that triggered internal errors" << '\n';
-    oss << "# TYPE tradeflow_order_service_modify_errors_total counter" << '\n';
-    oss << "tradeflow_order_service_modify_errors_total " << metrics_modify_errors.load() << '\n';
-
-    oss << "# HELP tradeflow_order_service_trade_updates_total Trade updates published to subscribers" << '\n';
-    oss << "# TYPE tradeflow_order_service_trade_updates_total counter" << '\n';
-    oss << "tradeflow_order_service_trade_updates_total " << metrics_trade_updates_published.load() << '\n';
-
-    oss << "# HELP tradeflow_order_service_trade_quantity_total Cumulative filled quantity across trades" << '\n';
-    oss << "# TYPE tradeflow_order_service_trade_quantity_total counter" << '\n';
-    oss << "tradeflow_order_service_trade_quantity_total " << metrics_trade_quantity_total.load() << '\n';
+    metrics_.writePrometheus(oss);
 
     long long last_trade = metrics_last_trade_timestamp_epoch.load();
     if (last_trade > 0) {
@@ -133,22 +219,45 @@ std::string CollectMetricsSnapshot() {
         oss << "tradeflow_order_service_last_trade_timestamp_seconds " << last_trade << '\n';
     }
 
-    oss << "# HELP tradeflow_order_service_subscribe_requests_total Total SubscribeTrades RPCs" << '\n';
-    oss << "# TYPE tradeflow_order_service_subscribe_requests_total counter" << '\n';
-    oss << "tradeflow_order_service_subscribe_requests_total " << metrics_subscribe_requests.load() << '\n';
+    // Threads in the process, so sync and async gRPC servers can be compared under load
+    std::ifstream status("/proc/self/status");
+    for (std::string line; std::getline(status, line);) {
+        if (line.rfind("Threads:", 0) != 0) continue;
+        oss << "# HELP tradeflow_process_threads Threads in the engine process" << '\n';
+        oss << "# TYPE tradeflow_process_threads gauge" << '\n';
+        oss << "tradeflow_process_threads " << std::stoll(line.substr(8)) << '\n';
+        break;
+    }
 
-    oss << "# HELP tradeflow_order_service_active_trade_subscriptions Active trade streaming subscriptions" << '\n';
-    oss << "# TYPE tradeflow_order_service_active_trade_subscriptions gauge" << '\n';
-    oss << "tradeflow_order_service_active_trade_subscriptions " << metrics_active_trade_subscriptions.load() << '\n';
+    AppendOrderBookMetrics(oss);
 
     return oss.str();
 }
 
+// GET /loglevel reports the current level; POST /loglevel?level=debug
+// changes it on the running process.
+bool HandleLogLevelRequest(const std::string& request, std::string& body) {
+    std::string line = request.substr(0, request.find('\r'));
+    size_t query = line.find("?level=");
+    if (line.rfind("POST", 0) == 0) {
+        LogLevel level;
+        std::string name = query == std::string::npos ? "" : line.substr(query + 7, line.find(' ', query) - query - 7);
+        if (!Logger::parseLevel(name, level)) {
+            body = "expected ?level=trace|debug|info|warn|error|off\n";
+            return false;
+        }
+        Logger::setLevel(level);
+        TF_LOG_INFO("[logger] level set to {}", Logger::levelName(level));
+    }
+    body = std::string("level=") + Logger::levelName(Logger::level()) + "\n";
+    return true;
+}
+
 #ifndef _WIN32
 void MetricsHttpServer() {
     int server_fd = socket(AF_INET, SOCK_STREAM, 0);
     if (server_fd < 0) {
-        std::cerr << "[metrics] failed to create socket" << std::endl;
+        TF_LOG_ERROR("[metrics] failed to create socket");
         return;
     }
 
@@ -161,18 +270,18 @@ void MetricsHttpServer() {
     address.sin_port = htons(METRICS_PORT);
 
     if (bind(server_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
-        std::cerr << "[metrics] failed to bind socket on port " << METRICS_PORT << std::endl;
+        TF_LOG_ERROR("[metrics] failed to bind socket on port {}", METRICS_PORT);
         close(server_fd);
         return;
     }
 
     if (listen(server_fd, 16) < 0) {
-        std::cerr << "[metrics] failed to listen on port " << METRICS_PORT << std::endl;
+        TF_LOG_ERROR("[metrics] failed to listen on port {}", METRICS_PORT);
         close(server_fd);
         return;
     }
 
-    std::cout << "[metrics] Prometheus exporter listening on 0.0.0.0:" << METRICS_PORT << std::endl;
+    TF_LOG_INFO("[metrics] Prometheus exporter listening on 0.0.0.0:{}", METRICS_PORT);
 
     while (true) {
         int client_fd = accept(server_fd, nullptr, nullptr);
@@ -181,11 +290,18 @@ void MetricsHttpServer() {
         }
 
         char buffer[1024];
-        (void)read(client_fd, buffer, sizeof(buffer));
-
-        std::string body = CollectMetricsSnapshot();
+        ssize_t received = read(client_fd, buffer, sizeof(buffer));
+        std::string request(buffer, received > 0 ? static_cast<size_t>(received) : 0);
+
+        std::string body;
+        bool ok = true;
+        if (request.rfind("GET /loglevel", 0) == 0 || request.rfind("POST /loglevel", 0) == 0) {
+            ok = HandleLogLevelRequest(request, body);
+        } else {
+            body = CollectMetricsSnapshot();
+        }
         std::ostringstream response;
-        response << "HTTP/1.1 200 OK\r\n";
+        response << (ok ? "HTTP/1.1 200 OK\r\n" : "HTTP/1.1 400 Bad Request\r\n");
         response << "Content-Type: text/plain; version=0.0.4\r\n";
         response << "Content-Length: " << body.size() << "\r\n";
         response << "Connection: close\r\n\r\n";
@@ -198,131 +314,1232 @@ void MetricsHttpServer() {
 }
 #else
 void MetricsHttpServer() {
-    std::cerr << "[metrics] Prometheus exporter disabled on Windows builds" << std::endl;
+    TF_LOG_WARN("[metrics] Prometheus exporter disabled on Windows builds");
 }
 #endif
 
+// LOCKED execution: every book appends to this one journal (declared before
+// the books so it outlives them). SEQUENCER shards own their own journals.
+unique_ptr<TradeJournal> trade_journal_;
+// Write-ahead command log shared by every book when a state directory is
+// configured; also declared before the books.
+unique_ptr<CommandLog> command_log_;
+mutex snapshot_mutex_;
 // Global variables for order books and subscribers
 unordered_map<string, unique_ptr<OrderBook>> order_books_;
-unordered_map<string, unique_ptr<Matcher>> matchers_;
 mutex order_books_mutex_;
 OrderId next_order_id_ = 1;
 mutex id_mutex_;
+// Order id -> owning book for cancel/modify; created in main() once the
+// engine config is known
+unique_ptr<OrderRouter> order_router_;
+// SEQUENCER execution: each shard owns the books shard_map_ assigns to it
+// and applies their commands on its own (optionally pinned) thread. Empty in
+// LOCKED mode, where books live in order_books_ and RPC threads call into
+// them directly.
+vector<unique_ptr<Shard>> shards_;
+ShardMap shard_map_;
+
+Shard* shardFor(const string& symbol) {
+    if (shards_.empty()) return nullptr;
+    return shards_[shard_map_.shardFor(symbol)].get();
+}
+
+Sequencer* sequencerFor(const OrderBook& book) {
+    Shard* shard = shardFor(book.getSymbol());
+    return shard ? &shard->sequencer() : nullptr;
+}
 
-// For streaming trades: per-subscriber queue + condition variable
-struct Subscriber {
+TradeJournal* journalFor(const string& symbol) {
+    Shard* shard = shardFor(symbol);
+    return shard ? shard->journal() : trade_journal_.get();
+}
+
+// Upper bound on a serialised TradeUpdate besides its symbol: two 20-digit
+// ids, price, quantity, a ctime() timestamp and field overhead
+constexpr size_t TRADE_UPDATE_MAX_BYTES = 160;
+// A book change is published in BookUpdate messages of at most this many
+// levels, each bounded by BOOK_LEVEL_MAX_BYTES, plus the symbol and sequence
+constexpr size_t BOOK_LEVELS_PER_MESSAGE = 32;
+constexpr size_t BOOK_LEVEL_MAX_BYTES = 24;
+constexpr size_t BOOK_UPDATE_HEADER_BYTES = 32;
+// How long an idle subscription stream parks before re-checking for a
+// client disconnect
+constexpr chrono::milliseconds SUBSCRIBER_POLL{100};
+
+class ChannelStreamCall;
+
+// Fan-out of one symbol's feed (trades for SubscribeTrades, depth changes
+// for SubscribeBook). The book's callback serialises each message once into
+// the broadcast ring and every stream reads it at its own cursor, so
+// publishing costs the same for one subscriber or a hundred and never waits
+// for a slow one. Idle sync streams park on cv; the publisher only takes the
+// mutex when one is parked. Idle async streams (see ChannelStreamCall) park
+// in parked_streams and are woken by the StreamWaker thread, never by the
+// publisher itself.
+struct StreamChannel {
+    StreamChannel(size_t capacity, size_t slot_bytes) : ring(capacity, slot_bytes) {}
+
+    BroadcastRing ring;
+    std::atomic<int> subscribers{0};
+    std::atomic<int> parked{0};
     mutex m;
     condition_variable cv;
-    deque<tradeflow::order::TradeUpdate> q;
-    bool active = true;
+    std::atomic<int> async_parked{0};
+    std::atomic<bool> wake_pending{false};  // channel is queued on the waker
+    vector<ChannelStreamCall*> parked_streams;  // guarded by m
 };
 
-unordered_map<string, vector<shared_ptr<Subscriber>>> trade_subscribers_;
-mutex subscribers_mutex_;
+void wakeStreams(StreamChannel& channel);
+
+// Channels are created on first use (book attach or subscribe) and never
+// removed, so references to them stay valid for the process lifetime
+unordered_map<string, unique_ptr<StreamChannel>> trade_channels_;
+unordered_map<string, unique_ptr<StreamChannel>> book_channels_;
+mutex stream_channels_mutex_;
+
+StreamChannel& tradeChannel(const string& symbol) {
+    lock_guard<mutex> lock(stream_channels_mutex_);
+    auto& channel = trade_channels_[symbol];
+    if (!channel) channel = make_unique<StreamChannel>(engine_config_.trade_ring_capacity, TRADE_UPDATE_MAX_BYTES + symbol.size());
+    return *channel;
+}
+
+StreamChannel& bookChannel(const string& symbol) {
+    lock_guard<mutex> lock(stream_channels_mutex_);
+    auto& channel = book_channels_[symbol];
+    if (!channel) {
+        channel = make_unique<StreamChannel>(engine_config_.book_ring_capacity,
+                                             BOOK_UPDATE_HEADER_BYTES + symbol.size() +
+                                                 BOOK_LEVELS_PER_MESSAGE * BOOK_LEVEL_MAX_BYTES);
+    }
+    return *channel;
+}
+
+// After publishing: wake the channel's parked streams, if any
+void notifyStreams(StreamChannel& channel) {
+    // Pairs with the fence in awaitMessage and ChannelStreamCall::park: either
+    // the stream sees the new head before parking or we see it parked and wake it
+    atomic_thread_fence(std::memory_order_seq_cst);
+    if (channel.parked.load(std::memory_order_relaxed) > 0) {
+        lock_guard<mutex> lock(channel.m);
+        channel.cv.notify_all();
+    }
+    if (channel.async_parked.load(std::memory_order_relaxed) > 0 &&
+        !channel.wake_pending.exchange(true, std::memory_order_acq_rel)) {
+        wakeStreams(channel);
+    }
+}
+
+// Sync streams: block until message `next` is published or `timeout` passes
+void awaitMessage(StreamChannel& channel, uint64_t next, chrono::milliseconds timeout) {
+    channel.parked.fetch_add(1, std::memory_order_relaxed);
+    atomic_thread_fence(std::memory_order_seq_cst);
+    {
+        unique_lock<mutex> lk(channel.m);
+        channel.cv.wait_for(lk, timeout, [&] { return channel.ring.head() >= next; });
+    }
+    channel.parked.fetch_sub(1, std::memory_order_relaxed);
+}
+
+// Runs on the thread executing the trade (under the book's lock, or on its
+// shard's sequencer), which serialises publishers per symbol as the ring needs
+void publishTrade(const Trade& trade, const string& symbol, const Clock& clock, StreamChannel& channel) {
+    metrics_trade_updates_published.inc();
+    metrics_trade_quantity_total.inc(static_cast<uint64_t>(trade.quantity));
+    int64_t epoch_nanos = clock.toEpochNanos(trade.timestamp);
+    long long epoch_seconds = epoch_nanos / 1000000000;
+    if (metrics_last_trade_timestamp_epoch.load(std::memory_order_relaxed) != epoch_seconds) {
+        metrics_last_trade_timestamp_epoch.store(epoch_seconds, std::memory_order_relaxed);
+    }
+    if (channel.subscribers.load(std::memory_order_relaxed) == 0) return;
 
-void publishTrade(const Trade& trade) {
-    tradeflow::order::TradeUpdate update;
+    // Reused per thread so its strings keep their capacity between trades
+    thread_local tradeflow::order::TradeUpdate update;
     update.set_buy_order_id(to_string(trade.buy_order_id));
     update.set_sell_order_id(to_string(trade.sell_order_id));
     update.set_price(priceToDouble(trade.price));
     update.set_quantity(trade.quantity);
-    update.set_symbol(trade.symbol);
-    auto time_t = chrono::system_clock::to_time_t(trade.timestamp);
-    update.set_timestamp(ctime(&time_t));
+    update.set_symbol(symbol);
+    update.set_sequence(trade.sequence);
+    update.set_timestamp_ns(epoch_nanos);
+    // The text only changes once a second, so each thread formats it once
+    thread_local long long formatted_second = -1;
+    thread_local char timestamp[64];
+    if (epoch_seconds != formatted_second) {
+        time_t seconds = static_cast<time_t>(epoch_seconds);
+        ctime_r(&seconds, timestamp);
+        formatted_second = epoch_seconds;
+    }
+    update.set_timestamp(timestamp);
+
+    size_t size = update.ByteSizeLong();
+    bool published = channel.ring.publish(size, [&](char* slot) {
+        update.SerializeWithCachedSizesToArray(reinterpret_cast<uint8_t*>(slot));
+    });
+    if (!published) {
+        TF_LOG_WARN("[trades] {} byte update for {} does not fit the trade ring slot", size, symbol);
+        return;
+    }
+    notifyStreams(channel);
+}
 
-    metrics_trade_updates_published.fetch_add(1, std::memory_order_relaxed);
-    metrics_trade_quantity_total.fetch_add(static_cast<uint64_t>(trade.quantity), std::memory_order_relaxed);
-    auto epoch_seconds = chrono::duration_cast<chrono::seconds>(trade.timestamp.time_since_epoch()).count();
-    metrics_last_trade_timestamp_epoch.store(epoch_seconds, std::memory_order_relaxed);
+// The book's DepthCallback: under its lock (or on its shard's sequencer),
+// like publishTrade. Nothing is serialised while nobody subscribes; a new
+// subscriber's snapshot covers whatever was skipped.
+void publishDepth(uint64_t sequence, const vector<LevelUpdate>& levels, const string& symbol,
+                  StreamChannel& channel) {
+    if (channel.subscribers.load(std::memory_order_relaxed) == 0) return;
+    thread_local tradeflow::order::BookUpdate update;
+    for (size_t begin = 0; begin < levels.size(); begin += BOOK_LEVELS_PER_MESSAGE) {
+        update.Clear();
+        update.set_symbol(symbol);
+        update.set_sequence(sequence);
+        for (size_t i = begin; i < min(levels.size(), begin + BOOK_LEVELS_PER_MESSAGE); ++i) {
+            auto* entry = levels[i].is_buy ? update.add_bids() : update.add_asks();
+            entry->set_price(priceToDouble(levels[i].price));
+            entry->set_quantity(levels[i].quantity);
+        }
+        size_t size = update.ByteSizeLong();
+        bool published = channel.ring.publish(size, [&](char* slot) {
+            update.SerializeWithCachedSizesToArray(reinterpret_cast<uint8_t*>(slot));
+        });
+        if (!published) {
+            TF_LOG_WARN("[book] {} byte update for {} does not fit the book ring slot", size, symbol);
+            continue;
+        }
+        metrics_book_updates_published.inc();
+    }
+    notifyStreams(channel);
+}
+
+// A stream that fell more than a ring behind: the trades in between are
+// gone. Applies TRADEFLOW_SLOW_SUBSCRIBER; returns false with `status` set
+// when the stream must end, otherwise moves `next` to where it resumes.
+bool resumeLappedStream(StreamChannel& channel, uint64_t& next, Status& status) {
+    if (engine_config_.slow_subscriber == SlowSubscriberPolicy::DISCONNECT) {
+        metrics_slow_subscriber_disconnects.inc();
+        status = Status(grpc::StatusCode::RESOURCE_EXHAUSTED,
+                        "Subscriber fell more than " + to_string(channel.ring.capacity()) + " trades behind");
+        return false;
+    }
+    uint64_t resume = channel.ring.head() + 1;
+    if (engine_config_.slow_subscriber == SlowSubscriberPolicy::LAG) {
+        // A quarter ring in from the oldest trade, so the stream is not
+        // lapped again straight away
+        resume = max(next, channel.ring.oldest() + channel.ring.capacity() / 4);
+    }
+    metrics_trade_updates_skipped.inc(resume - next);
+    next = resume;
+    return true;
+}
+
+class OrderEntrySession;
+
+// Resting orders entered on an OrderEntryStream, by id, so the book's trade
+// callback can send their fills back on that stream. Striped by id like
+// OrderRouter; the trade and close callbacks skip it while no stream is open.
+class FillRoutes {
+public:
+    struct Route {
+        OrderEntrySession* session;
+        uint64_t client_sequence;  // of the command that entered the order
+    };
+
+    bool active() const { return sessions_.load(std::memory_order_acquire) > 0; }
+    void openSession() { sessions_.fetch_add(1, std::memory_order_acq_rel); }
+    // Drops every route to session; once this returns no fill reaches it
+    void closeSession(OrderEntrySession* session) {
+        for (Stripe& stripe : stripes_) {
+            lock_guard<mutex> lock(stripe.m);
+            erase_if(stripe.routes, [&](const auto& entry) { return entry.second.session == session; });
+        }
+        sessions_.fetch_sub(1, std::memory_order_acq_rel);
+    }
+
+    void add(OrderId id, const Route& route) {
+        Stripe& stripe = stripeFor(id);
+        lock_guard<mutex> lock(stripe.m);
+        stripe.routes[id] = route;
+    }
+    void remove(OrderId id) {
+        Stripe& stripe = stripeFor(id);
+        lock_guard<mutex> lock(stripe.m);
+        stripe.routes.erase(id);
+    }
+    // deliver(route) runs under the stripe lock, so the session cannot close meanwhile
+    template <typename Deliver>
+    void visit(OrderId id, Deliver&& deliver) {
+        Stripe& stripe = stripeFor(id);
+        lock_guard<mutex> lock(stripe.m);
+        auto it = stripe.routes.find(id);
+        if (it != stripe.routes.end()) deliver(it->second);
+    }
+
+private:
+    static constexpr size_t STRIPES = 16;
+    struct alignas(64) Stripe {
+        mutex m;
+        unordered_map<OrderId, Route> routes;
+    };
+
+    Stripe& stripeFor(OrderId id) { return stripes_[id % STRIPES]; }
+
+    Stripe stripes_[STRIPES];
+    std::atomic<int> sessions_{0};
+};
+
+FillRoutes fill_routes_;
+
+void routeFills(const Trade& trade, const string& symbol);
+
+vector<OrderBook*> listOrderBooks() {
+    vector<OrderBook*> books;
+    if (shards_.empty()) {
+        lock_guard<mutex> lock(order_books_mutex_);
+        for (const auto& pair : order_books_) books.push_back(pair.second.get());
+    } else {
+        for (const auto& shard : shards_) {
+            shard->forEachBook([&](const string&, OrderBook& book) { books.push_back(&book); });
+        }
+    }
+    return books;
+}
 
-    lock_guard<mutex> lock(subscribers_mutex_);
-    auto it = trade_subscribers_.find(trade.symbol);
-    if (it != trade_subscribers_.end()) {
-        for (auto& sub : it->second) {
-            lock_guard<mutex> lk(sub->m);
-            sub->q.push_back(update);
-            sub->cv.notify_one();
+void AppendShardMetrics(std::ostringstream& oss) {
+    oss << "# HELP tradeflow_shard_commands_total Commands applied by the shard's sequencer" << '\n';
+    oss << "# TYPE tradeflow_shard_commands_total counter" << '\n';
+    oss << "# HELP tradeflow_shard_busy_seconds_total Time the shard's sequencer spent applying commands" << '\n';
+    oss << "# TYPE tradeflow_shard_busy_seconds_total counter" << '\n';
+    oss << "# HELP tradeflow_shard_queue_depth Commands waiting in the shard's ring" << '\n';
+    oss << "# TYPE tradeflow_shard_queue_depth gauge" << '\n';
+    oss << "# HELP tradeflow_shard_symbols Order books owned by the shard" << '\n';
+    oss << "# TYPE tradeflow_shard_symbols gauge" << '\n';
+    for (const auto& shard : shards_) {
+        const Sequencer& sequencer = shard->sequencer();
+        std::string labels = "{shard=\"" + to_string(shard->index()) + "\",cpu=\"" + to_string(sequencer.cpu()) + "\"}";
+        oss << "tradeflow_shard_commands_total" << labels << ' ' << sequencer.commandsProcessed() << '\n';
+        oss << "tradeflow_shard_busy_seconds_total" << labels << ' ' << sequencer.busyNanos() / 1e9 << '\n';
+        oss << "tradeflow_shard_queue_depth" << labels << ' ' << sequencer.pendingCommands() << '\n';
+        oss << "tradeflow_shard_symbols" << labels << ' ' << shard->bookCount() << '\n';
+    }
+}
+
+void AppendJournalMetrics(std::ostringstream& oss) {
+    vector<const TradeJournal*> journals;
+    if (trade_journal_) journals.push_back(trade_journal_.get());
+    for (const auto& shard : shards_) {
+        if (shard->journal()) journals.push_back(shard->journal());
+    }
+    if (journals.empty()) return;
+    oss << "# HELP tradeflow_trade_journal_records_total Trade records written (and synced, per policy) to the journal" << '\n';
+    oss << "# TYPE tradeflow_trade_journal_records_total counter" << '\n';
+    oss << "# HELP tradeflow_trade_journal_writes_total Batched write() calls issued by the journal writer" << '\n';
+    oss << "# TYPE tradeflow_trade_journal_writes_total counter" << '\n';
+    oss << "# HELP tradeflow_trade_journal_syncs_total fdatasync calls issued by the journal writer" << '\n';
+    oss << "# TYPE tradeflow_trade_journal_syncs_total counter" << '\n';
+    oss << "# HELP tradeflow_trade_journal_ring_full_total Appends that waited because the journal ring was full" << '\n';
+    oss << "# TYPE tradeflow_trade_journal_ring_full_total counter" << '\n';
+    oss << "# HELP tradeflow_trade_journal_write_errors_total Journal batches lost to a failed write() or sync" << '\n';
+    oss << "# TYPE tradeflow_trade_journal_write_errors_total counter" << '\n';
+    for (const TradeJournal* journal : journals) {
+        JournalStats stats = journal->stats();
+        std::string labels = "{path=\"" + journal->path() + "\"}";
+        oss << "tradeflow_trade_journal_records_total" << labels << ' ' << stats.records_written << '\n';
+        oss << "tradeflow_trade_journal_writes_total" << labels << ' ' << stats.writes << '\n';
+        oss << "tradeflow_trade_journal_syncs_total" << labels << ' ' << stats.syncs << '\n';
+        oss << "tradeflow_trade_journal_ring_full_total" << labels << ' ' << stats.ring_full_waits << '\n';
+        oss << "tradeflow_trade_journal_write_errors_total" << labels << ' ' << stats.write_errors << '\n';
+    }
+}
+
+void AppendStateMetrics(std::ostringstream& oss) {
+    if (!command_log_) return;
+    JournalStats wal = command_log_->stats();
+    oss << "# HELP tradeflow_command_log_records_total Commands written (and synced, per policy) to the write-ahead log" << '\n';
+    oss << "# TYPE tradeflow_command_log_records_total counter" << '\n';
+    oss << "tradeflow_command_log_records_total " << wal.records_written << '\n';
+    oss << "# HELP tradeflow_command_log_syncs_total fdatasync calls issued by the command log writer" << '\n';
+    oss << "# TYPE tradeflow_command_log_syncs_total counter" << '\n';
+    oss << "tradeflow_command_log_syncs_total " << wal.syncs << '\n';
+    oss << "# HELP tradeflow_command_log_ring_full_total Commands that waited because the command log ring was full" << '\n';
+    oss << "# TYPE tradeflow_command_log_ring_full_total counter" << '\n';
+    oss << "tradeflow_command_log_ring_full_total " << wal.ring_full_waits << '\n';
+    oss << "# HELP tradeflow_command_log_write_errors_total Command log batches lost to a failed write() or sync" << '\n';
+    oss << "# TYPE tradeflow_command_log_write_errors_total counter" << '\n';
+    oss << "tradeflow_command_log_write_errors_total " << wal.write_errors << '\n';
+    oss << "# HELP tradeflow_snapshots_total Book snapshots written" << '\n';
+    oss << "# TYPE tradeflow_snapshots_total counter" << '\n';
+    oss << "tradeflow_snapshots_total " << metrics_snapshots.load() << '\n';
+    oss << "# HELP tradeflow_snapshot_failures_total Book snapshots that failed" << '\n';
+    oss << "# TYPE tradeflow_snapshot_failures_total counter" << '\n';
+    oss << "tradeflow_snapshot_failures_total " << metrics_snapshot_failures.load() << '\n';
+    oss << "# HELP tradeflow_snapshot_last_duration_seconds Time taken by the last snapshot" << '\n';
+    oss << "# TYPE tradeflow_snapshot_last_duration_seconds gauge" << '\n';
+    oss << "tradeflow_snapshot_last_duration_seconds " << metrics_snapshot_last_seconds.load() << '\n';
+    oss << "# HELP tradeflow_snapshot_last_orders Resting orders in the last snapshot" << '\n';
+    oss << "# TYPE tradeflow_snapshot_last_orders gauge" << '\n';
+    oss << "tradeflow_snapshot_last_orders " << metrics_snapshot_last_orders.load() << '\n';
+}
+
+void AppendLatencyMetrics(std::ostringstream& oss) {
+    if (!engine_config_.latency_histograms) return;
+    oss << "# HELP tradeflow_rpc_latency_seconds RPC handler latency by stage (total = whole handler)" << '\n';
+    oss << "# TYPE tradeflow_rpc_latency_seconds histogram" << '\n';
+    for (RpcLatency* latency : {&submit_latency_, &cancel_latency_, &modify_latency_, &get_orderbook_latency_,
+                                &submit_batch_latency_, &entry_stream_latency_, &uncross_latency_}) {
+        const pair<const char*, const LatencyHistogram*> stages[] = {
+            {"total", &latency->total},     {"lock_wait", &latency->lock_wait}, {"book", &latency->book},
+            {"publish", &latency->publish}, {"durable", &latency->durable}};
+        for (const auto& stage : stages) {
+            HistogramSnapshot snapshot = stage.second->snapshot();
+            // Stages an RPC never passes through (GetOrderBook has no durable wait) stay unexported
+            if (snapshot.count == 0 && string(stage.first) != "total") continue;
+            std::string labels = std::string("rpc=\"") + latency->rpc + "\",stage=\"" + stage.first + "\"";
+            writePrometheusHistogram(oss, "tradeflow_rpc_latency_seconds", labels, snapshot);
+        }
+    }
+}
+
+void AppendOrderBookMetrics(std::ostringstream& oss) {
+    AppendLatencyMetrics(oss);
+    if (!shards_.empty()) AppendShardMetrics(oss);
+    AppendJournalMetrics(oss);
+    AppendStateMetrics(oss);
+
+    // Snapshot the book list first; stats are then read per book from what
+    // it published, outside the registry locks.
+    vector<OrderBook*> books = listOrderBooks();
+    if (books.empty()) return;
+
+    oss << "# HELP tradeflow_order_book_order_pool_in_use Order objects currently resting in the book's pool" << '\n';
+    oss << "# TYPE tradeflow_order_book_order_pool_in_use gauge" << '\n';
+    oss << "# HELP tradeflow_order_book_order_pool_high_water Peak Order objects handed out by the book's pool" << '\n';
+    oss << "# TYPE tradeflow_order_book_order_pool_high_water gauge" << '\n';
+    oss << "# HELP tradeflow_order_book_order_pool_capacity Order objects backed by the book's pool slabs" << '\n';
+    oss << "# TYPE tradeflow_order_book_order_pool_capacity gauge" << '\n';
+    oss << "# HELP tradeflow_order_book_level_pool_high_water Peak PriceLevel objects handed out by the book's pool" << '\n';
+    oss << "# TYPE tradeflow_order_book_level_pool_high_water gauge" << '\n';
+    oss << "# HELP tradeflow_order_book_best_bid Best bid price (absent while the side is empty)" << '\n';
+    oss << "# TYPE tradeflow_order_book_best_bid gauge" << '\n';
+    oss << "# HELP tradeflow_order_book_best_ask Best ask price (absent while the side is empty)" << '\n';
+    oss << "# TYPE tradeflow_order_book_best_ask gauge" << '\n';
+    oss << "# HELP tradeflow_order_book_indicative_price Call auction: price an uncross would trade at now" << '\n';
+    oss << "# TYPE tradeflow_order_book_indicative_price gauge" << '\n';
+    oss << "# HELP tradeflow_order_book_indicative_volume Call auction: quantity an uncross would trade now" << '\n';
+    oss << "# TYPE tradeflow_order_book_indicative_volume gauge" << '\n';
+    oss << "# HELP tradeflow_order_book_indicative_imbalance Call auction: bid minus ask quantity at that price" << '\n';
+    oss << "# TYPE tradeflow_order_book_indicative_imbalance gauge" << '\n';
+    // Books past TRADEFLOW_METRICS_MAX_SYMBOLS follow the symbol_* families:
+    // their pool gauges are summed under symbol="other" and their prices,
+    // which do not add up, are left out
+    PoolStats other_orders{};
+    PoolStats other_levels{};
+    bool any_other = false;
+    for (OrderBook* book : books) {
+        // Published by the book like its top of book: a scrape takes no book
+        // lock and sends nothing through the shards
+        PoolStats orders = book->publishedOrderPoolStats();
+        PoolStats levels = book->publishedLevelPoolStats();
+        if (!metrics_symbol_trades.hasOwnSeries(book->getSymbol())) {
+            other_orders.in_use += orders.in_use;
+            other_orders.high_water += orders.high_water;
+            other_orders.capacity += orders.capacity;
+            other_levels.high_water += levels.high_water;
+            any_other = true;
+            continue;
+        }
+        // Symbols come from clients, so may hold quotes or backslashes
+        const string symbol = escapeLabel(book->getSymbol());
+        oss << "tradeflow_order_book_order_pool_in_use{symbol=\"" << symbol << "\"} " << orders.in_use << '\n';
+        oss << "tradeflow_order_book_order_pool_high_water{symbol=\"" << symbol << "\"} " << orders.high_water << '\n';
+        oss << "tradeflow_order_book_order_pool_capacity{symbol=\"" << symbol << "\"} " << orders.capacity << '\n';
+        oss << "tradeflow_order_book_level_pool_high_water{symbol=\"" << symbol << "\"} " << levels.high_water << '\n';
+        // From the published levels, without the book lock or the shard
+        TopOfBook top = book->topOfBook();
+        if (top.bid_quantity > 0) {
+            oss << "tradeflow_order_book_best_bid{symbol=\"" << symbol << "\"} " << priceToDouble(top.bid_price) << '\n';
+        }
+        if (top.ask_quantity > 0) {
+            oss << "tradeflow_order_book_best_ask{symbol=\"" << symbol << "\"} " << priceToDouble(top.ask_price) << '\n';
+        }
+        if (book->getMatchingMode() == MatchingMode::CALL_AUCTION) {
+            AuctionResult auction = book->indicativeAuction();
+            oss << "tradeflow_order_book_indicative_volume{symbol=\"" << symbol << "\"} " << auction.volume << '\n';
+            if (auction.volume > 0) {
+                oss << "tradeflow_order_book_indicative_price{symbol=\"" << symbol << "\"} "
+                    << priceToDouble(auction.price) << '\n';
+                oss << "tradeflow_order_book_indicative_imbalance{symbol=\"" << symbol << "\"} " << auction.imbalance
+                    << '\n';
+            }
         }
     }
+    if (any_other) {
+        oss << "tradeflow_order_book_order_pool_in_use{symbol=\"other\"} " << other_orders.in_use << '\n';
+        oss << "tradeflow_order_book_order_pool_high_water{symbol=\"other\"} " << other_orders.high_water << '\n';
+        oss << "tradeflow_order_book_order_pool_capacity{symbol=\"other\"} " << other_orders.capacity << '\n';
+        oss << "tradeflow_order_book_level_pool_high_water{symbol=\"other\"} " << other_levels.high_water << '\n';
+    }
+}
+
+// Forgets where an order lives: when it closes, or when its submit never reached the book
+void unrouteOrder(OrderId id) {
+    order_router_->remove(id);
+    if (fill_routes_.active()) fill_routes_.remove(id);
 }
 
-OrderBook& getOrderBook(const string& symbol) {
+// A book with no callbacks, journals or command log: what recovery replays into
+unique_ptr<OrderBook> makeDetachedOrderBook(const string& symbol) {
+    return make_unique<OrderBook>(symbol, engine_config_.matchingModeFor(symbol), engine_config_.bookConfigFor(symbol));
+}
+
+void attachOrderBook(OrderBook& book) {
+    Counter trades = metrics_symbol_trades.labels({book.getSymbol()});
+    Counter traded_quantity = metrics_symbol_traded_quantity.labels({book.getSymbol()});
+    StreamChannel* channel = &tradeChannel(book.getSymbol());
+    const Clock* clock = &book.clock();
+    book.setTradeCallback([trades, traded_quantity, channel, clock, symbol = book.getSymbol()](const Trade& trade) {
+        trades.inc();
+        traded_quantity.inc(static_cast<uint64_t>(trade.quantity));
+        publishTrade(trade, symbol, *clock, *channel);
+        if (fill_routes_.active()) routeFills(trade, symbol);
+    });
+    StreamChannel* book_channel = &bookChannel(book.getSymbol());
+    book.setDepthCallback([book_channel, symbol = book.getSymbol()](uint64_t sequence, const vector<LevelUpdate>& levels) {
+        publishDepth(sequence, levels, symbol, *book_channel);
+    });
+    book.setOrderClosedCallback([](OrderId id) { unrouteOrder(id); });
+    book.setTradeJournal(journalFor(book.getSymbol()));
+    book.setCommandLog(command_log_.get());
+}
+
+unique_ptr<OrderBook> makeOrderBook(const string& symbol) {
+    auto book = makeDetachedOrderBook(symbol);
+    attachOrderBook(*book);
+    return book;
+}
+
+OrderBook& getOrderBook(const string& symbol, const Shard::BookFactory& factory = makeOrderBook) {
+    if (Shard* shard = shardFor(symbol)) {
+        return shard->getOrCreateBook(symbol, factory);
+    }
     lock_guard<mutex> lock(order_books_mutex_);
     if (order_books_.find(symbol) == order_books_.end()) {
-        order_books_[symbol] = make_unique<OrderBook>(symbol, MatchingMode::PRICE_TIME_PRIORITY);
-        matchers_[symbol] = make_unique<Matcher>();
-        order_books_[symbol]->setTradeCallback([&](const Trade& trade) { publishTrade(trade); });
-        order_books_[symbol]->setTradeLog(make_unique<TradeLog>(symbol + "_trades.log"));
+        order_books_[symbol] = factory(symbol);
     }
     return *order_books_[symbol];
 }
 
+// Rotate the command log, copy every book (under its lock, or on its shard
+// thread) and write the copies out. Once the snapshot is durable the log
+// segments before the rotation are deleted.
+bool TakeSnapshot() {
+    lock_guard<mutex> lock(snapshot_mutex_);
+    const string& dir = engine_config_.state_dir;
+    auto start = chrono::steady_clock::now();
+    try {
+        uint64_t segment = command_log_->rotate();
+        OrderId next_id;
+        {
+            lock_guard<mutex> id_lock(id_mutex_);
+            next_id = next_order_id_;
+        }
+        vector<BookImage> images;
+        uint64_t orders = 0;
+        for (OrderBook* book : listOrderBooks()) {
+            if (Sequencer* sequencer = sequencerFor(*book)) {
+                sequencer->execute(*book, [&](OrderBook& b) { images.push_back(captureBook(b)); });
+            } else {
+                images.push_back(captureBook(*book));
+            }
+            orders += images.back().bids.size() + images.back().asks.size();
+        }
+        writeSnapshot(snapshotPath(dir, segment), images, next_id);
+        pruneState(dir, segment);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        metrics_snapshots.fetch_add(1, std::memory_order_relaxed);
+        metrics_snapshot_last_seconds.store(seconds, std::memory_order_relaxed);
+        metrics_snapshot_last_orders.store(orders, std::memory_order_relaxed);
+        TF_LOG_INFO("[state] snapshot {} written: {} books, {} orders in {} s", segment, images.size(), orders, seconds);
+        return true;
+    } catch (const exception& e) {
+        metrics_snapshot_failures.fetch_add(1, std::memory_order_relaxed);
+        TF_LOG_ERROR("[state] snapshot failed: {}", e.what());
+        return false;
+    }
+}
+
+void SnapshotLoop() {
+    const auto interval = chrono::seconds(engine_config_.snapshot_interval_s);
+    while (true) {
+        this_thread::sleep_for(interval);
+        TakeSnapshot();
+    }
+}
+
+// Rebuild the books from the state directory, then start logging commands
+// to a fresh segment and write a snapshot so the next restart replays only
+// what happens from here on.
+void RecoverState() {
+    const string& dir = engine_config_.state_dir;
+    RecoveryResult result = recoverState(dir, [](const string& symbol) -> OrderBook& {
+        return getOrderBook(symbol, makeDetachedOrderBook);
+    });
+    next_order_id_ = max(next_order_id_, result.next_order_id);
+    command_log_ = make_unique<CommandLog>(dir, result.next_segment, result.next_sequence, engine_config_.command_log);
+    size_t resting = 0;
+    for (OrderBook* book : listOrderBooks()) {
+        attachOrderBook(*book);
+        book->forEachOrder([&](const Order& order) {
+            order_router_->add(order.id, book);
+            ++resting;
+        });
+    }
+    TF_LOG_INFO("[state] recovered {} resting orders from {} ({} from snapshot {}, {} commands replayed, {} skipped) in {} s",
+                resting, dir, result.snapshot_orders, result.snapshot_segment, result.commands_replayed,
+                result.commands_skipped, result.seconds);
+    if (!TakeSnapshot()) throw runtime_error("Unable to write the initial snapshot to " + dir);
+}
+
+// TRADEFLOW_WAL_ACK=durable: hold the acknowledgement until the command the
+// caller just applied is on disk. Throws once the command log has failed.
+void awaitDurable() {
+    if (command_log_ && engine_config_.wal_durable_ack) command_log_->flush();
+}
+
+bool parseOrderType(const string& value, OrderType& type) {
+    if (value.empty() || value == "LIMIT") type = OrderType::LIMIT;
+    else if (value == "MARKET") type = OrderType::MARKET;
+    else if (value == "IOC") type = OrderType::IOC;
+    else if (value == "FOK") type = OrderType::FOK;
+    else return false;
+    return true;
+}
+
+const char* submitOutcome(SubmitStatus status) {
+    switch (status) {
+        case SubmitStatus::RESTING: return "resting";
+        case SubmitStatus::PARTIALLY_FILLED: return "partially_filled";
+        case SubmitStatus::FILLED: return "filled";
+        case SubmitStatus::CANCELLED: return "cancelled";
+        case SubmitStatus::REJECTED: return "rejected";
+    }
+    return "unknown";
+}
+
 OrderId getNextOrderId() {
     lock_guard<mutex> lock(id_mutex_);
     return next_order_id_++;
 }
 
-class OrderServiceImpl final : public tradeflow::order::OrderService::Service {
+// Symbols and client ids are recorded in fixed-width fields (see
+// MAX_SYMBOL_LENGTH), so a longer one could not be recovered as itself.
+// Every RPC that names a symbol checks it before a book or channel is made.
+const char* symbolProblem(const string& symbol) {
+    static const string too_long = "Symbol must be at most " + to_string(MAX_SYMBOL_LENGTH) + " bytes";
+    if (symbol.empty()) return "Symbol is required";
+    if (symbol.size() > MAX_SYMBOL_LENGTH) return too_long.c_str();
+    return nullptr;
+}
+
+// Request checks shared by every submit path. A rejected order gets its
+// response filled in here and false is returned.
+bool validateSubmit(const tradeflow::order::SubmitOrderRequest& request, OrderType& type,
+                    tradeflow::order::SubmitOrderResponse& response) {
+    static const string client_id_too_long = "Client id must be at most " + to_string(MAX_CLIENT_ID_LENGTH) + " bytes";
+    const char* problem = nullptr;
+    if (request.quantity() <= 0) problem = "Quantity must be positive";
+    else if (!parseOrderType(request.type(), type)) problem = "Type must be LIMIT, MARKET, IOC or FOK";
+    else if (type != OrderType::MARKET && request.price() <= 0) problem = "Price must be positive";
+    else if (request.side() != "BUY" && request.side() != "SELL") problem = "Side must be BUY or SELL";
+    else if (const char* symbol_problem = symbolProblem(request.symbol())) problem = symbol_problem;
+    else if (request.client_id().size() > MAX_CLIENT_ID_LENGTH) problem = client_id_too_long.c_str();
+    if (!problem) return true;
+    response.set_status("REJECTED");
+    response.set_message(problem);
+    metrics_submit_rejected.inc();
+    return false;
+}
+
+// What the book did with a validated order
+void describeSubmit(const string& symbol, OrderId order_id, OrderType type, const SubmitResult& result,
+                    tradeflow::order::SubmitOrderResponse& response) {
+    metrics_symbol_submits.labels({symbol, submitOutcome(result.status)}).inc();
+    response.set_order_id(to_string(order_id));
+    response.set_filled_quantity(result.filled_quantity);
+    switch (result.status) {
+        case SubmitStatus::RESTING:
+            response.set_status("ACCEPTED");
+            response.set_message("Order submitted successfully");
+            response.set_resting_quantity(result.remaining_quantity);
+            break;
+        case SubmitStatus::PARTIALLY_FILLED:
+            response.set_status("ACCEPTED");
+            response.set_message("Order partially filled; remainder resting");
+            response.set_resting_quantity(result.remaining_quantity);
+            break;
+        case SubmitStatus::FILLED:
+            response.set_status("ACCEPTED");
+            response.set_message("Order filled");
+            break;
+        case SubmitStatus::CANCELLED:
+            response.set_status("ACCEPTED");
+            response.set_message("Unfilled quantity cancelled");
+            break;
+        case SubmitStatus::REJECTED:
+            response.set_status("REJECTED");
+            response.set_message(type == OrderType::FOK ? "FOK order could not be filled in full"
+                                                        : "Order rejected by the book");
+            metrics_submit_rejected.inc();
+            return;
+    }
+    metrics_submit_accepted.inc();
+}
+
+void describeCancel(bool found, tradeflow::order::CancelOrderResponse& response) {
+    if (found) {
+        response.set_status("CANCELLED");
+        response.set_message("Order cancelled successfully");
+        metrics_cancel_success.inc();
+    } else {
+        response.set_status("NOT_FOUND");
+        response.set_message("Order not found");
+        metrics_cancel_not_found.inc();
+    }
+}
+
+void describeAuction(const AuctionResult& auction, tradeflow::order::AuctionState& state) {
+    state.set_price(auction.volume > 0 ? priceToDouble(auction.price) : 0.0);
+    state.set_volume(auction.volume);
+    state.set_imbalance(auction.imbalance);
+}
+
+// Modify checks shared by every modify path, with the messages
+// validateSubmit uses. A rejected modify gets its response filled in here
+// and false is returned.
+bool validateModify(const tradeflow::order::ModifyOrderRequest& request,
+                    tradeflow::order::ModifyOrderResponse& response) {
+    const char* problem = nullptr;
+    if (request.new_quantity() <= 0) problem = "Quantity must be positive";
+    // On the rounded price, so a sub-tick price cannot reach the book as 0
+    else if (doubleToPrice(request.new_price()) <= 0) problem = "Price must be positive";
+    if (!problem) return true;
+    response.set_status("REJECTED");
+    response.set_message(problem);
+    metrics_modify_rejected.inc();
+    return false;
+}
+
+void describeModify(bool found, tradeflow::order::ModifyOrderResponse& response) {
+    if (found) {
+        response.set_status("MODIFIED");
+        response.set_message("Order modified successfully");
+        metrics_modify_success.inc();
+    } else {
+        response.set_status("NOT_FOUND");
+        response.set_message("Order not found");
+        metrics_modify_not_found.inc();
+    }
+}
+
+// The commands of one SubmitOrders or OrderEntryStream request. add*()
+// validate and route each command, answering rejects straight away; apply()
+// then runs each book's share in request order with a single acquisition of
+// the book (one write lock, or one sequencer round trip) and answers the
+// rest. The requests and responses must outlive apply().
+class EntryBatch {
 public:
-    Status SubmitOrder(ServerContext* context, const tradeflow::order::SubmitOrderRequest* request,
-                       tradeflow::order::SubmitOrderResponse* response) override {
-        metrics_submit_requests.fetch_add(1, std::memory_order_relaxed);
+    // session: an OrderEntryStream that wants the order's later fills
+    void addSubmit(const tradeflow::order::SubmitOrderRequest& request, tradeflow::order::SubmitOrderResponse* response,
+                   OrderEntrySession* session = nullptr, uint64_t client_sequence = 0) {
+        metrics_submit_requests.inc();
+        OrderId order_id = 0;
         try {
-            if (request->quantity() <= 0) {
-                response->set_status("REJECTED");
-                response->set_message("Quantity must be positive");
-                metrics_submit_rejected.fetch_add(1, std::memory_order_relaxed);
-                return Status::OK;
+            OrderType type;
+            if (!validateSubmit(request, type, *response)) return;
+            order_id = getNextOrderId();
+            OrderBook& book = getOrderBook(request.symbol());
+            // Routed before the order can rest or fill, as in SubmitOrder
+            order_router_->add(order_id, &book);
+            if (session) fill_routes_.add(order_id, {session, client_sequence});
+            Entry entry;
+            entry.command.id = order_id;
+            entry.command.is_buy = request.side() == "BUY";
+            entry.command.type = type;
+            entry.command.quantity = request.quantity();
+            entry.command.price = doubleToPrice(request.price());
+            entry.command.client_id = request.client_id();
+            entry.symbol = &request.symbol();
+            entry.submit = response;
+            push(book, entry);
+        } catch (const exception& e) {
+            if (order_id) unrouteOrder(order_id);
+            response->set_status("REJECTED");
+            response->set_message(string("Error: ") + e.what());
+            metrics_submit_errors.inc();
+        }
+    }
+
+    void addCancel(const tradeflow::order::CancelOrderRequest& request, tradeflow::order::CancelOrderResponse* response) {
+        metrics_cancel_requests.inc();
+        try {
+            Entry entry;
+            entry.command.kind = BookCommand::Kind::CANCEL;
+            entry.command.id = stoll(request.order_id());
+            entry.cancel = response;
+            OrderBook* book = order_router_->find(entry.command.id);
+            if (!book) {
+                describeCancel(false, *response);
+                return;
             }
-            if (request->price() <= 0) {
-                response->set_status("REJECTED");
-                response->set_message("Price must be positive");
-                metrics_submit_rejected.fetch_add(1, std::memory_order_relaxed);
-                return Status::OK;
+            push(*book, entry);
+        } catch (const exception& e) {
+            response->set_status("ERROR");
+            response->set_message(string("Error: ") + e.what());
+            metrics_cancel_errors.inc();
+        }
+    }
+
+    void addModify(const tradeflow::order::ModifyOrderRequest& request, tradeflow::order::ModifyOrderResponse* response) {
+        metrics_modify_requests.inc();
+        try {
+            // Rejected here so one bad modify cannot fail its book's share
+            if (!validateModify(request, *response)) return;
+            Entry entry;
+            entry.command.kind = BookCommand::Kind::MODIFY;
+            entry.command.id = stoll(request.order_id());
+            entry.command.quantity = request.new_quantity();
+            entry.command.price = doubleToPrice(request.new_price());
+            entry.modify = response;
+            OrderBook* book = order_router_->find(entry.command.id);
+            if (!book) {
+                describeModify(false, *response);
+                return;
             }
-            if (request->side() != "BUY" && request->side() != "SELL") {
-                response->set_status("REJECTED");
-                response->set_message("Side must be BUY or SELL");
-                metrics_submit_rejected.fetch_add(1, std::memory_order_relaxed);
-                return Status::OK;
+            push(*book, entry);
+        } catch (const exception& e) {
+            response->set_status("ERROR");
+            response->set_message(string("Error: ") + e.what());
+            metrics_modify_errors.inc();
+        }
+    }
+
+    void apply(RpcTimer& timer) {
+        timer.beginBook();
+        for (Share& share : shares_) {
+            try {
+                if (Sequencer* sequencer = sequencerFor(*share.book)) {
+                    sequencer->batch(*share.book, share.commands, share.results);
+                } else {
+                    share.book->applyBatch(share.commands, share.results);
+                }
+            } catch (const exception& e) {
+                share.error = e.what();
+                // Submits the book never took have no order to close their routes
+                for (size_t i = 0; i < share.commands.size(); ++i) {
+                    const BookCommand& command = share.commands[i];
+                    bool applied = i < share.results.size() && share.results[i].applied;
+                    if (command.kind == BookCommand::Kind::SUBMIT && !applied) unrouteOrder(command.id);
+                }
             }
-            if (request->symbol().empty()) {
-                response->set_status("REJECTED");
-                response->set_message("Symbol is required");
-                metrics_submit_rejected.fetch_add(1, std::memory_order_relaxed);
-                return Status::OK;
+        }
+        timer.endBook();
+        try {
+            if (!shares_.empty()) awaitDurable();
+        } catch (const exception& e) {
+            // Applied but not durable: nothing in the batch may be acknowledged
+            for (Share& share : shares_) {
+                if (share.error.empty()) share.error = e.what();
+            }
+        }
+        timer.endDurable();
+
+        for (Share& share : shares_) {
+            for (size_t i = 0; i < share.entries.size(); ++i) {
+                const Entry& entry = share.entries[i];
+                if (!share.error.empty()) {
+                    fail(entry, share.error);
+                    continue;
+                }
+                const BookCommandResult& result = share.results[i];
+                if (entry.submit) describeSubmit(*entry.symbol, entry.command.id, entry.command.type, result.submit, *entry.submit);
+                if (entry.cancel) describeCancel(result.found, *entry.cancel);
+                if (entry.modify) describeModify(result.found, *entry.modify);
             }
+        }
+    }
 
-            bool is_buy = (request->side() == "BUY");
-            OrderId order_id = getNextOrderId();
-            Price price = doubleToPrice(request->price());
-            OrderBook& order_book = getOrderBook(request->symbol());
-            order_book.addOrder(order_id, is_buy, request->quantity(), price, request->client_id());
+private:
+    struct Entry {
+        BookCommand command;
+        const string* symbol = nullptr;  // SUBMIT
+        tradeflow::order::SubmitOrderResponse* submit = nullptr;
+        tradeflow::order::CancelOrderResponse* cancel = nullptr;
+        tradeflow::order::ModifyOrderResponse* modify = nullptr;
+    };
+    // One book's commands, in request order
+    struct Share {
+        OrderBook* book;
+        vector<BookCommand> commands;
+        vector<Entry> entries;
+        vector<BookCommandResult> results;
+        string error;  // the book call threw
+    };
+
+    void push(OrderBook& book, const Entry& entry) {
+        // Batches touch few books, so a scan beats hashing
+        auto share = find_if(shares_.begin(), shares_.end(), [&](const Share& s) { return s.book == &book; });
+        if (share == shares_.end()) {
+            shares_.push_back(Share{&book, {}, {}, {}, {}});
+            share = shares_.end() - 1;
+        }
+        share->commands.push_back(entry.command);
+        share->entries.push_back(entry);
+    }
+
+    static void fail(const Entry& entry, const string& error) {
+        if (entry.submit) {
+            entry.submit->set_status("REJECTED");
+            entry.submit->set_message("Error: " + error);
+            metrics_submit_errors.inc();
+        }
+        if (entry.cancel) {
+            entry.cancel->set_status("ERROR");
+            entry.cancel->set_message("Error: " + error);
+            metrics_cancel_errors.inc();
+        }
+        if (entry.modify) {
+            entry.modify->set_status("ERROR");
+            entry.modify->set_message("Error: " + error);
+            metrics_modify_errors.inc();
+        }
+    }
+
+    vector<Share> shares_;
+};
+
+// One OrderEntryStream, for the sync and async servers alike. apply() runs a
+// request on the stream's thread and queues one ack per command; fills of
+// the stream's orders are queued from whichever thread executes the trade
+// (so an order's fills on arrival come before its ack; both carry the
+// submit's client_sequence). wake() tells the stream's writer to take().
+class OrderEntrySession {
+public:
+    explicit OrderEntrySession(function<void()> wake) : wake_(move(wake)) {
+        fill_routes_.openSession();
+        metrics_active_entry_streams.inc();
+    }
+    ~OrderEntrySession() {
+        fill_routes_.closeSession(this);
+        metrics_active_entry_streams.dec();
+    }
+    OrderEntrySession(const OrderEntrySession&) = delete;
+    OrderEntrySession& operator=(const OrderEntrySession&) = delete;
+
+    void apply(const tradeflow::order::OrderEntryRequest& request) {
+        using tradeflow::order::OrderEntryCommand;
+        metrics_entry_requests.inc();
+        RpcTimer timer(entry_stream_latency_);
+        vector<tradeflow::order::OrderEntryResponse> acks(request.commands_size());
+        EntryBatch batch;
+        for (int i = 0; i < request.commands_size(); ++i) {
+            const OrderEntryCommand& command = request.commands(i);
+            auto& ack = acks[i];
+            ack.set_client_sequence(command.client_sequence());
+            switch (command.command_case()) {
+                case OrderEntryCommand::kSubmit:
+                    batch.addSubmit(command.submit(), ack.mutable_submit(), this, command.client_sequence());
+                    break;
+                case OrderEntryCommand::kCancel:
+                    batch.addCancel(command.cancel(), ack.mutable_cancel());
+                    break;
+                case OrderEntryCommand::kModify:
+                    batch.addModify(command.modify(), ack.mutable_modify());
+                    break;
+                case OrderEntryCommand::COMMAND_NOT_SET:
+                    ack.mutable_submit()->set_status("REJECTED");
+                    ack.mutable_submit()->set_message("Command is empty");
+                    break;
+            }
+        }
+        batch.apply(timer);
+        {
+            lock_guard<mutex> lock(mutex_);
+            for (auto& ack : acks) outbox_.push_back(move(ack));
+        }
+        wake_();
+    }
+
+    // Trade thread, under the book's lock or on its sequencer
+    void fill(const Trade& trade, const string& symbol, OrderId own, OrderId counterparty, uint64_t client_sequence) {
+        tradeflow::order::OrderEntryResponse response;
+        response.set_client_sequence(client_sequence);
+        auto* fill = response.mutable_fill();
+        fill->set_order_id(to_string(own));
+        fill->set_client_sequence(client_sequence);
+        fill->set_price(priceToDouble(trade.price));
+        fill->set_quantity(trade.quantity);
+        fill->set_symbol(symbol);
+        fill->set_counterparty_order_id(to_string(counterparty));
+        fill->set_trade_sequence(trade.sequence);
+        {
+            lock_guard<mutex> lock(mutex_);
+            outbox_.push_back(move(response));
+        }
+        metrics_entry_fills.inc();
+        wake_();
+    }
+
+    // Moves everything queued so far to out; false when there was nothing
+    bool take(vector<tradeflow::order::OrderEntryResponse>& out) {
+        lock_guard<mutex> lock(mutex_);
+        if (outbox_.empty()) return false;
+        out.swap(outbox_);
+        outbox_.clear();
+        return true;
+    }
+
+private:
+    function<void()> wake_;
+    mutex mutex_;
+    vector<tradeflow::order::OrderEntryResponse> outbox_;
+};
+
+void routeFills(const Trade& trade, const string& symbol) {
+    fill_routes_.visit(trade.buy_order_id, [&](const FillRoutes::Route& route) {
+        route.session->fill(trade, symbol, trade.buy_order_id, trade.sell_order_id, route.client_sequence);
+    });
+    fill_routes_.visit(trade.sell_order_id, [&](const FillRoutes::Route& route) {
+        route.session->fill(trade, symbol, trade.sell_order_id, trade.buy_order_id, route.client_sequence);
+    });
+}
+
+// One SubscribeBook stream's side of its symbol's book channel, shared by
+// the sync and async servers. Produces serialised BookUpdates: a snapshot
+// first, then the channel's changes. Plain streams (no depth limit, no
+// conflation) forward the ring's bytes as published; the others run changes
+// through a DepthView and send its flushes. A stream lapped by the ring has
+// lost changes, so it starts over with a fresh snapshot.
+class BookFeed {
+public:
+    enum class Next {
+        READY,  // a message is in out
+        IDLE    // nothing to send; poll again once the ring moves or `wait` passes
+    };
+
+    BookFeed(const string& symbol, uint32_t depth, uint32_t conflation_ms)
+        : symbol_(symbol), book_(getOrderBook(symbol)), channel_(bookChannel(symbol)),
+          conflation_(conflation_ms), filtered_(depth > 0 || conflation_ms > 0), view_(depth) {
+        channel_.subscribers.fetch_add(1, std::memory_order_relaxed);
+        metrics_active_book_subscriptions.inc();
+    }
+
+    ~BookFeed() {
+        channel_.subscribers.fetch_sub(1, std::memory_order_relaxed);
+        metrics_active_book_subscriptions.dec();
+    }
+
+    BookFeed(const BookFeed&) = delete;
+    BookFeed& operator=(const BookFeed&) = delete;
+
+    StreamChannel& channel() { return channel_; }
+    // Ring message the feed reads next
+    uint64_t cursor() const { return next_; }
+
+    // wait is only lowered, to when a conflated flush is due
+    Next next(string& out, chrono::milliseconds& wait) {
+        if (!snapshot_sent_) {
+            snapshot(out);
+            return Next::READY;
+        }
+        while (true) {
+            BroadcastRing::ReadStatus read = channel_.ring.read(next_, bytes_);
+            if (read == BroadcastRing::ReadStatus::LAPPED) {
+                snapshot(out);
+                return Next::READY;
+            }
+            if (read == BroadcastRing::ReadStatus::EMPTY) {
+                if (!view_.pending()) return Next::IDLE;
+                auto now = chrono::steady_clock::now();
+                if (now >= flush_at_) return flush(out, now) ? Next::READY : Next::IDLE;
+                wait = min(wait, chrono::ceil<chrono::milliseconds>(flush_at_ - now));
+                return Next::IDLE;
+            }
+            ++next_;
+            // Changes the snapshot already has are skipped by sequence; once
+            // past them, a plain stream has no need to parse
+            if (filtered_ || !caught_up_) {
+                if (!update_.ParseFromString(bytes_)) continue;
+                if (!caught_up_) {
+                    if (update_.sequence() <= snapshot_sequence_) continue;
+                    caught_up_ = true;
+                }
+            }
+            if (!filtered_) {
+                out.swap(bytes_);
+                return Next::READY;
+            }
+            sequence_ = update_.sequence();
+            for (const auto& level : update_.bids()) view_.apply(LevelUpdate{true, doubleToPrice(level.price()), level.quantity()});
+            for (const auto& level : update_.asks()) view_.apply(LevelUpdate{false, doubleToPrice(level.price()), level.quantity()});
+            if (conflation_.count() == 0) {
+                if (flush(out, chrono::steady_clock::time_point())) return Next::READY;
+                continue;
+            }
+            auto now = chrono::steady_clock::now();
+            if (now >= flush_at_ && view_.pending() && flush(out, now)) return Next::READY;
+        }
+    }
+
+private:
+    void snapshot(string& out) {
+        metrics_book_snapshots.inc();
+        // Cursor first: a change published after it is read again, and
+        // skipped if the snapshot already has it
+        next_ = channel_.ring.head() + 1;
+        auto read_depth = [&](OrderBook& book) { snapshot_sequence_ = book.getDepth(0, bids_, asks_); };
+        if (Sequencer* sequencer = sequencerFor(book_)) sequencer->execute(book_, read_depth);
+        else read_depth(book_);
+        sequence_ = snapshot_sequence_;
+        snapshot_sent_ = true;
+        caught_up_ = false;
+        flush_at_ = chrono::steady_clock::now() + conflation_;
+
+        update_.Clear();
+        update_.set_symbol(symbol_);
+        update_.set_sequence(sequence_);
+        update_.set_snapshot(true);
+        if (filtered_) {
+            view_.reset(bids_, asks_, view_bids_, view_asks_);
+            addLevels(view_bids_, view_asks_);
+        } else {
+            addLevels(bids_, asks_);
+        }
+        update_.SerializeToString(&out);
+    }
+
+    void addLevels(const vector<pair<Price, Quantity>>& bids, const vector<pair<Price, Quantity>>& asks) {
+        for (const auto& level : bids) {
+            auto* entry = update_.add_bids();
+            entry->set_price(priceToDouble(level.first));
+            entry->set_quantity(level.second);
+        }
+        for (const auto& level : asks) {
+            auto* entry = update_.add_asks();
+            entry->set_price(priceToDouble(level.first));
+            entry->set_quantity(level.second);
+        }
+    }
+
+    // The view's changes as one update; false when they left the view as it was
+    bool flush(string& out, chrono::steady_clock::time_point now) {
+        flush_at_ = now + conflation_;
+        changes_.clear();
+        view_.flush(changes_);
+        if (changes_.empty()) return false;
+        update_.Clear();
+        update_.set_symbol(symbol_);
+        update_.set_sequence(sequence_);
+        for (const LevelUpdate& change : changes_) {
+            auto* entry = change.is_buy ? update_.add_bids() : update_.add_asks();
+            entry->set_price(priceToDouble(change.price));
+            entry->set_quantity(change.quantity);
+        }
+        update_.SerializeToString(&out);
+        return true;
+    }
 
-            response->set_order_id(to_string(order_id));
-            response->set_status("ACCEPTED");
-            response->set_message("Order submitted successfully");
+    string symbol_;
+    OrderBook& book_;
+    StreamChannel& channel_;
+    chrono::milliseconds conflation_;
+    bool filtered_;
+    DepthView view_;
+    bool snapshot_sent_ = false;
+    bool caught_up_ = false;  // read a change newer than the snapshot
+    uint64_t next_ = 0;
+    uint64_t snapshot_sequence_ = 0;
+    uint64_t sequence_ = 0;   // of the last change applied to view_
+    chrono::steady_clock::time_point flush_at_;
+    string bytes_;
+    tradeflow::order::BookUpdate update_;
+    vector<LevelUpdate> changes_;
+    vector<pair<Price, Quantity>> bids_, asks_, view_bids_, view_asks_;
+};
 
-            metrics_submit_accepted.fetch_add(1, std::memory_order_relaxed);
+class OrderServiceImpl final : public tradeflow::order::OrderService::Service {
+public:
+    Status SubmitOrder(ServerContext* context, const tradeflow::order::SubmitOrderRequest* request,
+                       tradeflow::order::SubmitOrderResponse* response) override {
+        metrics_submit_requests.inc();
+        RpcTimer timer(submit_latency_);
+        OrderId order_id = 0;
+        bool submitted = false;
+        try {
+            OrderType type;
+            if (!validateSubmit(*request, type, *response)) return Status::OK;
 
-            // Trigger matching
-            matchers_[request->symbol()]->match(order_book);
+            bool is_buy = (request->side() == "BUY");
+            order_id = getNextOrderId();
+            Price price = doubleToPrice(request->price());
+            OrderBook& order_book = getOrderBook(request->symbol());
+            // Route before the order can rest or fill, so the book's close
+            // callback always finds the entry it removes
+            order_router_->add(order_id, &order_book);
+            // The order is matched against the opposite side on arrival and
+            // only the remainder (LIMIT) is rested
+            SubmitResult result;
+            timer.beginBook();
+            if (Sequencer* sequencer = sequencerFor(order_book)) {
+                result = sequencer->submit(order_book, order_id, is_buy, request->quantity(), price,
+                                           request->client_id(), type);
+            } else {
+                result = order_book.submitOrder(order_id, is_buy, request->quantity(), price, request->client_id(),
+                                                type);
+            }
+            submitted = true;
+            timer.endBook();
+            awaitDurable();
+            timer.endDurable();
 
+            describeSubmit(request->symbol(), order_id, type, result, *response);
             return Status::OK;
         } catch (const exception& e) {
+            // Only a submit the book never took; one that is merely not durable may be resting
+            if (order_id && !submitted) unrouteOrder(order_id);
             response->set_status("REJECTED");
             response->set_message(string("Error: ") + e.what());
-            metrics_submit_errors.fetch_add(1, std::memory_order_relaxed);
+            metrics_submit_errors.inc();
             return Status::OK;
         }
     }
 
     Status GetOrderBook(ServerContext* context, const tradeflow::order::GetOrderBookRequest* request,
                         tradeflow::order::GetOrderBookResponse* response) override {
-        metrics_get_orderbook_requests.fetch_add(1, std::memory_order_relaxed);
+        metrics_get_orderbook_requests.inc();
+        RpcTimer timer(get_orderbook_latency_);
+        if (const char* problem = symbolProblem(request->symbol())) {
+            return Status(grpc::StatusCode::INVALID_ARGUMENT, problem);
+        }
         OrderBook& order_book = getOrderBook(request->symbol());
-        auto bids = order_book.getBidLevels();
-        auto asks = order_book.getAskLevels();
+        vector<pair<Price, Quantity>> bids;
+        vector<pair<Price, Quantity>> asks;
+        uint64_t sequence = 0;
+        size_t depth = request->depth();
+        timer.beginBook();
+        if (depth > 0 && depth <= order_book.publishedDepth()) {
+            // Served from the book's published levels: no lock, no shard round trip
+            sequence = order_book.readPublishedDepth(depth, bids, asks);
+        } else {
+            auto read_levels = [&](OrderBook& book) { sequence = book.getDepth(depth, bids, asks); };
+            if (Sequencer* sequencer = sequencerFor(order_book)) sequencer->execute(order_book, read_levels);
+            else read_levels(order_book);
+        }
+        timer.endBook();
+        response->set_sequence(sequence);
+        if (order_book.getMatchingMode() == MatchingMode::CALL_AUCTION) {
+            describeAuction(order_book.indicativeAuction(), *response->mutable_auction());
+        }
 
         for (const auto& level : bids) {
             auto* entry = response->add_bids();
@@ -341,129 +1558,861 @@ public:
 
     Status CancelOrder(ServerContext* context, const tradeflow::order::CancelOrderRequest* request,
                        tradeflow::order::CancelOrderResponse* response) override {
-        metrics_cancel_requests.fetch_add(1, std::memory_order_relaxed);
+        metrics_cancel_requests.inc();
+        RpcTimer timer(cancel_latency_);
         try {
             OrderId order_id = stoll(request->order_id());
-            // Find the order book for the order
+            OrderBook* order_book = order_router_->find(order_id);
             bool found = false;
-            lock_guard<mutex> lock(order_books_mutex_);
-            for (auto& pair : order_books_) {
-                if (pair.second->cancelOrder(order_id)) {
-                    found = true;
-                    break;
-                }
+            if (order_book) {
+                Sequencer* sequencer = sequencerFor(*order_book);
+                timer.beginBook();
+                found = sequencer ? sequencer->cancel(*order_book, order_id) : order_book->cancelOrder(order_id);
+                timer.endBook();
+                awaitDurable();
+                timer.endDurable();
             }
 
-            if (found) {
-                response->set_status("CANCELLED");
-                response->set_message("Order cancelled successfully");
-                metrics_cancel_success.fetch_add(1, std::memory_order_relaxed);
-            } else {
-                response->set_status("NOT_FOUND");
-                response->set_message("Order not found");
-                metrics_cancel_not_found.fetch_add(1, std::memory_order_relaxed);
-            }
+            describeCancel(found, *response);
             return Status::OK;
         } catch (const exception& e) {
             response->set_status("ERROR");
             response->set_message(string("Error: ") + e.what());
-            metrics_cancel_errors.fetch_add(1, std::memory_order_relaxed);
+            metrics_cancel_errors.inc();
             return Status::OK;
         }
     }
 
     Status ModifyOrder(ServerContext* context, const tradeflow::order::ModifyOrderRequest* request,
                        tradeflow::order::ModifyOrderResponse* response) override {
-        metrics_modify_requests.fetch_add(1, std::memory_order_relaxed);
+        metrics_modify_requests.inc();
+        RpcTimer timer(modify_latency_);
         try {
+            if (!validateModify(*request, *response)) return Status::OK;
             OrderId order_id = stoll(request->order_id());
             Price new_price = doubleToPrice(request->new_price());
+            OrderBook* order_book = order_router_->find(order_id);
             bool found = false;
-            lock_guard<mutex> lock(order_books_mutex_);
-            for (auto& pair : order_books_) {
-                if (pair.second->modifyOrder(order_id, request->new_quantity(), new_price)) {
-                    found = true;
-                    break;
+            if (order_book) {
+                Sequencer* sequencer = sequencerFor(*order_book);
+                timer.beginBook();
+                if (sequencer) {
+                    found = sequencer->modify(*order_book, order_id, request->new_quantity(), new_price);
+                } else {
+                    found = order_book->modifyAndMatch(order_id, request->new_quantity(), new_price);
                 }
+                timer.endBook();
+                awaitDurable();
+                timer.endDurable();
             }
 
-            if (found) {
-                response->set_status("MODIFIED");
-                response->set_message("Order modified successfully");
-                metrics_modify_success.fetch_add(1, std::memory_order_relaxed);
-            } else {
-                response->set_status("NOT_FOUND");
-                response->set_message("Order not found");
-                metrics_modify_not_found.fetch_add(1, std::memory_order_relaxed);
-            }
+            describeModify(found, *response);
             return Status::OK;
         } catch (const exception& e) {
             response->set_status("ERROR");
             response->set_message(string("Error: ") + e.what());
-            metrics_modify_errors.fetch_add(1, std::memory_order_relaxed);
+            metrics_modify_errors.inc();
+            return Status::OK;
+        }
+    }
+
+    Status Uncross(ServerContext* context, const tradeflow::order::UncrossRequest* request,
+                   tradeflow::order::UncrossResponse* response) override {
+        metrics_uncross_requests.inc();
+        RpcTimer timer(uncross_latency_);
+        if (symbolProblem(request->symbol())) {
+            response->set_status("REJECTED");
             return Status::OK;
         }
+        OrderBook& order_book = getOrderBook(request->symbol());
+        if (order_book.getMatchingMode() != MatchingMode::CALL_AUCTION) {
+            response->set_status("REJECTED");
+            return Status::OK;
+        }
+        Price reference = request->reference_price() > 0 ? doubleToPrice(request->reference_price()) : 0;
+        AuctionResult auction;
+        auto run = [&](OrderBook& book) { auction = book.uncross(reference); };
+        timer.beginBook();
+        if (Sequencer* sequencer = sequencerFor(order_book)) sequencer->execute(order_book, run);
+        else run(order_book);
+        timer.endBook();
+        try {
+            awaitDurable();
+        } catch (const exception& e) {
+            return Status(grpc::StatusCode::UNAVAILABLE, e.what());
+        }
+        timer.endDurable();
+        metrics_auction_volume.inc(static_cast<uint64_t>(auction.volume));
+        response->set_status(auction.volume > 0 ? "UNCROSSED" : "NO_CROSS");
+        describeAuction(auction, *response->mutable_auction());
+        return Status::OK;
     }
 
     Status SubscribeTrades(ServerContext* context, const tradeflow::order::SubscribeTradesRequest* request,
                            ServerWriter<tradeflow::order::TradeUpdate>* writer) override {
-        metrics_subscribe_requests.fetch_add(1, std::memory_order_relaxed);
-        auto sub = make_shared<Subscriber>();
+        metrics_subscribe_requests.inc();
+        if (const char* problem = symbolProblem(request->symbol())) {
+            return Status(grpc::StatusCode::INVALID_ARGUMENT, problem);
+        }
+        StreamChannel& channel = tradeChannel(request->symbol());
+        channel.subscribers.fetch_add(1, std::memory_order_relaxed);
+        metrics_active_trade_subscriptions.inc();
+
+        // Trades from subscription onwards, read at this stream's own cursor
+        uint64_t next = channel.ring.head() + 1;
+        std::string bytes;
+        tradeflow::order::TradeUpdate update;
+        Status status = Status::OK;
+        while (!context->IsCancelled()) {
+            BroadcastRing::ReadStatus read = channel.ring.read(next, bytes);
+            if (read == BroadcastRing::ReadStatus::EMPTY) {
+                awaitMessage(channel, next, SUBSCRIBER_POLL);
+                continue;
+            }
+            if (read == BroadcastRing::ReadStatus::LAPPED) {
+                if (!resumeLappedStream(channel, next, status)) break;
+                continue;
+            }
+            if (!update.ParseFromString(bytes) || !writer->Write(update)) break;
+            ++next;
+        }
+
+        channel.subscribers.fetch_sub(1, std::memory_order_relaxed);
+        metrics_active_trade_subscriptions.dec();
+
+        return status;
+    }
+
+    Status SubscribeBook(ServerContext* context, const tradeflow::order::SubscribeBookRequest* request,
+                         ServerWriter<tradeflow::order::BookUpdate>* writer) override {
+        metrics_book_subscribe_requests.inc();
+        if (const char* problem = symbolProblem(request->symbol())) {
+            return Status(grpc::StatusCode::INVALID_ARGUMENT, problem);
+        }
+        BookFeed feed(request->symbol(), request->depth(), request->conflation_ms());
+        std::string bytes;
+        tradeflow::order::BookUpdate update;
+        while (!context->IsCancelled()) {
+            chrono::milliseconds wait = SUBSCRIBER_POLL;
+            if (feed.next(bytes, wait) == BookFeed::Next::IDLE) {
+                awaitMessage(feed.channel(), feed.cursor(), wait);
+                continue;
+            }
+            if (!update.ParseFromString(bytes) || !writer->Write(update)) break;
+        }
+        return Status::OK;
+    }
+
+    Status SubmitOrders(ServerContext* context, const tradeflow::order::SubmitOrdersRequest* request,
+                        tradeflow::order::SubmitOrdersResponse* response) override {
+        metrics_submit_batches.inc();
+        RpcTimer timer(submit_batch_latency_);
+        EntryBatch batch;
+        for (const auto& order : request->orders()) batch.addSubmit(order, response->add_results());
+        batch.apply(timer);
+        return Status::OK;
+    }
+
+    Status OrderEntryStream(ServerContext* context,
+                            grpc::ServerReaderWriter<tradeflow::order::OrderEntryResponse,
+                                                     tradeflow::order::OrderEntryRequest>* stream) override {
+        // Acks and fills go out from a writer thread, so fills of resting
+        // orders are sent while this thread waits for the next request
+        mutex m;
+        condition_variable cv;
+        bool pending = false;
+        bool closing = false;
+        OrderEntrySession session([&] {
+            lock_guard<mutex> lock(m);
+            pending = true;
+            cv.notify_one();
+        });
+        thread writer([&] {
+            vector<tradeflow::order::OrderEntryResponse> out;
+            bool connected = true;
+            unique_lock<mutex> lock(m);
+            while (true) {
+                cv.wait(lock, [&] { return pending || closing; });
+                bool last = closing;
+                pending = false;
+                lock.unlock();
+                while (session.take(out)) {
+                    // Once the client is gone, keep draining so the outbox stays empty
+                    for (const auto& response : out) connected = connected && stream->Write(response);
+                    out.clear();
+                }
+                lock.lock();
+                if (last) return;
+            }
+        });
+        tradeflow::order::OrderEntryRequest request;
+        while (stream->Read(&request)) session.apply(request);
+        {
+            lock_guard<mutex> lock(m);
+            closing = true;
+            cv.notify_one();
+        }
+        writer.join();
+        return Status::OK;
+    }
+};
+
+// Async server (TRADEFLOW_GRPC_SERVER=async). A fixed pool of threads each
+// polls its own completion queue; every RPC is a call object whose tag comes
+// back on that queue, so one call's events are always handled by one thread
+// in order. Unary calls run the sync service's handlers on the polling
+// thread. Subscription streams hold no thread while idle (see
+// ChannelStreamCall) and use raw methods, writing ring bytes as they are.
+using AsyncOrderService = tradeflow::order::OrderService::WithAsyncMethod_SubmitOrder<
+    tradeflow::order::OrderService::WithAsyncMethod_GetOrderBook<
+        tradeflow::order::OrderService::WithAsyncMethod_CancelOrder<
+            tradeflow::order::OrderService::WithAsyncMethod_ModifyOrder<
+                tradeflow::order::OrderService::WithRawMethod_SubscribeTrades<
+                    tradeflow::order::OrderService::WithAsyncMethod_SubmitOrders<
+                        tradeflow::order::OrderService::WithAsyncMethod_OrderEntryStream<
+                            tradeflow::order::OrderService::WithRawMethod_SubscribeBook<
+                                tradeflow::order::OrderService::WithAsyncMethod_Uncross<
+                                    tradeflow::order::OrderService::Service>>>>>>>>>;
+
+class AsyncCall {
+public:
+    virtual ~AsyncCall() = default;
+    // ok is the completion queue's verdict on the operation that completed
+    virtual void proceed(bool ok) = 0;
+};
+
+// An extra tag for a call with several operations in flight at once; its
+// completion goes to one of the call's member functions
+template <typename Call>
+class CallTag final : public AsyncCall {
+public:
+    CallTag(Call* call, void (Call::*on)(bool)) : call_(call), on_(on) {}
+    void proceed(bool ok) override { (call_->*on_)(ok); }
+
+private:
+    Call* call_;
+    void (Call::*on_)(bool);
+};
+
+// Runs the async server's handler work, which can block on a book lock, a
+// shard round trip or a durable-ack sync, so a completion queue's thread only
+// drives calls and the streams sharing its queue are not held up behind it
+class HandlerPool {
+public:
+    explicit HandlerPool(size_t threads) {
+        for (size_t i = 0; i < threads; ++i) workers_.emplace_back([this] { run(); });
+    }
+    ~HandlerPool() {
         {
-            lock_guard<mutex> lock(subscribers_mutex_);
-            trade_subscribers_[request->symbol()].push_back(sub);
+            lock_guard<mutex> lock(mutex_);
+            stopping_ = true;
         }
-        metrics_active_trade_subscriptions.fetch_add(1, std::memory_order_relaxed);
+        ready_.notify_all();
+        for (auto& worker : workers_) worker.join();
+    }
+    HandlerPool(const HandlerPool&) = delete;
+    HandlerPool& operator=(const HandlerPool&) = delete;
 
-        // Loop until client disconnects; write updates from the subscriber queue
+    void post(function<void()> task) {
+        {
+            lock_guard<mutex> lock(mutex_);
+            tasks_.push_back(move(task));
+        }
+        ready_.notify_one();
+    }
+
+private:
+    void run() {
         while (true) {
-            unique_lock<mutex> lk(sub->m);
-            sub->cv.wait(lk, [&] { return !sub->q.empty() || !sub->active || context->IsCancelled(); });
+            function<void()> task;
+            {
+                unique_lock<mutex> lock(mutex_);
+                ready_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+                if (tasks_.empty()) return;
+                task = move(tasks_.front());
+                tasks_.pop_front();
+            }
+            task();
+        }
+    }
+
+    mutex mutex_;
+    condition_variable ready_;
+    deque<function<void()>> tasks_;
+    bool stopping_ = false;
+    vector<thread> workers_;
+};
 
-            if (context->IsCancelled()) break;
+unique_ptr<HandlerPool> handler_pool_;
 
-            while (!sub->q.empty()) {
-                auto update = sub->q.front();
-                sub->q.pop_front();
-                lk.unlock();
-                writer->Write(update);
-                lk.lock();
+// Requested -> handled (on the HandlerPool) and finished -> deleted. Arms its
+// successor as soon as a call arrives, so each queue always has one
+// outstanding request per RPC.
+template <typename Request, typename Response>
+class UnaryCall final : public AsyncCall {
+public:
+    using RequestMethod = void (AsyncOrderService::*)(ServerContext*, Request*, grpc::ServerAsyncResponseWriter<Response>*,
+                                                      grpc::CompletionQueue*, grpc::ServerCompletionQueue*, void*);
+    using Handler = Status (OrderServiceImpl::*)(ServerContext*, const Request*, Response*);
+
+    UnaryCall(AsyncOrderService* service, grpc::ServerCompletionQueue* cq, OrderServiceImpl* handlers,
+              RequestMethod request_method, Handler handler)
+        : service_(service), cq_(cq), handlers_(handlers), request_method_(request_method), handler_(handler),
+          responder_(&context_) {
+        (service_->*request_method_)(&context_, &request_, &responder_, cq_, cq_, this);
+    }
+
+    void proceed(bool ok) override {
+        if (!ok || finished_) {
+            delete this;
+            return;
+        }
+        new UnaryCall(service_, cq_, handlers_, request_method_, handler_);
+        finished_ = true;
+        handler_pool_->post([this] {
+            Status status = (handlers_->*handler_)(&context_, &request_, &response_);
+            responder_.Finish(response_, status, this);
+        });
+    }
+
+private:
+    AsyncOrderService* service_;
+    grpc::ServerCompletionQueue* cq_;
+    OrderServiceImpl* handlers_;
+    RequestMethod request_method_;
+    Handler handler_;
+    ServerContext context_;
+    Request request_;
+    Response response_;
+    grpc::ServerAsyncResponseWriter<Response> responder_;
+    bool finished_ = false;
+};
+
+// A server-streaming call that follows one StreamChannel (SubscribeTrades,
+// SubscribeBook). Subclasses issue the request, start the stream and pump
+// messages from the channel; this class owns the write, park and finish
+// mechanics. A caught-up stream parks in its channel with an alarm as a
+// timeout, and the StreamWaker cancels the alarm (firing it early) when the
+// channel gets a message. Deleted once both the finish and the done tag are back.
+class ChannelStreamCall : public AsyncCall {
+public:
+    void proceed(bool ok) override {
+        switch (state_) {
+            case State::REQUESTED:
+                if (!ok) {  // server shutting down; the done tag never comes for a call that did not start
+                    delete this;
+                    return;
+                }
+                spawn();
+                start();
+                return;
+            case State::WRITING:
+                if (!ok) {  // client went away
+                    finish(Status::CANCELLED);
+                    return;
+                }
+                written();
+                pump();
+                return;
+            case State::PARKED:  // timeout, or cancelled early by the waker
+                unpark();
+                pump();
+                return;
+            case State::FINISHING:
+                finished_ = true;
+                if (done_) delete this;
+                return;
+        }
+    }
+
+    // Waker thread, holding channel_->m while this stream is parked
+    void wake() { alarm_.Cancel(); }
+
+protected:
+    ChannelStreamCall(AsyncOrderService* service, grpc::ServerCompletionQueue* cq)
+        : service_(service), cq_(cq), writer_(&context_), done_tag_(this, &ChannelStreamCall::onDone) {
+        // IsCancelled is only safe to call once this tag is back
+        context_.AsyncNotifyWhenDone(&done_tag_);
+    }
+
+    // Arm the next call of the same RPC
+    virtual void spawn() = 0;
+    // The request arrived: parse it, set channel_ and pump
+    virtual void start() = 0;
+    // Write the next message, park, or finish
+    virtual void pump() = 0;
+    // The last write completed
+    virtual void written() {}
+
+    void write(const std::string& bytes) {
+        grpc::Slice slice(bytes);
+        buffer_ = grpc::ByteBuffer(&slice, 1);
+        state_ = State::WRITING;
+        writer_.Write(buffer_, this);
+    }
+
+    // Wait for message `next` until `timeout` passes. Returns false if it
+    // arrived while parking, so there is nothing to wait for.
+    bool park(uint64_t next, chrono::milliseconds timeout) {
+        lock_guard<mutex> lock(channel_->m);
+        channel_->parked_streams.push_back(this);
+        channel_->async_parked.fetch_add(1, std::memory_order_relaxed);
+        // Pairs with the fence in notifyStreams, as for sync streams
+        atomic_thread_fence(std::memory_order_seq_cst);
+        if (channel_->ring.head() >= next) {
+            channel_->parked_streams.pop_back();
+            channel_->async_parked.fetch_sub(1, std::memory_order_relaxed);
+            return false;
+        }
+        state_ = State::PARKED;
+        alarm_.Set(cq_, chrono::system_clock::now() + timeout, this);
+        return true;
+    }
+
+    void finish(const Status& status) {
+        state_ = State::FINISHING;
+        writer_.Finish(status, this);
+    }
+
+    AsyncOrderService* service_;
+    grpc::ServerCompletionQueue* cq_;
+    ServerContext context_;
+    grpc::ByteBuffer request_;
+    grpc::ServerAsyncWriter<grpc::ByteBuffer> writer_;
+    StreamChannel* channel_ = nullptr;
+    bool cancelled_ = false;
+
+private:
+    enum class State { REQUESTED, WRITING, PARKED, FINISHING };
+
+    // Fires once the RPC is over, ours or the client's doing
+    void onDone(bool) {
+        done_ = true;
+        cancelled_ = context_.IsCancelled();
+        if (finished_) {
+            delete this;
+            return;
+        }
+        // A parked client that went away is not woken by a message; end the wait now
+        if (state_ == State::PARKED && unpark()) alarm_.Cancel();
+    }
+
+    // False if the waker already took this stream off the list (and cancelled its alarm)
+    bool unpark() {
+        lock_guard<mutex> lock(channel_->m);
+        auto& parked = channel_->parked_streams;
+        auto it = find(parked.begin(), parked.end(), this);
+        if (it == parked.end()) return false;
+        *it = parked.back();
+        parked.pop_back();
+        channel_->async_parked.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    State state_ = State::REQUESTED;
+    grpc::ByteBuffer buffer_;  // in flight until the write completes
+    grpc::Alarm alarm_;
+    CallTag<ChannelStreamCall> done_tag_;
+    bool done_ = false;
+    bool finished_ = false;
+};
+
+// Sends the trade ring's bytes as they are (raw method), so nothing is re-serialised
+class TradeStreamCall final : public ChannelStreamCall {
+public:
+    TradeStreamCall(AsyncOrderService* service, grpc::ServerCompletionQueue* cq) : ChannelStreamCall(service, cq) {
+        service_->RequestSubscribeTrades(&context_, &request_, &writer_, cq_, cq_, this);
+    }
+
+    ~TradeStreamCall() override {
+        if (!channel_) return;
+        channel_->subscribers.fetch_sub(1, std::memory_order_relaxed);
+        metrics_active_trade_subscriptions.dec();
+    }
+
+private:
+    void spawn() override { new TradeStreamCall(service_, cq_); }
+
+    void start() override {
+        metrics_subscribe_requests.inc();
+        tradeflow::order::SubscribeTradesRequest request;
+        if (!grpc::SerializationTraits<tradeflow::order::SubscribeTradesRequest>::Deserialize(&request_, &request).ok()) {
+            finish(Status(grpc::StatusCode::INVALID_ARGUMENT, "Malformed SubscribeTradesRequest"));
+            return;
+        }
+        if (const char* problem = symbolProblem(request.symbol())) {
+            finish(Status(grpc::StatusCode::INVALID_ARGUMENT, problem));
+            return;
+        }
+        channel_ = &tradeChannel(request.symbol());
+        channel_->subscribers.fetch_add(1, std::memory_order_relaxed);
+        metrics_active_trade_subscriptions.inc();
+        next_ = channel_->ring.head() + 1;
+        pump();
+    }
+
+    void written() override { ++next_; }
+
+    // Write the next trade, or park until there is one
+    void pump() override {
+        Status status;
+        while (!cancelled_) {
+            switch (channel_->ring.read(next_, bytes_)) {
+                case BroadcastRing::ReadStatus::OK:
+                    write(bytes_);
+                    return;
+                case BroadcastRing::ReadStatus::LAPPED:
+                    if (!resumeLappedStream(*channel_, next_, status)) {
+                        finish(status);
+                        return;
+                    }
+                    break;
+                case BroadcastRing::ReadStatus::EMPTY:
+                    if (park(next_, SUBSCRIBER_POLL)) return;
+                    break;
+            }
+        }
+        finish(Status::CANCELLED);
+    }
+
+    uint64_t next_ = 0;
+    std::string bytes_;
+};
+
+class BookStreamCall final : public ChannelStreamCall {
+public:
+    BookStreamCall(AsyncOrderService* service, grpc::ServerCompletionQueue* cq) : ChannelStreamCall(service, cq) {
+        service_->RequestSubscribeBook(&context_, &request_, &writer_, cq_, cq_, this);
+    }
+
+private:
+    void spawn() override { new BookStreamCall(service_, cq_); }
+
+    void start() override {
+        metrics_book_subscribe_requests.inc();
+        tradeflow::order::SubscribeBookRequest request;
+        if (!grpc::SerializationTraits<tradeflow::order::SubscribeBookRequest>::Deserialize(&request_, &request).ok()) {
+            finish(Status(grpc::StatusCode::INVALID_ARGUMENT, "Malformed SubscribeBookRequest"));
+            return;
+        }
+        if (const char* problem = symbolProblem(request.symbol())) {
+            finish(Status(grpc::StatusCode::INVALID_ARGUMENT, problem));
+            return;
+        }
+        feed_ = make_unique<BookFeed>(request.symbol(), request.depth(), request.conflation_ms());
+        channel_ = &feed_->channel();
+        pump();
+    }
+
+    // Write the next update, or park until there is one or a conflated flush is due
+    void pump() override {
+        while (!cancelled_) {
+            chrono::milliseconds wait = SUBSCRIBER_POLL;
+            if (feed_->next(bytes_, wait) == BookFeed::Next::READY) {
+                write(bytes_);
+                return;
             }
+            if (park(feed_->cursor(), wait)) return;
         }
+        finish(Status::CANCELLED);
+    }
+
+    unique_ptr<BookFeed> feed_;
+    std::string bytes_;
+};
 
-        // remove subscriber
+// Reads, applies and acks request batches while writing queued acks and
+// fills, one write at a time. Fills from trade threads reach the call
+// through an alarm set to fire at once, so every stream operation still
+// happens on the call's own completion queue. Ends (Finish) once the client
+// has closed its side and everything queued before that has been written.
+class EntryStreamCall final : public AsyncCall {
+public:
+    EntryStreamCall(AsyncOrderService* service, grpc::ServerCompletionQueue* cq)
+        : service_(service), cq_(cq), stream_(&context_), read_tag_(this, &EntryStreamCall::onRead),
+          write_tag_(this, &EntryStreamCall::onWrite), wake_tag_(this, &EntryStreamCall::onWake),
+          finish_tag_(this, &EntryStreamCall::onFinish) {
+        service_->RequestOrderEntryStream(&context_, &stream_, cq_, cq_, this);
+    }
+
+    // The call has started
+    void proceed(bool ok) override {
+        if (!ok) {  // server shutting down
+            delete this;
+            return;
+        }
+        new EntryStreamCall(service_, cq_);
+        session_ = make_unique<OrderEntrySession>([this] { wake(); });
+        stream_.Read(&request_, &read_tag_);
+    }
+
+private:
+    void onRead(bool ok) {
+        if (!ok) {
+            read_closed_ = true;
+            pump();
+            return;
+        }
+        // The batch runs on the HandlerPool. apply() ends by waking this call
+        // to write the acks; the next read goes out only after that, so the
+        // call cannot finish (and be deleted) while the batch still runs.
+        handler_pool_->post([this] {
+            session_->apply(request_);
+            request_.Clear();
+            stream_.Read(&request_, &read_tag_);
+        });
+    }
+
+    void onWrite(bool ok) {
+        writing_ = false;
+        connected_ = connected_ && ok;
+        pump();
+    }
+
+    // Any thread, via the session
+    void wake() {
+        lock_guard<mutex> lock(wake_mutex_);
+        if (wake_armed_) return;
+        wake_armed_ = true;
+        wake_alarm_.Set(cq_, gpr_now(GPR_CLOCK_MONOTONIC), &wake_tag_);
+    }
+
+    void onWake(bool) {
         {
-            lock_guard<mutex> lock(subscribers_mutex_);
-            auto& vec = trade_subscribers_[request->symbol()];
-            vec.erase(remove_if(vec.begin(), vec.end(), [&](const shared_ptr<Subscriber>& s) { return s == sub; }), vec.end());
+            lock_guard<mutex> lock(wake_mutex_);
+            wake_armed_ = false;
+        }
+        if (finishing_) {
+            if (finished_) delete this;
+            return;
         }
+        pump();
+    }
 
-        metrics_active_trade_subscriptions.fetch_sub(1, std::memory_order_relaxed);
+    // Only this call's queue thread runs its tags, and with the session gone
+    // nothing arms the alarm again, so whichever of finish and an outstanding
+    // wake completes last deletes the call
+    void onFinish(bool) {
+        finished_ = true;
+        bool armed;
+        {
+            lock_guard<mutex> lock(wake_mutex_);
+            armed = wake_armed_;
+        }
+        if (!armed) delete this;
+    }
 
-        return Status::OK;
+    void pump() {
+        if (writing_ || finishing_) return;
+        while (true) {
+            if (next_ == out_.size()) {
+                out_.clear();
+                next_ = 0;
+                if (!session_->take(out_)) break;
+            }
+            const auto& response = out_[next_++];
+            if (!connected_) continue;  // client gone: drain without writing
+            writing_ = true;
+            stream_.Write(response, &write_tag_);
+            return;
+        }
+        if (!read_closed_) return;
+        // No more requests and nothing left to write; no fill can arrive once
+        // the session is closed
+        finishing_ = true;
+        session_.reset();
+        stream_.Finish(Status::OK, &finish_tag_);
     }
+
+    AsyncOrderService* service_;
+    grpc::ServerCompletionQueue* cq_;
+    ServerContext context_;
+    grpc::ServerAsyncReaderWriter<tradeflow::order::OrderEntryResponse, tradeflow::order::OrderEntryRequest> stream_;
+    CallTag<EntryStreamCall> read_tag_;
+    CallTag<EntryStreamCall> write_tag_;
+    CallTag<EntryStreamCall> wake_tag_;
+    CallTag<EntryStreamCall> finish_tag_;
+    unique_ptr<OrderEntrySession> session_;
+    tradeflow::order::OrderEntryRequest request_;
+    vector<tradeflow::order::OrderEntryResponse> out_;
+    size_t next_ = 0;  // next of out_ to write
+    bool writing_ = false;
+    bool connected_ = true;
+    bool read_closed_ = false;
+    bool finishing_ = false;
+    bool finished_ = false;
+    mutex wake_mutex_;
+    bool wake_armed_ = false;  // guarded by wake_mutex_
+    grpc::Alarm wake_alarm_;
 };
 
+// Wakes async streams parked on channels that got a message. The
+// publisher, on a matching thread, only queues the channel (once until it is
+// handled); cancelling the parked streams' alarms, one per stream, happens
+// here. Runs for the life of the process.
+class StreamWaker {
+public:
+    StreamWaker() : ring_(4096), sleeping_(false) { thread([this] { loop(); }).detach(); }
+
+    void post(StreamChannel* channel) {
+        while (!ring_.tryPush(channel)) this_thread::yield();
+        // Pairs with the fence in loop(), as in Sequencer::enqueue
+        atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping_.load(std::memory_order_relaxed)) {
+            sleeping_.store(false, std::memory_order_relaxed);
+            sleeping_.notify_one();
+        }
+    }
+
+private:
+    void loop() {
+        StreamChannel* channel;
+        while (true) {
+            if (ring_.tryPop(channel)) {
+                wake(*channel);
+                continue;
+            }
+            sleeping_.store(true, std::memory_order_relaxed);
+            atomic_thread_fence(std::memory_order_seq_cst);
+            if (!ring_.empty()) {
+                sleeping_.store(false, std::memory_order_relaxed);
+                continue;
+            }
+            sleeping_.wait(true, std::memory_order_relaxed);
+        }
+    }
+
+    void wake(StreamChannel& channel) {
+        // Cleared first: a trade published from here on queues the channel again
+        channel.wake_pending.store(false, std::memory_order_release);
+        lock_guard<mutex> lock(channel.m);
+        for (ChannelStreamCall* stream : channel.parked_streams) stream->wake();
+        channel.async_parked.fetch_sub(static_cast<int>(channel.parked_streams.size()), std::memory_order_relaxed);
+        channel.parked_streams.clear();
+    }
+
+    MpscRing<StreamChannel*> ring_;
+    std::atomic<bool> sleeping_;
+};
+
+unique_ptr<StreamWaker> stream_waker_;
+
+void wakeStreams(StreamChannel& channel) {
+    stream_waker_->post(&channel);
+}
+
+void RunAsyncServer(ServerBuilder& builder) {
+    size_t threads = engine_config_.grpc_threads ? engine_config_.grpc_threads
+                                                 : max<size_t>(1, thread::hardware_concurrency());
+    OrderServiceImpl handlers;
+    AsyncOrderService service;
+    builder.RegisterService(&service);
+    vector<unique_ptr<grpc::ServerCompletionQueue>> queues;
+    for (size_t i = 0; i < threads; ++i) queues.push_back(builder.AddCompletionQueue());
+    unique_ptr<Server> server(builder.BuildAndStart());
+    stream_waker_ = make_unique<StreamWaker>();
+    size_t handler_threads = engine_config_.grpc_handler_threads ? engine_config_.grpc_handler_threads
+                                                                 : 4 * max<size_t>(1, thread::hardware_concurrency());
+    handler_pool_ = make_unique<HandlerPool>(handler_threads);
+    TF_LOG_INFO("Async gRPC server with {} completion queue thread(s) and {} handler thread(s)", threads,
+                handler_threads);
+
+    using namespace tradeflow::order;
+    vector<thread> pollers;
+    for (auto& queue : queues) {
+        grpc::ServerCompletionQueue* cq = queue.get();
+        pollers.emplace_back([&service, &handlers, cq] {
+            new UnaryCall<SubmitOrderRequest, SubmitOrderResponse>(&service, cq, &handlers,
+                                                                   &AsyncOrderService::RequestSubmitOrder,
+                                                                   &OrderServiceImpl::SubmitOrder);
+            new UnaryCall<GetOrderBookRequest, GetOrderBookResponse>(&service, cq, &handlers,
+                                                                     &AsyncOrderService::RequestGetOrderBook,
+                                                                     &OrderServiceImpl::GetOrderBook);
+            new UnaryCall<CancelOrderRequest, CancelOrderResponse>(&service, cq, &handlers,
+                                                                   &AsyncOrderService::RequestCancelOrder,
+                                                                   &OrderServiceImpl::CancelOrder);
+            new UnaryCall<ModifyOrderRequest, ModifyOrderResponse>(&service, cq, &handlers,
+                                                                   &AsyncOrderService::RequestModifyOrder,
+                                                                   &OrderServiceImpl::ModifyOrder);
+            new TradeStreamCall(&service, cq);
+            new UnaryCall<SubmitOrdersRequest, SubmitOrdersResponse>(&service, cq, &handlers,
+                                                                     &AsyncOrderService::RequestSubmitOrders,
+                                                                     &OrderServiceImpl::SubmitOrders);
+            new EntryStreamCall(&service, cq);
+            new BookStreamCall(&service, cq);
+            new UnaryCall<UncrossRequest, UncrossResponse>(&service, cq, &handlers, &AsyncOrderService::RequestUncross,
+                                                           &OrderServiceImpl::Uncross);
+            void* tag;
+            bool ok;
+            while (cq->Next(&tag, &ok)) static_cast<AsyncCall*>(tag)->proceed(ok);
+        });
+    }
+    for (auto& poller : pollers) poller.join();
+}
+
 } // namespace tradeflow
 
 void RunServer() {
     string server_address("0.0.0.0:50051");
-    tradeflow::OrderServiceImpl service;
 
     std::thread metrics_thread(tradeflow::MetricsHttpServer);
     metrics_thread.detach();
 
     ServerBuilder builder;
     builder.AddListeningPort(server_address, grpc::InsecureServerCredentials());
+    if (tradeflow::engine_config_.grpc_server == tradeflow::GrpcServerMode::ASYNC) {
+        TF_LOG_INFO("Order Matching Engine Server listening on {}", server_address);
+        tradeflow::RunAsyncServer(builder);
+        return;
+    }
+    tradeflow::OrderServiceImpl service;
     builder.RegisterService(&service);
 
     unique_ptr<Server> server(builder.BuildAndStart());
-    cout << "Order Matching Engine Server listening on " << server_address << endl;
+    TF_LOG_INFO("Order Matching Engine Server listening on {}", server_address);
 
     server->Wait();
 }
 
 int main(int argc, char** argv) {
+    tradeflow::engine_config_ = tradeflow::EngineConfig::fromEnvironment();
+    tradeflow::Logger::setLevel(tradeflow::engine_config_.log_level);
+    tradeflow::setStageTiming(tradeflow::engine_config_.latency_histograms);
+    // Symbols come from clients; cap the series they can add to the exposition
+    for (tradeflow::MetricFamily* family : {&tradeflow::metrics_symbol_submits, &tradeflow::metrics_symbol_trades,
+                                            &tradeflow::metrics_symbol_traded_quantity}) {
+        family->capLabel(0, tradeflow::engine_config_.metrics_max_symbols);
+    }
+    if (auto* tsc = dynamic_cast<const tradeflow::TscClock*>(tradeflow::engine_config_.book.clock)) {
+        TF_LOG_INFO("Trade timestamps from the TSC at {} ticks/us",
+                    static_cast<int64_t>(tsc->ticksPerNanosecond() * 1000));
+    } else {
+        TF_LOG_INFO("Trade timestamps from the system clock");
+    }
+    tradeflow::order_router_ = make_unique<tradeflow::OrderRouter>(tradeflow::engine_config_.router_stripes,
+                                                                  tradeflow::engine_config_.book.order_pool_reserve);
+    if (tradeflow::engine_config_.execution == tradeflow::ExecutionMode::SEQUENCER) {
+        const auto& config = tradeflow::engine_config_;
+        tradeflow::shard_map_ = tradeflow::ShardMap(config.shard_count, config.shard_overrides);
+        for (size_t i = 0; i < tradeflow::shard_map_.shardCount(); ++i) {
+            int cpu = config.shard_cores.empty() ? -1 : config.shard_cores[i % config.shard_cores.size()];
+            unique_ptr<tradeflow::TradeJournal> journal;
+            if (config.journal_enabled) {
+                journal = make_unique<tradeflow::TradeJournal>(
+                    config.journal_dir + "/trades-shard" + to_string(i) + ".journal", config.journal);
+            }
+            tradeflow::shards_.push_back(
+                make_unique<tradeflow::Shard>(i, config.sequencer_ring_capacity, cpu, move(journal)));
+        }
+        TF_LOG_INFO("Sequencer execution with {} shard(s)", tradeflow::shards_.size());
+    } else if (tradeflow::engine_config_.journal_enabled) {
+        const auto& config = tradeflow::engine_config_;
+        tradeflow::trade_journal_ = make_unique<tradeflow::TradeJournal>(config.journal_dir + "/trades.journal", config.journal);
+    }
+    if (!tradeflow::engine_config_.state_dir.empty()) {
+        tradeflow::RecoverState();
+        if (tradeflow::engine_config_.snapshot_interval_s > 0) thread(tradeflow::SnapshotLoop).detach();
+    }
     RunServer();
     return 0;
 }
@@ -0,0 +1,431 @@
+// Drives a running order-matching-engine over gRPC to compare server modes
+// (TRADEFLOW_GRPC_SERVER=sync|async) under the same load:
+//
+//   grpc_load [options]
+//
+// Clients submit crossing SELL/BUY pairs on one symbol as fast as their
+// round trips allow (one SubmitOrder per order, one SubmitOrders per batch,
+// or one batch at a time on an OrderEntryStream) while the subscribers stream
+// its trades and the book subscribers keep a copy of its levels from
+// SubscribeBook. On a call-auction symbol (TRADEFLOW_AUCTION_SYMBOLS) the
+// orders only collect; --uncross then trades them in one Uncross call once
+// the clients are done. Reports order throughput, round-trip latency, trades
+// delivered per subscriber, book update traffic (and whether each copy ends
+// equal to GetOrderBook) and the server's thread count
+// (tradeflow_process_threads, scraped from the metrics endpoint while the
+// load is running).
+#include <grpcpp/grpcpp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "order_matching/LatencyHistogram.hpp"
+#include "order_service.grpc.pb.h"
+
+using namespace std;
+using namespace tradeflow;
+using namespace tradeflow::order;
+
+namespace {
+
+struct LoadConfig {
+    string target = "localhost:50051";
+    string metrics = "localhost:9464";
+    string symbol = "LOAD";
+    size_t clients = 8;
+    size_t orders = 2000;  // per client
+    size_t subscribers = 0;
+    string mode = "unary";
+    size_t batch = 100;  // orders per round trip outside unary mode
+    size_t book_subscribers = 0;
+    uint32_t depth = 0;
+    uint32_t conflation_ms = 0;
+    size_t seed_levels = 0;  // resting levels per side placed before the run
+    bool uncross = false;    // call Uncross after the run (call-auction symbols)
+};
+
+void usage(const char* argv0) {
+    cerr << "Usage: " << argv0 << " [options]\n"
+         << "  --target HOST:PORT     gRPC endpoint (localhost:50051)\n"
+         << "  --metrics HOST:PORT    metrics endpoint to scrape the server's thread count from (localhost:9464)\n"
+         << "  --symbol S             book to load (LOAD)\n"
+         << "  --clients N            concurrent submitting clients, one channel each (8)\n"
+         << "  --orders N             orders per client, alternating SELL/BUY at one price (2000)\n"
+         << "  --subscribers N        SubscribeTrades streams on the symbol (0)\n"
+         << "  --mode unary|batch|stream\n"
+         << "                         SubmitOrder per order, SubmitOrders per batch, or batches on one\n"
+         << "                         OrderEntryStream per client, waiting for each batch's acks (unary)\n"
+         << "  --batch N              orders per SubmitOrders / stream request (100)\n"
+         << "  --book-subscribers N   SubscribeBook streams on the symbol (0)\n"
+         << "  --depth N              levels per side book subscribers ask for; 0 = all (0)\n"
+         << "  --conflation-ms N      book subscribers' conflation interval (0)\n"
+         << "  --seed-levels N        resting levels per side added around the traded price first (0)\n"
+         << "  --uncross              call Uncross once the clients are done (call-auction symbols)" << endl;
+}
+
+// Value of an unlabelled series from a Prometheus scrape; -1 when unreachable
+long long scrapeGauge(const string& endpoint, const string& name) {
+    size_t colon = endpoint.rfind(':');
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* address = nullptr;
+    if (getaddrinfo(endpoint.substr(0, colon).c_str(), endpoint.substr(colon + 1).c_str(), &hints, &address) != 0) {
+        return -1;
+    }
+    int fd = socket(address->ai_family, address->ai_socktype, 0);
+    bool connected = fd >= 0 && connect(fd, address->ai_addr, address->ai_addrlen) == 0;
+    freeaddrinfo(address);
+    if (!connected) {
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    string request = "GET /metrics HTTP/1.0\r\n\r\n";
+    if (send(fd, request.data(), request.size(), 0) < 0) {
+        close(fd);
+        return -1;
+    }
+    string response;
+    char buffer[4096];
+    for (ssize_t n; (n = recv(fd, buffer, sizeof(buffer), 0)) > 0;) response.append(buffer, n);
+    close(fd);
+    size_t at = response.find("\n" + name + " ");
+    return at == string::npos ? -1 : atoll(response.c_str() + at + name.size() + 2);
+}
+
+shared_ptr<grpc::Channel> dedicatedChannel(const string& target) {
+    // A subchannel pool of its own, so every client gets its own connection
+    grpc::ChannelArguments args;
+    args.SetInt(GRPC_ARG_USE_LOCAL_SUBCHANNEL_POOL, 1);
+    return grpc::CreateCustomChannel(target, grpc::InsecureChannelCredentials(), args);
+}
+
+// A SubscribeBook client's copy of the book
+struct BookCopy {
+    map<double, int32_t, greater<double>> bids;
+    map<double, int32_t> asks;
+    uint64_t messages = 0;
+    uint64_t bytes = 0;
+    uint64_t out_of_order = 0;  // sequence went backwards
+    uint64_t sequence = 0;
+
+    void apply(const BookUpdate& update) {
+        ++messages;
+        bytes += update.ByteSizeLong();
+        if (update.sequence() < sequence) ++out_of_order;
+        sequence = update.sequence();
+        if (update.snapshot()) {
+            bids.clear();
+            asks.clear();
+        }
+        for (const auto& level : update.bids()) set(bids, level);
+        for (const auto& level : update.asks()) set(asks, level);
+    }
+
+    template <typename Side>
+    static void set(Side& side, const OrderBookEntry& level) {
+        if (level.quantity() == 0) side.erase(level.price());
+        else side[level.price()] = level.quantity();
+    }
+
+    // Equal to a GetOrderBook response cut to depth levels per side
+    bool matches(const GetOrderBookResponse& book, size_t depth) const {
+        auto same = [depth](const auto& copy, const auto& levels) {
+            size_t count = depth ? min<size_t>(depth, levels.size()) : levels.size();
+            if (copy.size() != count) return false;
+            auto it = copy.begin();
+            for (size_t i = 0; i < count; ++i, ++it) {
+                if (it->first != levels[i].price() || it->second != levels[i].quantity()) return false;
+            }
+            return true;
+        };
+        return same(bids, book.bids()) && same(asks, book.asks());
+    }
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    LoadConfig config;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--uncross") {
+            config.uncross = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return 2;
+        }
+        const char* value = argv[++i];
+        if (arg == "--target") config.target = value;
+        else if (arg == "--metrics") config.metrics = value;
+        else if (arg == "--symbol") config.symbol = value;
+        else if (arg == "--clients") config.clients = strtoull(value, nullptr, 10);
+        else if (arg == "--orders") config.orders = strtoull(value, nullptr, 10);
+        else if (arg == "--subscribers") config.subscribers = strtoull(value, nullptr, 10);
+        else if (arg == "--mode") config.mode = value;
+        else if (arg == "--batch") config.batch = max<size_t>(1, strtoull(value, nullptr, 10));
+        else if (arg == "--book-subscribers") config.book_subscribers = strtoull(value, nullptr, 10);
+        else if (arg == "--depth") config.depth = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+        else if (arg == "--conflation-ms") config.conflation_ms = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+        else if (arg == "--seed-levels") config.seed_levels = strtoull(value, nullptr, 10);
+        else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (config.mode != "unary" && config.mode != "batch" && config.mode != "stream") {
+        usage(argv[0]);
+        return 2;
+    }
+    if (config.mode == "unary") config.batch = 1;
+
+    // Resting levels on both sides, clear of the traded price
+    auto subscriber_channel = dedicatedChannel(config.target);
+    auto subscriber_stub = OrderService::NewStub(subscriber_channel);
+    for (size_t level = 1; level <= config.seed_levels; ++level) {
+        for (const char* side : {"BUY", "SELL"}) {
+            grpc::ClientContext context;
+            SubmitOrderRequest request;
+            SubmitOrderResponse response;
+            request.set_symbol(config.symbol);
+            request.set_side(side);
+            request.set_price(100.0 + (side[0] == 'B' ? -0.01 : 0.01) * static_cast<double>(level));
+            request.set_quantity(static_cast<int32_t>(level));
+            request.set_client_id("load-seed");
+            subscriber_stub->SubmitOrder(&context, request, &response);
+        }
+    }
+
+    // Subscribers first, so every one of them sees every trade of the run
+    vector<unique_ptr<grpc::ClientContext>> subscriber_contexts;
+    vector<thread> subscribers;
+    atomic<uint64_t> delivered{0};
+    const string active = "tradeflow_order_service_active_trade_subscriptions";
+    long long active_before = max(0LL, scrapeGauge(config.metrics, active));
+    for (size_t i = 0; i < config.subscribers; ++i) {
+        subscriber_contexts.push_back(make_unique<grpc::ClientContext>());
+        grpc::ClientContext* context = subscriber_contexts.back().get();
+        subscribers.emplace_back([&, context] {
+            SubscribeTradesRequest request;
+            request.set_symbol(config.symbol);
+            auto reader = subscriber_stub->SubscribeTrades(context, request);
+            TradeUpdate update;
+            while (reader->Read(&update)) delivered.fetch_add(1, memory_order_relaxed);
+            reader->Finish();
+        });
+    }
+    // The sync server only sends a stream's headers with its first trade, so
+    // wait for the server to count the streams instead (for up to 10 s)
+    for (int i = 0; i < 1000 && config.subscribers > 0; ++i) {
+        if (scrapeGauge(config.metrics, active) >= active_before + static_cast<long long>(config.subscribers)) break;
+        this_thread::sleep_for(chrono::milliseconds(10));
+    }
+    vector<BookCopy> copies(config.book_subscribers);
+    mutex copies_mutex;
+    vector<thread> book_subscribers;
+    atomic<size_t> books_subscribed{0};
+    for (size_t i = 0; i < config.book_subscribers; ++i) {
+        subscriber_contexts.push_back(make_unique<grpc::ClientContext>());
+        grpc::ClientContext* context = subscriber_contexts.back().get();
+        book_subscribers.emplace_back([&, context, i] {
+            SubscribeBookRequest request;
+            request.set_symbol(config.symbol);
+            request.set_depth(config.depth);
+            request.set_conflation_ms(config.conflation_ms);
+            auto reader = subscriber_stub->SubscribeBook(context, request);
+            BookUpdate update;
+            bool first = true;
+            while (reader->Read(&update)) {
+                lock_guard<mutex> lock(copies_mutex);
+                copies[i].apply(update);
+                if (first) books_subscribed.fetch_add(1);
+                first = false;
+            }
+            reader->Finish();
+        });
+    }
+    // Each book stream starts with its snapshot
+    for (int i = 0; i < 1000 && books_subscribed.load() < config.book_subscribers; ++i) {
+        this_thread::sleep_for(chrono::milliseconds(10));
+    }
+
+    LatencyHistogram latency;  // per round trip
+    atomic<uint64_t> failed{0};
+    atomic<uint64_t> trades{0};
+    vector<thread> clients;
+    auto start = chrono::steady_clock::now();
+    for (size_t c = 0; c < config.clients; ++c) {
+        clients.emplace_back([&, c] {
+            auto stub = OrderService::NewStub(dedicatedChannel(config.target));
+            const string client_id = "load-" + to_string(c);
+            auto order = [&](SubmitOrderRequest& request, size_t i) {
+                request.set_symbol(config.symbol);
+                request.set_side(i % 2 ? "BUY" : "SELL");
+                request.set_price(100.0);
+                request.set_quantity(10);
+                request.set_client_id(client_id);
+                if (i % 2) trades.fetch_add(1, memory_order_relaxed);
+            };
+            auto check = [&](const SubmitOrderResponse& response) {
+                if (response.status() != "ACCEPTED") failed.fetch_add(1, memory_order_relaxed);
+            };
+
+            grpc::ClientContext stream_context;
+            unique_ptr<grpc::ClientReaderWriter<OrderEntryRequest, OrderEntryResponse>> stream;
+            if (config.mode == "stream") stream = stub->OrderEntryStream(&stream_context);
+
+            for (size_t sent = 0; sent < config.orders;) {
+                size_t count = min(config.batch, config.orders - sent);
+                uint64_t begin = monotonicNanos();
+                if (config.mode == "unary") {
+                    grpc::ClientContext context;
+                    SubmitOrderRequest request;
+                    SubmitOrderResponse response;
+                    order(request, sent);
+                    grpc::Status status = stub->SubmitOrder(&context, request, &response);
+                    if (status.ok()) check(response);
+                    else failed.fetch_add(1, memory_order_relaxed);
+                } else if (config.mode == "batch") {
+                    grpc::ClientContext context;
+                    SubmitOrdersRequest request;
+                    SubmitOrdersResponse response;
+                    for (size_t i = 0; i < count; ++i) order(*request.add_orders(), sent + i);
+                    grpc::Status status = stub->SubmitOrders(&context, request, &response);
+                    if (status.ok()) for (const auto& result : response.results()) check(result);
+                    else failed.fetch_add(count, memory_order_relaxed);
+                } else {
+                    OrderEntryRequest request;
+                    for (size_t i = 0; i < count; ++i) {
+                        OrderEntryCommand* command = request.add_commands();
+                        command->set_client_sequence(sent + i);
+                        order(*command->mutable_submit(), sent + i);
+                    }
+                    if (!stream->Write(request)) {
+                        failed.fetch_add(config.orders - sent, memory_order_relaxed);
+                        break;
+                    }
+                    // Fills of this client's orders arrive on the stream too; skip them
+                    OrderEntryResponse response;
+                    for (size_t acked = 0; acked < count && stream->Read(&response);) {
+                        if (!response.has_submit()) continue;
+                        check(response.submit());
+                        ++acked;
+                    }
+                }
+                latency.record(monotonicNanos() - begin);
+                sent += count;
+            }
+            if (stream) {
+                stream->WritesDone();
+                OrderEntryResponse response;
+                while (stream->Read(&response)) {}
+                stream->Finish();
+            }
+        });
+    }
+    this_thread::sleep_for(chrono::milliseconds(200));
+    long long server_threads = scrapeGauge(config.metrics, "tradeflow_process_threads");
+    for (auto& client : clients) client.join();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    // What the book indicated after the last order, then what the uncross traded
+    GetOrderBookResponse indicated;
+    UncrossResponse uncrossed;
+    uint64_t uncross_us = 0;
+    if (config.uncross) {
+        grpc::ClientContext book_context;
+        GetOrderBookRequest book_request;
+        book_request.set_symbol(config.symbol);
+        subscriber_stub->GetOrderBook(&book_context, book_request, &indicated);
+        grpc::ClientContext context;
+        UncrossRequest request;
+        request.set_symbol(config.symbol);
+        uint64_t begin = monotonicNanos();
+        subscriber_stub->Uncross(&context, request, &uncrossed);
+        uncross_us = (monotonicNanos() - begin) / 1000;
+    }
+
+    // Let the streams drain (until nothing arrives for a second), then hang up
+    uint64_t expected = trades.load() * config.subscribers;
+    for (uint64_t seen = ~0ull; delivered.load() < expected && delivered.load() != seen;) {
+        seen = delivered.load();
+        this_thread::sleep_for(chrono::seconds(1));
+    }
+    long long skipped = scrapeGauge(config.metrics, "tradeflow_order_service_trade_updates_skipped_total");
+    // Book copies settle once nothing has arrived for a second (conflation included)
+    auto book_messages = [&] {
+        lock_guard<mutex> lock(copies_mutex);
+        uint64_t total = 0;
+        for (const auto& copy : copies) total += copy.messages;
+        return total;
+    };
+    for (uint64_t seen = ~0ull; config.book_subscribers > 0 && book_messages() != seen;) {
+        seen = book_messages();
+        this_thread::sleep_for(chrono::seconds(1));
+    }
+    GetOrderBookResponse final_book;
+    if (config.book_subscribers > 0) {
+        grpc::ClientContext context;
+        GetOrderBookRequest request;
+        request.set_symbol(config.symbol);
+        request.set_depth(config.depth);
+        subscriber_stub->GetOrderBook(&context, request, &final_book);
+    }
+    for (auto& context : subscriber_contexts) context->TryCancel();
+    for (auto& subscriber : subscribers) subscriber.join();
+    for (auto& subscriber : book_subscribers) subscriber.join();
+
+    HistogramSnapshot snapshot = latency.snapshot();
+    uint64_t orders = config.clients * config.orders;
+    cout << fixed << setprecision(1);
+    cout << "orders:         " << orders << " in " << seconds << " s (" << orders / seconds << " orders/s, "
+         << snapshot.count / seconds << " round trips/s, " << config.mode << "), " << failed.load() << " not accepted\n";
+    cout << "round trip:     p50 " << snapshot.quantile(0.5) / 1000.0 << " us, p99 " << snapshot.quantile(0.99) / 1000.0
+         << " us, p99.9 " << snapshot.quantile(0.999) / 1000.0 << " us (" << config.batch << " order(s) each)\n";
+    if (config.subscribers > 0) {
+        cout << "trade updates:  " << delivered.load() << " of " << expected << " delivered to " << config.subscribers
+             << " subscriber(s)";
+        if (skipped > 0) cout << ", " << skipped << " skipped by the server (subscriber lapped)";
+        cout << '\n';
+    }
+    if (config.uncross) {
+        cout << "auction:        indicated " << indicated.auction().volume() << " @ " << indicated.auction().price()
+             << ", " << uncrossed.status() << " " << uncrossed.auction().volume() << " @ "
+             << uncrossed.auction().price() << " (imbalance " << uncrossed.auction().imbalance() << ") in "
+             << uncross_us << " us\n";
+    }
+    if (config.book_subscribers > 0) {
+        uint64_t messages = 0;
+        uint64_t bytes = 0;
+        uint64_t out_of_order = 0;
+        size_t matching = 0;
+        for (const auto& copy : copies) {
+            messages += copy.messages;
+            bytes += copy.bytes;
+            out_of_order += copy.out_of_order;
+            if (copy.matches(final_book, config.depth)) ++matching;
+        }
+        cout << "book updates:   " << messages / config.book_subscribers << " messages, "
+             << bytes / config.book_subscribers << " bytes per subscriber (depth " << config.depth << ", conflation "
+             << config.conflation_ms << " ms); GetOrderBook is " << final_book.ByteSizeLong() << " bytes per call\n";
+        cout << "book copies:    " << matching << " of " << config.book_subscribers << " equal GetOrderBook at the end";
+        if (out_of_order > 0) cout << ", " << out_of_order << " update(s) out of sequence";
+        cout << '\n';
+    }
+    cout << "server threads: " << (server_threads < 0 ? string("unavailable") : to_string(server_threads)) << endl;
+    return failed.load() == 0 ? 0 : 1;
+}
@@ -0,0 +1,145 @@
+// Replays an order event stream into fresh order books as fast as they will
+// take it and reports throughput plus fingerprints of the result:
+//
+//   replay_runner [--mode price_time|pro_rata] [--min-allocation N] [--top-order]
+//                 [--layout map|ladder] [--reserve N] <replay.bin|replay.json>
+//   replay_runner --convert <replay.json> <replay.bin>
+//
+// Binary replays (see Replay.hpp) are memory-mapped and streamed without
+// parsing; JSON replays are converted to a temporary binary file first.
+// Two runs over the same events print the same checksums, so the output
+// doubles as a regression check for matching changes.
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <nlohmann/json.hpp>
+#include "order_matching/ReplayJson.hpp"
+
+using namespace std;
+using namespace tradeflow;
+
+namespace {
+
+void usage(const char* argv0) {
+    cerr << "Usage: " << argv0 << " [--mode price_time|pro_rata] [--min-allocation N] [--top-order]"
+         << " [--layout map|ladder] [--reserve N] <replay>\n"
+         << "       " << argv0 << " --convert <replay.json> <replay.bin>" << endl;
+}
+
+bool isBinaryReplay(const string& path) {
+    ifstream in(path, ios::binary);
+    char magic[sizeof(REPLAY_MAGIC)] = {};
+    in.read(magic, sizeof(magic));
+    return in.gcount() == sizeof(magic) && memcmp(magic, REPLAY_MAGIC, sizeof(magic)) == 0;
+}
+
+string hex64(uint64_t value) {
+    char text[17];
+    snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(value));
+    return text;
+}
+
+uint64_t convert(const string& json_path, const string& out_path) {
+    ifstream in(json_path);
+    if (!in) throw runtime_error("Cannot open " + json_path);
+    nlohmann::json doc;
+    in >> doc;
+    ReplayWriter writer(out_path);
+    uint64_t events = convertJsonReplay(doc, writer);
+    writer.finish();
+    return events;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    MatchingMode mode = MatchingMode::PRICE_TIME_PRIORITY;
+    OrderBookConfig config;
+    string input;
+    string convert_out;
+    bool converting = false;
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--convert" && i + 2 < argc) {
+            converting = true;
+            input = argv[++i];
+            convert_out = argv[++i];
+        } else if (arg == "--mode" && has_value) {
+            string value = argv[++i];
+            if (value == "price_time") mode = MatchingMode::PRICE_TIME_PRIORITY;
+            else if (value == "pro_rata") mode = MatchingMode::PRO_RATA;
+            else { usage(argv[0]); return 2; }
+        } else if (arg == "--min-allocation" && has_value) {
+            config.pro_rata.min_allocation = static_cast<Quantity>(strtol(argv[++i], nullptr, 10));
+        } else if (arg == "--top-order") {
+            config.pro_rata.top_order = true;
+        } else if (arg == "--layout" && has_value) {
+            string value = argv[++i];
+            if (value == "map") config.layout = BookLayout::SPARSE_MAP;
+            else if (value == "ladder") config.layout = BookLayout::TICK_LADDER;
+            else { usage(argv[0]); return 2; }
+        } else if (arg == "--reserve" && has_value) {
+            config.order_pool_reserve = strtoull(argv[++i], nullptr, 10);
+        } else if (!arg.empty() && arg[0] != '-' && input.empty()) {
+            input = arg;
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (input.empty()) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    try {
+        if (converting) {
+            uint64_t events = convert(input, convert_out);
+            cout << "converted " << events << " events to " << convert_out << endl;
+            return 0;
+        }
+
+        string replay_path = input;
+        string temporary;
+        if (!isBinaryReplay(input)) {
+            char name[] = "/tmp/replay-XXXXXX";
+            int fd = mkstemp(name);
+            if (fd < 0) throw runtime_error(string("mkstemp: ") + strerror(errno));
+            close(fd);
+            temporary = name;
+            replay_path = temporary;
+        }
+        ReplayStats stats;
+        try {
+            if (!temporary.empty()) convert(input, temporary);
+            stats = runReplay(replay_path, mode, config);
+        } catch (...) {
+            if (!temporary.empty()) unlink(temporary.c_str());
+            throw;
+        }
+        if (!temporary.empty()) unlink(temporary.c_str());
+
+        cout << "events=" << stats.events << '\n'
+             << "books=" << stats.books << '\n'
+             << "seconds=" << stats.seconds << '\n'
+             << "events_per_sec=" << static_cast<uint64_t>(stats.seconds > 0 ? stats.events / stats.seconds : 0) << '\n'
+             << "trades=" << stats.trades << '\n'
+             << "traded_quantity=" << stats.traded_quantity << '\n'
+             << "rejected=" << stats.rejected << '\n'
+             << "resting_orders=" << stats.resting_orders << '\n'
+             << "trade_checksum=" << hex64(stats.trade_checksum) << '\n'
+             << "book_checksum=" << hex64(stats.book_checksum) << endl;
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
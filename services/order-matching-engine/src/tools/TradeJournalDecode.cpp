@@ -0,0 +1,51 @@
+// Converts binary trade journals back to the CSV layout the old TradeLog
+// wrote: timestamp_ms,buy_order_id,sell_order_id,price,quantity,symbol
+//
+//   trade_journal_decode [--ns] [--header] trades.journal [more.journal ...] > trades.csv
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "order_matching/TradeJournal.hpp"
+
+using namespace std;
+using namespace tradeflow;
+
+int main(int argc, char** argv) {
+    bool nanos = false;
+    bool header = false;
+    vector<string> paths;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--ns") nanos = true;
+        else if (arg == "--header") header = true;
+        else paths.push_back(arg);
+    }
+    if (paths.empty()) {
+        cerr << "Usage: " << argv[0] << " [--ns] [--header] <journal> [journal ...]" << endl;
+        return 2;
+    }
+
+    ios::sync_with_stdio(false);
+    if (header) {
+        cout << (nanos ? "timestamp_ns" : "timestamp_ms") << ",buy_order_id,sell_order_id,price,quantity,symbol\n";
+    }
+    for (const auto& path : paths) {
+        try {
+            TradeJournalReader reader(path);
+            TradeRecord record;
+            while (reader.next(record)) {
+                int64_t ts = nanos ? record.timestamp_ns : record.timestamp_ns / 1000000;
+                cout << ts << ',' << record.buy_order_id << ',' << record.sell_order_id << ',' << record.price << ','
+                     << record.quantity << ',';
+                cout.write(record.symbol, strnlen(record.symbol, sizeof(record.symbol)));
+                cout << '\n';
+            }
+        } catch (const exception& e) {
+            cerr << e.what() << endl;
+            return 1;
+        }
+    }
+    return 0;
+}
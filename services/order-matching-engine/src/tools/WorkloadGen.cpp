@@ -0,0 +1,117 @@
+// Synthesizes a replay file of production-like order flow for replay_runner
+// and the benchmarks:
+//
+//   workload_gen [options] <out.bin>
+//
+// Every option maps to a WorkloadConfig field (see Workload.hpp); the same
+// options and seed always produce the same file.
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include "order_matching/Workload.hpp"
+
+using namespace std;
+using namespace tradeflow;
+
+namespace {
+
+void usage(const char* argv0) {
+    cerr << "Usage: " << argv0 << " [options] <out.bin>\n"
+         << "  --seed N               random seed (1)\n"
+         << "  --events N             order events after the initial depth (1000000)\n"
+         << "  --symbols N            number of books (16)\n"
+         << "  --zipf S               symbol popularity exponent, 0 = uniform (1.0)\n"
+         << "  --price TICKS          starting mid price (10000)\n"
+         << "  --walk P               chance per event that the mid moves a tick (0.02)\n"
+         << "  --depth TICKS          passive orders rest up to this far from the mid (20)\n"
+         << "  --initial-levels N     levels per side added up front (10)\n"
+         << "  --orders-per-level N   orders per initial level (4)\n"
+         << "  --cancel R             share of events that cancel (0.35)\n"
+         << "  --modify R             share of events that modify (0.10)\n"
+         << "  --aggressor R          share of events that cross the spread (0.10)\n"
+         << "  --market R --ioc R --fok R\n"
+         << "                         aggressor type mix; the rest are crossing LIMITs (0.10 / 0.40 / 0.05)\n"
+         << "  --sweep TICKS          aggressors reach up to this far through the mid (3)\n"
+         << "  --size fixed|uniform|lognormal\n"
+         << "                         order size distribution in lots (lognormal)\n"
+         << "  --size-min N --size-max N --size-sigma S --lot N\n"
+         << "                         size bounds in lots, lognormal spread, lot size (1 / 100 / 1.0 / 100)" << endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    WorkloadConfig config;
+    string output;
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg.size() > 2 && arg[0] == '-' && arg[1] == '-') {
+            if (i + 1 >= argc) {
+                usage(argv[0]);
+                return 2;
+            }
+            const char* value = argv[++i];
+            if (arg == "--seed") config.seed = strtoull(value, nullptr, 10);
+            else if (arg == "--events") config.events = strtoull(value, nullptr, 10);
+            else if (arg == "--symbols") config.symbols = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+            else if (arg == "--zipf") config.zipf_exponent = strtod(value, nullptr);
+            else if (arg == "--price") config.start_price = strtoll(value, nullptr, 10);
+            else if (arg == "--walk") config.walk_probability = strtod(value, nullptr);
+            else if (arg == "--depth") config.depth = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+            else if (arg == "--initial-levels") config.initial_levels = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+            else if (arg == "--orders-per-level") config.orders_per_level = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+            else if (arg == "--cancel") config.cancel_ratio = strtod(value, nullptr);
+            else if (arg == "--modify") config.modify_ratio = strtod(value, nullptr);
+            else if (arg == "--aggressor") config.aggressor_ratio = strtod(value, nullptr);
+            else if (arg == "--market") config.market_share = strtod(value, nullptr);
+            else if (arg == "--ioc") config.ioc_share = strtod(value, nullptr);
+            else if (arg == "--fok") config.fok_share = strtod(value, nullptr);
+            else if (arg == "--sweep") config.sweep_levels = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+            else if (arg == "--size-min") config.size_min = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+            else if (arg == "--size-max") config.size_max = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+            else if (arg == "--size-sigma") config.size_sigma = strtod(value, nullptr);
+            else if (arg == "--lot") config.lot = static_cast<Quantity>(strtol(value, nullptr, 10));
+            else if (arg == "--size") {
+                string name = value;
+                if (name == "fixed") config.size_distribution = SizeDistribution::FIXED;
+                else if (name == "uniform") config.size_distribution = SizeDistribution::UNIFORM;
+                else if (name == "lognormal") config.size_distribution = SizeDistribution::LOGNORMAL;
+                else {
+                    usage(argv[0]);
+                    return 2;
+                }
+            } else {
+                usage(argv[0]);
+                return 2;
+            }
+        } else if (output.empty()) {
+            output = arg;
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (output.empty()) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    try {
+        ReplayWriter writer(output);
+        WorkloadSummary summary = generateWorkload(config, writer);
+        writer.finish();
+        cout << "events=" << summary.events << '\n'
+             << "adds=" << summary.adds << '\n'
+             << "passive=" << summary.passive << '\n'
+             << "aggressive=" << summary.aggressive << '\n'
+             << "cancels=" << summary.cancels << '\n'
+             << "modifies=" << summary.modifies << '\n'
+             << "last_order_id=" << summary.last_order_id << endl;
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -29,7 +29,7 @@ fi
 rm -f "$LOGFILE" "$PIDFILE"
 
 echo "Starting server..."
-nohup "$BIN" > "$LOGFILE" 2>&1 &
+TRADEFLOW_LOG_LEVEL=debug nohup "$BIN" > "$LOGFILE" 2>&1 &
 echo $! > "$PIDFILE"
 sleep 0.5
 
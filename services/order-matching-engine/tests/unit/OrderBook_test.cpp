@@ -1,12 +1,102 @@
 #include <gtest/gtest.h>
+#include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <map>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+#include <sys/resource.h>
+#include "order_matching/BroadcastRing.hpp"
+#include "order_matching/Clock.hpp"
+#include "order_matching/CommandLog.hpp"
+#include "order_matching/DepthView.hpp"
+#include "order_matching/Interner.hpp"
+#include "order_matching/LatencyHistogram.hpp"
+#include "order_matching/Logger.hpp"
+#include "order_matching/MetricsRegistry.hpp"
 #include "order_matching/OrderBook.hpp"
+#include "order_matching/OrderRouter.hpp"
+#include "order_matching/ProRataAllocator.hpp"
+#include "order_matching/Sequencer.hpp"
+#include "order_matching/Shard.hpp"
+#include "order_matching/Snapshot.hpp"
+#include "order_matching/TradeJournal.hpp"
 
 using namespace tradeflow;
 
+// Count global heap allocations so tests can assert the steady-state book
+// path stays off the allocator. Every replaceable allocation function is
+// replaced, all on malloc/free, so each new pairs with a matching delete.
+static std::atomic<size_t> g_heap_allocations{0};
+
+static void* countedAlloc(std::size_t size, std::size_t alignment = 0) noexcept {
+    g_heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (size == 0) size = 1;
+    if (alignment <= alignof(std::max_align_t)) return std::malloc(size);
+    return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+}
+
+static void* countedAllocOrThrow(std::size_t size, std::size_t alignment = 0) {
+    if (void* p = countedAlloc(size, alignment)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size) { return countedAllocOrThrow(size); }
+void* operator new[](std::size_t size) { return countedAllocOrThrow(size); }
+void* operator new(std::size_t size, std::align_val_t al) { return countedAllocOrThrow(size, std::size_t(al)); }
+void* operator new[](std::size_t size, std::align_val_t al) { return countedAllocOrThrow(size, std::size_t(al)); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return countedAlloc(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return countedAlloc(size); }
+void* operator new(std::size_t size, std::align_val_t al, const std::nothrow_t&) noexcept {
+    return countedAlloc(size, std::size_t(al));
+}
+void* operator new[](std::size_t size, std::align_val_t al, const std::nothrow_t&) noexcept {
+    return countedAlloc(size, std::size_t(al));
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { std::free(p); }
+
 namespace {
 
+// Deterministic 64-bit LCG for the randomised tests; next() yields the high
+// 31 bits, next(bound) a value in [0, bound).
+class TestRng {
+public:
+    explicit TestRng(uint64_t seed) : state_(seed) {}
+
+    uint64_t operator()() {
+        state_ = state_ * 6364136223846793005ull + 1442695040888963407ull;
+        return state_ >> 33;
+    }
+    uint64_t operator()(uint64_t bound) { return (*this)() % bound; }
+
+private:
+    uint64_t state_;
+};
+
 TEST(OrderBookTest, MatchesOrdersPriceTime) {
     OrderBook ob("TEST", MatchingMode::PRICE_TIME_PRIORITY);
 
@@ -30,6 +120,8 @@ TEST(OrderBookTest, MatchesOrdersPriceTime) {
     EXPECT_EQ(2, captured.sell_order_id);
     EXPECT_EQ(15000, captured.price);
     EXPECT_EQ(50, captured.quantity);
+    EXPECT_EQ(ob.getSymbolHandle(), captured.symbol);
+    EXPECT_EQ("TEST", symbolNames().name(captured.symbol));
 
     const auto bids = ob.getBidLevels();
     ASSERT_FALSE(bids.empty());
@@ -57,5 +149,1399 @@ TEST(OrderBookTest, CancelAndModifyOrder) {
     EXPECT_TRUE(bids.empty());
 }
 
-}  // namespace
+TEST(OrderBookTest, ModifyRejectsNonPositiveQuantityAndPrice) {
+    for (MatchingMode mode : {MatchingMode::PRICE_TIME_PRIORITY, MatchingMode::PRO_RATA}) {
+        OrderBook ob("TEST", mode);
+        std::vector<Trade> trades;
+        ob.setTradeCallback([&](const Trade& trade) { trades.push_back(trade); });
+
+        ASSERT_TRUE(ob.addOrder(1, true, 10, 10000, "buyer"));
+        ASSERT_TRUE(ob.addOrder(2, false, 4, 10100, "seller"));
+
+        EXPECT_THROW(ob.modifyOrder(2, 0, 10000), std::invalid_argument);
+        EXPECT_THROW(ob.modifyOrder(2, -5, 10000), std::invalid_argument);
+        EXPECT_THROW(ob.modifyOrder(2, 4, 0), std::invalid_argument);
+        EXPECT_THROW(ob.modifyOrder(2, 4, -10000), std::invalid_argument);
+        // Rejected even when the order does not exist
+        EXPECT_THROW(ob.modifyOrder(99, 0, 10000), std::invalid_argument);
+
+        std::vector<BookCommand> commands(1);
+        commands[0].kind = BookCommand::Kind::MODIFY;
+        commands[0].id = 2;
+        commands[0].quantity = -5;
+        commands[0].price = 10000;
+        std::vector<BookCommandResult> results;
+        EXPECT_THROW(ob.applyBatch(commands, results), std::invalid_argument);
+
+        ob.triggerMatching();
+        EXPECT_TRUE(trades.empty());
+        const auto bids = ob.getBidLevels();
+        ASSERT_EQ(1u, bids.size());
+        EXPECT_EQ(10, bids.front().second);
+        const auto asks = ob.getAskLevels();
+        ASSERT_EQ(1u, asks.size());
+        EXPECT_EQ(10100, asks.front().first);
+        EXPECT_EQ(4, asks.front().second);
+    }
+}
+
+TEST(OrderBookTest, BatchMarksOnlyTheCommandsItApplied) {
+    OrderBook ob("TEST");
+    std::vector<BookCommand> commands(3);
+    commands[0].id = 1;
+    commands[0].is_buy = true;
+    commands[0].quantity = 10;
+    commands[0].price = 10000;
+    commands[0].client_id = "buyer";
+    commands[1].kind = BookCommand::Kind::MODIFY;
+    commands[1].id = 1;
+    commands[1].quantity = 0;
+    commands[1].price = 10000;
+    commands[2] = commands[0];
+    commands[2].id = 2;
+    std::vector<BookCommandResult> results;
+    EXPECT_THROW(ob.applyBatch(commands, results), std::invalid_argument);
+
+    ASSERT_EQ(3u, results.size());
+    EXPECT_TRUE(results[0].applied);
+    EXPECT_FALSE(results[1].applied);
+    EXPECT_FALSE(results[2].applied);
+    const auto bids = ob.getBidLevels();
+    ASSERT_EQ(1u, bids.size());
+    EXPECT_EQ(10, bids.front().second);
+}
+
+TEST(OrderBookTest, ModifyAndMatchPublishesTheCrossOnce) {
+    OrderBook ob("TEST");
+    std::vector<Trade> trades;
+    std::vector<uint64_t> publishes;
+    ob.setTradeCallback([&](const Trade& trade) { trades.push_back(trade); });
+    ob.setDepthCallback([&](uint64_t sequence, const std::vector<LevelUpdate>&) { publishes.push_back(sequence); });
+    ASSERT_TRUE(ob.addOrder(1, true, 10, 100, "buyer"));
+    ASSERT_TRUE(ob.addOrder(2, false, 4, 101, "seller"));
+    publishes.clear();
+
+    EXPECT_FALSE(ob.modifyAndMatch(99, 4, 100));
+    EXPECT_TRUE(publishes.empty());
+    EXPECT_TRUE(ob.modifyAndMatch(2, 4, 100));
+    ASSERT_EQ(1u, trades.size());
+    EXPECT_EQ(4, trades[0].quantity);
+    EXPECT_EQ(100, trades[0].price);
+    // The repriced ask never shows as resting crossed
+    EXPECT_EQ(1u, publishes.size());
+    EXPECT_EQ((std::vector<std::pair<Price, Quantity>>{{100, 6}}), ob.getBidLevels());
+    EXPECT_TRUE(ob.getAskLevels().empty());
+}
+
+TEST(OrderBookTest, CancelFromMiddleKeepsTimePriority) {
+    OrderBook ob("TEST", MatchingMode::PRICE_TIME_PRIORITY);
+
+    ASSERT_TRUE(ob.addOrder(1, true, 10, 10000, "a"));
+    ASSERT_TRUE(ob.addOrder(2, true, 20, 10000, "b"));
+    ASSERT_TRUE(ob.addOrder(3, true, 30, 10000, "c"));
+    EXPECT_TRUE(ob.cancelOrder(2));
+    EXPECT_FALSE(ob.cancelOrder(2));
+
+    auto bids = ob.getBidLevels();
+    ASSERT_EQ(1u, bids.size());
+    EXPECT_EQ(40, bids.front().second);
+
+    std::vector<OrderId> filled;
+    ob.setTradeCallback([&](const Trade& trade) { filled.push_back(trade.buy_order_id); });
+    ASSERT_TRUE(ob.addOrder(4, false, 40, 10000, "d"));
+    ob.triggerMatching();
+
+    ASSERT_EQ(2u, filled.size());
+    EXPECT_EQ(1, filled[0]);
+    EXPECT_EQ(3, filled[1]);
+    EXPECT_TRUE(ob.getBidLevels().empty());
+    EXPECT_TRUE(ob.getAskLevels().empty());
+}
+
+TEST(OrderBookTest, SteadyStateDoesNotAllocate) {
+    OrderBookConfig config;
+    config.order_pool_reserve = 64;
+    config.level_pool_reserve = 16;
+    OrderBook ob("TEST", MatchingMode::PRICE_TIME_PRIORITY, config);
+
+    const std::string client = "client-with-a-long-identifier";
+    OrderId id = 1;
+    auto cycle = [&]() {
+        for (int i = 0; i < 8; ++i) {
+            ASSERT_TRUE(ob.addOrder(id++, true, 10, 10000 - i, client));
+        }
+        ASSERT_TRUE(ob.addOrder(id++, false, 25, 9990, client));
+        ob.triggerMatching();
+        for (OrderId cancel = id - 9; cancel < id; ++cancel) {
+            ob.cancelOrder(cancel);
+        }
+    };
+
+    // Warm-up grows the node pools to their working set
+    for (int i = 0; i < 16; ++i) cycle();
+    const size_t before = g_heap_allocations.load();
+    for (int i = 0; i < 256; ++i) cycle();
+    EXPECT_EQ(before, g_heap_allocations.load()) << "add/match/cancel should be served from the book's pools";
+
+    PoolStats orders = ob.getOrderPoolStats();
+    EXPECT_EQ(0u, orders.in_use);
+    EXPECT_LE(orders.high_water, 64u);
+    EXPECT_EQ(1u, orders.slabs);
+}
+
+TEST(OrderBookTest, PublishedPoolStatsFollowTheBook) {
+    OrderBookConfig config;
+    config.order_pool_reserve = 8;
+    config.order_pool_slab_size = 8;
+    OrderBook ob("TEST", MatchingMode::PRICE_TIME_PRIORITY, config);
+    auto same = [](const PoolStats& a, const PoolStats& b) {
+        return a.capacity == b.capacity && a.in_use == b.in_use && a.high_water == b.high_water && a.slabs == b.slabs;
+    };
+    EXPECT_EQ(8u, ob.publishedOrderPoolStats().capacity);
+    for (OrderId id = 1; id <= 12; ++id) ASSERT_TRUE(ob.addOrder(id, true, 10, 100 - id, "c"));
+    EXPECT_TRUE(same(ob.getOrderPoolStats(), ob.publishedOrderPoolStats()));
+    EXPECT_TRUE(same(ob.getLevelPoolStats(), ob.publishedLevelPoolStats()));
+    EXPECT_EQ(12u, ob.publishedOrderPoolStats().in_use);
+    EXPECT_EQ(SubmitStatus::FILLED, ob.submitOrder(20, false, 25, 90, "c").status);
+    EXPECT_TRUE(ob.cancelOrder(12));
+    EXPECT_TRUE(same(ob.getOrderPoolStats(), ob.publishedOrderPoolStats()));
+    EXPECT_TRUE(same(ob.getLevelPoolStats(), ob.publishedLevelPoolStats()));
+    EXPECT_EQ(9u, ob.publishedOrderPoolStats().in_use);  // two filled, one cancelled
+}
+
+TEST(OrderBookTest, TickLadderMatchesSparseMap) {
+    OrderBookConfig map_config;
+    OrderBookConfig ladder_config;
+    ladder_config.layout = BookLayout::TICK_LADDER;
+    ladder_config.ladder_ticks = 130;  // narrow band so outliers exercise the sparse fallback
+
+    OrderBook map_book("TEST", MatchingMode::PRICE_TIME_PRIORITY, map_config);
+    OrderBook ladder_book("TEST", MatchingMode::PRICE_TIME_PRIORITY, ladder_config);
+    std::vector<Trade> map_trades;
+    std::vector<Trade> ladder_trades;
+    map_book.setTradeCallback([&](const Trade& t) { map_trades.push_back(t); });
+    ladder_book.setTradeCallback([&](const Trade& t) { ladder_trades.push_back(t); });
+
+    TestRng next(12345);
+    const std::string client = "client";
+    OrderId id = 1;
+    for (int step = 0; step < 5000; ++step) {
+        uint64_t op = next() % 10;
+        if (op < 6) {
+            bool is_buy = next() % 2 == 0;
+            // Mostly near 10000, occasionally far outside the band
+            Price px = 10000 + static_cast<Price>(next() % 200) - 100;
+            if (next() % 20 == 0) px += is_buy ? -5000 : 5000;
+            Quantity qty = 1 + static_cast<Quantity>(next() % 50);
+            map_book.addOrder(id, is_buy, qty, px, client);
+            ladder_book.addOrder(id, is_buy, qty, px, client);
+            ++id;
+        } else if (op < 8) {
+            OrderId victim = 1 + static_cast<OrderId>(next() % id);
+            EXPECT_EQ(map_book.cancelOrder(victim), ladder_book.cancelOrder(victim));
+        } else if (op < 9) {
+            OrderId victim = 1 + static_cast<OrderId>(next() % id);
+            Price px = 10000 + static_cast<Price>(next() % 400) - 200;
+            Quantity qty = 1 + static_cast<Quantity>(next() % 50);
+            EXPECT_EQ(map_book.modifyOrder(victim, qty, px), ladder_book.modifyOrder(victim, qty, px));
+        } else {
+            map_book.triggerMatching();
+            ladder_book.triggerMatching();
+        }
+        if (step % 250 == 0) {
+            ASSERT_EQ(map_book.getBidLevels(), ladder_book.getBidLevels()) << "step " << step;
+            ASSERT_EQ(map_book.getAskLevels(), ladder_book.getAskLevels()) << "step " << step;
+        }
+    }
+    map_book.triggerMatching();
+    ladder_book.triggerMatching();
+    EXPECT_EQ(map_book.getBidLevels(), ladder_book.getBidLevels());
+    EXPECT_EQ(map_book.getAskLevels(), ladder_book.getAskLevels());
+    ASSERT_EQ(map_trades.size(), ladder_trades.size());
+    for (size_t i = 0; i < map_trades.size(); ++i) {
+        EXPECT_EQ(map_trades[i].buy_order_id, ladder_trades[i].buy_order_id);
+        EXPECT_EQ(map_trades[i].sell_order_id, ladder_trades[i].sell_order_id);
+        EXPECT_EQ(map_trades[i].price, ladder_trades[i].price);
+        EXPECT_EQ(map_trades[i].quantity, ladder_trades[i].quantity);
+    }
+    EXPECT_GT(map_trades.size(), 0u);
+}
+
+TEST(OrderBookTest, OrderTypesMatchOnArrival) {
+    OrderBook ob("TEST", MatchingMode::PRICE_TIME_PRIORITY);
+    std::vector<Trade> trades;
+    std::vector<OrderId> closed;
+    ob.setTradeCallback([&](const Trade& t) { trades.push_back(t); });
+    ob.setOrderClosedCallback([&](OrderId id) { closed.push_back(id); });
+    ASSERT_TRUE(ob.addOrder(1, false, 10, 100, "s"));
+    ASSERT_TRUE(ob.addOrder(2, false, 10, 101, "s"));
+    ASSERT_TRUE(ob.addOrder(3, false, 10, 102, "s"));
+
+    // LIMIT sweeps two levels at the resting prices and never rests
+    SubmitResult limit = ob.submitOrder(10, true, 15, 101, "b");
+    EXPECT_EQ(SubmitStatus::FILLED, limit.status);
+    EXPECT_EQ(15, limit.filled_quantity);
+    ASSERT_EQ(2u, trades.size());
+    EXPECT_EQ(100, trades[0].price);
+    EXPECT_EQ(101, trades[1].price);
+    EXPECT_EQ(5, trades[1].quantity);
+
+    // FOK needs 20 within 102 but only 15 is there: no trades at all
+    EXPECT_EQ(SubmitStatus::REJECTED, ob.submitOrder(11, true, 20, 102, "b", OrderType::FOK).status);
+    EXPECT_EQ(2u, trades.size());
+
+    SubmitResult ioc = ob.submitOrder(12, true, 8, 101, "b", OrderType::IOC);
+    EXPECT_EQ(SubmitStatus::CANCELLED, ioc.status);
+    EXPECT_EQ(5, ioc.filled_quantity);
+    EXPECT_EQ(3, ioc.remaining_quantity);
+
+    SubmitResult market = ob.submitOrder(13, false, 5, 0, "s", OrderType::MARKET);
+    EXPECT_EQ(SubmitStatus::CANCELLED, market.status);
+    EXPECT_EQ(0, market.filled_quantity);
+
+    SubmitResult partial = ob.submitOrder(14, true, 20, 102, "b");
+    EXPECT_EQ(SubmitStatus::PARTIALLY_FILLED, partial.status);
+    EXPECT_EQ(10, partial.filled_quantity);
+    const std::vector<std::pair<Price, Quantity>> expected_bids{{102, 10}};
+    EXPECT_EQ(expected_bids, ob.getBidLevels());
+    EXPECT_TRUE(ob.getAskLevels().empty());
+    EXPECT_EQ(SubmitStatus::REJECTED, ob.submitOrder(14, false, 1, 102, "s").status);  // duplicate id
+
+    std::vector<OrderId> expected_closed{1, 10, 11, 2, 12, 13, 3};
+    EXPECT_EQ(expected_closed, closed);
+    EXPECT_EQ(1u, ob.getOrderPoolStats().in_use);
+    EXPECT_EQ(3u, ob.getOrderPoolStats().high_water) << "aggressors that fill on arrival never allocate an Order";
+}
+
+TEST(OrderBookTest, BatchMatchesOneAtATime) {
+    const std::string client = "client";
+    std::vector<BookCommand> commands;
+    auto submit = [&](OrderId id, bool is_buy, Quantity qty, Price px, OrderType type = OrderType::LIMIT) {
+        BookCommand command;
+        command.id = id;
+        command.is_buy = is_buy;
+        command.quantity = qty;
+        command.price = px;
+        command.type = type;
+        command.client_id = client;
+        commands.push_back(command);
+    };
+    auto change = [&](BookCommand::Kind kind, OrderId id, Quantity qty = 0, Price px = 0) {
+        BookCommand command;
+        command.kind = kind;
+        command.id = id;
+        command.quantity = qty;
+        command.price = px;
+        commands.push_back(command);
+    };
+    submit(1, false, 10, 101);
+    submit(2, false, 10, 102);
+    submit(3, true, 5, 100);
+    submit(4, true, 12, 101);                              // fills 10 at 101, rests 2
+    change(BookCommand::Kind::CANCEL, 3);
+    change(BookCommand::Kind::CANCEL, 3);                  // already gone
+    change(BookCommand::Kind::MODIFY, 4, 2, 102);          // now crosses order 2
+    submit(5, true, 20, 103, OrderType::FOK);              // only 8 left: rejected
+    submit(6, false, 3, 0, OrderType::MARKET);             // nothing bid: cancelled
+    change(BookCommand::Kind::MODIFY, 99, 1, 100);
+
+    auto run = [&](OrderBook& book, std::vector<Trade>& trades) {
+        book.setTradeCallback([&](const Trade& trade) { trades.push_back(trade); });
+    };
+    OrderBook single("TEST");
+    std::vector<Trade> single_trades;
+    run(single, single_trades);
+    std::vector<BookCommandResult> expected;
+    for (const BookCommand& command : commands) {
+        BookCommandResult result;
+        if (command.kind == BookCommand::Kind::SUBMIT) {
+            result.submit = single.submitOrder(command.id, command.is_buy, command.quantity, command.price, client,
+                                               command.type);
+        } else if (command.kind == BookCommand::Kind::CANCEL) {
+            result.found = single.cancelOrder(command.id);
+        } else if ((result.found = single.modifyOrder(command.id, command.quantity, command.price))) {
+            single.triggerMatching();
+        }
+        expected.push_back(result);
+    }
+
+    OrderBook batched("TEST");
+    std::vector<Trade> batched_trades;
+    run(batched, batched_trades);
+    std::vector<BookCommandResult> results;
+    batched.applyBatch(commands, results);
+
+    OrderBookConfig config;
+    config.locking = false;
+    OrderBook sequenced("TEST", MatchingMode::PRICE_TIME_PRIORITY, config);
+    std::vector<Trade> sequenced_trades;
+    run(sequenced, sequenced_trades);
+    std::vector<BookCommandResult> sequenced_results;
+    Sequencer sequencer(8);
+    sequencer.batch(sequenced, commands, sequenced_results);
+    EXPECT_EQ(1u, sequencer.commandsProcessed()) << "the whole batch is one ring command";
+
+    for (const auto* got : {&results, &sequenced_results}) {
+        ASSERT_EQ(expected.size(), got->size());
+        for (size_t i = 0; i < expected.size(); ++i) {
+            EXPECT_EQ(expected[i].submit.status, (*got)[i].submit.status) << "command " << i;
+            EXPECT_EQ(expected[i].submit.filled_quantity, (*got)[i].submit.filled_quantity) << "command " << i;
+            EXPECT_EQ(expected[i].found, (*got)[i].found) << "command " << i;
+        }
+    }
+    EXPECT_EQ(SubmitStatus::PARTIALLY_FILLED, results[3].submit.status);
+    EXPECT_FALSE(results[5].found);
+    EXPECT_TRUE(results[6].found);
+    EXPECT_EQ(SubmitStatus::REJECTED, results[7].submit.status);
+    for (const auto* trades : {&batched_trades, &sequenced_trades}) {
+        ASSERT_EQ(single_trades.size(), trades->size());
+        for (size_t i = 0; i < trades->size(); ++i) {
+            EXPECT_EQ(single_trades[i].buy_order_id, (*trades)[i].buy_order_id);
+            EXPECT_EQ(single_trades[i].sell_order_id, (*trades)[i].sell_order_id);
+            EXPECT_EQ(single_trades[i].price, (*trades)[i].price);
+            EXPECT_EQ(single_trades[i].quantity, (*trades)[i].quantity);
+        }
+    }
+    EXPECT_EQ(single.getAskLevels(), batched.getAskLevels());
+    EXPECT_EQ(single.getBidLevels(), batched.getBidLevels());
+}
+
+TEST(OrderBookTest, DepthUpdatesRebuildLevelsAndViews) {
+    OrderBook book("TEST");
+    // A client applying every update, and two views flushed every few updates
+    std::map<Price, Quantity> bids, asks;
+    DepthView full_view(0);
+    DepthView top_view(3);
+    std::map<Price, Quantity> full_bids, full_asks, top_bids, top_asks;
+    uint64_t last_sequence = 0;
+    size_t updates = 0;
+    auto applyTo = [](std::map<Price, Quantity>& side, const LevelUpdate& update) {
+        if (update.quantity == 0) side.erase(update.price);
+        else side[update.price] = update.quantity;
+    };
+    auto flushView = [&](DepthView& view, std::map<Price, Quantity>& view_bids, std::map<Price, Quantity>& view_asks) {
+        std::vector<LevelUpdate> out;
+        view.flush(out);
+        for (const LevelUpdate& update : out) applyTo(update.is_buy ? view_bids : view_asks, update);
+    };
+    book.setDepthCallback([&](uint64_t sequence, const std::vector<LevelUpdate>& changed) {
+        EXPECT_EQ(last_sequence + 1, sequence);
+        last_sequence = sequence;
+        for (const LevelUpdate& update : changed) {
+            applyTo(update.is_buy ? bids : asks, update);
+            full_view.apply(update);
+            top_view.apply(update);
+        }
+        if (++updates % 7 == 0) {
+            flushView(full_view, full_bids, full_asks);
+            flushView(top_view, top_bids, top_asks);
+        }
+    });
+    // Best first, at most depth levels (0 = all)
+    auto levels = [](const std::map<Price, Quantity>& side, bool is_buy, size_t depth) {
+        std::vector<std::pair<Price, Quantity>> out(side.begin(), side.end());
+        if (is_buy) std::reverse(out.begin(), out.end());
+        if (depth && out.size() > depth) out.resize(depth);
+        return out;
+    };
+
+    TestRng next(777);
+    const std::string client = "client";
+    const OrderType types[] = {OrderType::LIMIT, OrderType::LIMIT, OrderType::IOC, OrderType::MARKET};
+    OrderId id = 1;
+    for (int step = 0; step < 4000; ++step) {
+        uint64_t op = next() % 10;
+        bool is_buy = next() % 2 == 0;
+        Price px = 1000 + static_cast<Price>(next() % 40) - 20;
+        Quantity qty = 1 + static_cast<Quantity>(next() % 30);
+        if (op < 3) {
+            book.addOrder(id++, is_buy, qty, px, client);
+        } else if (op < 7) {
+            book.submitOrder(id++, is_buy, qty, px, client, types[next() % 4]);
+        } else if (op < 9) {
+            book.cancelOrder(1 + static_cast<OrderId>(next() % id));
+        } else if (book.modifyOrder(1 + static_cast<OrderId>(next() % id), qty, px)) {
+            book.triggerMatching();
+        }
+        if (step % 200 == 0) {
+            ASSERT_EQ(book.getBidLevels(), levels(bids, true, 0)) << "step " << step;
+            ASSERT_EQ(book.getAskLevels(), levels(asks, false, 0)) << "step " << step;
+        }
+    }
+    flushView(full_view, full_bids, full_asks);
+    flushView(top_view, top_bids, top_asks);
+
+    std::vector<std::pair<Price, Quantity>> snapshot_bids, snapshot_asks;
+    EXPECT_EQ(last_sequence, book.getDepth(0, snapshot_bids, snapshot_asks));
+    EXPECT_GT(last_sequence, 1000u);
+    EXPECT_EQ(snapshot_bids, levels(bids, true, 0));
+    EXPECT_EQ(snapshot_asks, levels(asks, false, 0));
+    EXPECT_EQ(snapshot_bids, levels(full_bids, true, 0));
+    EXPECT_EQ(snapshot_asks, levels(full_asks, false, 0));
+    EXPECT_EQ(levels(bids, true, 3), levels(top_bids, true, 0));
+    EXPECT_EQ(levels(asks, false, 3), levels(top_asks, false, 0));
+    EXPECT_EQ(last_sequence, book.getDepth(3, snapshot_bids, snapshot_asks));
+    EXPECT_EQ(snapshot_bids, levels(bids, true, 3));
+    EXPECT_EQ(snapshot_asks, levels(asks, false, 3));
+
+    // A view reset from a snapshot starts with nothing to report
+    std::vector<std::pair<Price, Quantity>> view_bids, view_asks;
+    book.getDepth(0, snapshot_bids, snapshot_asks);
+    top_view.reset(snapshot_bids, snapshot_asks, view_bids, view_asks);
+    EXPECT_EQ(view_bids, levels(bids, true, 3));
+    EXPECT_EQ(view_asks, levels(asks, false, 3));
+    EXPECT_FALSE(top_view.pending());
+}
+
+TEST(OrderBookTest, PublishedDepthFollowsBookAndNeverTears) {
+    OrderBookConfig config;
+    config.published_depth = 4;
+    OrderBook book("TEST", MatchingMode::PRICE_TIME_PRIORITY, config);
+    // A lock-free reader racing the writer must only ever see whole states
+    std::atomic<bool> done{false};
+    std::atomic<size_t> reads{0};
+    std::thread reader([&]() {
+        std::vector<std::pair<Price, Quantity>> bids, asks;
+        uint64_t last_sequence = 0;
+        while (!done.load(std::memory_order_acquire)) {
+            uint64_t sequence = book.readPublishedDepth(0, bids, asks);
+            EXPECT_GE(sequence, last_sequence);
+            last_sequence = sequence;
+            EXPECT_LE(bids.size(), 4u);
+            EXPECT_LE(asks.size(), 4u);
+            for (size_t i = 1; i < bids.size(); ++i) EXPECT_GT(bids[i - 1].first, bids[i].first);
+            for (size_t i = 1; i < asks.size(); ++i) EXPECT_LT(asks[i - 1].first, asks[i].first);
+            if (!bids.empty() && !asks.empty()) {
+                EXPECT_LT(bids[0].first, asks[0].first);
+            }
+            reads.fetch_add(1, std::memory_order_relaxed);
+            std::this_thread::yield();
+        }
+    });
+
+    TestRng next(4242);
+    const std::string client = "client";
+    std::vector<std::pair<Price, Quantity>> bids, asks, cached_bids, cached_asks;
+    OrderId id = 1;
+    for (int step = 0; step < 3000; ++step) {
+        bool is_buy = next() % 2 == 0;
+        Price px = 1000 + static_cast<Price>(next() % 30) - 15;
+        Quantity qty = 1 + static_cast<Quantity>(next() % 20);
+        if (next() % 3 == 0) book.cancelOrder(1 + static_cast<OrderId>(next() % id));
+        else book.submitOrder(id++, is_buy, qty, px, client, OrderType::LIMIT);
+        if (step % 10 == 0) std::this_thread::yield();
+        if (step % 100 == 0) {
+            uint64_t sequence = book.getDepth(4, bids, asks);
+            ASSERT_EQ(sequence, book.readPublishedDepth(4, cached_bids, cached_asks)) << "step " << step;
+            ASSERT_EQ(bids, cached_bids) << "step " << step;
+            ASSERT_EQ(asks, cached_asks) << "step " << step;
+            book.readPublishedDepth(1, cached_bids, cached_asks);
+            TopOfBook top = book.topOfBook();
+            EXPECT_EQ(top.sequence, sequence);
+            EXPECT_EQ(top.bid_quantity > 0, !cached_bids.empty());
+            if (!cached_bids.empty()) {
+                EXPECT_EQ(std::make_pair(top.bid_price, top.bid_quantity), cached_bids[0]);
+            }
+            if (!cached_asks.empty()) {
+                EXPECT_EQ(std::make_pair(top.ask_price, top.ask_quantity), cached_asks[0]);
+            }
+        }
+    }
+    while (reads.load(std::memory_order_relaxed) == 0) std::this_thread::yield();
+    done.store(true, std::memory_order_release);
+    reader.join();
+}
+
+TEST(OrderBookTest, ProRataAllocatesEveryLotAndCrossedLevelsProgress) {
+    std::vector<Quantity> allocations(4);
+    auto allocate = [&](const ProRataConfig& config, std::vector<Quantity> quantities, Quantity qty) {
+        allocations.assign(quantities.size(), -1);
+        Quantity allocated = allocateProRata(config, quantities.data(), quantities.size(), qty, allocations.data());
+        return allocated;
+    };
+    ProRataConfig config;
+    EXPECT_EQ(10, allocate(config, {10, 20, 30, 40}, 10));
+    EXPECT_EQ((std::vector<Quantity>{1, 2, 3, 4}), allocations);
+    // Shares of 2.2, 2.2 and 5.6 floor to 2, 2 and 5; the lot left goes to the oldest
+    EXPECT_EQ(10, allocate(config, {11, 11, 28}, 10));
+    EXPECT_EQ((std::vector<Quantity>{3, 2, 5}), allocations);
+    // Every share rounds to nothing: the residual still fills, round-robin
+    EXPECT_EQ(2, allocate(config, {1, 1, 1}, 2));
+    EXPECT_EQ((std::vector<Quantity>{1, 1, 0}), allocations);
+    EXPECT_EQ(50, allocate(config, {11, 11, 28}, 80));
+    EXPECT_EQ((std::vector<Quantity>{11, 11, 28}), allocations);
+    // Shares of 1 and 2 are below the minimum; their 3 lots go round-robin
+    config.min_allocation = 3;
+    EXPECT_EQ(10, allocate(config, {10, 20, 30, 40}, 10));
+    EXPECT_EQ((std::vector<Quantity>{1, 1, 4, 4}), allocations);
+    config.min_allocation = 1;
+    config.top_order = true;
+    EXPECT_EQ(30, allocate(config, {10, 20, 20}, 30));
+    EXPECT_EQ((std::vector<Quantity>{10, 10, 10}), allocations);
+
+    // Large levels: the allocations always add up and never overfill
+    TestRng next(99);
+    for (int round = 0; round < 50; ++round) {
+        std::vector<Quantity> quantities(1 + next() % 20000);
+        int64_t total = 0;
+        for (Quantity& q : quantities) total += q = 1 + static_cast<Quantity>(next() % 1000);
+        config.min_allocation = 1 + static_cast<Quantity>(next() % 5);
+        config.top_order = next() % 2 == 0;
+        Quantity qty = 1 + static_cast<Quantity>(next() % static_cast<uint64_t>(total));
+        allocations.resize(quantities.size());
+        ASSERT_EQ(qty, allocateProRata(config, quantities.data(), quantities.size(), qty, allocations.data()));
+        int64_t sum = 0;
+        for (size_t i = 0; i < quantities.size(); ++i) {
+            ASSERT_GE(allocations[i], 0);
+            ASSERT_LE(allocations[i], quantities[i]);
+            sum += allocations[i];
+        }
+        ASSERT_EQ(qty, sum);
+    }
+
+    // Levels crossed by a modify whose shares all round to 0 used to loop forever
+    OrderBook book("TEST", MatchingMode::PRO_RATA);
+    Quantity traded = 0;
+    book.setTradeCallback([&](const Trade& trade) {
+        EXPECT_EQ(100, trade.price);
+        traded += trade.quantity;
+    });
+    for (OrderId id = 1; id <= 3; ++id) book.addOrder(id, true, 1, 100, "bidder");
+    book.addOrder(4, false, 2, 101, "seller");
+    ASSERT_TRUE(book.modifyOrder(4, 2, 100));
+    book.triggerMatching();
+    EXPECT_EQ(2, traded);
+    EXPECT_EQ((std::vector<std::pair<Price, Quantity>>{{100, 1}}), book.getBidLevels());
+    EXPECT_TRUE(book.getAskLevels().empty());
+}
+
+TEST(OrderBookTest, CallAuctionUncrossesAtEquilibrium) {
+    // Brute force over every level price of the book as given
+    auto equilibrium = [](const std::vector<std::pair<Price, Quantity>>& bids,
+                          const std::vector<std::pair<Price, Quantity>>& asks, Price reference) {
+        std::vector<AuctionResult> candidates;
+        for (const auto* side : {&bids, &asks}) {
+            for (const auto& level : *side) {
+                Price px = level.first;
+                int64_t buy = 0, sell = 0;
+                for (const auto& bid : bids) buy += bid.first >= px ? bid.second : 0;
+                for (const auto& ask : asks) sell += ask.first <= px ? ask.second : 0;
+                if (std::min(buy, sell) > 0) {
+                    candidates.push_back({px, std::min(buy, sell), buy - sell});
+                }
+            }
+        }
+        if (candidates.empty()) return AuctionResult{};
+        auto better = [](const AuctionResult& a, const AuctionResult& b) {
+            if (a.volume != b.volume) return a.volume > b.volume;
+            return std::abs(a.imbalance) < std::abs(b.imbalance);
+        };
+        std::sort(candidates.begin(), candidates.end(), [&](const AuctionResult& a, const AuctionResult& b) {
+            return better(a, b) || (!better(b, a) && a.price < b.price);
+        });
+        std::vector<AuctionResult> tied;
+        for (const AuctionResult& c : candidates) {
+            if (!better(candidates[0], c)) tied.push_back(c);
+        }
+        if (reference <= 0) reference = tied.front().price + (tied.back().price - tied.front().price) / 2;
+        AuctionResult chosen = tied.front();
+        for (const AuctionResult& c : tied) {
+            if (std::llabs(c.price - reference) < std::llabs(chosen.price - reference)) chosen = c;
+        }
+        return chosen;
+    };
+
+    TestRng next(2024);
+    OrderId id = 1;
+    for (int round = 0; round < 200; ++round) {
+        OrderBook book("TEST", MatchingMode::CALL_AUCTION);
+        int64_t traded = 0;
+        bool one_price = true;
+        Price last_price = 0;
+        book.setTradeCallback([&](const Trade& trade) {
+            traded += trade.quantity;
+            if (last_price && trade.price != last_price) one_price = false;
+            last_price = trade.price;
+        });
+        int orders = 1 + static_cast<int>(next() % 60);
+        for (int i = 0; i < orders; ++i) {
+            bool is_buy = next() % 2 == 0;
+            Price px = 100 + static_cast<Price>(next() % 20) - (is_buy ? 0 : 8);
+            SubmitResult result = book.submitOrder(id++, is_buy, 1 + static_cast<Quantity>(next() % 50), px, "client");
+            ASSERT_EQ(SubmitStatus::RESTING, result.status);
+        }
+        EXPECT_EQ(SubmitStatus::REJECTED, book.submitOrder(id++, true, 5, 0, "client", OrderType::MARKET).status);
+        book.triggerMatching();  // does not trade a call auction
+        EXPECT_EQ(0, traded);
+
+        Price reference = next() % 3 == 0 ? 0 : 95 + static_cast<Price>(next() % 15);
+        AuctionResult expected = equilibrium(book.getBidLevels(), book.getAskLevels(), reference);
+        AuctionResult indicative = book.indicativeAuction();
+        if (reference == 0) {
+            EXPECT_EQ(expected.price, indicative.price) << "round " << round;
+        }
+        EXPECT_EQ(expected.volume, indicative.volume) << "round " << round;
+        EXPECT_EQ(expected.imbalance, indicative.imbalance) << "round " << round;
+        AuctionResult result = book.uncross(reference);
+        EXPECT_EQ(expected.price, result.price) << "round " << round;
+        EXPECT_EQ(expected.volume, result.volume) << "round " << round;
+        EXPECT_EQ(expected.imbalance, result.imbalance) << "round " << round;
+        EXPECT_EQ(result.volume, traded);
+        EXPECT_TRUE(one_price);
+        if (result.volume > 0) {
+            EXPECT_EQ(result.price, last_price);
+        }
+        // Nothing crossed is left, and so nothing is indicated
+        auto bids = book.getBidLevels();
+        auto asks = book.getAskLevels();
+        if (!bids.empty() && !asks.empty()) {
+            EXPECT_LT(bids.front().first, asks.front().first);
+        }
+        EXPECT_EQ(0, book.indicativeAuction().volume);
+    }
+}
 
+TEST(OrderBookTest, CallAuctionVolumeBeyondOneOrderQuantity) {
+    OrderBook book("TEST", MatchingMode::CALL_AUCTION);
+    int64_t traded = 0;
+    book.setTradeCallback([&](const Trade& trade) { traded += trade.quantity; });
+    // Each order fits a Quantity; the 4e9 crossing at 100 does not
+    const Quantity big = 2'000'000'000;
+    ASSERT_TRUE(book.addOrder(1, true, big, 101, "b"));
+    ASSERT_TRUE(book.addOrder(2, true, big, 100, "b"));
+    ASSERT_TRUE(book.addOrder(3, false, big, 99, "s"));
+    ASSERT_TRUE(book.addOrder(4, false, big, 100, "s"));
+    EXPECT_EQ(4'000'000'000, book.indicativeAuction().volume);
+    AuctionResult result = book.uncross();
+    EXPECT_EQ(100, result.price);
+    EXPECT_EQ(4'000'000'000, result.volume);
+    EXPECT_EQ(0, result.imbalance);
+    EXPECT_EQ(4'000'000'000, traded);
+    EXPECT_TRUE(book.getBidLevels().empty());
+    EXPECT_TRUE(book.getAskLevels().empty());
+}
+
+TEST(OrderRouterTest, BookClosesRoutesOnFillAndCancel) {
+    OrderRouter router(4);
+    OrderBook aapl("AAPL");
+    OrderBook msft("MSFT");
+    for (OrderBook* book : {&aapl, &msft}) {
+        book->setOrderClosedCallback([&](OrderId id) { router.remove(id); });
+    }
+    auto submit = [&](OrderBook& book, OrderId id, bool is_buy, Quantity qty, Price px) {
+        ASSERT_TRUE(router.add(id, &book));
+        ASSERT_TRUE(book.addOrder(id, is_buy, qty, px, "client"));
+    };
+
+    submit(aapl, 1, true, 100, 10000);
+    submit(msft, 2, true, 100, 20000);
+    submit(aapl, 3, false, 40, 10000);
+    EXPECT_FALSE(router.add(1, &msft));
+    EXPECT_EQ(&aapl, router.find(1));
+    EXPECT_EQ(&msft, router.find(2));
+
+    aapl.triggerMatching();  // 3 fully filled, 1 partially filled
+    EXPECT_EQ(nullptr, router.find(3));
+    EXPECT_EQ(&aapl, router.find(1));
+
+    EXPECT_TRUE(router.find(2)->cancelOrder(2));
+    EXPECT_EQ(nullptr, router.find(2));
+    EXPECT_TRUE(router.find(1)->modifyOrder(1, 10, 9900));
+    EXPECT_EQ(1u, router.size());
+}
+
+TEST(SequencerTest, ConcurrentSubmittersSeeSerialisedBook) {
+    OrderBookConfig config;
+    config.locking = false;
+    OrderBook ob("TEST", MatchingMode::PRICE_TIME_PRIORITY, config);
+    std::atomic<int64_t> traded{0};
+    ob.setTradeCallback([&](const Trade& trade) { traded += trade.quantity; });
+    Sequencer sequencer(8);  // small ring so submitters hit back-pressure
+
+    const int threads = 4;
+    const int per_thread = 500;
+    std::vector<std::thread> clients;
+    for (int t = 0; t < threads; ++t) {
+        clients.emplace_back([&, t]() {
+            const std::string client = "client";
+            for (int i = 0; i < per_thread; ++i) {
+                OrderId id = static_cast<OrderId>(t) * per_thread + i + 1;
+                // Even threads buy, odd threads sell, all at one price
+                ASSERT_NE(SubmitStatus::REJECTED, sequencer.submit(ob, id, t % 2 == 0, 1, 10000, client).status);
+                if (i % 10 == 9) sequencer.cancel(ob, id);
+            }
+        });
+    }
+    for (auto& client : clients) client.join();
+
+    std::vector<std::pair<Price, Quantity>> bids;
+    std::vector<std::pair<Price, Quantity>> asks;
+    sequencer.execute(ob, [&](OrderBook& book) {
+        bids = book.getBidLevels();
+        asks = book.getAskLevels();
+    });
+    // Matching ran after every submit, so the book can never be left crossed
+    EXPECT_TRUE(bids.empty() || asks.empty());
+    int64_t resting = 0;
+    for (const auto& level : bids) resting += level.second;
+    for (const auto& level : asks) resting += level.second;
+    const int64_t submitted = threads * per_thread;
+    EXPECT_LE(2 * traded.load() + resting, submitted);
+    EXPECT_GT(traded.load(), 0);
+    EXPECT_EQ(static_cast<uint64_t>(submitted + threads * per_thread / 10 + 1), sequencer.commandsProcessed());
+}
+
+TEST(ShardMapTest, ConsistentHashingAndOverrides) {
+    std::vector<std::string> symbols;
+    for (int i = 0; i < 5000; ++i) symbols.push_back("SYM" + std::to_string(i));
+
+    ShardMap eight(8);
+    ShardMap nine(9);
+    std::vector<size_t> load(8, 0);
+    size_t moved = 0;
+    for (const auto& symbol : symbols) {
+        size_t shard = eight.shardFor(symbol);
+        ASSERT_LT(shard, 8u);
+        ++load[shard];
+        size_t grown = nine.shardFor(symbol);
+        // Growing only ever moves symbols onto the new shard
+        if (grown != shard) {
+            EXPECT_EQ(8u, grown);
+            ++moved;
+        }
+    }
+    for (size_t count : load) EXPECT_NEAR(5000.0 / 8, count, 5000.0 / 8 * 0.2);
+    EXPECT_NEAR(5000.0 / 9, moved, 5000.0 / 9 * 0.25);
+
+    ShardMap pinned(8, {{"HOT", 3}});
+    EXPECT_EQ(3u, pinned.shardFor("HOT"));
+    EXPECT_EQ(eight.shardFor("SYM1"), pinned.shardFor("SYM1"));
+    EXPECT_THROW(ShardMap(2, {{"HOT", 2}}), std::runtime_error);
+}
+
+TEST(ShardTest, CreatesBooksOnTheShardThread) {
+    Shard shard(0, 64, -1);
+    std::thread::id creator;
+    auto factory = [&](const std::string& symbol) {
+        creator = std::this_thread::get_id();
+        OrderBookConfig config;
+        config.locking = false;
+        return std::make_unique<OrderBook>(symbol, MatchingMode::PRICE_TIME_PRIORITY, config);
+    };
+    OrderBook& book = shard.getOrCreateBook("AAPL", factory);
+    EXPECT_NE(std::this_thread::get_id(), creator);
+    EXPECT_EQ(&book, &shard.getOrCreateBook("AAPL", factory));
+    EXPECT_EQ(1u, shard.bookCount());
+    EXPECT_EQ(SubmitStatus::RESTING, shard.sequencer().submit(book, 1, true, 10, 10000, "client").status);
+    EXPECT_TRUE(shard.sequencer().cancel(book, 1));
+    EXPECT_EQ(3u, shard.sequencer().commandsProcessed());
+}
+
+TEST(ShardTest, FactoryAndCommandExceptionsReachTheCaller) {
+    Shard shard(0, 64, -1);
+    auto failing = [](const std::string&) -> std::unique_ptr<OrderBook> { throw std::runtime_error("no book"); };
+    EXPECT_THROW(shard.getOrCreateBook("AAPL", failing), std::runtime_error);
+    EXPECT_EQ(0u, shard.bookCount());
+
+    OrderBook& book = shard.getOrCreateBook("AAPL", [](const std::string& symbol) {
+        return std::make_unique<OrderBook>(symbol);
+    });
+    EXPECT_THROW(shard.sequencer().execute(book, [](OrderBook&) { throw std::logic_error("command"); }),
+                 std::logic_error);
+    // The sequencer carries on after a throwing command
+    EXPECT_EQ(SubmitStatus::RESTING, shard.sequencer().submit(book, 1, true, 10, 10000, "client").status);
+}
+
+TEST(ShardTest, CreatingABookHoldsNoRegistryLock) {
+    Shard shard(0, 64, -1);
+    auto plain = [](const std::string& symbol) { return std::make_unique<OrderBook>(symbol); };
+    OrderBook& aapl = shard.getOrCreateBook("AAPL", plain);
+    std::atomic<bool> in_factory{false};
+    std::atomic<bool> release{false};
+    std::atomic<int> calls{0};
+    auto slow = [&](const std::string& symbol) {
+        calls.fetch_add(1);
+        in_factory = true;
+        while (!release) std::this_thread::yield();
+        return std::make_unique<OrderBook>(symbol);
+    };
+    std::vector<OrderBook*> created(2, nullptr);
+    std::vector<std::thread> creators;
+    for (size_t i = 0; i < created.size(); ++i) {
+        creators.emplace_back([&, i] { created[i] = &shard.getOrCreateBook("MSFT", slow); });
+    }
+    while (!in_factory) std::this_thread::yield();
+    // Lookups go ahead while the factory runs
+    EXPECT_EQ(&aapl, &shard.getOrCreateBook("AAPL", plain));
+    EXPECT_EQ(1u, shard.bookCount());
+    release = true;
+    for (auto& creator : creators) creator.join();
+    // The racing creator finds the first one's book
+    EXPECT_EQ(1, calls.load());
+    EXPECT_EQ(created[0], created[1]);
+    EXPECT_EQ(2u, shard.bookCount());
+}
+
+TEST(OrderIdIndexTest, MatchesUnorderedMapUnderChurn) {
+    OrderIdIndex<Order> index(8);
+    std::unordered_map<OrderId, Order*> reference;
+    std::vector<Order> orders(4096);
+    TestRng next(0x2545F4914F6CDD1Dull);
+    for (int step = 0; step < 200000; ++step) {
+        // Small key space so inserts collide with live keys and erases punch
+        // holes in the middle of probe runs
+        OrderId key = static_cast<OrderId>(next() % 4096);
+        Order* value = &orders[static_cast<size_t>(key)];
+        if (next() % 3 == 0) {
+            bool expected = reference.erase(key) > 0;
+            ASSERT_EQ(expected ? value : nullptr, index.erase(key));
+        } else {
+            bool expected = reference.emplace(key, value).second;
+            ASSERT_EQ(expected, index.insert(key, value));
+        }
+        ASSERT_EQ(reference.size(), index.size());
+    }
+    for (OrderId key = 0; key < 4096; ++key) {
+        auto it = reference.find(key);
+        EXPECT_EQ(it == reference.end() ? nullptr : it->second, index.find(key));
+    }
+    EXPECT_LE(index.size() * 2, index.capacity());
+}
+
+TEST(ClientTableTest, HandlesAreCountedAndRecycled) {
+    ClientTable table;
+    uint32_t a = table.acquire("alice");
+    EXPECT_EQ(a, table.acquire("alice"));
+    uint32_t b = table.acquire("bob");
+    EXPECT_NE(a, b);
+    EXPECT_EQ(2u, table.size());
+    table.release(a);
+    EXPECT_EQ("alice", table.name(a)) << "still held once";
+    table.release(a);
+    // Released but not yet reused: alice gets her handle back
+    EXPECT_EQ(a, table.acquire("alice"));
+    table.release(a);
+    // The freed handle is reused, so the table only grows with the ids held
+    // at once, not with every id ever seen
+    for (int i = 0; i < 1000; ++i) table.release(table.acquire("client-" + std::to_string(i)));
+    EXPECT_EQ(2u, table.size());
+    uint32_t c = table.acquire("carol");
+    EXPECT_EQ(a, c);
+    EXPECT_EQ("carol", table.name(c));
+    EXPECT_EQ("bob", table.name(b));
+}
+
+TEST(OrderBookTest, ClientIdsLiveOnlyAsLongAsTheirOrders) {
+    OrderBook ob("TEST");
+    ASSERT_TRUE(ob.addOrder(1, true, 10, 100, "alice"));
+    // Filled on arrival: the aggressor's id is never stored
+    EXPECT_EQ(SubmitStatus::FILLED, ob.submitOrder(2, false, 4, 100, "bob").status);
+    ASSERT_TRUE(ob.addOrder(3, true, 5, 99, "carol"));
+    EXPECT_TRUE(ob.cancelOrder(1));
+    // carol's handle may be alice's recycled one; either way the name is carol
+    ASSERT_EQ(SubmitStatus::RESTING, ob.submitOrder(4, true, 5, 98, "dave").status);
+    std::vector<std::string> clients;
+    ob.forEachOrder([&](const Order& o) { clients.push_back(ob.clientName(o.client)); });
+    EXPECT_EQ((std::vector<std::string>{"carol", "dave"}), clients);
+}
+
+TEST(InternerTest, ConcurrentInternersAgreeOnHandles) {
+    Interner table;
+    EXPECT_EQ(0u, table.intern(""));
+    std::vector<std::vector<uint32_t>> seen(4);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < seen.size(); ++t) {
+        threads.emplace_back([&, t] {
+            for (int i = 0; i < 500; ++i) seen[t].push_back(table.intern("client-" + std::to_string((i * 7 + t) % 100)));
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    EXPECT_EQ(101u, table.size());
+    for (size_t t = 0; t < seen.size(); ++t) {
+        for (int i = 0; i < 500; ++i) {
+            EXPECT_EQ("client-" + std::to_string((i * 7 + t) % 100), table.name(seen[t][i]));
+        }
+    }
+}
+
+TEST(ClockTest, TscTracksWallClockAndBooksNumberTrades) {
+    auto wall = [] {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::system_clock::now().time_since_epoch())
+            .count();
+    };
+    TscClock tsc(std::chrono::milliseconds(10));
+    EXPECT_GT(tsc.ticksPerNanosecond(), 0.0);
+    ClockTicks previous = tsc.now();
+    for (int i = 0; i < 5; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        ClockTicks ticks = tsc.now();
+        EXPECT_GT(ticks, previous);
+        previous = ticks;
+        // Calibration error over a few ms, plus scheduling between the reads
+        EXPECT_NEAR(static_cast<double>(wall()), static_cast<double>(tsc.toEpochNanos(ticks)), 5e6);
+    }
+
+    VirtualClock clock(1000);
+    OrderBookConfig config;
+    config.clock = &clock;
+    OrderBook ob("CLK", MatchingMode::PRICE_TIME_PRIORITY, config);
+    std::vector<Trade> trades;
+    ob.setTradeCallback([&](const Trade& trade) { trades.push_back(trade); });
+    ob.addOrder(1, false, 10, 100, "a");
+    ob.addOrder(2, false, 10, 101, "a");
+    ob.submitOrder(3, true, 15, 101, "b");
+    clock.advance(500);
+    ob.submitOrder(4, true, 5, 101, "b");
+    ASSERT_EQ(3u, trades.size());
+    // Same time within one submit; the sequence still orders them
+    for (size_t i = 0; i < trades.size(); ++i) EXPECT_EQ(i + 1, trades[i].sequence);
+    EXPECT_EQ(1000, clock.toEpochNanos(trades[0].timestamp));
+    EXPECT_EQ(1000, clock.toEpochNanos(trades[1].timestamp));
+    EXPECT_EQ(1500, clock.toEpochNanos(trades[2].timestamp));
+    EXPECT_EQ(3u, ob.tradeSequence());
+}
+
+TEST(TradeJournalTest, RoundTripsTradesFromConcurrentBooks) {
+    std::string path = ::testing::TempDir() + "trade_journal_test.journal";
+    std::remove(path.c_str());
+    JournalConfig config;
+    config.ring_capacity = 64;  // small enough that producers hit back-pressure
+    config.batch_records = 16;
+    {
+        TradeJournal journal(path, config);
+        auto trade = [&](const std::string& symbol, OrderId base) {
+            OrderBook book(symbol);
+            book.setTradeJournal(&journal);
+            for (OrderId i = 0; i < 500; ++i) {
+                book.addOrder(base + 2 * i, false, 5, 10000 + i % 7, "seller");
+                book.submitOrder(base + 2 * i + 1, true, 5, 10010, "buyer");
+            }
+        };
+        std::thread other(trade, "MSFT", 1000000);
+        trade("AAPL", 0);
+        other.join();
+        journal.flush();
+        EXPECT_EQ(1000u, journal.stats().records_written);
+    }
+    {
+        // Reopening appends after the existing records without a second header
+        TradeJournal journal(path, config);
+        journal.append(42, 7, 8, 12345, 3, "A_SYMBOL_LONGER_THAN_24_BYTES");
+    }
+
+    TradeJournalReader reader(path);
+    TradeRecord record;
+    std::unordered_map<std::string, OrderId> next_sell{{"AAPL", 0}, {"MSFT", 1000000}};
+    for (int i = 0; i < 1000; ++i) {
+        ASSERT_TRUE(reader.next(record));
+        std::string symbol(record.symbol);
+        ASSERT_TRUE(next_sell.count(symbol));
+        // Per-book order is preserved even though the books interleave
+        EXPECT_EQ(next_sell[symbol], record.sell_order_id);
+        EXPECT_EQ(record.sell_order_id + 1, record.buy_order_id);
+        EXPECT_EQ(5, record.quantity);
+        EXPECT_GT(record.timestamp_ns, 0);
+        next_sell[symbol] += 2;
+    }
+    ASSERT_TRUE(reader.next(record));
+    EXPECT_EQ(42, record.timestamp_ns);
+    EXPECT_EQ(12345, record.price);
+    EXPECT_EQ(std::string("A_SYMBOL_LONGER_THAN_24_"), std::string(record.symbol, sizeof(record.symbol)));
+    EXPECT_FALSE(reader.next(record));
+    std::remove(path.c_str());
+}
+
+TEST(TradeJournalTest, FailedWriteStopsTheJournal) {
+    std::string path = ::testing::TempDir() + "trade_journal_fail_test.journal";
+    std::remove(path.c_str());
+    JournalConfig config;
+    config.batch_records = 4;
+    TradeJournal journal(path, config);
+    for (int i = 0; i < 4; ++i) journal.append(i, 1, 2, 100, 1, "AAPL");
+    journal.flush();
+
+    // Cap the file half a record past its end: the next write stops there
+    // and fails, leaving a torn record
+    std::signal(SIGXFSZ, SIG_IGN);
+    rlimit saved;
+    ASSERT_EQ(0, getrlimit(RLIMIT_FSIZE, &saved));
+    rlimit capped = saved;
+    capped.rlim_cur = sizeof(JournalFileHeader) + 4 * sizeof(TradeRecord) + sizeof(TradeRecord) / 2;
+    ASSERT_EQ(0, setrlimit(RLIMIT_FSIZE, &capped));
+    for (int i = 0; i < 4; ++i) journal.append(i, 1, 2, 100, 1, "AAPL");
+    EXPECT_THROW(journal.flush(), std::runtime_error);
+    ASSERT_EQ(0, setrlimit(RLIMIT_FSIZE, &saved));
+    std::signal(SIGXFSZ, SIG_DFL);
+
+    // Later records are dropped rather than appended after the torn one,
+    // and only the batch before the failure counts as written
+    for (int i = 0; i < 4; ++i) journal.append(i, 1, 2, 100, 1, "AAPL");
+    EXPECT_THROW(journal.flush(), std::runtime_error);
+    while (journal.stats().write_errors < 2) std::this_thread::yield();
+    EXPECT_EQ(4u, journal.stats().records_written);
+    EXPECT_EQ(4u, TradeJournalReader(path).size());
+    std::remove(path.c_str());
+}
+
+TEST(RecoveryTest, SnapshotPlusCommandTailRebuildsBooks) {
+    std::string dir = ::testing::TempDir() + "recovery_test";
+    pruneState(dir, UINT64_MAX);  // leftovers from an earlier run
+    std::unordered_map<std::string, std::unique_ptr<OrderBook>> books;
+    auto book_for = [&](const std::string& symbol) -> OrderBook& {
+        auto& book = books[symbol];
+        if (!book) {
+            book = std::make_unique<OrderBook>(
+                symbol, symbol == "AUCT" ? MatchingMode::CALL_AUCTION : MatchingMode::PRICE_TIME_PRIORITY);
+        }
+        return *book;
+    };
+    ASSERT_FALSE(recoverState(dir, book_for).snapshot_loaded);
+
+    OrderId next_id = 1;
+    TestRng random(88172645463325252ull);
+    auto churn = [&](int commands) {
+        for (int i = 0; i < commands; ++i) {
+            OrderBook& book = book_for(i % 5 == 4 ? "AUCT" : i % 3 ? "AAPL" : "MSFT");
+            bool is_buy = random(2);
+            Price px = 10000 + static_cast<Price>(random(11)) - 5;
+            if (book.getMatchingMode() == MatchingMode::CALL_AUCTION && random(40) == 0) {
+                book.uncross(random(2) ? px : 0);
+                continue;
+            }
+            switch (random(5)) {
+                case 0: book.addOrder(next_id++, is_buy, 1 + random(20), px, "c" + std::to_string(random(4))); break;
+                case 1: book.cancelOrder(1 + random(next_id)); break;
+                case 2:
+                    if (book.modifyOrder(1 + random(next_id), 1 + random(20), px)) book.triggerMatching();
+                    break;
+                default:
+                    book.submitOrder(next_id++, is_buy, 1 + random(30), px, "c" + std::to_string(random(4)),
+                                     random(4) ? OrderType::LIMIT : OrderType::IOC);
+            }
+        }
+    };
+
+    {
+        CommandLog log(dir, 1, 1);
+        for (const char* symbol : {"AAPL", "MSFT", "AUCT"}) book_for(symbol).setCommandLog(&log);
+        churn(3000);
+        uint64_t segment = log.rotate();
+        std::vector<BookImage> images;
+        for (const auto& pair : books) images.push_back(captureBook(*pair.second));
+        writeSnapshot(snapshotPath(dir, segment), images, next_id);
+        pruneState(dir, segment);
+        churn(3000);  // the tail only the command log has
+        log.flush();
+        for (const auto& pair : books) pair.second->setCommandLog(nullptr);
+    }
+
+    auto original = std::move(books);
+    books.clear();
+    RecoveryResult result = recoverState(dir, book_for);
+    EXPECT_TRUE(result.snapshot_loaded);
+    EXPECT_GT(result.snapshot_orders, 0u);
+    EXPECT_GT(result.commands_replayed, 0u);
+    EXPECT_GE(result.next_order_id, next_id);
+    ASSERT_EQ(original.size(), books.size());
+    for (const auto& pair : original) {
+        OrderBook& expected = *pair.second;
+        OrderBook& actual = book_for(pair.first);
+        EXPECT_EQ(expected.getBidLevels(), actual.getBidLevels());
+        EXPECT_EQ(expected.getAskLevels(), actual.getAskLevels());
+        EXPECT_EQ(expected.lastSequence(), actual.lastSequence());
+        EXPECT_EQ(expected.tradeSequence(), actual.tradeSequence());
+        // Same queues, in the same time priority
+        auto orders = [](const OrderBook& book) {
+            std::vector<std::tuple<OrderId, Quantity, Price, std::string>> out;
+            book.forEachOrder([&](const Order& o) {
+                out.emplace_back(o.id, o.quantity, o.price(), book.clientName(o.client));
+            });
+            return out;
+        };
+        EXPECT_EQ(orders(expected), orders(actual));
+    }
+    pruneState(dir, UINT64_MAX);
+}
+
+TEST(RecoveryTest, LongestSymbolsAndClientIdsRecoverExactly) {
+    std::string dir = ::testing::TempDir() + "recovery_names_test";
+    pruneState(dir, UINT64_MAX);
+    std::unordered_map<std::string, std::unique_ptr<OrderBook>> books;
+    auto book_for = [&](const std::string& symbol) -> OrderBook& {
+        auto& book = books[symbol];
+        if (!book) book = std::make_unique<OrderBook>(symbol);
+        return *book;
+    };
+    ASSERT_FALSE(recoverState(dir, book_for).snapshot_loaded);
+
+    // Two symbols at the limit that differ only in their last byte, and a
+    // client id at its limit
+    const std::string first(MAX_SYMBOL_LENGTH, 'S');
+    const std::string second = first.substr(0, MAX_SYMBOL_LENGTH - 1) + 'T';
+    const std::string client(MAX_CLIENT_ID_LENGTH, 'c');
+    {
+        CommandLog log(dir, 1, 1);
+        // Its records could only name a truncated symbol, so it is never logged
+        OrderBook too_long(std::string(33, 'S'));
+        EXPECT_THROW(too_long.setCommandLog(&log), std::invalid_argument);
+
+        book_for(first).setCommandLog(&log);
+        book_for(second).setCommandLog(&log);
+        book_for(first).addOrder(1, true, 10, 100, client);
+        uint64_t segment = log.rotate();
+        std::vector<BookImage> images;
+        for (const auto& pair : books) images.push_back(captureBook(*pair.second));
+        writeSnapshot(snapshotPath(dir, segment), images, 3);
+        book_for(second).addOrder(2, false, 20, 200, client);  // only in the command log
+        log.flush();
+        for (const auto& pair : books) pair.second->setCommandLog(nullptr);
+    }
+
+    books.clear();
+    RecoveryResult result = recoverState(dir, book_for);
+    EXPECT_TRUE(result.snapshot_loaded);
+    EXPECT_EQ(1u, result.commands_replayed);
+    ASSERT_EQ(2u, books.size());
+    auto only_order = [&](const std::string& symbol) {
+        std::vector<std::tuple<OrderId, Price, std::string>> out;
+        const OrderBook& book = book_for(symbol);
+        book.forEachOrder([&](const Order& o) { out.emplace_back(o.id, o.price(), book.clientName(o.client)); });
+        return out;
+    };
+    EXPECT_EQ((std::vector<std::tuple<OrderId, Price, std::string>>{{1, 100, client}}), only_order(first));
+    EXPECT_EQ((std::vector<std::tuple<OrderId, Price, std::string>>{{2, 200, client}}), only_order(second));
+    pruneState(dir, UINT64_MAX);
+}
+
+TEST(LoggerTest, FormatsOnTheBackgroundThreadAndSkipsDisabledLevels) {
+    std::FILE* out = std::tmpfile();
+    ASSERT_NE(nullptr, out);
+    Logger& logger = Logger::instance();
+    logger.setOutput(out);
+    LogLevel previous = Logger::level();
+    Logger::setLevel(LogLevel::INFO);
+
+    int evaluated = 0;
+    auto counted = [&]() { return ++evaluated; };
+    TF_LOG_DEBUG("suppressed {}", counted());
+    EXPECT_EQ(0, evaluated);
+
+    std::string symbol = "AAPL";
+    TF_LOG_INFO("Trade: {} {} @ {} between {} and {}", symbol, Quantity(5), Price(10000), OrderId(2), OrderId(1));
+    std::thread other([] { TF_LOG_WARN("from {} thread: {} {} {}", "another", 2.5, true, 'x'); });
+    other.join();
+    TF_LOG_ERROR("missing args {} {}", uint64_t(7));
+    // A small buffer wraps many times; whatever does not fit is dropped and
+    // counted, never torn
+    logger.setThreadBufferBytes(1024);
+    std::thread wrapper([] {
+        for (int i = 0; i < 5000; ++i) TF_LOG_INFO("wrap {} {}", i, std::string(i % 40, 'w'));
+    });
+    wrapper.join();
+    logger.flush();
+    logger.setThreadBufferBytes(256 * 1024);
+
+    logger.setOutput(stdout);
+    Logger::setLevel(previous);
+
+    std::string text;
+    std::rewind(out);
+    char chunk[256];
+    while (size_t n = std::fread(chunk, 1, sizeof(chunk), out)) text.append(chunk, n);
+    std::fclose(out);
+    EXPECT_EQ(std::string::npos, text.find("suppressed"));
+    EXPECT_NE(std::string::npos, text.find("INFO  Trade: AAPL 5 @ 10000 between 2 and 1\n"));
+    EXPECT_NE(std::string::npos, text.find("WARN  from another thread: 2.5 true x\n"));
+    EXPECT_NE(std::string::npos, text.find("ERROR missing args 7 {}\n"));
+    size_t wrapped = 0;
+    for (size_t pos = text.find("INFO  wrap "); pos != std::string::npos; pos = text.find("INFO  wrap ", pos + 1)) {
+        ++wrapped;
+    }
+    EXPECT_EQ(5000u, wrapped + logger.dropped());
+}
+
+TEST(LatencyHistogramTest, BucketsBoundErrorAndThreadsMerge) {
+    // Every value lands in a bucket that contains it and is at most 1/16 wide
+    for (uint64_t v : {0ull, 1ull, 15ull, 16ull, 17ull, 31ull, 32ull, 1000ull, 123456789ull, (1ull << 35) + 7}) {
+        size_t index = LatencyHistogram::bucketIndex(v);
+        EXPECT_LE(LatencyHistogram::bucketLowerBound(index), v);
+        EXPECT_GE(LatencyHistogram::bucketUpperBound(index), v);
+        EXPECT_LE(LatencyHistogram::bucketUpperBound(index) - LatencyHistogram::bucketLowerBound(index), v / 16);
+    }
+    EXPECT_EQ(LatencyHistogram::BUCKETS - 1, LatencyHistogram::bucketIndex(UINT64_MAX));
+
+    LatencyHistogram histogram;
+    const int threads = 4;
+    const uint64_t per_thread = 10000;
+    std::vector<std::thread> recorders;
+    for (int t = 0; t < threads; ++t) {
+        recorders.emplace_back([&] {
+            for (uint64_t v = 1; v <= per_thread; ++v) histogram.record(v * 100);
+        });
+    }
+    for (auto& recorder : recorders) recorder.join();
+    HistogramSnapshot snapshot = histogram.snapshot();
+    EXPECT_EQ(threads * per_thread, snapshot.count);
+    EXPECT_EQ(threads * 100 * per_thread * (per_thread + 1) / 2, snapshot.sum_ns);
+    uint64_t p50 = snapshot.quantile(0.5);
+    EXPECT_GE(p50, 500000u);
+    EXPECT_LE(p50, 500000u + 500000u / 16);
+
+    std::ostringstream out;
+    writePrometheusHistogram(out, "test_seconds", "stage=\"x\"", snapshot);
+    std::string text = out.str();
+    EXPECT_NE(std::string::npos, text.find("test_seconds_bucket{stage=\"x\",le=\"+Inf\"} 40000\n"));
+    // 100..900 ns; the bucket holding 1000 (992..1023) falls under the next edge
+    EXPECT_NE(std::string::npos, text.find("test_seconds_bucket{stage=\"x\",le=\"1e-06\"} 36\n"));
+    EXPECT_NE(std::string::npos, text.find("test_seconds_count{stage=\"x\"} 40000\n"));
+}
+
+TEST(LatencyHistogramTest, SequencerHandsBackQueueAndPublishStages) {
+    OrderBookConfig config;
+    config.locking = false;
+    OrderBook ob("TEST", MatchingMode::PRICE_TIME_PRIORITY, config);
+    // A slow subscriber: publishing each trade takes at least 2 ms
+    ob.setTradeCallback([](const Trade&) {
+        uint64_t until = monotonicNanos() + 2000000;
+        while (monotonicNanos() < until) {}
+    });
+    Sequencer sequencer(8);
+    const std::string client = "client";
+    setStageTiming(true);
+    sequencer.submit(ob, 1, false, 10, 10000, client);
+    threadStageTimes() = StageTimes();
+    sequencer.submit(ob, 2, true, 10, 10000, client);
+    StageTimes stages = threadStageTimes();
+    setStageTiming(false);
+    EXPECT_GE(stages.publish_ns, 2000000u);
+    EXPECT_LT(stages.lock_wait_ns, stages.publish_ns);
+
+    // Timing off: nothing is reported
+    threadStageTimes() = StageTimes();
+    sequencer.submit(ob, 3, false, 10, 10000, client);
+    sequencer.submit(ob, 4, true, 10, 10000, client);
+    EXPECT_EQ(0u, threadStageTimes().publish_ns);
+}
+
+TEST(MetricsRegistryTest, ThreadSlotsSumOnScrape) {
+    MetricsRegistry registry;
+    Counter requests = registry.counter("test_requests_total", "Requests");
+    Counter active = registry.gauge("test_active", "Active streams");
+    MetricFamily& outcomes = registry.family("test_outcomes_total", "Outcomes", MetricType::COUNTER, {"symbol", "outcome"});
+    EXPECT_EQ(&outcomes, &registry.family("test_outcomes_total", "Outcomes", MetricType::COUNTER, {"symbol", "outcome"}));
+    EXPECT_THROW(outcomes.labels({"AAPL"}), std::invalid_argument);
+
+    const int threads = 8;
+    const int per_thread = 10000;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            active.inc();
+            for (int i = 0; i < per_thread; ++i) {
+                requests.inc();
+                outcomes.labels({t % 2 ? "MSFT" : "AAPL", i % 4 ? "filled" : "rejected"}).inc();
+            }
+            if (t % 2) active.dec();
+        });
+    }
+    for (auto& worker : workers) worker.join();
+
+    EXPECT_EQ(threads * per_thread, requests.value());
+    EXPECT_EQ(threads / 2, active.value());
+    EXPECT_EQ(threads / 2 * per_thread / 4, outcomes.labels({"AAPL", "rejected"}).value());
+    std::ostringstream out;
+    registry.writePrometheus(out);
+    std::string text = out.str();
+    EXPECT_NE(std::string::npos, text.find("# TYPE test_requests_total counter\ntest_requests_total 80000\n"));
+    EXPECT_NE(std::string::npos, text.find("# TYPE test_active gauge\ntest_active 4\n"));
+    EXPECT_NE(std::string::npos, text.find("test_outcomes_total{symbol=\"MSFT\",outcome=\"filled\"} 30000\n"));
+
+    // Label values are escaped for the exposition format
+    registry.family("test_odd_total", "Odd labels", MetricType::COUNTER, {"symbol"}).labels({"A\"B\\"}).inc(2);
+    out.str("");
+    registry.writePrometheus(out);
+    EXPECT_NE(std::string::npos, out.str().find("test_odd_total{symbol=\"A\\\"B\\\\\"} 2\n"));
+    // The same escaping for series written by hand
+    EXPECT_EQ("A\\\"B\\\\\\n", escapeLabel("A\"B\\\n"));
+}
+
+TEST(MetricsRegistryTest, CappedLabelFoldsLaterValuesIntoOverflow) {
+    MetricsRegistry registry;
+    MetricFamily& submits = registry.family("test_submits_total", "Submits", MetricType::COUNTER, {"symbol", "outcome"});
+    submits.capLabel(0, 2);
+    for (const char* symbol : {"AAPL", "MSFT", "GOOG", "AMZN", "AAPL"}) {
+        submits.labels({symbol, "filled"}).inc();
+        submits.labels({symbol, "rejected"}).inc();
+    }
+    EXPECT_EQ(2, submits.labels({"AAPL", "filled"}).value());
+    EXPECT_EQ(1, submits.labels({"MSFT", "rejected"}).value());
+    // Past the cap the symbol is dropped but the other labels are kept
+    EXPECT_EQ(2, submits.labels({"other", "filled"}).value());
+    EXPECT_EQ(submits.labels({"GOOG", "rejected"}).value(), submits.labels({"other", "rejected"}).value());
+    EXPECT_TRUE(submits.hasOwnSeries("MSFT"));
+    EXPECT_FALSE(submits.hasOwnSeries("GOOG"));
+    EXPECT_FALSE(submits.hasOwnSeries("NFLX"));
+    MetricFamily& uncapped = registry.family("test_uncapped_total", "Uncapped", MetricType::COUNTER, {"symbol"});
+    EXPECT_TRUE(uncapped.hasOwnSeries("NFLX"));
+    std::ostringstream out;
+    registry.writePrometheus(out);
+    EXPECT_EQ(std::string::npos, out.str().find("GOOG"));
+    EXPECT_NE(std::string::npos, out.str().find("test_submits_total{symbol=\"other\",outcome=\"filled\"} 2\n"));
+}
+
+TEST(BroadcastRingTest, ReadersFollowLapAndNeverSeeTornMessages) {
+    BroadcastRing ring(8, 64);
+    std::string out;
+    EXPECT_EQ(BroadcastRing::ReadStatus::EMPTY, ring.read(1, out));
+    EXPECT_FALSE(ring.publish(65, [](char*) {}));
+    auto publishNumber = [&](uint64_t n) {
+        std::string text(8 + n % 50, static_cast<char>('a' + n % 26));
+        std::memcpy(text.data(), &n, sizeof(n));
+        ASSERT_TRUE(ring.publish(text.size(), [&](char* slot) { std::memcpy(slot, text.data(), text.size()); }));
+    };
+    for (uint64_t n = 1; n <= 20; ++n) publishNumber(n);
+    EXPECT_EQ(20u, ring.head());
+    EXPECT_EQ(13u, ring.oldest());
+    EXPECT_EQ(BroadcastRing::ReadStatus::LAPPED, ring.read(12, out));
+    ASSERT_EQ(BroadcastRing::ReadStatus::OK, ring.read(13, out));
+    uint64_t value = 0;
+    std::memcpy(&value, out.data(), sizeof(value));
+    EXPECT_EQ(13u, value);
+    EXPECT_EQ(8u + 13 % 50, out.size());
+
+    // Concurrent readers: every message they accept is whole, in order
+    std::atomic<bool> done{false};
+    std::atomic<uint64_t> delivered{0};
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; ++r) {
+        readers.emplace_back([&] {
+            uint64_t next = ring.head() + 1;
+            uint64_t last = 0;
+            std::string message;
+            while (!done.load() || next <= ring.head()) {
+                auto status = ring.read(next, message);
+                if (status == BroadcastRing::ReadStatus::EMPTY) continue;
+                if (status == BroadcastRing::ReadStatus::LAPPED) {
+                    next = ring.oldest();
+                    continue;
+                }
+                uint64_t n = 0;
+                std::memcpy(&n, message.data(), sizeof(n));
+                ASSERT_EQ(next, n);
+                ASSERT_GT(n, last);
+                ASSERT_EQ(8u + n % 50, message.size());
+                for (size_t i = sizeof(n); i < message.size(); ++i) ASSERT_EQ(static_cast<char>('a' + n % 26), message[i]);
+                last = n;
+                ++next;
+                delivered.fetch_add(1);
+            }
+        });
+    }
+    for (uint64_t n = 21; n <= 200000; ++n) publishNumber(n);
+    done = true;
+    for (auto& reader : readers) reader.join();
+    EXPECT_GT(delivered.load(), 0u);
+}
+
+}  // namespace
@@ -1,7 +1,13 @@
 #include <gtest/gtest.h>
 #include <nlohmann/json.hpp>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
+#include <memory>
+#include <random>
 #include "../../include/order_matching/OrderBook.hpp"
+#include "../../include/order_matching/ReplayJson.hpp"
+#include "../../include/order_matching/Workload.hpp"
 
 using json = nlohmann::json;
 using namespace tradeflow;
@@ -39,3 +45,151 @@ TEST(ReplayTest, SimpleReplayEndsEmpty) {
     EXPECT_TRUE(bids.empty());
     EXPECT_TRUE(asks.empty());
 }
+
+TEST(ReplayTest, BinaryReplayMatchesJsonReplay) {
+    string replay_path = string(TEST_SRCDIR) + "/tests/data/replays/simple_replay.json";
+    ifstream in(replay_path);
+    ASSERT_TRUE(in.good()) << "Could not open replay file: " << replay_path;
+    json j; in >> j;
+
+    string bin_path = testing::TempDir() + "simple_replay.bin";
+    {
+        ReplayWriter writer(bin_path);
+        EXPECT_EQ(convertJsonReplay(j, writer), j["events"].size());
+        writer.finish();
+    }
+    ReplayReader reader(bin_path);
+    EXPECT_EQ(reader.size(), j["events"].size() + 1);  // plus the SYMBOL event
+    EXPECT_EQ(replaySymbolName(reader.at(0)), "REPLAY");
+
+    ReplayStats stats = runReplay(bin_path);
+    EXPECT_EQ(stats.events, j["events"].size());
+    EXPECT_EQ(stats.books, 1u);
+    EXPECT_EQ(stats.trades, 2u);
+    EXPECT_EQ(stats.traded_quantity, 100u);
+    EXPECT_EQ(stats.resting_orders, 0u);
+    EXPECT_EQ(stats.rejected, 0u);
+    remove(bin_path.c_str());
+}
+
+// The runner's checksums must match a direct replay through OrderBook and
+// be stable across runs and book layouts.
+TEST(ReplayTest, BinaryReplayChecksumsAreDeterministic) {
+    string bin_path = testing::TempDir() + "random_replay.bin";
+    mt19937_64 rng(12345);
+    {
+        ReplayWriter writer(bin_path);
+        uint32_t symbols[2] = {writer.symbol("AAA"), writer.symbol("BBB")};
+        for (OrderId id = 1; id <= 20000; ++id) {
+            uint32_t symbol = symbols[rng() % 2];
+            bool is_buy = rng() % 2 == 0;
+            Price px = 1000 + static_cast<Price>(rng() % 20) - (is_buy ? 12 : 8);
+            Quantity qty = 1 + static_cast<Quantity>(rng() % 100);
+            switch (rng() % 6) {
+            case 0: writer.add(symbol, id, is_buy, qty, px); break;
+            case 1: writer.cancel(symbol, id - 1 - static_cast<OrderId>(rng() % 50)); break;
+            case 2: writer.modify(symbol, id - 1 - static_cast<OrderId>(rng() % 50), qty, px); break;
+            case 3: writer.submit(symbol, id, is_buy, qty, px, OrderType::IOC); break;
+            default: writer.submit(symbol, id, is_buy, qty, px); break;
+            }
+        }
+        writer.match(symbols[0]);
+        writer.finish();
+    }
+
+    // Reference: apply the same events directly
+    vector<unique_ptr<OrderBook>> books;
+    uint64_t trades = 0;
+    uint64_t resting = 0;
+    ReplayReader reader(bin_path);
+    ReplayEvent event;
+    while (reader.next(event)) {
+        if (event.kind == ReplayEventKind::SYMBOL) {
+            books.push_back(make_unique<OrderBook>(replaySymbolName(event)));
+            books.back()->setTradeCallback([&trades](const Trade&) { ++trades; });
+            continue;
+        }
+        OrderBook& book = *books[event.symbol];
+        switch (event.kind) {
+        case ReplayEventKind::ADD: book.addOrder(event.order_id, event.is_buy, event.quantity, event.price, "replay"); break;
+        case ReplayEventKind::SUBMIT:
+            book.submitOrder(event.order_id, event.is_buy, event.quantity, event.price, "replay",
+                             static_cast<OrderType>(event.order_type));
+            break;
+        case ReplayEventKind::CANCEL: book.cancelOrder(event.order_id); break;
+        case ReplayEventKind::MODIFY: book.modifyOrder(event.order_id, event.quantity, event.price); break;
+        case ReplayEventKind::MATCH: book.triggerMatching(); break;
+        default: FAIL() << "unexpected event kind";
+        }
+    }
+    for (auto& book : books) book->forEachOrder([&resting](const Order&) { ++resting; });
+
+    ReplayStats first = runReplay(bin_path);
+    EXPECT_EQ(first.events, 20001u);
+    EXPECT_EQ(first.books, 2u);
+    EXPECT_EQ(first.trades, trades);
+    EXPECT_EQ(first.resting_orders, resting);
+    EXPECT_GT(first.trades, 0u);
+
+    OrderBookConfig ladder;
+    ladder.layout = BookLayout::TICK_LADDER;
+    ReplayStats second = runReplay(bin_path, MatchingMode::PRICE_TIME_PRIORITY, ladder);
+    EXPECT_EQ(second.trade_checksum, first.trade_checksum);
+    EXPECT_EQ(second.book_checksum, first.book_checksum);
+    EXPECT_EQ(second.rejected, first.rejected);
+    remove(bin_path.c_str());
+}
+
+TEST(ReplayTest, WorkloadGeneratorIsSeededAndFollowsTheMix) {
+    WorkloadConfig config;
+    config.events = 50000;
+    config.symbols = 8;
+    string first_path = testing::TempDir() + "workload_a.bin";
+    string second_path = testing::TempDir() + "workload_b.bin";
+    WorkloadSummary summary;
+    {
+        ReplayWriter writer(first_path);
+        summary = generateWorkload(config, writer);
+        writer.finish();
+    }
+    {
+        ReplayWriter writer(second_path);
+        generateWorkload(config, writer);
+        writer.finish();
+    }
+    ReplayReader first(first_path);
+    ReplayReader second(second_path);
+    ASSERT_EQ(first.size(), summary.events + config.symbols);
+    ASSERT_EQ(second.size(), first.size());
+    for (size_t i = 0; i < first.size(); ++i) {
+        ReplayEvent a = first.at(i);
+        ReplayEvent b = second.at(i);
+        ASSERT_EQ(memcmp(&a, &b, sizeof(ReplayEvent)), 0) << "event " << i;
+    }
+
+    EXPECT_EQ(summary.adds, uint64_t(config.symbols) * config.initial_levels * 2 * config.orders_per_level);
+    EXPECT_NEAR(double(summary.cancels) / config.events, config.cancel_ratio, 0.02);
+    EXPECT_NEAR(double(summary.modifies) / config.events, config.modify_ratio, 0.02);
+    EXPECT_NEAR(double(summary.aggressive) / config.events, config.aggressor_ratio, 0.02);
+
+    // Zipf: the first symbol is the busiest
+    vector<uint64_t> per_symbol(config.symbols);
+    for (size_t i = 0; i < first.size(); ++i) {
+        ReplayEvent event = first.at(i);
+        if (event.kind != ReplayEventKind::SYMBOL) ++per_symbol[event.symbol];
+    }
+    EXPECT_GT(per_symbol[0], per_symbol[config.symbols - 1] * 3);
+
+    ReplayStats stats = runReplay(first_path);
+    EXPECT_EQ(stats.events, summary.events);
+    EXPECT_GT(stats.trades, 0u);
+    EXPECT_GT(stats.resting_orders, 0u);
+
+    config.seed = 2;
+    ReplayWriter writer(second_path);
+    generateWorkload(config, writer);
+    writer.finish();
+    EXPECT_NE(runReplay(second_path).trade_checksum, stats.trade_checksum);
+    remove(first_path.c_str());
+    remove(second_path.c_str());
+}